@@ -76,6 +76,7 @@ extern uint32_t SystemCoreClock;
 #define configUSE_RECURSIVE_MUTEXES                         1
 #define configUSE_QUEUE_SETS                                0
 #define configUSE_TASK_NOTIFICATIONS                        1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES               3
 #define configUSE_TRACE_FACILITY                            1
 
 /* Constants that define which hook (callback) functions should be used. */
@@ -59,6 +59,25 @@ static HTTPStatus_t sendHttpData( const TransportInterface_t * pTransport,
                                   const uint8_t * pData,
                                   size_t dataLen );
 
+/**
+ * @brief Send several buffers of HTTP request data over the transport writev
+ * interface.
+ *
+ * @param[in] pTransport Transport interface.
+ * @param[in] getTimestampMs Function to retrieve a timestamp in milliseconds.
+ * @param[in] pIoVec Segments of HTTP request data to send; modified as bytes
+ * are sent.
+ * @param[in] ioVecCount Number of segments.
+ *
+ * @return #HTTPSuccess if successful. If there was a network error or less
+ * bytes than what were specified were sent, then #HTTPNetworkError is
+ * returned.
+ */
+static HTTPStatus_t sendHttpDataVector( const TransportInterface_t * pTransport,
+                                        HTTPClient_GetCurrentTimeFunc_t getTimestampMs,
+                                        TransportOutVector_t * pIoVec,
+                                        size_t ioVecCount );
+
 /**
  * @brief Send the HTTP headers over the transport send interface.
  *
@@ -66,6 +85,8 @@ static HTTPStatus_t sendHttpData( const TransportInterface_t * pTransport,
  * @param[in] getTimestampMs Function to retrieve a timestamp in milliseconds.
  * @param[in] pRequestHeaders Request headers to send, it includes the buffer
  * and length.
+ * @param[in] pRequestBodyBuf Request body sent together with the headers when
+ * the transport provides writev, otherwise NULL.
  * @param[in] reqBodyLen The length of the request body to be sent. This is
  * used to generated a Content-Length header.
  * @param[in] sendFlags Application provided flags to #HTTPClient_Send.
@@ -77,6 +98,7 @@ static HTTPStatus_t sendHttpData( const TransportInterface_t * pTransport,
 static HTTPStatus_t sendHttpHeaders( const TransportInterface_t * pTransport,
                                      HTTPClient_GetCurrentTimeFunc_t getTimestampMs,
                                      HTTPRequestHeaders_t * pRequestHeaders,
+                                     const uint8_t * pRequestBodyBuf,
                                      size_t reqBodyLen,
                                      uint32_t sendFlags );
 
@@ -1856,6 +1878,101 @@ static HTTPStatus_t sendHttpData( const TransportInterface_t * pTransport,
 
 /*-----------------------------------------------------------*/
 
+static HTTPStatus_t sendHttpDataVector( const TransportInterface_t * pTransport,
+                                        HTTPClient_GetCurrentTimeFunc_t getTimestampMs,
+                                        TransportOutVector_t * pIoVec,
+                                        size_t ioVecCount )
+{
+    HTTPStatus_t returnStatus = HTTPSuccess;
+    TransportOutVector_t * pIoVectIterator = pIoVec;
+    size_t vectorsToBeSent = ioVecCount;
+    int32_t bytesSent = 0;
+    size_t bytesRemaining = 0UL, index = 0UL;
+    uint32_t lastSendTimeMs = 0U, timeSinceLastSendMs = 0U;
+    uint32_t retryTimeoutMs = HTTP_SEND_RETRY_TIMEOUT_MS;
+
+    assert( pTransport != NULL );
+    assert( pTransport->writev != NULL );
+    assert( pIoVec != NULL );
+
+    for( index = 0UL; index < ioVecCount; index++ )
+    {
+        bytesRemaining += pIoVec[ index ].iov_len;
+    }
+
+    /* If the timestamp function was undefined by the application, then do not
+     * retry the transport send. */
+    if( getTimestampMs == getZeroTimestampMs )
+    {
+        retryTimeoutMs = 0U;
+    }
+
+    /* Initialize the last send time to allow retries, if 0 bytes are sent on
+     * the first try. */
+    lastSendTimeMs = getTimestampMs();
+
+    /* Loop until all segments are sent. */
+    while( ( bytesRemaining > 0UL ) && ( returnStatus != HTTPNetworkError ) )
+    {
+        bytesSent = pTransport->writev( pTransport->pNetworkContext,
+                                        pIoVectIterator,
+                                        vectorsToBeSent );
+
+        /* BytesSent less than zero is an error. */
+        if( bytesSent < 0 )
+        {
+            LogError( ( "Failed to send data: Transport writev error: "
+                        "TransportStatus=%ld", ( long int ) bytesSent ) );
+            returnStatus = HTTPNetworkError;
+        }
+        else if( bytesSent > 0 )
+        {
+            assert( ( size_t ) bytesSent <= bytesRemaining );
+
+            /* Record the most recent time of successful transmission. */
+            lastSendTimeMs = getTimestampMs();
+
+            bytesRemaining -= ( size_t ) bytesSent;
+            LogDebug( ( "Sent data over the transport: "
+                        "BytesSent=%ld, BytesRemaining=%lu",
+                        ( long int ) bytesSent,
+                        ( unsigned long ) bytesRemaining ) );
+
+            /* Skip the segments that were sent completely. */
+            while( ( vectorsToBeSent > 0UL ) && ( ( size_t ) bytesSent >= pIoVectIterator->iov_len ) )
+            {
+                bytesSent -= ( int32_t ) pIoVectIterator->iov_len;
+                pIoVectIterator++;
+                vectorsToBeSent--;
+            }
+
+            /* Advance into the segment that was sent partially. */
+            if( ( vectorsToBeSent > 0UL ) && ( bytesSent > 0 ) )
+            {
+                pIoVectIterator->iov_base = &( ( ( const uint8_t * ) pIoVectIterator->iov_base )[ bytesSent ] );
+                pIoVectIterator->iov_len -= ( size_t ) bytesSent;
+            }
+        }
+        else
+        {
+            /* No bytes were sent over the network. */
+            timeSinceLastSendMs = getTimestampMs() - lastSendTimeMs;
+
+            /* Check for timeout if we have been waiting to send any data over
+             * the network. */
+            if( timeSinceLastSendMs >= retryTimeoutMs )
+            {
+                LogError( ( "Unable to send packet: Timed out in transport writev." ) );
+                returnStatus = HTTPNetworkError;
+            }
+        }
+    }
+
+    return returnStatus;
+}
+
+/*-----------------------------------------------------------*/
+
 static HTTPStatus_t addContentLengthHeader( HTTPRequestHeaders_t * pRequestHeaders,
                                             size_t contentLength )
 {
@@ -1891,11 +2008,13 @@ static HTTPStatus_t addContentLengthHeader( HTTPRequestHeaders_t * pRequestHeade
 static HTTPStatus_t sendHttpHeaders( const TransportInterface_t * pTransport,
                                      HTTPClient_GetCurrentTimeFunc_t getTimestampMs,
                                      HTTPRequestHeaders_t * pRequestHeaders,
+                                     const uint8_t * pRequestBodyBuf,
                                      size_t reqBodyLen,
                                      uint32_t sendFlags )
 {
     HTTPStatus_t returnStatus = HTTPSuccess;
     uint8_t shouldSendContentLength = 0U;
+    TransportOutVector_t pIoVector[ 2 ];
 
     assert( pTransport != NULL );
     assert( pTransport->send != NULL );
@@ -1911,7 +2030,25 @@ static HTTPStatus_t sendHttpHeaders( const TransportInterface_t * pTransport,
         returnStatus = addContentLengthHeader( pRequestHeaders, reqBodyLen );
     }
 
-    if( returnStatus == HTTPSuccess )
+    if( ( returnStatus == HTTPSuccess ) && ( pRequestBodyBuf != NULL ) )
+    {
+        assert( pTransport->writev != NULL );
+
+        /* Send the headers and the body, which are at different locations in
+         * memory, in one transport call. */
+        LogDebug( ( "Sending HTTP request headers and body: HeaderBytes=%lu, BodyBytes=%lu",
+                    ( unsigned long ) ( pRequestHeaders->headersLen ),
+                    ( unsigned long ) reqBodyLen ) );
+        pIoVector[ 0 ].iov_base = pRequestHeaders->pBuffer;
+        pIoVector[ 0 ].iov_len = pRequestHeaders->headersLen;
+        pIoVector[ 1 ].iov_base = pRequestBodyBuf;
+        pIoVector[ 1 ].iov_len = reqBodyLen;
+        returnStatus = sendHttpDataVector( pTransport,
+                                           getTimestampMs,
+                                           pIoVector,
+                                           2UL );
+    }
+    else if( returnStatus == HTTPSuccess )
     {
         LogDebug( ( "Sending HTTP request headers: HeaderBytes=%lu",
                     ( unsigned long ) ( pRequestHeaders->headersLen ) ) );
@@ -1920,6 +2057,10 @@ static HTTPStatus_t sendHttpHeaders( const TransportInterface_t * pTransport,
                                      pRequestHeaders->pBuffer,
                                      pRequestHeaders->headersLen );
     }
+    else
+    {
+        /* Empty else MISRA 15.7 */
+    }
 
     return returnStatus;
 }
@@ -2116,6 +2257,7 @@ static HTTPStatus_t sendHttpRequest( const TransportInterface_t * pTransport,
                                      uint32_t sendFlags )
 {
     HTTPStatus_t returnStatus = HTTPSuccess;
+    uint8_t sendBodyWithHeaders = 0U;
 
     assert( pTransport != NULL );
     assert( pRequestHeaders != NULL );
@@ -2123,15 +2265,20 @@ static HTTPStatus_t sendHttpRequest( const TransportInterface_t * pTransport,
             ( ( pRequestBodyBuf == NULL ) && ( reqBodyBufLen == 0 ) ) );
     assert( getTimestampMs != NULL );
 
+    /* With a vectored send the body goes out in the same transport call as
+     * the headers. */
+    sendBodyWithHeaders = ( ( pTransport->writev != NULL ) && ( pRequestBodyBuf != NULL ) ) ? 1U : 0U;
+
     /* Send the headers, which are at one location in memory. */
     returnStatus = sendHttpHeaders( pTransport,
                                     getTimestampMs,
                                     pRequestHeaders,
+                                    ( sendBodyWithHeaders == 1U ) ? pRequestBodyBuf : NULL,
                                     reqBodyBufLen,
                                     sendFlags );
 
     /* Send the body, which is at another location in memory. */
-    if( returnStatus == HTTPSuccess )
+    if( ( returnStatus == HTTPSuccess ) && ( sendBodyWithHeaders == 0U ) )
     {
         if( pRequestBodyBuf != NULL )
         {
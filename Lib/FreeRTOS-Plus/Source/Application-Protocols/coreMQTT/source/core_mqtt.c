@@ -54,6 +54,22 @@ static int32_t sendPacket( MQTTContext_t * pContext,
                            const uint8_t * pBufferToSend,
                            size_t bytesToSend );
 
+/**
+ * @brief Sends several buffers as one packet using the transport writev function.
+ *
+ * @brief param[in] pContext Initialized MQTT context.
+ * @brief param[in] pIoVec Segments to be sent; modified as bytes are sent.
+ * @brief param[in] ioVecCount Number of segments.
+ *
+ * @note Same retry and timeout behavior as #sendPacket. Requires
+ * #TransportInterface_t.writev to be set.
+ *
+ * @return Total number of bytes sent, or negative value on network error.
+ */
+static int32_t sendMessageVector( MQTTContext_t * pContext,
+                                  TransportOutVector_t * pIoVec,
+                                  size_t ioVecCount );
+
 /**
  * @brief Calculate the interval between two millisecond timestamps, including
  * when the later value has overflowed.
@@ -671,6 +687,99 @@ static int32_t sendPacket( MQTTContext_t * pContext,
 
 /*-----------------------------------------------------------*/
 
+static int32_t sendMessageVector( MQTTContext_t * pContext,
+                                  TransportOutVector_t * pIoVec,
+                                  size_t ioVecCount )
+{
+    TransportOutVector_t * pIoVectIterator = pIoVec;
+    size_t vectorsToBeSent = ioVecCount;
+    size_t bytesRemaining = 0UL, index = 0UL;
+    int32_t totalBytesSent = 0, bytesSent;
+    uint32_t lastSendTimeMs = 0U, timeSinceLastSendMs = 0U;
+    bool sendError = false;
+
+    assert( pContext != NULL );
+    assert( pContext->getTime != NULL );
+    assert( pContext->transportInterface.writev != NULL );
+    assert( pIoVec != NULL );
+
+    for( index = 0UL; index < ioVecCount; index++ )
+    {
+        bytesRemaining += pIoVec[ index ].iov_len;
+    }
+
+    /* Record the most recent time of successful transmission. */
+    lastSendTimeMs = pContext->getTime();
+
+    /* Loop until all segments are sent. */
+    while( ( bytesRemaining > 0UL ) && ( sendError == false ) )
+    {
+        bytesSent = pContext->transportInterface.writev( pContext->transportInterface.pNetworkContext,
+                                                         pIoVectIterator,
+                                                         vectorsToBeSent );
+
+        if( bytesSent < 0 )
+        {
+            LogError( ( "Transport writev failed. Error code=%ld.", ( long int ) bytesSent ) );
+            totalBytesSent = bytesSent;
+            sendError = true;
+        }
+        else if( bytesSent > 0 )
+        {
+            /* Record the most recent time of successful transmission. */
+            lastSendTimeMs = pContext->getTime();
+
+            assert( ( size_t ) bytesSent <= bytesRemaining );
+
+            bytesRemaining -= ( size_t ) bytesSent;
+            totalBytesSent += bytesSent;
+
+            /* Skip the segments that were sent completely. */
+            while( ( vectorsToBeSent > 0UL ) && ( ( size_t ) bytesSent >= pIoVectIterator->iov_len ) )
+            {
+                bytesSent -= ( int32_t ) pIoVectIterator->iov_len;
+                pIoVectIterator++;
+                vectorsToBeSent--;
+            }
+
+            /* Advance into the segment that was sent partially. */
+            if( ( vectorsToBeSent > 0UL ) && ( bytesSent > 0 ) )
+            {
+                pIoVectIterator->iov_base = &( ( ( const uint8_t * ) pIoVectIterator->iov_base )[ bytesSent ] );
+                pIoVectIterator->iov_len -= ( size_t ) bytesSent;
+            }
+
+            LogDebug( ( "BytesSent=%ld, BytesRemaining=%lu",
+                        ( long int ) totalBytesSent,
+                        ( unsigned long ) bytesRemaining ) );
+        }
+        else
+        {
+            /* No bytes were sent over the network. */
+            timeSinceLastSendMs = calculateElapsedTime( pContext->getTime(), lastSendTimeMs );
+
+            /* Check for timeout if we have been waiting to send any data over the network. */
+            if( timeSinceLastSendMs >= MQTT_SEND_RETRY_TIMEOUT_MS )
+            {
+                LogError( ( "Unable to send packet: Timed out in transport writev." ) );
+                sendError = true;
+            }
+        }
+    }
+
+    /* Update time of last transmission if the entire packet is successfully sent. */
+    if( totalBytesSent > 0 )
+    {
+        pContext->lastPacketTime = lastSendTimeMs;
+        LogDebug( ( "Successfully sent packet at time %lu.",
+                    ( unsigned long ) lastSendTimeMs ) );
+    }
+
+    return totalBytesSent;
+}
+
+/*-----------------------------------------------------------*/
+
 static uint32_t calculateElapsedTime( uint32_t later,
                                       uint32_t start )
 {
@@ -1406,6 +1515,8 @@ static MQTTStatus_t sendPublish( MQTTContext_t * pContext,
 {
     MQTTStatus_t status = MQTTSuccess;
     int32_t bytesSent = 0;
+    TransportOutVector_t pIoVector[ 2 ];
+    size_t ioVectorLength = 1UL;
 
     assert( pContext != NULL );
     assert( pPublishInfo != NULL );
@@ -1413,44 +1524,73 @@ static MQTTStatus_t sendPublish( MQTTContext_t * pContext,
     assert( pContext->networkBuffer.pBuffer != NULL );
     assert( !( pPublishInfo->payloadLength > 0 ) || ( pPublishInfo->pPayload != NULL ) );
 
-    /* Send header first. */
-    bytesSent = sendPacket( pContext,
-                            pContext->networkBuffer.pBuffer,
-                            headerSize );
-
-    if( bytesSent < ( int32_t ) headerSize )
+    if( pContext->transportInterface.writev != NULL )
     {
-        LogError( ( "Transport send failed for PUBLISH header." ) );
-        status = MQTTSendFailed;
+        /* Send header and payload in one transport call. */
+        pIoVector[ 0 ].iov_base = pContext->networkBuffer.pBuffer;
+        pIoVector[ 0 ].iov_len = headerSize;
+
+        if( pPublishInfo->payloadLength > 0U )
+        {
+            pIoVector[ 1 ].iov_base = pPublishInfo->pPayload;
+            pIoVector[ 1 ].iov_len = pPublishInfo->payloadLength;
+            ioVectorLength = 2UL;
+        }
+
+        bytesSent = sendMessageVector( pContext, pIoVector, ioVectorLength );
+
+        if( bytesSent < ( int32_t ) ( headerSize + pPublishInfo->payloadLength ) )
+        {
+            LogError( ( "Transport writev failed for PUBLISH packet." ) );
+            status = MQTTSendFailed;
+        }
+        else
+        {
+            LogDebug( ( "Sent %ld bytes of PUBLISH packet.",
+                        ( long int ) bytesSent ) );
+        }
     }
     else
     {
-        LogDebug( ( "Sent %ld bytes of PUBLISH header.",
-                    ( long int ) bytesSent ) );
+        /* Send header first. */
+        bytesSent = sendPacket( pContext,
+                                pContext->networkBuffer.pBuffer,
+                                headerSize );
 
-        /* Send Payload if there is one to send. It is valid for a PUBLISH
-         * Packet to contain a zero length payload.*/
-        if( pPublishInfo->payloadLength > 0U )
+        if( bytesSent < ( int32_t ) headerSize )
         {
-            bytesSent = sendPacket( pContext,
-                                    pPublishInfo->pPayload,
-                                    pPublishInfo->payloadLength );
+            LogError( ( "Transport send failed for PUBLISH header." ) );
+            status = MQTTSendFailed;
+        }
+        else
+        {
+            LogDebug( ( "Sent %ld bytes of PUBLISH header.",
+                        ( long int ) bytesSent ) );
 
-            if( bytesSent < ( int32_t ) pPublishInfo->payloadLength )
+            /* Send Payload if there is one to send. It is valid for a PUBLISH
+             * Packet to contain a zero length payload.*/
+            if( pPublishInfo->payloadLength > 0U )
             {
-                LogError( ( "Transport send failed for PUBLISH payload." ) );
-                status = MQTTSendFailed;
+                bytesSent = sendPacket( pContext,
+                                        pPublishInfo->pPayload,
+                                        pPublishInfo->payloadLength );
+
+                if( bytesSent < ( int32_t ) pPublishInfo->payloadLength )
+                {
+                    LogError( ( "Transport send failed for PUBLISH payload." ) );
+                    status = MQTTSendFailed;
+                }
+                else
+                {
+                    LogDebug( ( "Sent %ld bytes of PUBLISH payload.",
+                                ( long int ) bytesSent ) );
+                }
             }
             else
             {
-                LogDebug( ( "Sent %ld bytes of PUBLISH payload.",
-                            ( long int ) bytesSent ) );
+                LogDebug( ( "PUBLISH payload was not sent. Payload length was zero." ) );
             }
         }
-        else
-        {
-            LogDebug( ( "PUBLISH payload was not sent. Payload length was zero." ) );
-        }
     }
 
     return status;
@@ -1609,10 +1749,10 @@ static MQTTStatus_t handleSessionResumption( MQTTContext_t * pContext,
     else
     {
         /* Clear any existing records if a new session is established. */
-        ( void ) memset( pContext->outgoingPublishRecords,
+        ( void ) memset( &( pContext->outgoingPublishRecords ),
                          0x00,
                          sizeof( pContext->outgoingPublishRecords ) );
-        ( void ) memset( pContext->incomingPublishRecords,
+        ( void ) memset( &( pContext->incomingPublishRecords ),
                          0x00,
                          sizeof( pContext->incomingPublishRecords ) );
     }
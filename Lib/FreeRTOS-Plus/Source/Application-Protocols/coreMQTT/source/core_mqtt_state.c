@@ -53,6 +53,48 @@
  */
 #define UINT16_CHECK_BIT( x, position )         ( ( ( x ) & ( UINT16_BITMAP_BIT_SET_AT( position ) ) ) == ( UINT16_BITMAP_BIT_SET_AT( position ) ) )
 
+#if ( MQTT_STATE_INDEXED == 1 )
+
+    #if ( MQTT_STATE_ARRAY_MAX_COUNT > 255U )
+        #error "MQTT_STATE_ARRAY_MAX_COUNT must not exceed 255 with MQTT_STATE_INDEXED."
+    #endif
+
+    #if ( MQTT_STATE_INDEX_SIZE <= MQTT_STATE_ARRAY_MAX_COUNT )
+        #error "MQTT_STATE_INDEX_SIZE must be larger than MQTT_STATE_ARRAY_MAX_COUNT."
+    #endif
+
+/**
+ * @brief Type of a set of state records passed to the record functions.
+ */
+    typedef MQTTStateTable_t   MQTTStateRecords_t;
+
+/**
+ * @brief Get the outgoing state records of a context.
+ */
+    #define OUTGOING_RECORDS( pContext )    ( &( ( pContext )->outgoingPublishRecords ) )
+
+/**
+ * @brief Get the incoming state records of a context.
+ */
+    #define INCOMING_RECORDS( pContext )    ( &( ( pContext )->incomingPublishRecords ) )
+#else
+
+/**
+ * @brief Type of a set of state records passed to the record functions.
+ */
+    typedef MQTTPubAckInfo_t   MQTTStateRecords_t;
+
+/**
+ * @brief Get the outgoing state records of a context.
+ */
+    #define OUTGOING_RECORDS( pContext )    ( ( pContext )->outgoingPublishRecords )
+
+/**
+ * @brief Get the incoming state records of a context.
+ */
+    #define INCOMING_RECORDS( pContext )    ( ( pContext )->incomingPublishRecords )
+#endif /* if ( MQTT_STATE_INDEXED == 1 ) */
+
 /*-----------------------------------------------------------*/
 
 /**
@@ -108,12 +150,37 @@ static bool isPublishOutgoing( MQTTPubAckType_t packetType,
  *
  * @return index of the packet id in the record if it exists, else the record length.
  */
-static size_t findInRecord( const MQTTPubAckInfo_t * records,
+static size_t findInRecord( const MQTTStateRecords_t * records,
                             size_t recordCount,
                             uint16_t packetId,
                             MQTTQoS_t * pQos,
                             MQTTPublishState_t * pCurrentState );
 
+#if ( MQTT_STATE_INDEXED == 1 )
+
+/**
+ * @brief Find the index slot of a packet ID.
+ *
+ * @param[in] pTable State records.
+ * @param[in] packetId packet ID to search for.
+ *
+ * @return Index slot holding the packet ID, or the empty slot that ends its
+ * probe sequence if the packet ID is not in the records.
+ */
+    static size_t findIndexSlot( const MQTTStateTable_t * pTable,
+                                 uint16_t packetId );
+
+/**
+ * @brief Remove a packet ID from the index, closing the gap in its probe
+ * sequence.
+ *
+ * @param[in] pTable State records.
+ * @param[in] packetId packet ID to remove; must be in the index.
+ */
+    static void removeFromIndex( MQTTStateTable_t * pTable,
+                                 uint16_t packetId );
+#else
+
 /**
  * @brief Compact records.
  *
@@ -124,8 +191,9 @@ static size_t findInRecord( const MQTTPubAckInfo_t * records,
  * @param[in] records State record array.
  * @param[in] recordCount Length of record array.
  */
-static void compactRecords( MQTTPubAckInfo_t * records,
-                            size_t recordCount );
+    static void compactRecords( MQTTPubAckInfo_t * records,
+                                size_t recordCount );
+#endif /* if ( MQTT_STATE_INDEXED == 1 ) */
 
 /**
  * @brief Store a new entry in the state record.
@@ -138,7 +206,7 @@ static void compactRecords( MQTTPubAckInfo_t * records,
  *
  * @return #MQTTSuccess, #MQTTNoMemory, or #MQTTStateCollision.
  */
-static MQTTStatus_t addRecord( MQTTPubAckInfo_t * records,
+static MQTTStatus_t addRecord( MQTTStateRecords_t * records,
                                size_t recordCount,
                                uint16_t packetId,
                                MQTTQoS_t qos,
@@ -152,7 +220,7 @@ static MQTTStatus_t addRecord( MQTTPubAckInfo_t * records,
  * @param[in] newState New state to update.
  * @param[in] shouldDelete Whether an existing entry should be deleted.
  */
-static void updateRecord( MQTTPubAckInfo_t * records,
+static void updateRecord( MQTTStateRecords_t * records,
                           size_t recordIndex,
                           MQTTPublishState_t newState,
                           bool shouldDelete );
@@ -183,7 +251,7 @@ static uint16_t stateSelect( const MQTTContext_t * pMqttContext,
  *
  * @return #MQTTIllegalState, or #MQTTSuccess.
  */
-static MQTTStatus_t updateStateAck( MQTTPubAckInfo_t * records,
+static MQTTStatus_t updateStateAck( MQTTStateRecords_t * records,
                                     size_t recordIndex,
                                     uint16_t packetId,
                                     MQTTPublishState_t currentState,
@@ -425,203 +493,440 @@ static bool isPublishOutgoing( MQTTPubAckType_t packetType,
 
 /*-----------------------------------------------------------*/
 
-static size_t findInRecord( const MQTTPubAckInfo_t * records,
-                            size_t recordCount,
-                            uint16_t packetId,
-                            MQTTQoS_t * pQos,
-                            MQTTPublishState_t * pCurrentState )
-{
-    size_t index = 0;
+#if ( MQTT_STATE_INDEXED == 1 )
 
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-
-    *pCurrentState = MQTTStateNull;
-
-    for( index = 0; index < recordCount; index++ )
+    static size_t findIndexSlot( const MQTTStateTable_t * pTable,
+                                 uint16_t packetId )
     {
-        if( records[ index ].packetId == packetId )
+        size_t slot = ( size_t ) packetId % MQTT_STATE_INDEX_SIZE;
+
+        /* The index always has an empty slot, as it is larger than the number
+         * of records. */
+        while( ( pTable->index[ slot ] != 0U ) &&
+               ( pTable->records[ pTable->index[ slot ] - 1U ].packetId != packetId ) )
         {
-            *pQos = records[ index ].qos;
-            *pCurrentState = records[ index ].publishState;
-            break;
+            slot = ( slot + 1U ) % MQTT_STATE_INDEX_SIZE;
         }
-    }
 
-    return index;
-}
+        return slot;
+    }
 
 /*-----------------------------------------------------------*/
 
-static void compactRecords( MQTTPubAckInfo_t * records,
-                            size_t recordCount )
-{
-    size_t index = 0;
-    size_t emptyIndex = MQTT_STATE_ARRAY_MAX_COUNT;
+    static void removeFromIndex( MQTTStateTable_t * pTable,
+                                 uint16_t packetId )
+    {
+        size_t hole = findIndexSlot( pTable, packetId );
+        size_t next = ( hole + 1U ) % MQTT_STATE_INDEX_SIZE;
+        size_t home = 0U;
+        bool homeBetween = false;
 
-    assert( records != NULL );
+        assert( pTable->index[ hole ] != 0U );
 
-    /* Find the empty spots and fill those with non empty values. */
-    for( ; index < recordCount; index++ )
-    {
-        /* Find the first empty spot. */
-        if( records[ index ].packetId == MQTT_PACKET_ID_INVALID )
+        pTable->index[ hole ] = 0U;
+
+        /* Shift back entries of the probe sequence that would no longer be
+         * reachable from their home slot. */
+        while( pTable->index[ next ] != 0U )
         {
-            if( emptyIndex == MQTT_STATE_ARRAY_MAX_COUNT )
+            home = ( size_t ) pTable->records[ pTable->index[ next ] - 1U ].packetId % MQTT_STATE_INDEX_SIZE;
+
+            /* The entry stays if its home slot lies cyclically in ( hole, next ]. */
+            if( hole <= next )
             {
-                emptyIndex = index;
+                homeBetween = ( ( hole < home ) && ( home <= next ) ) ? true : false;
             }
-        }
-        else
-        {
-            if( emptyIndex != MQTT_STATE_ARRAY_MAX_COUNT )
+            else
             {
-                /* Copy over the contents at non empty index to empty index. */
-                records[ emptyIndex ].packetId = records[ index ].packetId;
-                records[ emptyIndex ].qos = records[ index ].qos;
-                records[ emptyIndex ].publishState = records[ index ].publishState;
-
-                /* Mark the record at current non empty index as invalid. */
-                records[ index ].packetId = MQTT_PACKET_ID_INVALID;
+                homeBetween = ( ( hole < home ) || ( home <= next ) ) ? true : false;
+            }
 
-                /* Advance the emptyIndex. */
-                emptyIndex++;
+            if( homeBetween == false )
+            {
+                pTable->index[ hole ] = pTable->index[ next ];
+                pTable->index[ next ] = 0U;
+                hole = next;
             }
+
+            next = ( next + 1U ) % MQTT_STATE_INDEX_SIZE;
         }
     }
-}
 
 /*-----------------------------------------------------------*/
 
-static MQTTStatus_t addRecord( MQTTPubAckInfo_t * records,
-                               size_t recordCount,
-                               uint16_t packetId,
-                               MQTTQoS_t qos,
-                               MQTTPublishState_t publishState )
-{
-    MQTTStatus_t status = MQTTNoMemory;
-    int32_t index = 0;
-    size_t availableIndex = recordCount;
-    bool validEntryFound = false;
+    static size_t findInRecord( const MQTTStateRecords_t * records,
+                                size_t recordCount,
+                                uint16_t packetId,
+                                MQTTQoS_t * pQos,
+                                MQTTPublishState_t * pCurrentState )
+    {
+        size_t index = recordCount;
+        size_t slot = 0U;
 
-    assert( packetId != MQTT_PACKET_ID_INVALID );
-    assert( qos != MQTTQoS0 );
+        assert( packetId != MQTT_PACKET_ID_INVALID );
+
+        *pCurrentState = MQTTStateNull;
+
+        slot = findIndexSlot( records, packetId );
+
+        if( records->index[ slot ] != 0U )
+        {
+            index = ( size_t ) records->index[ slot ] - 1U;
+            *pQos = records->records[ index ].qos;
+            *pCurrentState = records->records[ index ].publishState;
+        }
+
+        return index;
+    }
 
-    /* Check if we have to compact the records. This is known by checking if
-     * the last spot in the array is filled. */
-    if( records[ recordCount - 1U ].packetId != MQTT_PACKET_ID_INVALID )
+/*-----------------------------------------------------------*/
+
+    static MQTTStatus_t addRecord( MQTTStateRecords_t * records,
+                                   size_t recordCount,
+                                   uint16_t packetId,
+                                   MQTTQoS_t qos,
+                                   MQTTPublishState_t publishState )
     {
-        compactRecords( records, recordCount );
+        MQTTStatus_t status = MQTTNoMemory;
+        size_t slot = 0U, index = recordCount;
+
+        assert( packetId != MQTT_PACKET_ID_INVALID );
+        assert( qos != MQTTQoS0 );
+
+        slot = findIndexSlot( records, packetId );
+
+        if( records->index[ slot ] != 0U )
+        {
+            /* Collision. */
+            LogError( ( "Collision when adding PacketID=%u at index=%d.",
+                        ( unsigned int ) packetId,
+                        ( int ) ( records->index[ slot ] - 1U ) ) );
+
+            status = MQTTStateCollision;
+        }
+        else if( records->freeCount > 0U )
+        {
+            records->freeCount--;
+            index = records->freeSlots[ records->freeCount ];
+        }
+        else if( records->usedCount < recordCount )
+        {
+            index = records->usedCount;
+            records->usedCount++;
+        }
+        else
+        {
+            /* All records are in use. */
+        }
+
+        if( index < recordCount )
+        {
+            records->records[ index ].packetId = packetId;
+            records->records[ index ].qos = qos;
+            records->records[ index ].publishState = publishState;
+
+            /* The sequence number keeps the relative order of the records in
+             * order to meet the message ordering requirement of MQTT spec 3.1.1. */
+            records->sequence[ index ] = records->nextSequence;
+            records->nextSequence++;
+            records->index[ slot ] = ( uint8_t ) ( index + 1U );
+            status = MQTTSuccess;
+        }
+
+        return status;
     }
 
-    /* Start from end so first available index will be populated.
-     * Available index is always found after the last element in the records.
-     * This is to make sure the relative order of the records in order to meet
-     * the message ordering requirement of MQTT spec 3.1.1. */
-    for( index = ( ( int32_t ) recordCount - 1 ); index >= 0; index-- )
+/*-----------------------------------------------------------*/
+
+    static void updateRecord( MQTTStateRecords_t * records,
+                              size_t recordIndex,
+                              MQTTPublishState_t newState,
+                              bool shouldDelete )
+    {
+        assert( records != NULL );
+
+        if( shouldDelete == true )
+        {
+            /* Release the record. */
+            removeFromIndex( records, records->records[ recordIndex ].packetId );
+            records->records[ recordIndex ].packetId = MQTT_PACKET_ID_INVALID;
+            records->records[ recordIndex ].qos = MQTTQoS0;
+            records->records[ recordIndex ].publishState = MQTTStateNull;
+            records->freeSlots[ records->freeCount ] = ( uint8_t ) recordIndex;
+            records->freeCount++;
+        }
+        else
+        {
+            records->records[ recordIndex ].publishState = newState;
+        }
+    }
+
+/*-----------------------------------------------------------*/
+
+    static uint16_t stateSelect( const MQTTContext_t * pMqttContext,
+                                 uint16_t searchStates,
+                                 MQTTStateCursor_t * pCursor )
     {
-        /* Available index is only found after packet at the highest index. */
-        if( records[ index ].packetId == MQTT_PACKET_ID_INVALID )
+        uint16_t packetId = MQTT_PACKET_ID_INVALID;
+        uint16_t outgoingStates = 0U;
+        const MQTTStateRecords_t * records = NULL;
+        size_t index = 0U;
+        uint32_t age = 0U, oldestAge = UINT32_MAX;
+        bool stateCheck = false;
+
+        assert( pMqttContext != NULL );
+        assert( searchStates != 0U );
+        assert( pCursor != NULL );
+
+        /* Create a bit map with all the outgoing publish states. */
+        UINT16_SET_BIT( outgoingStates, MQTTPublishSend );
+        UINT16_SET_BIT( outgoingStates, MQTTPubAckPending );
+        UINT16_SET_BIT( outgoingStates, MQTTPubRecPending );
+        UINT16_SET_BIT( outgoingStates, MQTTPubRelSend );
+        UINT16_SET_BIT( outgoingStates, MQTTPubCompPending );
+
+        /* Only outgoing publish records need to be searched. */
+        assert( ( outgoingStates & searchStates ) > 0U );
+        assert( ( ~outgoingStates & searchStates ) == 0 );
+
+        records = OUTGOING_RECORDS( pMqttContext );
+
+        /* The cursor holds the lowest sequence number still to be returned. The
+         * oldest matching record at or after it is returned, so records come out
+         * in the order in which they were added. */
+        for( index = 0U; index < records->usedCount; index++ )
         {
-            if( validEntryFound == false )
+            stateCheck = UINT16_CHECK_BIT( searchStates, records->records[ index ].publishState ) ? true : false;
+
+            if( ( records->records[ index ].packetId != MQTT_PACKET_ID_INVALID ) &&
+                ( stateCheck == true ) &&
+                ( records->sequence[ index ] >= ( uint32_t ) *pCursor ) )
             {
-                availableIndex = ( size_t ) index;
+                age = records->sequence[ index ] - ( uint32_t ) *pCursor;
+
+                if( age < oldestAge )
+                {
+                    oldestAge = age;
+                    packetId = records->records[ index ].packetId;
+                }
             }
         }
+
+        if( packetId != MQTT_PACKET_ID_INVALID )
+        {
+            *pCursor += ( MQTTStateCursor_t ) oldestAge + 1U;
+        }
         else
         {
-            /* A non-empty spot found in the records. */
-            validEntryFound = true;
+            /* Past the last record, as the linear backend leaves the cursor
+             * past the end of the array. */
+            *pCursor = ( MQTTStateCursor_t ) records->nextSequence;
+        }
+
+        return packetId;
+    }
+
+#else /* if ( MQTT_STATE_INDEXED == 1 ) */
+
+    static size_t findInRecord( const MQTTStateRecords_t * records,
+                                size_t recordCount,
+                                uint16_t packetId,
+                                MQTTQoS_t * pQos,
+                                MQTTPublishState_t * pCurrentState )
+    {
+        size_t index = 0;
+
+        assert( packetId != MQTT_PACKET_ID_INVALID );
 
+        *pCurrentState = MQTTStateNull;
+
+        for( index = 0; index < recordCount; index++ )
+        {
             if( records[ index ].packetId == packetId )
             {
-                /* Collision. */
-                LogError( ( "Collision when adding PacketID=%u at index=%d.",
-                            ( unsigned int ) packetId,
-                            ( int ) index ) );
-
-                status = MQTTStateCollision;
-                availableIndex = recordCount;
+                *pQos = records[ index ].qos;
+                *pCurrentState = records[ index ].publishState;
                 break;
             }
         }
+
+        return index;
     }
 
-    if( availableIndex < recordCount )
+/*-----------------------------------------------------------*/
+
+    static void compactRecords( MQTTPubAckInfo_t * records,
+                                size_t recordCount )
     {
-        records[ availableIndex ].packetId = packetId;
-        records[ availableIndex ].qos = qos;
-        records[ availableIndex ].publishState = publishState;
-        status = MQTTSuccess;
-    }
+        size_t index = 0;
+        size_t emptyIndex = MQTT_STATE_ARRAY_MAX_COUNT;
 
-    return status;
-}
+        assert( records != NULL );
 
-/*-----------------------------------------------------------*/
+        /* Find the empty spots and fill those with non empty values. */
+        for( ; index < recordCount; index++ )
+        {
+            /* Find the first empty spot. */
+            if( records[ index ].packetId == MQTT_PACKET_ID_INVALID )
+            {
+                if( emptyIndex == MQTT_STATE_ARRAY_MAX_COUNT )
+                {
+                    emptyIndex = index;
+                }
+            }
+            else
+            {
+                if( emptyIndex != MQTT_STATE_ARRAY_MAX_COUNT )
+                {
+                    /* Copy over the contents at non empty index to empty index. */
+                    records[ emptyIndex ].packetId = records[ index ].packetId;
+                    records[ emptyIndex ].qos = records[ index ].qos;
+                    records[ emptyIndex ].publishState = records[ index ].publishState;
+
+                    /* Mark the record at current non empty index as invalid. */
+                    records[ index ].packetId = MQTT_PACKET_ID_INVALID;
+
+                    /* Advance the emptyIndex. */
+                    emptyIndex++;
+                }
+            }
+        }
+    }
 
-static void updateRecord( MQTTPubAckInfo_t * records,
-                          size_t recordIndex,
-                          MQTTPublishState_t newState,
-                          bool shouldDelete )
-{
-    assert( records != NULL );
+/*-----------------------------------------------------------*/
 
-    if( shouldDelete == true )
+    static MQTTStatus_t addRecord( MQTTStateRecords_t * records,
+                                   size_t recordCount,
+                                   uint16_t packetId,
+                                   MQTTQoS_t qos,
+                                   MQTTPublishState_t publishState )
     {
-        /* Mark the record as invalid. */
-        records[ recordIndex ].packetId = MQTT_PACKET_ID_INVALID;
+        MQTTStatus_t status = MQTTNoMemory;
+        int32_t index = 0;
+        size_t availableIndex = recordCount;
+        bool validEntryFound = false;
+
+        assert( packetId != MQTT_PACKET_ID_INVALID );
+        assert( qos != MQTTQoS0 );
+
+        /* Check if we have to compact the records. This is known by checking if
+         * the last spot in the array is filled. */
+        if( records[ recordCount - 1U ].packetId != MQTT_PACKET_ID_INVALID )
+        {
+            compactRecords( records, recordCount );
+        }
+
+        /* Start from end so first available index will be populated.
+         * Available index is always found after the last element in the records.
+         * This is to make sure the relative order of the records in order to meet
+         * the message ordering requirement of MQTT spec 3.1.1. */
+        for( index = ( ( int32_t ) recordCount - 1 ); index >= 0; index-- )
+        {
+            /* Available index is only found after packet at the highest index. */
+            if( records[ index ].packetId == MQTT_PACKET_ID_INVALID )
+            {
+                if( validEntryFound == false )
+                {
+                    availableIndex = ( size_t ) index;
+                }
+            }
+            else
+            {
+                /* A non-empty spot found in the records. */
+                validEntryFound = true;
+
+                if( records[ index ].packetId == packetId )
+                {
+                    /* Collision. */
+                    LogError( ( "Collision when adding PacketID=%u at index=%d.",
+                                ( unsigned int ) packetId,
+                                ( int ) index ) );
+
+                    status = MQTTStateCollision;
+                    availableIndex = recordCount;
+                    break;
+                }
+            }
+        }
+
+        if( availableIndex < recordCount )
+        {
+            records[ availableIndex ].packetId = packetId;
+            records[ availableIndex ].qos = qos;
+            records[ availableIndex ].publishState = publishState;
+            status = MQTTSuccess;
+        }
+
+        return status;
     }
-    else
+
+/*-----------------------------------------------------------*/
+
+    static void updateRecord( MQTTStateRecords_t * records,
+                              size_t recordIndex,
+                              MQTTPublishState_t newState,
+                              bool shouldDelete )
     {
-        records[ recordIndex ].publishState = newState;
+        assert( records != NULL );
+
+        if( shouldDelete == true )
+        {
+            /* Mark the record as invalid. */
+            records[ recordIndex ].packetId = MQTT_PACKET_ID_INVALID;
+        }
+        else
+        {
+            records[ recordIndex ].publishState = newState;
+        }
     }
-}
 
 /*-----------------------------------------------------------*/
 
-static uint16_t stateSelect( const MQTTContext_t * pMqttContext,
-                             uint16_t searchStates,
-                             MQTTStateCursor_t * pCursor )
-{
-    uint16_t packetId = MQTT_PACKET_ID_INVALID;
-    uint16_t outgoingStates = 0U;
-    const MQTTPubAckInfo_t * records = NULL;
-    bool stateCheck = false;
-
-    assert( pMqttContext != NULL );
-    assert( searchStates != 0U );
-    assert( pCursor != NULL );
+    static uint16_t stateSelect( const MQTTContext_t * pMqttContext,
+                                 uint16_t searchStates,
+                                 MQTTStateCursor_t * pCursor )
+    {
+        uint16_t packetId = MQTT_PACKET_ID_INVALID;
+        uint16_t outgoingStates = 0U;
+        const MQTTStateRecords_t * records = NULL;
+        bool stateCheck = false;
 
-    /* Create a bit map with all the outgoing publish states. */
-    UINT16_SET_BIT( outgoingStates, MQTTPublishSend );
-    UINT16_SET_BIT( outgoingStates, MQTTPubAckPending );
-    UINT16_SET_BIT( outgoingStates, MQTTPubRecPending );
-    UINT16_SET_BIT( outgoingStates, MQTTPubRelSend );
-    UINT16_SET_BIT( outgoingStates, MQTTPubCompPending );
+        assert( pMqttContext != NULL );
+        assert( searchStates != 0U );
+        assert( pCursor != NULL );
 
-    /* Only outgoing publish records need to be searched. */
-    assert( ( outgoingStates & searchStates ) > 0U );
-    assert( ( ~outgoingStates & searchStates ) == 0 );
+        /* Create a bit map with all the outgoing publish states. */
+        UINT16_SET_BIT( outgoingStates, MQTTPublishSend );
+        UINT16_SET_BIT( outgoingStates, MQTTPubAckPending );
+        UINT16_SET_BIT( outgoingStates, MQTTPubRecPending );
+        UINT16_SET_BIT( outgoingStates, MQTTPubRelSend );
+        UINT16_SET_BIT( outgoingStates, MQTTPubCompPending );
 
-    records = pMqttContext->outgoingPublishRecords;
+        /* Only outgoing publish records need to be searched. */
+        assert( ( outgoingStates & searchStates ) > 0U );
+        assert( ( ~outgoingStates & searchStates ) == 0 );
 
-    while( *pCursor < MQTT_STATE_ARRAY_MAX_COUNT )
-    {
-        /* Check if any of the search states are present. */
-        stateCheck = UINT16_CHECK_BIT( searchStates, records[ *pCursor ].publishState ) ? true : false;
+        records = OUTGOING_RECORDS( pMqttContext );
 
-        if( stateCheck == true )
+        while( *pCursor < MQTT_STATE_ARRAY_MAX_COUNT )
         {
-            packetId = records[ *pCursor ].packetId;
+            /* Check if any of the search states are present. */
+            stateCheck = UINT16_CHECK_BIT( searchStates, records[ *pCursor ].publishState ) ? true : false;
+
+            if( stateCheck == true )
+            {
+                packetId = records[ *pCursor ].packetId;
+                ( *pCursor )++;
+                break;
+            }
+
             ( *pCursor )++;
-            break;
         }
 
-        ( *pCursor )++;
+        return packetId;
     }
 
-    return packetId;
-}
+#endif /* if ( MQTT_STATE_INDEXED == 1 ) */
 
 /*-----------------------------------------------------------*/
 
@@ -674,7 +979,7 @@ MQTTPublishState_t MQTT_CalculateStateAck( MQTTPubAckType_t packetType,
 
 /*-----------------------------------------------------------*/
 
-static MQTTStatus_t updateStateAck( MQTTPubAckInfo_t * records,
+static MQTTStatus_t updateStateAck( MQTTStateRecords_t * records,
                                     size_t recordIndex,
                                     uint16_t packetId,
                                     MQTTPublishState_t currentState,
@@ -759,7 +1064,7 @@ static MQTTStatus_t updateStatePublish( MQTTContext_t * pMqttContext,
         /* addRecord will check for collisions. */
         if( opType == MQTT_RECEIVE )
         {
-            status = addRecord( pMqttContext->incomingPublishRecords,
+            status = addRecord( INCOMING_RECORDS( pMqttContext ),
                                 MQTT_STATE_ARRAY_MAX_COUNT,
                                 packetId,
                                 qos,
@@ -772,7 +1077,7 @@ static MQTTStatus_t updateStatePublish( MQTTContext_t * pMqttContext,
              * update is required. */
             if( currentState != newState )
             {
-                updateRecord( pMqttContext->outgoingPublishRecords, recordIndex, newState, false );
+                updateRecord( OUTGOING_RECORDS( pMqttContext ), recordIndex, newState, false );
             }
         }
     }
@@ -806,7 +1111,7 @@ MQTTStatus_t MQTT_ReserveState( MQTTContext_t * pMqttContext,
     else
     {
         /* Collisions are detected when adding the record. */
-        status = addRecord( pMqttContext->outgoingPublishRecords,
+        status = addRecord( OUTGOING_RECORDS( pMqttContext ),
                             MQTT_STATE_ARRAY_MAX_COUNT,
                             packetId,
                             qos,
@@ -880,7 +1185,7 @@ MQTTStatus_t MQTT_UpdateStatePublish( MQTTContext_t * pMqttContext,
     else if( opType == MQTT_SEND )
     {
         /* Search record for entry so we can check QoS. */
-        recordIndex = findInRecord( pMqttContext->outgoingPublishRecords,
+        recordIndex = findInRecord( OUTGOING_RECORDS( pMqttContext ),
                                     MQTT_STATE_ARRAY_MAX_COUNT,
                                     packetId,
                                     &foundQoS,
@@ -932,7 +1237,7 @@ MQTTStatus_t MQTT_UpdateStateAck( MQTTContext_t * pMqttContext,
     bool isOutgoingPublish = isPublishOutgoing( packetType, opType );
     MQTTQoS_t qos = MQTTQoS0;
     size_t recordIndex = MQTT_STATE_ARRAY_MAX_COUNT;
-    MQTTPubAckInfo_t * records = NULL;
+    MQTTStateRecords_t * records = NULL;
     MQTTStatus_t status = MQTTBadResponse;
 
     if( ( pMqttContext == NULL ) || ( pNewState == NULL ) )
@@ -956,11 +1261,11 @@ MQTTStatus_t MQTT_UpdateStateAck( MQTTContext_t * pMqttContext,
     {
         if( isOutgoingPublish == true )
         {
-            records = pMqttContext->outgoingPublishRecords;
+            records = OUTGOING_RECORDS( pMqttContext );
         }
         else
         {
-            records = pMqttContext->incomingPublishRecords;
+            records = INCOMING_RECORDS( pMqttContext );
         }
 
         recordIndex = findInRecord( records,
@@ -161,21 +161,56 @@ typedef struct MQTTPubAckInfo
     MQTTPublishState_t publishState; /**< @brief The current state of the publish process. */
 } MQTTPubAckInfo_t;
 
+#if ( MQTT_STATE_INDEXED == 1 )
+
+/**
+ * @ingroup mqtt_struct_types
+ * @brief State engine records with a packet ID index, used when
+ * #MQTT_STATE_INDEXED is 1.
+ *
+ * All members are valid when zero-initialized.
+ */
+typedef struct MQTTStateTable
+{
+    MQTTPubAckInfo_t records[ MQTT_STATE_ARRAY_MAX_COUNT ];  /**< @brief Record storage, in no particular order. */
+    uint32_t sequence[ MQTT_STATE_ARRAY_MAX_COUNT ];         /**< @brief Insertion order of each record. */
+    uint8_t index[ MQTT_STATE_INDEX_SIZE ];                  /**< @brief Open-addressing index: record position + 1, or 0 when empty. */
+    uint8_t freeSlots[ MQTT_STATE_ARRAY_MAX_COUNT ];         /**< @brief Stack of released record positions. */
+    size_t freeCount;                                        /**< @brief Entries on the free-slot stack. */
+    size_t usedCount;                                        /**< @brief Record positions handed out so far. */
+    uint32_t nextSequence;                                   /**< @brief Sequence number of the next record. */
+} MQTTStateTable_t;
+#endif /* if ( MQTT_STATE_INDEXED == 1 ) */
+
 /**
  * @ingroup mqtt_struct_types
  * @brief A struct representing an MQTT connection.
  */
 typedef struct MQTTContext
 {
-    /**
-     * @brief State engine records for outgoing publishes.
-     */
-    MQTTPubAckInfo_t outgoingPublishRecords[ MQTT_STATE_ARRAY_MAX_COUNT ];
-
-    /**
-     * @brief State engine records for incoming publishes.
-     */
-    MQTTPubAckInfo_t incomingPublishRecords[ MQTT_STATE_ARRAY_MAX_COUNT ];
+    #if ( MQTT_STATE_INDEXED == 1 )
+
+        /**
+         * @brief State engine records for outgoing publishes.
+         */
+        MQTTStateTable_t outgoingPublishRecords;
+
+        /**
+         * @brief State engine records for incoming publishes.
+         */
+        MQTTStateTable_t incomingPublishRecords;
+    #else
+
+        /**
+         * @brief State engine records for outgoing publishes.
+         */
+        MQTTPubAckInfo_t outgoingPublishRecords[ MQTT_STATE_ARRAY_MAX_COUNT ];
+
+        /**
+         * @brief State engine records for incoming publishes.
+         */
+        MQTTPubAckInfo_t incomingPublishRecords[ MQTT_STATE_ARRAY_MAX_COUNT ];
+    #endif
 
     /**
      * @brief The transport interface used by the MQTT connection.
@@ -82,6 +82,43 @@
     #define MQTT_STATE_ARRAY_MAX_COUNT    ( 10U )
 #endif
 
+/**
+ * @brief Selects the backend used for the PUBLISH state records.
+ *
+ * With the default value of 0, the records are kept in insertion order in a
+ * plain array, which is searched and compacted linearly on every PUBLISH and
+ * acknowledgment. This is adequate for one or two messages in flight.
+ *
+ * When set to 1, each record array is paired with an open-addressing index on
+ * the packet ID and a free-slot stack, so lookup, insert and remove take
+ * constant time regardless of #MQTT_STATE_ARRAY_MAX_COUNT. Message ordering for
+ * resends is kept with a per-record sequence number; only
+ * #MQTT_PublishToResend and #MQTT_PubrelToResend, which run on session
+ * reestablishment, scan the records.
+ *
+ * @note In the indexed backend the position of a record in the array does not
+ * reflect its insertion order.
+ *
+ * <b>Possible values:</b> `0` or `1` <br>
+ * <b>Default value:</b> `0`
+ */
+#ifndef MQTT_STATE_INDEXED
+    #define MQTT_STATE_INDEXED    ( 0 )
+#endif
+
+/**
+ * @brief Number of slots in the packet ID index of the indexed state backend.
+ *
+ * Must be larger than #MQTT_STATE_ARRAY_MAX_COUNT; twice the record count
+ * keeps probe sequences short. Only used when #MQTT_STATE_INDEXED is 1.
+ *
+ * <b>Possible values:</b> Greater than #MQTT_STATE_ARRAY_MAX_COUNT. <br>
+ * <b>Default value:</b> `2 * MQTT_STATE_ARRAY_MAX_COUNT`
+ */
+#ifndef MQTT_STATE_INDEX_SIZE
+    #define MQTT_STATE_INDEX_SIZE    ( 2U * MQTT_STATE_ARRAY_MAX_COUNT )
+#endif
+
 /**
  * @brief The number of retries for receiving CONNACK.
  *
@@ -243,6 +243,46 @@ typedef int32_t ( * TransportSend_t )( NetworkContext_t * pNetworkContext,
                                        size_t bytesToSend );
 /* @[define_transportsend] */
 
+/**
+ * @transportstruct
+ * @brief One segment of data to be sent by #TransportWritev_t.
+ */
+/* @[define_transportoutvector] */
+typedef struct TransportOutVector
+{
+    const void * iov_base; /**< Base address of data. */
+    size_t iov_len;        /**< Length of data in buffer. */
+} TransportOutVector_t;
+/* @[define_transportoutvector] */
+
+/**
+ * @transportcallback
+ * @brief Transport interface for sending several segments of data in one call.
+ *
+ * The segments should be sent as if they were one contiguous buffer, so that a
+ * packet split over several buffers (e.g. a header and a payload) leaves the
+ * device as a single write of the underlying stack.
+ *
+ * @param[in] pNetworkContext Implementation-defined network context.
+ * @param[in] pIoVec Array of segments to send over the network.
+ * @param[in] ioVecCount Number of segments in @p pIoVec.
+ *
+ * @return The number of bytes sent or a negative value to indicate error.
+ *
+ * @note The same rules as for #TransportSend_t apply to the return value: zero
+ * means nothing was sent and the operation can be retried. A return value
+ * smaller than the total length means the leading bytes were sent and the
+ * caller will call again with the remaining bytes.
+ *
+ * @note This function is optional. Libraries fall back to #TransportSend_t
+ * when it is NULL.
+ */
+/* @[define_transportwritev] */
+typedef int32_t ( * TransportWritev_t )( NetworkContext_t * pNetworkContext,
+                                         TransportOutVector_t * pIoVec,
+                                         size_t ioVecCount );
+/* @[define_transportwritev] */
+
 /**
  * @transportstruct
  * @brief The transport layer interface.
@@ -252,6 +292,7 @@ typedef struct TransportInterface
 {
     TransportRecv_t recv;               /**< Transport receive interface. */
     TransportSend_t send;               /**< Transport send interface. */
+    TransportWritev_t writev;           /**< Transport vectored send interface (optional, may be NULL). */
     NetworkContext_t * pNetworkContext; /**< Implementation-defined network context. */
 } TransportInterface_t;
 /* @[define_transportinterface] */
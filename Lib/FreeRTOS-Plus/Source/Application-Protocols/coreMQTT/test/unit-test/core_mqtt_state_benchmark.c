@@ -0,0 +1,170 @@
+/*
+ * coreMQTT v1.2.0
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @file core_mqtt_state_benchmark.c
+ * @brief Throughput benchmark for the publish state records.
+ *
+ * Keeps a window of publishes in flight and measures the state engine cost of
+ * one complete publish (reserve, send and all acknowledgments) for the record
+ * backend selected by #MQTT_STATE_INDEXED. Exits with a non-zero status if the
+ * state engine reports an unexpected result.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "core_mqtt_state.h"
+
+/**
+ * @brief Number of publishes completed per measurement.
+ */
+#define BENCHMARK_PUBLISHES    ( 200000UL )
+
+/**
+ * @brief Check a state engine result, leaving the benchmark on failure.
+ */
+#define BENCHMARK_CHECK( x )                                                \
+    do {                                                                    \
+        if( ( x ) != MQTTSuccess )                                          \
+        {                                                                   \
+            printf( "Unexpected state engine result at line %d.\n", __LINE__ ); \
+            return -1.0;                                                    \
+        }                                                                   \
+    } while( 0 )
+
+/*-----------------------------------------------------------*/
+
+static uint16_t nextPacketId( uint16_t packetId )
+{
+    packetId++;
+
+    /* Packet ID 0 is invalid. */
+    return ( packetId == 0U ) ? 1U : packetId;
+}
+
+/*-----------------------------------------------------------*/
+
+static MQTTStatus_t completePublish( MQTTContext_t * pContext,
+                                     uint16_t packetId,
+                                     MQTTQoS_t qos )
+{
+    MQTTStatus_t status;
+    MQTTPublishState_t state;
+
+    if( qos == MQTTQoS1 )
+    {
+        status = MQTT_UpdateStateAck( pContext, packetId, MQTTPuback, MQTT_RECEIVE, &state );
+    }
+    else
+    {
+        status = MQTT_UpdateStateAck( pContext, packetId, MQTTPubrec, MQTT_RECEIVE, &state );
+
+        if( status == MQTTSuccess )
+        {
+            status = MQTT_UpdateStateAck( pContext, packetId, MQTTPubrel, MQTT_SEND, &state );
+        }
+
+        if( status == MQTTSuccess )
+        {
+            status = MQTT_UpdateStateAck( pContext, packetId, MQTTPubcomp, MQTT_RECEIVE, &state );
+        }
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
+
+/**
+ * @brief Measure the time per publish with a given number of publishes in flight.
+ *
+ * @return Nanoseconds per publish, or a negative value on error.
+ */
+static double runWindow( size_t window,
+                         MQTTQoS_t qos )
+{
+    static MQTTContext_t context;
+    MQTTPublishState_t state;
+    uint16_t oldest = 1U, newest = 1U;
+    unsigned long i;
+    clock_t start;
+    size_t inFlight;
+
+    ( void ) memset( &context, 0x00, sizeof( context ) );
+
+    /* Fill the window. */
+    for( inFlight = 0U; inFlight < window; inFlight++ )
+    {
+        BENCHMARK_CHECK( MQTT_ReserveState( &context, newest, qos ) );
+        BENCHMARK_CHECK( MQTT_UpdateStatePublish( &context, newest, MQTT_SEND, qos, &state ) );
+        newest = nextPacketId( newest );
+    }
+
+    /* Each round completes the oldest publish and sends a new one, so the
+     * window stays full. */
+    start = clock();
+
+    for( i = 0UL; i < BENCHMARK_PUBLISHES; i++ )
+    {
+        BENCHMARK_CHECK( completePublish( &context, oldest, qos ) );
+        oldest = nextPacketId( oldest );
+        BENCHMARK_CHECK( MQTT_ReserveState( &context, newest, qos ) );
+        BENCHMARK_CHECK( MQTT_UpdateStatePublish( &context, newest, MQTT_SEND, qos, &state ) );
+        newest = nextPacketId( newest );
+    }
+
+    return ( ( double ) ( clock() - start ) * 1e9 ) / ( ( double ) CLOCKS_PER_SEC * ( double ) BENCHMARK_PUBLISHES );
+}
+
+/*-----------------------------------------------------------*/
+
+int main( void )
+{
+    static const size_t windows[] = { 1U, 4U, 16U, MQTT_STATE_ARRAY_MAX_COUNT };
+    size_t i;
+    double qos1, qos2;
+    int status = 0;
+
+    printf( "%s records, MQTT_STATE_ARRAY_MAX_COUNT %u\n",
+            ( MQTT_STATE_INDEXED == 1 ) ? "Indexed" : "Linear",
+            ( unsigned int ) MQTT_STATE_ARRAY_MAX_COUNT );
+
+    for( i = 0U; i < ( sizeof( windows ) / sizeof( windows[ 0 ] ) ); i++ )
+    {
+        qos1 = runWindow( windows[ i ], MQTTQoS1 );
+        qos2 = runWindow( windows[ i ], MQTTQoS2 );
+
+        if( ( qos1 < 0.0 ) || ( qos2 < 0.0 ) )
+        {
+            status = 1;
+            break;
+        }
+
+        printf( "Window %3u: QoS1 %8.1f ns, QoS2 %8.1f ns per publish\n",
+                ( unsigned int ) windows[ i ],
+                qos1,
+                qos2 );
+    }
+
+    return status;
+}
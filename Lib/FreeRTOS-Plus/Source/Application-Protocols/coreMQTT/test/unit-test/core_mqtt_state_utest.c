@@ -31,6 +31,23 @@
 
 #define MQTT_PACKET_ID_INVALID    ( ( uint16_t ) 0U )
 
+/* The tests place records at given positions of the record array. With the
+ * indexed backend, the index, free-slot stack and sequence numbers are rebuilt
+ * from the array afterwards, numbering records by position. */
+#if ( MQTT_STATE_INDEXED == 1 )
+    typedef MQTTStateTable_t         StateRecords_t;
+    #define RECORD_AT( pRecords, i )    ( ( pRecords )->records[ i ] )
+    #define OUTGOING( context )         ( &( ( context ).outgoingPublishRecords ) )
+    #define INCOMING( context )         ( &( ( context ).incomingPublishRecords ) )
+    #define CURSOR_END( context )       ( ( MQTTStateCursor_t ) ( context ).outgoingPublishRecords.nextSequence )
+#else
+    typedef MQTTPubAckInfo_t         StateRecords_t;
+    #define RECORD_AT( pRecords, i )    ( ( pRecords )[ i ] )
+    #define OUTGOING( context )         ( ( context ).outgoingPublishRecords )
+    #define INCOMING( context )         ( ( context ).incomingPublishRecords )
+    #define CURSOR_END( context )       ( MQTT_STATE_ARRAY_MAX_COUNT )
+#endif
+
 /* ============================   UNITY FIXTURES ============================ */
 void setUp( void )
 {
@@ -54,33 +71,66 @@ int suiteTearDown( int numFailures )
 
 /* ========================================================================== */
 
-static void resetPublishRecords( MQTTContext_t * pMqttContext )
+static void syncRecords( StateRecords_t * records )
 {
-    uint32_t i = 0;
+    #if ( MQTT_STATE_INDEXED == 1 )
+        size_t i, slot;
+
+        ( void ) memset( records->index, 0x00, sizeof( records->index ) );
+        records->freeCount = 0U;
+        records->usedCount = MQTT_STATE_ARRAY_MAX_COUNT;
+        records->nextSequence = MQTT_STATE_ARRAY_MAX_COUNT;
+
+        /* Push free positions from the top, so the lowest one is reused first. */
+        for( i = MQTT_STATE_ARRAY_MAX_COUNT; i > 0U; i-- )
+        {
+            records->sequence[ i - 1U ] = ( uint32_t ) ( i - 1U );
+
+            if( records->records[ i - 1U ].packetId == MQTT_PACKET_ID_INVALID )
+            {
+                records->freeSlots[ records->freeCount ] = ( uint8_t ) ( i - 1U );
+                records->freeCount++;
+            }
+        }
+
+        for( i = 0U; i < MQTT_STATE_ARRAY_MAX_COUNT; i++ )
+        {
+            if( records->records[ i ].packetId != MQTT_PACKET_ID_INVALID )
+            {
+                slot = records->records[ i ].packetId % MQTT_STATE_INDEX_SIZE;
+
+                while( records->index[ slot ] != 0U )
+                {
+                    slot = ( slot + 1U ) % MQTT_STATE_INDEX_SIZE;
+                }
+
+                records->index[ slot ] = ( uint8_t ) ( i + 1U );
+            }
+        }
+    #else /* if ( MQTT_STATE_INDEXED == 1 ) */
+        ( void ) records;
+    #endif /* if ( MQTT_STATE_INDEXED == 1 ) */
+}
 
-    for( ; i < MQTT_STATE_ARRAY_MAX_COUNT; i++ )
-    {
-        pMqttContext->outgoingPublishRecords[ i ].packetId = MQTT_PACKET_ID_INVALID;
-        pMqttContext->outgoingPublishRecords[ i ].qos = MQTTQoS0;
-        pMqttContext->outgoingPublishRecords[ i ].publishState = MQTTStateNull;
-        pMqttContext->incomingPublishRecords[ i ].packetId = MQTT_PACKET_ID_INVALID;
-        pMqttContext->incomingPublishRecords[ i ].qos = MQTTQoS0;
-        pMqttContext->incomingPublishRecords[ i ].publishState = MQTTStateNull;
-    }
+static void resetPublishRecords( MQTTContext_t * pMqttContext )
+{
+    ( void ) memset( &( pMqttContext->outgoingPublishRecords ), 0x00, sizeof( pMqttContext->outgoingPublishRecords ) );
+    ( void ) memset( &( pMqttContext->incomingPublishRecords ), 0x00, sizeof( pMqttContext->incomingPublishRecords ) );
 }
 
-static void addToRecord( MQTTPubAckInfo_t * records,
+static void addToRecord( StateRecords_t * records,
                          size_t index,
                          uint16_t packetId,
                          MQTTQoS_t qos,
                          MQTTPublishState_t state )
 {
-    records[ index ].packetId = packetId;
-    records[ index ].qos = qos;
-    records[ index ].publishState = state;
+    RECORD_AT( records, index ).packetId = packetId;
+    RECORD_AT( records, index ).qos = qos;
+    RECORD_AT( records, index ).publishState = state;
+    syncRecords( records );
 }
 
-static void fillRecord( MQTTPubAckInfo_t * records,
+static void fillRecord( StateRecords_t * records,
                         uint16_t startingId,
                         MQTTQoS_t qos,
                         MQTTPublishState_t state )
@@ -89,25 +139,70 @@ static void fillRecord( MQTTPubAckInfo_t * records,
 
     for( i = 0; i < MQTT_STATE_ARRAY_MAX_COUNT; i++ )
     {
-        records[ i ].packetId = startingId + i;
-        records[ i ].qos = qos;
-        records[ i ].publishState = state;
+        RECORD_AT( records, i ).packetId = startingId + i;
+        RECORD_AT( records, i ).qos = qos;
+        RECORD_AT( records, i ).publishState = state;
     }
+
+    syncRecords( records );
 }
 
-static void validateRecordAt( MQTTPubAckInfo_t * records,
+static void validateRecordAt( StateRecords_t * records,
                               size_t index,
                               uint16_t packetId,
                               MQTTQoS_t qos,
                               MQTTPublishState_t state )
 {
-    TEST_ASSERT_EQUAL( packetId, records[ index ].packetId );
-    TEST_ASSERT_EQUAL( qos, records[ index ].qos );
-    TEST_ASSERT_EQUAL( state, records[ index ].publishState );
+    TEST_ASSERT_EQUAL( packetId, RECORD_AT( records, index ).packetId );
+    TEST_ASSERT_EQUAL( qos, RECORD_AT( records, index ).qos );
+    TEST_ASSERT_EQUAL( state, RECORD_AT( records, index ).publishState );
+}
+
+/**
+ * @brief A record of the reference model used by the randomized test.
+ */
+typedef struct ModelRecord
+{
+    uint16_t packetId;
+    MQTTQoS_t qos;
+    MQTTPublishState_t state;
+} ModelRecord_t;
+
+static uint32_t nextRandom( uint32_t * pSeed )
+{
+    *pSeed = ( *pSeed * 1103515245U ) + 12345U;
+    return ( *pSeed >> 16 ) & 0x7FFFU;
+}
+
+static size_t modelFind( const ModelRecord_t * model,
+                         size_t count,
+                         uint16_t packetId )
+{
+    size_t i;
+
+    for( i = 0; i < count; i++ )
+    {
+        if( model[ i ].packetId == packetId )
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+static void modelRemove( ModelRecord_t * model,
+                         size_t * pCount,
+                         size_t index )
+{
+    ( void ) memmove( &model[ index ], &model[ index + 1U ], ( *pCount - index - 1U ) * sizeof( ModelRecord_t ) );
+    ( *pCount )--;
 }
 
 /* ========================================================================== */
 
+/* ========================================================================== */
+
 void test_MQTT_ReserveState( void )
 {
     MQTTContext_t mqttContext = { 0 };
@@ -116,6 +211,7 @@ void test_MQTT_ReserveState( void )
     const uint16_t PACKET_ID2 = 2;
     const uint16_t PACKET_ID3 = 3;
     const size_t index = MQTT_STATE_ARRAY_MAX_COUNT / 2;
+    MQTTStateCursor_t cursor = MQTT_STATE_CURSOR_INITIALIZER;
 
     /* QoS 0 returns success. */
     TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_ReserveState( NULL, MQTT_PACKET_ID_INVALID, MQTTQoS0 ) );
@@ -127,15 +223,13 @@ void test_MQTT_ReserveState( void )
     TEST_ASSERT_EQUAL( MQTTBadParameter, status );
 
     /* Test for collisions. */
-    mqttContext.outgoingPublishRecords[ 1 ].packetId = PACKET_ID;
-    mqttContext.outgoingPublishRecords[ 1 ].qos = MQTTQoS1;
-    mqttContext.outgoingPublishRecords[ 1 ].publishState = MQTTPublishSend;
+    addToRecord( OUTGOING( mqttContext ), 1, PACKET_ID, MQTTQoS1, MQTTPublishSend );
 
     status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
     TEST_ASSERT_EQUAL( MQTTStateCollision, status );
 
     /* Test for no memory. */
-    fillRecord( mqttContext.outgoingPublishRecords, 2, MQTTQoS1, MQTTPublishSend );
+    fillRecord( OUTGOING( mqttContext ), 2, MQTTQoS1, MQTTPublishSend );
     status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
     TEST_ASSERT_EQUAL( MQTTNoMemory, status );
 
@@ -144,144 +238,155 @@ void test_MQTT_ReserveState( void )
     status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     /* Reserve uses first available entry. */
-    TEST_ASSERT_EQUAL( PACKET_ID, mqttContext.outgoingPublishRecords[ 0 ].packetId );
-    TEST_ASSERT_EQUAL( MQTTQoS1, mqttContext.outgoingPublishRecords[ 0 ].qos );
-    TEST_ASSERT_EQUAL( MQTTPublishSend, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( PACKET_ID, RECORD_AT( OUTGOING( mqttContext ), 0 ).packetId );
+    TEST_ASSERT_EQUAL( MQTTQoS1, RECORD_AT( OUTGOING( mqttContext ), 0 ).qos );
+    TEST_ASSERT_EQUAL( MQTTPublishSend, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
 
     /* Success.
      * Add record after the highest non empty index.
      * Already an entry exists at index 0. Adding 1 more entry at index 5.
      * The new index used should be 6. */
-    addToRecord( mqttContext.outgoingPublishRecords, index, PACKET_ID2, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), index, PACKET_ID2, MQTTQoS2, MQTTPubRelSend );
     status = MQTT_ReserveState( &mqttContext, PACKET_ID3, MQTTQoS1 );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    TEST_ASSERT_EQUAL( PACKET_ID3, mqttContext.outgoingPublishRecords[ index + 1 ].packetId );
-    TEST_ASSERT_EQUAL( MQTTQoS1, mqttContext.outgoingPublishRecords[ index + 1 ].qos );
-    TEST_ASSERT_EQUAL( MQTTPublishSend, mqttContext.outgoingPublishRecords[ index + 1 ].publishState );
+    #if ( MQTT_STATE_INDEXED == 0 )
+        TEST_ASSERT_EQUAL( PACKET_ID3, RECORD_AT( OUTGOING( mqttContext ), index + 1 ).packetId );
+        TEST_ASSERT_EQUAL( MQTTQoS1, RECORD_AT( OUTGOING( mqttContext ), index + 1 ).qos );
+        TEST_ASSERT_EQUAL( MQTTPublishSend, RECORD_AT( OUTGOING( mqttContext ), index + 1 ).publishState );
+    #endif
+
+    /* Whichever position the backend picks, the new record is resent last. */
+    TEST_ASSERT_EQUAL( PACKET_ID, MQTT_PublishToResend( &mqttContext, &cursor ) );
+    TEST_ASSERT_EQUAL( PACKET_ID3, MQTT_PublishToResend( &mqttContext, &cursor ) );
+    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, MQTT_PublishToResend( &mqttContext, &cursor ) );
 }
 
 /* ========================================================================== */
 
 void test_MQTT_ReserveState_compactRecords( void )
 {
-    MQTTContext_t mqttContext = { 0 };
-    MQTTStatus_t status;
-    const uint16_t PACKET_ID = 1;
-    const uint16_t PACKET_ID2 = 2;
-
-    /* Consider the state of the array with 2 states. 1 indicates a non empty
-     * spot and 0 an empty spot. Size of the array is 10.
-     * Pre condition - 0 0 0 0 0 0 0 0 0 1.
-     * Add an element will try to compact the array and the resulting state
-     * should be - 1 1 0 0 0 0 0 0 0 0. */
-    addToRecord( mqttContext.outgoingPublishRecords, MQTT_STATE_ARRAY_MAX_COUNT - 1, PACKET_ID, MQTTQoS1, MQTTPubRelSend );
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    /* The existing record should be at index 0. */
-    validateRecordAt( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPubRelSend );
-    /* New record should be added to index 1. */
-    validateRecordAt( mqttContext.outgoingPublishRecords, 1, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
-
-    /* One free spot.
-     * Pre condition - 1 1 1 0 1 1 1 1 1 1.
-     * Add an element will try to compact the array and the resulting state
-     * should be - 1 1 1 1 1 1 1 1 1 1. */
-    fillRecord( mqttContext.outgoingPublishRecords, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
-    /* Invalid record at index 3. */
-    mqttContext.outgoingPublishRecords[ 3 ].packetId = MQTT_PACKET_ID_INVALID;
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    /* The new record should be added to the end. */
-    validateRecordAt( mqttContext.outgoingPublishRecords,
-                      MQTT_STATE_ARRAY_MAX_COUNT - 1,
-                      PACKET_ID,
-                      MQTTQoS1,
-                      MQTTPublishSend );
-    /* Any new add should result in no memory error. */
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTNoMemory, status );
-
-    /* Alternate free spots.
-     * Pre condition - 1 0 1 0 1 0 1 0 1 0.
-     * Add an element will skip to compact the array and the resulting state
-     * should be - 1 0 1 0 1 0 1 0 1 1. */
-    fillRecord( mqttContext.outgoingPublishRecords, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
-    /* Invalidate record at alternate indexes starting from 1. */
-    mqttContext.outgoingPublishRecords[ 1 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 3 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 5 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 7 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 9 ].packetId = MQTT_PACKET_ID_INVALID;
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    /* The new record should be added to the end. */
-    validateRecordAt( mqttContext.outgoingPublishRecords,
-                      MQTT_STATE_ARRAY_MAX_COUNT - 1,
-                      PACKET_ID,
-                      MQTTQoS1,
-                      MQTTPublishSend );
-
-    /* Array is in state 1 0 1 0 1 0 1 0 1 1.
-     * Adding one more element should result in array in state
-     * 1 1 1 1 1 1 1 0 0 0. */
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    validateRecordAt( mqttContext.outgoingPublishRecords, 6, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
-    /* Remaining records should be invalid. */
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 7 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 8 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 9 ].packetId );
-
-    /* Free spots only in the beginning.
-     * Pre condition - 0 0 0 0 0 1 1 1 1 1.
-     * Add an element will compact the array and the resulting state
-     * should be - 1 1 1 1 1 1 0 0 0 0. */
-    fillRecord( mqttContext.outgoingPublishRecords, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
-    /* Clear record from 0 to 4. */
-    ( void ) memset( &mqttContext.outgoingPublishRecords[ 0 ], 0x00, 5 * sizeof( MQTTPubAckInfo_t ) );
-
-    /* Adding one element should result in array in state
-     * 1 1 1 1 1 1 0 0 0 0. */
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    validateRecordAt( mqttContext.outgoingPublishRecords, 5, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
-    /* Remaining records should be cleared. */
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 6 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 7 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 8 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 9 ].packetId );
-
-    /* Fragmented array.
-     * Pre condition - 1 0 0 1 1 1 1 0 0 1.
-     * Add an element will compact the array and the resulting state
-     * should be - 1 1 1 1 1 1 1 0 0 0. */
-    fillRecord( mqttContext.outgoingPublishRecords, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
-    /* Clear record at index 1,2,7 and 8. */
-    mqttContext.outgoingPublishRecords[ 1 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 2 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 7 ].packetId = MQTT_PACKET_ID_INVALID;
-    mqttContext.outgoingPublishRecords[ 8 ].packetId = MQTT_PACKET_ID_INVALID;
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    validateRecordAt( mqttContext.outgoingPublishRecords, 6, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
-    /* Remaining records should be cleared. */
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 7 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 8 ].packetId );
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 9 ].packetId );
-
-    /* Fragmented array.
-     * Pre condition - 1 0 0 0 0 0 0 0 0 1.
-     * Add an element will compact the array and the resulting state
-     * should be - 1 1 1 0 0 0 0 0 0 0. */
-    resetPublishRecords( &mqttContext );
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
-    addToRecord( mqttContext.outgoingPublishRecords, 9, PACKET_ID2 + 1, MQTTQoS2, MQTTPubCompPending );
-    status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
-    TEST_ASSERT_EQUAL( MQTTSuccess, status );
-    validateRecordAt( mqttContext.outgoingPublishRecords, 2, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
-    /* Validate existing records. */
-    validateRecordAt( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
-    validateRecordAt( mqttContext.outgoingPublishRecords, 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubCompPending );
+    #if ( MQTT_STATE_INDEXED == 0 )
+        MQTTContext_t mqttContext = { 0 };
+        MQTTStatus_t status;
+        const uint16_t PACKET_ID = 1;
+        const uint16_t PACKET_ID2 = 2;
+
+        /* Consider the state of the array with 2 states. 1 indicates a non empty
+         * spot and 0 an empty spot. Size of the array is 10.
+         * Pre condition - 0 0 0 0 0 0 0 0 0 1.
+         * Add an element will try to compact the array and the resulting state
+         * should be - 1 1 0 0 0 0 0 0 0 0. */
+        addToRecord( OUTGOING( mqttContext ), MQTT_STATE_ARRAY_MAX_COUNT - 1, PACKET_ID, MQTTQoS1, MQTTPubRelSend );
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        /* The existing record should be at index 0. */
+        validateRecordAt( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPubRelSend );
+        /* New record should be added to index 1. */
+        validateRecordAt( OUTGOING( mqttContext ), 1, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
+
+        /* One free spot.
+         * Pre condition - 1 1 1 0 1 1 1 1 1 1.
+         * Add an element will try to compact the array and the resulting state
+         * should be - 1 1 1 1 1 1 1 1 1 1. */
+        fillRecord( OUTGOING( mqttContext ), PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
+        /* Invalid record at index 3. */
+        RECORD_AT( OUTGOING( mqttContext ), 3 ).packetId = MQTT_PACKET_ID_INVALID;
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        /* The new record should be added to the end. */
+        validateRecordAt( OUTGOING( mqttContext ),
+                          MQTT_STATE_ARRAY_MAX_COUNT - 1,
+                          PACKET_ID,
+                          MQTTQoS1,
+                          MQTTPublishSend );
+        /* Any new add should result in no memory error. */
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTNoMemory, status );
+
+        /* Alternate free spots.
+         * Pre condition - 1 0 1 0 1 0 1 0 1 0.
+         * Add an element will skip to compact the array and the resulting state
+         * should be - 1 0 1 0 1 0 1 0 1 1. */
+        fillRecord( OUTGOING( mqttContext ), PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
+        /* Invalidate record at alternate indexes starting from 1. */
+        RECORD_AT( OUTGOING( mqttContext ), 1 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 3 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 5 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 7 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 9 ).packetId = MQTT_PACKET_ID_INVALID;
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        /* The new record should be added to the end. */
+        validateRecordAt( OUTGOING( mqttContext ),
+                          MQTT_STATE_ARRAY_MAX_COUNT - 1,
+                          PACKET_ID,
+                          MQTTQoS1,
+                          MQTTPublishSend );
+
+        /* Array is in state 1 0 1 0 1 0 1 0 1 1.
+         * Adding one more element should result in array in state
+         * 1 1 1 1 1 1 1 0 0 0. */
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        validateRecordAt( OUTGOING( mqttContext ), 6, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
+        /* Remaining records should be invalid. */
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 7 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 8 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 9 ).packetId );
+
+        /* Free spots only in the beginning.
+         * Pre condition - 0 0 0 0 0 1 1 1 1 1.
+         * Add an element will compact the array and the resulting state
+         * should be - 1 1 1 1 1 1 0 0 0 0. */
+        fillRecord( OUTGOING( mqttContext ), PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
+        /* Clear record from 0 to 4. */
+        ( void ) memset( &RECORD_AT( OUTGOING( mqttContext ), 0 ), 0x00, 5 * sizeof( MQTTPubAckInfo_t ) );
+
+        /* Adding one element should result in array in state
+         * 1 1 1 1 1 1 0 0 0 0. */
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        validateRecordAt( OUTGOING( mqttContext ), 5, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
+        /* Remaining records should be cleared. */
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 6 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 7 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 8 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 9 ).packetId );
+
+        /* Fragmented array.
+         * Pre condition - 1 0 0 1 1 1 1 0 0 1.
+         * Add an element will compact the array and the resulting state
+         * should be - 1 1 1 1 1 1 1 0 0 0. */
+        fillRecord( OUTGOING( mqttContext ), PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
+        /* Clear record at index 1,2,7 and 8. */
+        RECORD_AT( OUTGOING( mqttContext ), 1 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 2 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 7 ).packetId = MQTT_PACKET_ID_INVALID;
+        RECORD_AT( OUTGOING( mqttContext ), 8 ).packetId = MQTT_PACKET_ID_INVALID;
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        validateRecordAt( OUTGOING( mqttContext ), 6, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
+        /* Remaining records should be cleared. */
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 7 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 8 ).packetId );
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 9 ).packetId );
+
+        /* Fragmented array.
+         * Pre condition - 1 0 0 0 0 0 0 0 0 1.
+         * Add an element will compact the array and the resulting state
+         * should be - 1 1 1 0 0 0 0 0 0 0. */
+        resetPublishRecords( &mqttContext );
+        addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
+        addToRecord( OUTGOING( mqttContext ), 9, PACKET_ID2 + 1, MQTTQoS2, MQTTPubCompPending );
+        status = MQTT_ReserveState( &mqttContext, PACKET_ID2, MQTTQoS1 );
+        TEST_ASSERT_EQUAL( MQTTSuccess, status );
+        validateRecordAt( OUTGOING( mqttContext ), 2, PACKET_ID2, MQTTQoS1, MQTTPublishSend );
+        /* Validate existing records. */
+        validateRecordAt( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
+        validateRecordAt( OUTGOING( mqttContext ), 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubCompPending );
+    #else
+        TEST_IGNORE_MESSAGE( "The indexed backend does not compact its records." );
+    #endif
 }
 
 /* ========================================================================== */
@@ -335,18 +440,18 @@ void test_MQTT_UpdateStatePublish( void )
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTBadParameter, status );
     /* QoS mismatch. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTBadParameter, status );
 
     /* Invalid state transition. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPubRelPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPubRelPending );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
 
     /* Invalid QoS. */
     operation = MQTT_SEND;
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, 3, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, 3, MQTTPublishSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, 3, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
     operation = MQTT_RECEIVE;
@@ -355,19 +460,19 @@ void test_MQTT_UpdateStatePublish( void )
 
     /* Invalid current state. */
     operation = MQTT_SEND;
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, qos, MQTTStateNull );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, qos, MQTTStateNull );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
 
     /* Collision. */
     operation = MQTT_RECEIVE;
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPubAckSend );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPubAckSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTStateCollision, status );
 
     /* No memory. */
     operation = MQTT_RECEIVE;
-    fillRecord( mqttContext.incomingPublishRecords, 2, MQTTQoS1, MQTTPublishSend );
+    fillRecord( INCOMING( mqttContext ), 2, MQTTQoS1, MQTTPublishSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTNoMemory, status );
 
@@ -377,27 +482,27 @@ void test_MQTT_UpdateStatePublish( void )
     qos = MQTTQoS1;
     /* Send. */
     operation = MQTT_SEND;
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPublishSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubAckPending, state );
-    TEST_ASSERT_EQUAL( MQTTPubAckPending, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubAckPending, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
     /* Resend when record already exists. */
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubAckPending, state );
-    TEST_ASSERT_EQUAL( MQTTPubAckPending, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubAckPending, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
     /* Receive. */
     operation = MQTT_RECEIVE;
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubAckSend, state );
-    TEST_ASSERT_EQUAL( MQTTPubAckSend, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubAckSend, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
     /* Receive duplicate incoming publish. */
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTStateCollision, status );
     TEST_ASSERT_EQUAL( MQTTPubAckSend, state );
-    TEST_ASSERT_EQUAL( MQTTPubAckSend, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubAckSend, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
 
     resetPublishRecords( &mqttContext );
 
@@ -405,34 +510,34 @@ void test_MQTT_UpdateStatePublish( void )
     qos = MQTTQoS2;
     /* Send. */
     operation = MQTT_SEND;
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRecPending, state );
-    TEST_ASSERT_EQUAL( MQTTPubRecPending, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubRecPending, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
     /* Resend when record already exists. */
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRecPending, state );
-    TEST_ASSERT_EQUAL( MQTTPubRecPending, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubRecPending, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
     /* Receive. */
     operation = MQTT_RECEIVE;
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRecSend, state );
-    TEST_ASSERT_EQUAL( MQTTPubRecSend, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubRecSend, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
     /* Receive incoming publish when the packet record is in state #MQTTPubRecSend. */
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTStateCollision, status );
     TEST_ASSERT_EQUAL( MQTTPubRecSend, state );
-    TEST_ASSERT_EQUAL( MQTTPubRecSend, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubRecSend, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
     /* Receive incoming publish when the packet record is in state #MQTTPubRelPending. */
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
     status = MQTT_UpdateStatePublish( &mqttContext, PACKET_ID, operation, qos, &state );
     TEST_ASSERT_EQUAL( MQTTStateCollision, status );
     /* The returned state will always be #MQTTPubRecSend as a PUBREC need to be sent. */
     TEST_ASSERT_EQUAL( MQTTPubRecSend, state );
-    TEST_ASSERT_EQUAL( MQTTPubRelPending, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubRelPending, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
 }
 
 /* ========================================================================== */
@@ -504,6 +609,8 @@ void test_MQTT_UpdateStateAck( void )
     MQTTPubAckType_t ack = MQTTPuback;
     MQTTStateOperation_t operation = MQTT_RECEIVE;
     MQTTPublishState_t state = MQTTStateNull;
+    MQTTPublishState_t resendState = MQTTStateNull;
+    MQTTStateCursor_t cursor = MQTT_STATE_CURSOR_INITIALIZER;
     MQTTStatus_t status;
 
     const uint16_t PACKET_ID = 1;
@@ -522,23 +629,23 @@ void test_MQTT_UpdateStateAck( void )
 
     /* Invalid transitions. */
     /* Invalid transition from #MQTTPubRelPending. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
     ack = MQTTPubrel;
     operation = MQTT_SEND;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
     /* Invalid transition from #MQTTPubCompSend. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubCompSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubCompSend );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
     /* Invalid transition from #MQTTPubCompPending. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
     ack = MQTTPubrec;
     operation = MQTT_RECEIVE;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
     /* Invalid transition from #MQTTPubRecPending. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
     ack = MQTTPubcomp;
     status = MQTT_UpdateStateAck( &mqttContext, 1, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
@@ -548,20 +655,20 @@ void test_MQTT_UpdateStateAck( void )
     TEST_ASSERT_EQUAL( MQTTBadParameter, status );
 
     /* Invalid current state. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPublishDone );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPublishDone );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPublishSend );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTStateNull );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTStateNull );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTIllegalState, status );
 
     resetPublishRecords( &mqttContext );
 
     /* QoS 1, receive PUBACK for outgoing publish. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPubAckPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPubAckPending );
     operation = MQTT_RECEIVE;
     ack = MQTTPuback;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
@@ -569,10 +676,10 @@ void test_MQTT_UpdateStateAck( void )
     TEST_ASSERT_EQUAL( MQTTPublishDone, state );
 
     /* Test for deletion. */
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 0 ].packetId );
+    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 0 ).packetId );
     /* Send PUBACK for incoming publish. */
     operation = MQTT_SEND;
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS1, MQTTPubAckSend );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS1, MQTTPubAckSend );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPublishDone, state );
@@ -581,7 +688,7 @@ void test_MQTT_UpdateStateAck( void )
 
     /* QoS 2, PUBREL. */
     /* Outgoing. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRelSend );
     operation = MQTT_SEND;
     ack = MQTTPubrel;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
@@ -594,13 +701,13 @@ void test_MQTT_UpdateStateAck( void )
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubCompPending, state );
     /* Incoming. */
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
     operation = MQTT_RECEIVE;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubCompSend, state );
     /* Test for update. */
-    TEST_ASSERT_EQUAL( MQTTPubCompSend, mqttContext.incomingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( MQTTPubCompSend, RECORD_AT( INCOMING( mqttContext ), 0 ).publishState );
     /* Incoming. Duplicate PUBREL is received when record is in state #MQTTPubRelPending. */
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
@@ -608,7 +715,7 @@ void test_MQTT_UpdateStateAck( void )
 
     /* QoS 2, PUBREC. */
     /* Outgoing. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
     operation = MQTT_RECEIVE;
     ack = MQTTPubrec;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
@@ -617,50 +724,58 @@ void test_MQTT_UpdateStateAck( void )
 
     /* Receiving a PUBREC will move the record to the end.
      * In this case, only one record exists, no moving is required. */
-    TEST_ASSERT_EQUAL( PACKET_ID, mqttContext.outgoingPublishRecords[ 0 ].packetId );
-    TEST_ASSERT_EQUAL( MQTTQoS2, mqttContext.outgoingPublishRecords[ 0 ].qos );
-    TEST_ASSERT_EQUAL( MQTTPubRelSend, mqttContext.outgoingPublishRecords[ 0 ].publishState );
+    TEST_ASSERT_EQUAL( PACKET_ID, RECORD_AT( OUTGOING( mqttContext ), 0 ).packetId );
+    TEST_ASSERT_EQUAL( MQTTQoS2, RECORD_AT( OUTGOING( mqttContext ), 0 ).qos );
+    TEST_ASSERT_EQUAL( MQTTPubRelSend, RECORD_AT( OUTGOING( mqttContext ), 0 ).publishState );
 
     /* Outgoing.
      * Test if the record moves to the end of the records when PUBREC is
      * received. */
     resetPublishRecords( &mqttContext );
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
-    addToRecord( mqttContext.outgoingPublishRecords, 1, PACKET_ID + 1, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecPending );
+    addToRecord( OUTGOING( mqttContext ), 1, PACKET_ID + 1, MQTTQoS2, MQTTPubRelSend );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRelSend, state );
 
-    /* Receiving a PUBREC will move the record to the end.
-     * In this case, the record will be moved to index 2. */
-    TEST_ASSERT_EQUAL( PACKET_ID, mqttContext.outgoingPublishRecords[ 2 ].packetId );
-    TEST_ASSERT_EQUAL( MQTTQoS2, mqttContext.outgoingPublishRecords[ 2 ].qos );
-    TEST_ASSERT_EQUAL( MQTTPubRelSend, mqttContext.outgoingPublishRecords[ 2 ].publishState );
-    /* Record at the current index will be marked as invalid. */
-    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, mqttContext.outgoingPublishRecords[ 0 ].packetId );
+    #if ( MQTT_STATE_INDEXED == 0 )
+
+        /* Receiving a PUBREC will move the record to the end.
+         * In this case, the record will be moved to index 2. */
+        TEST_ASSERT_EQUAL( PACKET_ID, RECORD_AT( OUTGOING( mqttContext ), 2 ).packetId );
+        TEST_ASSERT_EQUAL( MQTTQoS2, RECORD_AT( OUTGOING( mqttContext ), 2 ).qos );
+        TEST_ASSERT_EQUAL( MQTTPubRelSend, RECORD_AT( OUTGOING( mqttContext ), 2 ).publishState );
+        /* Record at the current index will be marked as invalid. */
+        TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, RECORD_AT( OUTGOING( mqttContext ), 0 ).packetId );
+    #endif
+
+    /* Either way, the PUBREL for the moved record is resent last. */
+    TEST_ASSERT_EQUAL( PACKET_ID + 1, MQTT_PubrelToResend( &mqttContext, &cursor, &resendState ) );
+    TEST_ASSERT_EQUAL( PACKET_ID, MQTT_PubrelToResend( &mqttContext, &cursor, &resendState ) );
+    TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, MQTT_PubrelToResend( &mqttContext, &cursor, &resendState ) );
 
     /* Incoming. */
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRecSend );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRecSend );
     operation = MQTT_SEND;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRelPending, state );
     /* Incoming. Duplicate publish received and record is in state #MQTTPubRelPending. */
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubRelPending );
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPubRelPending, state );
 
     /* QoS 2, PUBCOMP. */
     /* Outgoing. */
-    addToRecord( mqttContext.outgoingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
+    addToRecord( OUTGOING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
     operation = MQTT_RECEIVE;
     ack = MQTTPubcomp;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
     TEST_ASSERT_EQUAL( MQTTPublishDone, state );
     /* Incoming. */
-    addToRecord( mqttContext.incomingPublishRecords, 0, PACKET_ID, MQTTQoS2, MQTTPubCompSend );
+    addToRecord( INCOMING( mqttContext ), 0, PACKET_ID, MQTTQoS2, MQTTPubCompSend );
     operation = MQTT_SEND;
     status = MQTT_UpdateStateAck( &mqttContext, PACKET_ID, ack, operation, &state );
     TEST_ASSERT_EQUAL( MQTTSuccess, status );
@@ -697,34 +812,34 @@ void test_MQTT_AckToResend( void )
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
     TEST_ASSERT_EQUAL( MQTTStateNull, state );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
 
     /* No packet exists in state #MQTTPubCompPending or #MQTTPubCompPending states. */
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
-    addToRecord( mqttContext.outgoingPublishRecords, index, PACKET_ID3, MQTTQoS2, MQTTPubRelPending );
-    addToRecord( mqttContext.outgoingPublishRecords, index2, PACKET_ID4, MQTTQoS2, MQTTPubCompSend );
+    addToRecord( OUTGOING( mqttContext ), index, PACKET_ID3, MQTTQoS2, MQTTPubRelPending );
+    addToRecord( OUTGOING( mqttContext ), index2, PACKET_ID4, MQTTQoS2, MQTTPubCompSend );
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
     TEST_ASSERT_EQUAL( MQTTStateNull, state );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
 
     /* Add a record in #MQTTPubCompPending state. */
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
-    addToRecord( mqttContext.outgoingPublishRecords, index3, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
+    addToRecord( OUTGOING( mqttContext ), index3, PACKET_ID, MQTTQoS2, MQTTPubCompPending );
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( PACKET_ID, packetId );
     TEST_ASSERT_EQUAL( index3 + 1, cursor );
     TEST_ASSERT_EQUAL( MQTTPubRelSend, state );
 
     /* Add another record in #MQTTPubCompPending state. */
-    addToRecord( mqttContext.outgoingPublishRecords, index4, PACKET_ID2, MQTTQoS2, MQTTPubCompPending );
+    addToRecord( OUTGOING( mqttContext ), index4, PACKET_ID2, MQTTQoS2, MQTTPubCompPending );
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( PACKET_ID2, packetId );
     TEST_ASSERT_EQUAL( index4 + 1, cursor );
     TEST_ASSERT_EQUAL( MQTTPubRelSend, state );
 
     /* Add another record in #MQTTPubRelSend state. */
-    addToRecord( mqttContext.outgoingPublishRecords, index4 + 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), index4 + 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRelSend );
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( PACKET_ID2 + 1, packetId );
     TEST_ASSERT_EQUAL( index4 + 2, cursor );
@@ -733,7 +848,7 @@ void test_MQTT_AckToResend( void )
     /* Only one record in #MQTTPubRelSend state. */
     resetPublishRecords( &mqttContext );
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
-    addToRecord( mqttContext.outgoingPublishRecords, index3, PACKET_ID, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), index3, PACKET_ID, MQTTQoS2, MQTTPubRelSend );
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( PACKET_ID, packetId );
     TEST_ASSERT_EQUAL( index3 + 1, cursor );
@@ -744,7 +859,7 @@ void test_MQTT_AckToResend( void )
     packetId = MQTT_PubrelToResend( &mqttContext, &cursor, &state );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
     TEST_ASSERT_EQUAL( MQTTStateNull, state );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
 }
 
 void test_MQTT_PublishToResend( void )
@@ -772,32 +887,32 @@ void test_MQTT_PublishToResend( void )
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
 
     /* No packet exists in state #MQTTPublishSend, #MQTTPubAckPending and
      * #MQTTPubRecPending states. */
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
-    addToRecord( mqttContext.outgoingPublishRecords, index, PACKET_ID3, MQTTQoS2, MQTTPubCompPending );
-    addToRecord( mqttContext.outgoingPublishRecords, index2, PACKET_ID4, MQTTQoS2, MQTTPubRelSend );
+    addToRecord( OUTGOING( mqttContext ), index, PACKET_ID3, MQTTQoS2, MQTTPubCompPending );
+    addToRecord( OUTGOING( mqttContext ), index2, PACKET_ID4, MQTTQoS2, MQTTPubRelSend );
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
 
     /* Add a record in #MQTTPublishSend state. */
     cursor = MQTT_STATE_CURSOR_INITIALIZER;
-    addToRecord( mqttContext.outgoingPublishRecords, index3, PACKET_ID, MQTTQoS2, MQTTPublishSend );
+    addToRecord( OUTGOING( mqttContext ), index3, PACKET_ID, MQTTQoS2, MQTTPublishSend );
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( PACKET_ID, packetId );
     TEST_ASSERT_EQUAL( index3 + 1, cursor );
 
     /* Add another record in #MQTTPubAckPending state. */
-    addToRecord( mqttContext.outgoingPublishRecords, index4, PACKET_ID2, MQTTQoS1, MQTTPubAckPending );
+    addToRecord( OUTGOING( mqttContext ), index4, PACKET_ID2, MQTTQoS1, MQTTPubAckPending );
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( PACKET_ID2, packetId );
     TEST_ASSERT_EQUAL( index4 + 1, cursor );
 
     /* Add another record in #MQTTPubRecPending state. */
-    addToRecord( mqttContext.outgoingPublishRecords, index4 + 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRecPending );
+    addToRecord( OUTGOING( mqttContext ), index4 + 1, PACKET_ID2 + 1, MQTTQoS2, MQTTPubRecPending );
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( PACKET_ID2 + 1, packetId );
     TEST_ASSERT_EQUAL( index4 + 2, cursor );
@@ -805,7 +920,263 @@ void test_MQTT_PublishToResend( void )
     /* Further search should find no packets. */
     packetId = MQTT_PublishToResend( &mqttContext, &cursor );
     TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, packetId );
-    TEST_ASSERT_EQUAL( MQTT_STATE_ARRAY_MAX_COUNT, cursor );
+    TEST_ASSERT_EQUAL( CURSOR_END( mqttContext ), cursor );
+}
+
+/* ========================================================================== */
+
+void test_MQTT_State_collidingPacketIds( void )
+{
+    MQTTContext_t mqttContext = { 0 };
+    MQTTPublishState_t state = MQTTStateNull;
+    uint16_t packetIds[ MQTT_STATE_ARRAY_MAX_COUNT ];
+    size_t i;
+
+    /* Packet IDs that all map to the last slot of the packet ID index, so that
+     * their probe sequences collide and wrap around the end of the index. */
+    for( i = 0; i < MQTT_STATE_ARRAY_MAX_COUNT; i++ )
+    {
+        packetIds[ i ] = ( uint16_t ) ( ( MQTT_STATE_INDEX_SIZE - 1U ) + ( i * MQTT_STATE_INDEX_SIZE ) );
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_ReserveState( &mqttContext, packetIds[ i ], MQTTQoS1 ) );
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStatePublish( &mqttContext, packetIds[ i ], MQTT_SEND, MQTTQoS1, &state ) );
+        TEST_ASSERT_EQUAL( MQTTPubAckPending, state );
+    }
+
+    validateRecordAt( OUTGOING( mqttContext ), 0, packetIds[ 0 ], MQTTQoS1, MQTTPubAckPending );
+    TEST_ASSERT_EQUAL( MQTTStateCollision, MQTT_ReserveState( &mqttContext, packetIds[ 3 ], MQTTQoS1 ) );
+    TEST_ASSERT_EQUAL( MQTTNoMemory, MQTT_ReserveState( &mqttContext, 1, MQTTQoS1 ) );
+
+    /* Acknowledge every other record, removing entries from the middle of the
+     * probe sequence; the remaining records must still be found. */
+    for( i = 0; i < MQTT_STATE_ARRAY_MAX_COUNT; i += 2U )
+    {
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetIds[ i ], MQTTPuback, MQTT_RECEIVE, &state ) );
+        TEST_ASSERT_EQUAL( MQTTPublishDone, state );
+    }
+
+    for( i = 1; i < MQTT_STATE_ARRAY_MAX_COUNT; i += 2U )
+    {
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStatePublish( &mqttContext, packetIds[ i ], MQTT_SEND, MQTTQoS1, &state ) );
+        TEST_ASSERT_EQUAL( MQTTPubAckPending, state );
+        TEST_ASSERT_EQUAL( MQTTBadResponse, MQTT_UpdateStateAck( &mqttContext, packetIds[ i - 1U ], MQTTPuback, MQTT_RECEIVE, &state ) );
+    }
+
+    /* Acknowledge the rest in reverse order. */
+    for( i = MQTT_STATE_ARRAY_MAX_COUNT; i > 0U; i-- )
+    {
+        if( ( ( i - 1U ) % 2U ) == 1U )
+        {
+            TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetIds[ i - 1U ], MQTTPuback, MQTT_RECEIVE, &state ) );
+        }
+    }
+
+    /* All records are free again. */
+    for( i = 0; i < MQTT_STATE_ARRAY_MAX_COUNT; i++ )
+    {
+        TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_ReserveState( &mqttContext, packetIds[ MQTT_STATE_ARRAY_MAX_COUNT - 1U - i ], MQTTQoS2 ) );
+    }
+
+    TEST_ASSERT_EQUAL( MQTTNoMemory, MQTT_ReserveState( &mqttContext, 1, MQTTQoS1 ) );
+}
+
+/* ========================================================================== */
+
+void test_MQTT_State_randomOperations( void )
+{
+    MQTTContext_t mqttContext = { 0 };
+    ModelRecord_t outgoing[ MQTT_STATE_ARRAY_MAX_COUNT ];
+    ModelRecord_t incoming[ MQTT_STATE_ARRAY_MAX_COUNT ];
+    ModelRecord_t moved;
+    size_t outgoingCount = 0, incomingCount = 0, i;
+    uint32_t seed = 1U, step;
+    uint16_t packetId;
+    MQTTQoS_t qos;
+    MQTTPublishState_t state, expected;
+    MQTTStatus_t status;
+
+    /* Drive the state engine with random publishes and acknowledgments, and
+     * check every result against a plain list of records in sending order. */
+    for( step = 0; step < 20000U; step++ )
+    {
+        packetId = ( uint16_t ) ( 1U + ( nextRandom( &seed ) % ( 3U * MQTT_STATE_ARRAY_MAX_COUNT ) ) );
+        qos = ( ( nextRandom( &seed ) % 2U ) == 0U ) ? MQTTQoS1 : MQTTQoS2;
+
+        switch( nextRandom( &seed ) % 5U )
+        {
+            case 0:
+                /* Outgoing publish. */
+                status = MQTT_ReserveState( &mqttContext, packetId, qos );
+
+                if( modelFind( outgoing, outgoingCount, packetId ) < outgoingCount )
+                {
+                    TEST_ASSERT_EQUAL( MQTTStateCollision, status );
+                }
+                else if( outgoingCount == MQTT_STATE_ARRAY_MAX_COUNT )
+                {
+                    TEST_ASSERT_EQUAL( MQTTNoMemory, status );
+                }
+                else
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, status );
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStatePublish( &mqttContext, packetId, MQTT_SEND, qos, &state ) );
+                    outgoing[ outgoingCount ].packetId = packetId;
+                    outgoing[ outgoingCount ].qos = qos;
+                    outgoing[ outgoingCount ].state = MQTT_CalculateStatePublish( MQTT_SEND, qos );
+                    TEST_ASSERT_EQUAL( outgoing[ outgoingCount ].state, state );
+                    outgoingCount++;
+                }
+
+                break;
+
+            case 1:
+                /* Acknowledgment for an outgoing publish. */
+                i = modelFind( outgoing, outgoingCount, packetId );
+
+                if( i == outgoingCount )
+                {
+                    TEST_ASSERT_EQUAL( MQTTBadResponse, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPuback, MQTT_RECEIVE, &state ) );
+                }
+                else if( outgoing[ i ].state == MQTTPubAckPending )
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPuback, MQTT_RECEIVE, &state ) );
+                    TEST_ASSERT_EQUAL( MQTTPublishDone, state );
+                    modelRemove( outgoing, &outgoingCount, i );
+                }
+                else if( outgoing[ i ].state == MQTTPubRecPending )
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPubrec, MQTT_RECEIVE, &state ) );
+                    TEST_ASSERT_EQUAL( MQTTPubRelSend, state );
+
+                    /* The record moves to the end to keep the PUBREL order. */
+                    moved = outgoing[ i ];
+                    moved.state = MQTTPubRelSend;
+                    modelRemove( outgoing, &outgoingCount, i );
+                    outgoing[ outgoingCount ] = moved;
+                    outgoingCount++;
+                }
+                else if( outgoing[ i ].state == MQTTPubRelSend )
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPubrel, MQTT_SEND, &state ) );
+                    TEST_ASSERT_EQUAL( MQTTPubCompPending, state );
+                    outgoing[ i ].state = MQTTPubCompPending;
+                }
+                else
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPubcomp, MQTT_RECEIVE, &state ) );
+                    TEST_ASSERT_EQUAL( MQTTPublishDone, state );
+                    modelRemove( outgoing, &outgoingCount, i );
+                }
+
+                break;
+
+            case 2:
+                /* Incoming publish. */
+                status = MQTT_UpdateStatePublish( &mqttContext, packetId, MQTT_RECEIVE, qos, &state );
+
+                if( modelFind( incoming, incomingCount, packetId ) < incomingCount )
+                {
+                    TEST_ASSERT_EQUAL( MQTTStateCollision, status );
+                }
+                else if( incomingCount == MQTT_STATE_ARRAY_MAX_COUNT )
+                {
+                    TEST_ASSERT_EQUAL( MQTTNoMemory, status );
+                }
+                else
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, status );
+                    incoming[ incomingCount ].packetId = packetId;
+                    incoming[ incomingCount ].qos = qos;
+                    incoming[ incomingCount ].state = MQTT_CalculateStatePublish( MQTT_RECEIVE, qos );
+                    TEST_ASSERT_EQUAL( incoming[ incomingCount ].state, state );
+                    incomingCount++;
+                }
+
+                break;
+
+            case 3:
+                /* Acknowledgment for an incoming publish. */
+                i = modelFind( incoming, incomingCount, packetId );
+
+                if( i == incomingCount )
+                {
+                    TEST_ASSERT_EQUAL( MQTTBadResponse, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPubrel, MQTT_RECEIVE, &state ) );
+                }
+                else if( incoming[ i ].state == MQTTPubAckSend )
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStateAck( &mqttContext, packetId, MQTTPuback, MQTT_SEND, &state ) );
+                    TEST_ASSERT_EQUAL( MQTTPublishDone, state );
+                    modelRemove( incoming, &incomingCount, i );
+                }
+                else
+                {
+                    expected = ( incoming[ i ].state == MQTTPubRecSend ) ? MQTTPubRelPending :
+                               ( incoming[ i ].state == MQTTPubRelPending ) ? MQTTPubCompSend : MQTTPublishDone;
+                    status = MQTT_UpdateStateAck( &mqttContext,
+                                                  packetId,
+                                                  ( incoming[ i ].state == MQTTPubRecSend ) ? MQTTPubrec :
+                                                  ( incoming[ i ].state == MQTTPubRelPending ) ? MQTTPubrel : MQTTPubcomp,
+                                                  ( incoming[ i ].state == MQTTPubRelPending ) ? MQTT_RECEIVE : MQTT_SEND,
+                                                  &state );
+                    TEST_ASSERT_EQUAL( MQTTSuccess, status );
+                    TEST_ASSERT_EQUAL( expected, state );
+
+                    if( expected == MQTTPublishDone )
+                    {
+                        modelRemove( incoming, &incomingCount, i );
+                    }
+                    else
+                    {
+                        incoming[ i ].state = expected;
+                    }
+                }
+
+                break;
+
+            default:
+                /* Resend of an outgoing publish; the state must not change. */
+                i = modelFind( outgoing, outgoingCount, packetId );
+
+                if( ( i < outgoingCount ) &&
+                    ( ( outgoing[ i ].state == MQTTPubAckPending ) || ( outgoing[ i ].state == MQTTPubRecPending ) ) )
+                {
+                    TEST_ASSERT_EQUAL( MQTTSuccess, MQTT_UpdateStatePublish( &mqttContext, packetId, MQTT_SEND, outgoing[ i ].qos, &state ) );
+                    TEST_ASSERT_EQUAL( outgoing[ i ].state, state );
+                }
+
+                break;
+        }
+
+        #if ( MQTT_STATE_INDEXED == 1 )
+        {
+            MQTTStateCursor_t cursor = MQTT_STATE_CURSOR_INITIALIZER;
+
+            /* Resends must come out in sending order. The linear backend only
+             * invalidates the packet ID of a deleted record, so there a resend
+             * scan can stop early at a deleted record. */
+            for( i = 0; i < outgoingCount; i++ )
+            {
+                if( ( outgoing[ i ].state == MQTTPubAckPending ) || ( outgoing[ i ].state == MQTTPubRecPending ) )
+                {
+                    TEST_ASSERT_EQUAL( outgoing[ i ].packetId, MQTT_PublishToResend( &mqttContext, &cursor ) );
+                }
+            }
+
+            TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, MQTT_PublishToResend( &mqttContext, &cursor ) );
+
+            cursor = MQTT_STATE_CURSOR_INITIALIZER;
+
+            for( i = 0; i < outgoingCount; i++ )
+            {
+                if( ( outgoing[ i ].state == MQTTPubRelSend ) || ( outgoing[ i ].state == MQTTPubCompPending ) )
+                {
+                    TEST_ASSERT_EQUAL( outgoing[ i ].packetId, MQTT_PubrelToResend( &mqttContext, &cursor, &state ) );
+                }
+            }
+
+            TEST_ASSERT_EQUAL( MQTT_PACKET_ID_INVALID, MQTT_PubrelToResend( &mqttContext, &cursor, &state ) );
+        }
+        #endif /* if ( MQTT_STATE_INDEXED == 1 ) */
+    }
 }
 
 /* ========================================================================== */
@@ -76,6 +76,16 @@
  */
 #define MQTT_SAMPLE_PROCESS_LOOP_TIMEOUT_MS    ( 1U )
 
+/**
+ * @brief Access the record array of a set of state records, whichever state
+ * backend is configured.
+ */
+#if ( MQTT_STATE_INDEXED == 1 )
+    #define STATE_RECORDS( recordSet )    ( ( recordSet ).records )
+#else
+    #define STATE_RECORDS( recordSet )    ( recordSet )
+#endif
+
 /**
  * @brief Zero timeout in the process loop implies one iteration.
  */
@@ -1106,7 +1116,7 @@ void test_MQTT_Connect_happy_path()
     TransportInterface_t transport;
     MQTTFixedBuffer_t networkBuffer;
     MQTTPacketInfo_t incomingPacket;
-    MQTTPubAckInfo_t cleanRecords[ MQTT_STATE_ARRAY_MAX_COUNT ] = { 0 };
+    uint8_t cleanRecords[ sizeof( mqttContext.outgoingPublishRecords ) ] = { 0 };
 
     setupTransportInterface( &transport );
     setupNetworkBuffer( &networkBuffer );
@@ -1149,10 +1159,10 @@ void test_MQTT_Connect_happy_path()
 
     /* Populate some state records to make sure they are cleared since a clean session
      * will be established. */
-    mqttContext.outgoingPublishRecords[ 0 ].packetId = 1;
-    mqttContext.outgoingPublishRecords[ 0 ].qos = MQTTQoS2;
-    mqttContext.outgoingPublishRecords[ 0 ].publishState = MQTTPublishSend;
-    mqttContext.incomingPublishRecords[ MQTT_STATE_ARRAY_MAX_COUNT - 1 ].packetId = 1;
+    STATE_RECORDS( mqttContext.outgoingPublishRecords )[ 0 ].packetId = 1;
+    STATE_RECORDS( mqttContext.outgoingPublishRecords )[ 0 ].qos = MQTTQoS2;
+    STATE_RECORDS( mqttContext.outgoingPublishRecords )[ 0 ].publishState = MQTTPublishSend;
+    STATE_RECORDS( mqttContext.incomingPublishRecords )[ MQTT_STATE_ARRAY_MAX_COUNT - 1 ].packetId = 1;
     /* Set ping response flag to true to ensure it will be cleared. */
     mqttContext.waitingForPingResp = true;
     MQTT_GetIncomingPacketTypeAndLength_ExpectAnyArgsAndReturn( MQTTSuccess );
@@ -1166,8 +1176,8 @@ void test_MQTT_Connect_happy_path()
     TEST_ASSERT_FALSE( mqttContext.waitingForPingResp );
     TEST_ASSERT_FALSE( sessionPresent );
     /* Test old records were cleared. */
-    TEST_ASSERT_EQUAL_MEMORY( cleanRecords, mqttContext.outgoingPublishRecords, sizeof( cleanRecords ) );
-    TEST_ASSERT_EQUAL_MEMORY( cleanRecords, mqttContext.incomingPublishRecords, sizeof( cleanRecords ) );
+    TEST_ASSERT_EQUAL_MEMORY( cleanRecords, &( mqttContext.outgoingPublishRecords ), sizeof( cleanRecords ) );
+    TEST_ASSERT_EQUAL_MEMORY( cleanRecords, &( mqttContext.incomingPublishRecords ), sizeof( cleanRecords ) );
 
     /* Request to establish a session if present and session present is received
      * from broker. */
@@ -21,6 +21,7 @@
 #include "eelcodes.h"
 #include "board.h"
 #include "dmm.h"
+#include "pool.h"
 #include "log.h"
 #include "twdt.h"
 #include "cli.h"
@@ -28,6 +29,8 @@
 #include "tls.h"
 #include "slm.h"
 #include "mqtt.h"
+#include "dtls.h"
+#include "coap.h"
 #include "fs.h"
 #include "blinky.h"
 #if NRFX_SPIM_ENABLED
@@ -99,6 +102,16 @@ void app_Thread( void * parameter_ptr )
         Log.ErrorPrint( "Error: 0x%04x", error );
     }
 
+    if ( ( error = dtls.Init() ) != NO_ERROR )
+    {
+        Log.ErrorPrint( "Error: 0x%04x", error );
+    }
+
+    if ( ( error = coap.Init() ) != NO_ERROR )
+    {
+        Log.ErrorPrint( "Error: 0x%04x", error );
+    }
+
 #if NRFX_SPIM_ENABLED
     if ( ( error = spimtest.Init() ) != NO_ERROR )
     {
@@ -135,12 +148,17 @@ error_code_module_t app_Init( void )
     /* Singleton pattern */
     if ( app_obj.is_init == false )
     {
-        /* Make sure the heap, board, logging and watchdog tasks are initialized first */
+        /* Make sure the heap, pools, board, logging and watchdog tasks are initialized first */
         if ( ( error = dmm.Init( dmm_handle_0, shared_struct->heap, APP_HEAP_SIZE ) != NO_ERROR ) )
         {
             printf( "Error: 0x%04x\r\n", error );
         }
 
+        if ( ( error = pool.Init( shared_struct->pool, POOL_MEM_SIZE ) ) != NO_ERROR )
+        {
+            printf( "Error: 0x%04x\r\n", error );
+        }
+
         if ( ( error = board.Init() ) != NO_ERROR )
         {
             printf( "Error: 0x%04x\r\n", error );
@@ -193,31 +211,31 @@ error_code_module_t app_Init( void )
     return error;
 }
 
-QueueHandle_t app_GetLogHandle( void )
+MailboxHandle_t app_GetLogHandle( void )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
     return shared_struct->log_queue;
 }
 
-QueueHandle_t app_GetCliQHandle( void )
+MailboxHandle_t app_GetCliQHandle( void )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
     return shared_struct->cli_queue;
 }
 
-QueueHandle_t app_GetSlmQHandle( void )
+MailboxHandle_t app_GetSlmQHandle( void )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
     return shared_struct->slm_queue;
 }
 
-QueueHandle_t app_GetFsQHandle( void )
+MailboxHandle_t app_GetFsQHandle( void )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
     return shared_struct->fs_queue;
 }
 
-QueueHandle_t app_GetMqttQHandle( void )
+MailboxHandle_t app_GetMqttQHandle( void )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
     return shared_struct->mqtt_queue;
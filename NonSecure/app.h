@@ -32,10 +32,16 @@
 #define MEDIUM_MSG_MAX                  ( 256 )
 #define LONG_MSG_MAX                    ( 1024 )
 #define APP_HEAP_SIZE                   ( 8192 )
+#define POOL_SHORT_COUNT                ( 26 )        /* 8 general + CLI and MQTT mailboxes */
+#define POOL_MEDIUM_COUNT               ( 29 )        /* 4 general + log, SLM and FS mailboxes */
+#define POOL_LONG_COUNT                 ( 3 )
+#define POOL_MEM_SIZE                   ( POOL_SHORT_COUNT * SHORT_MSG_MAX + \
+                                          POOL_MEDIUM_COUNT * MEDIUM_MSG_MAX + \
+                                          POOL_LONG_COUNT * LONG_MSG_MAX )
 #define TASK_HIGH_PRIORITY              ( tskIDLE_PRIORITY + 1 )
 #define TASK_LOW_PRIORITY               ( tskIDLE_PRIORITY )
 #define MAX_TASKS                       ( 16 )
-#define SHAREDMEM_SIZE                  ( 512 + APP_HEAP_SIZE )
+#define SHAREDMEM_SIZE                  ( 512 + APP_HEAP_SIZE + POOL_MEM_SIZE )
 
 /***************************************************************************************************************************
  * Public data structures and typedefs
@@ -51,12 +57,14 @@ typedef struct
 typedef struct
 {
     uint8_t heap[ APP_HEAP_SIZE ];
-    QueueHandle_t log_queue;
-    QueueHandle_t cli_queue;
-    QueueHandle_t slm_queue;
-    QueueHandle_t fs_queue;
-    QueueHandle_t mqtt_queue;
+    uint8_t pool[ POOL_MEM_SIZE ];
+    MailboxHandle_t log_queue;
+    MailboxHandle_t cli_queue;
+    MailboxHandle_t slm_queue;
+    MailboxHandle_t fs_queue;
+    MailboxHandle_t mqtt_queue;
     task_status_t task_status[ MAX_TASKS ];
+    uint32_t log_early_drops;
     uint32_t time_led;
     uint32_t num_led;
     bool mqtt_enable;
@@ -68,11 +76,11 @@ typedef struct
 typedef struct
 {
     error_code_module_t ( *Init )( void );
-    QueueHandle_t ( *GetLogHandle )( void );
-    QueueHandle_t ( *GetCliQHandle )( void );
-    QueueHandle_t ( *GetSlmQHandle )( void );
-    QueueHandle_t ( *GetFsQHandle )( void );
-    QueueHandle_t ( *GetMqttQHandle )( void );
+    MailboxHandle_t ( *GetLogHandle )( void );
+    MailboxHandle_t ( *GetCliQHandle )( void );
+    MailboxHandle_t ( *GetSlmQHandle )( void );
+    MailboxHandle_t ( *GetFsQHandle )( void );
+    MailboxHandle_t ( *GetMqttQHandle )( void );
 } const app_interface_t;
 
 /***************************************************************************************************************************
@@ -51,34 +51,34 @@ typedef struct
 static error_code_module_t app_Init( void );
 
 /**
- * @brief       Return queue handle of log task.
- * @return      Log queue handle.
+ * @brief       Return mailbox handle of log task.
+ * @return      Log mailbox handle.
  */
-static QueueHandle_t app_GetLogHandle( void );
+static MailboxHandle_t app_GetLogHandle( void );
 
 /**
- * @brief       Return queue handle of command line interface task.
- * @return      CLI queue handle.
+ * @brief       Return mailbox handle of command line interface task.
+ * @return      CLI mailbox handle.
  */
-static QueueHandle_t app_GetCliQHandle( void );
+static MailboxHandle_t app_GetCliQHandle( void );
 
 /**
- * @brief       Return queue handle of serial LTE modem task.
- * @return      SLM queue handle.
+ * @brief       Return mailbox handle of serial LTE modem task.
+ * @return      SLM mailbox handle.
  */
-static QueueHandle_t app_GetSlmQHandle( void );
+static MailboxHandle_t app_GetSlmQHandle( void );
 
 /**
- * @brief       Return queue handle of file system task.
- * @return      FS queue handle.
+ * @brief       Return mailbox handle of file system task.
+ * @return      FS mailbox handle.
  */
-static QueueHandle_t app_GetFsQHandle( void );
+static MailboxHandle_t app_GetFsQHandle( void );
 
 /**
  * @brief       Return queue handle of file system task.
  * @return      MQTT client queue handle.
  */
-static QueueHandle_t app_GetMqttQHandle( void );
+static MailboxHandle_t app_GetMqttQHandle( void );
 
 /***************************************************************************************************************************
  * Private prototypes
@@ -0,0 +1,413 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      blob.c
+ * @brief     Mapped blob store module
+ * @details   Immutable, aligned objects in flash pages of their own, read in place through the memory map.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Blob Mapped blob store
+ * @brief     Read-only objects handed out as pointers into flash
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "blob_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+blob_interface_t blob =
+{
+    .Open               = &blob_Open,
+    .Begin              = &blob_Begin,
+    .Write              = &blob_Write,
+    .Commit             = &blob_Commit,
+    .Delete             = &blob_Delete,
+    .Format             = &blob_Format,
+    .Find               = &blob_Find,
+    .Report             = &blob_Report,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t blob_Open( blob_store_t *store, uint32_t base, uint32_t size )
+{
+    const blob_header_t *header = ( const blob_header_t * )base;
+    const blob_entry_t *entry;
+    error_code_module_t error = NO_ERROR;
+    uint32_t end;
+
+    if ( store == NULL || ( base % BLOB_PAGE_SIZE ) != 0 || ( size % BLOB_PAGE_SIZE ) != 0 || size < 2 * BLOB_PAGE_SIZE )
+    {
+        return ERROR_BLOB_BAD_PARAM;
+    }
+
+    memset( store, 0, sizeof( blob_store_t ) );
+    store->base = base;
+    store->size = size;
+    store->used = BLOB_PAGE_SIZE;
+    store->writing = -1;
+
+    if ( header->magic != BLOB_MAGIC || header->size != size )
+    {
+        Log.InfoPrint( "Formatting blob store" );
+        return blob_Format( store );
+    }
+
+    for ( ; store->entries < BLOB_ENTRY_COUNT; store->entries++ )
+    {
+        entry = blob_Entry( base, store->entries );
+        if ( entry->offset == BLOB_ERASED_WORD )
+        {
+            break;
+        }
+
+        // A reset while the entry was programmed may have left its length out
+        if ( entry->offset < BLOB_PAGE_SIZE || entry->offset > size || entry->length > size - entry->offset )
+        {
+            if ( entry->deleted == BLOB_ERASED_WORD )
+            {
+                blob_Retire( entry );
+                store->stats.abandoned++;
+            }
+            continue;
+        }
+        end = entry->offset + BLOB_ROUND( entry->length );
+        if ( end > store->used )
+        {
+            store->used = end;
+        }
+
+        if ( entry->deleted != BLOB_ERASED_WORD )
+        {
+            continue;
+        }
+        if ( entry->committed != BLOB_MAGIC )
+        {
+            blob_Retire( entry );
+            store->stats.abandoned++;
+        }
+        else if ( lfs_crc( BLOB_CRC_SEED, ( const void * )( base + entry->offset ), entry->length ) != entry->crc )
+        {
+            Log.ErrorPrint( "Blob %.*s fails its CRC", BLOB_NAME_MAX, entry->name );
+            blob_Retire( entry );
+            store->stats.crc_errors++;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t blob_Begin( blob_store_t *store, const char *name, uint32_t length )
+{
+    blob_entry_t entry;
+    error_code_module_t error = NO_ERROR;
+
+    blob_Abandon( store );
+    if ( name == NULL || strlen( name ) >= BLOB_NAME_MAX || length == 0 )
+    {
+        error = ERROR_BLOB_BAD_PARAM;
+    }
+    else if ( store->entries >= BLOB_ENTRY_COUNT || length > store->size - store->used ||
+              BLOB_ROUND( length ) > store->size - store->used )
+    {
+        error = ERROR_BLOB_FULL;
+    }
+    else
+    {
+        // Offset, length and name now; CRC and commit word once the data is in
+        memset( &entry, 0, sizeof( entry ) );
+        entry.offset = store->used;
+        entry.length = length;
+        memcpy( entry.name, name, strlen( name ) );
+        nrfx_nvmc_bytes_write( ( uint32_t )blob_Entry( store->base, store->entries ), &entry, offsetof( blob_entry_t, crc ) );
+
+        store->writing = store->entries++;
+        store->used += BLOB_ROUND( length );
+        store->written = 0;
+        store->crc = BLOB_CRC_SEED;
+        store->tail_length = 0;
+    }
+    store->error = error;
+
+    return error;
+}
+
+error_code_module_t blob_Write( blob_store_t *store, const uint8_t *data, uint32_t length )
+{
+    const blob_entry_t *entry;
+    error_code_module_t error = NO_ERROR;
+    uint32_t address, take, whole;
+
+    if ( store->error != NO_ERROR )
+    {
+        return store->error;
+    }
+    if ( store->writing < 0 )
+    {
+        return ERROR_BLOB_BAD_STATE;
+    }
+
+    entry = blob_Entry( store->base, store->writing );
+    if ( data == NULL || length > entry->length - store->written )
+    {
+        error = ERROR_BLOB_BAD_PARAM;
+        store->error = error;
+    }
+    else
+    {
+        address = store->base + entry->offset + store->written - store->tail_length;
+        store->crc = lfs_crc( store->crc, data, length );
+        store->written += length;
+
+        // Complete the word the last call began
+        if ( store->tail_length > 0 )
+        {
+            take = ( length < sizeof( store->tail ) - store->tail_length ) ? length : sizeof( store->tail ) - store->tail_length;
+            memcpy( &store->tail[ store->tail_length ], data, take );
+            store->tail_length += take;
+            data += take;
+            length -= take;
+            if ( store->tail_length == sizeof( store->tail ) )
+            {
+                nrfx_nvmc_bytes_write( address, store->tail, sizeof( store->tail ) );
+                address += sizeof( store->tail );
+                store->tail_length = 0;
+            }
+        }
+
+        // Whole words go straight in, the rest waits for the next call or the commit
+        whole = length & ~( sizeof( uint32_t ) - 1 );
+        if ( whole > 0 )
+        {
+            nrfx_nvmc_bytes_write( address, data, whole );
+        }
+        if ( length > whole )
+        {
+            memcpy( store->tail, &data[ whole ], length - whole );
+            store->tail_length = length - whole;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t blob_Commit( blob_store_t *store )
+{
+    const blob_entry_t *entry;
+    error_code_module_t error = NO_ERROR;
+    uint32_t i;
+
+    // A blob that failed to begin reports that failure here
+    if ( store->writing < 0 )
+    {
+        error = ( store->error != NO_ERROR ) ? store->error : ERROR_BLOB_BAD_STATE;
+        store->error = NO_ERROR;
+        return error;
+    }
+
+    entry = blob_Entry( store->base, store->writing );
+    if ( store->error != NO_ERROR )
+    {
+        error = store->error;
+    }
+    else if ( store->written != entry->length )
+    {
+        error = ERROR_BLOB_BAD_PARAM;
+    }
+    else
+    {
+        if ( store->tail_length > 0 )
+        {
+            // The last word is padded with erased bytes
+            nrfx_nvmc_bytes_write( store->base + entry->offset + store->written - store->tail_length, store->tail, store->tail_length );
+            store->tail_length = 0;
+        }
+
+        // What is read back is what Find hands out
+        if ( lfs_crc( BLOB_CRC_SEED, ( const void * )( store->base + entry->offset ), entry->length ) != store->crc )
+        {
+            store->stats.crc_errors++;
+            error = ERROR_BLOB_BAD_CRC;
+        }
+    }
+
+    if ( error != NO_ERROR )
+    {
+        blob_Abandon( store );
+        store->error = NO_ERROR;
+        return error;
+    }
+
+    nrfx_nvmc_word_write( ( uint32_t )&entry->crc, store->crc );
+    nrfx_nvmc_word_write( ( uint32_t )&entry->committed, BLOB_MAGIC );
+    store->stats.stored++;
+
+    // The new blob is live before the old one goes, so a reset in between leaves one of them
+    for ( i = 0; i < ( uint32_t )store->writing; i++ )
+    {
+        if ( blob_IsLive( blob_Entry( store->base, i ) ) && strncmp( blob_Entry( store->base, i )->name, entry->name, BLOB_NAME_MAX ) == 0 )
+        {
+            blob_Retire( blob_Entry( store->base, i ) );
+        }
+    }
+    store->writing = -1;
+
+    return error;
+}
+
+error_code_module_t blob_Delete( blob_store_t *store, const char *name )
+{
+    const blob_entry_t *entry;
+    error_code_module_t error = ERROR_BLOB_NOT_FOUND;
+    uint32_t i;
+
+    if ( name == NULL )
+    {
+        return ERROR_BLOB_BAD_PARAM;
+    }
+
+    for ( i = 0; i < store->entries; i++ )
+    {
+        entry = blob_Entry( store->base, i );
+        if ( blob_IsLive( entry ) && strncmp( entry->name, name, BLOB_NAME_MAX ) == 0 )
+        {
+            blob_Retire( entry );
+            store->stats.deleted++;
+            error = NO_ERROR;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t blob_Format( blob_store_t *store )
+{
+    const blob_header_t header = { .magic = BLOB_MAGIC, .size = store->size };
+    uint32_t address;
+
+    for ( address = store->base; address < store->base + store->size; address += BLOB_PAGE_SIZE )
+    {
+        nrfx_nvmc_page_erase( address );
+    }
+    nrfx_nvmc_bytes_write( store->base, &header, sizeof( header ) );
+
+    store->entries = 0;
+    store->used = BLOB_PAGE_SIZE;
+    store->writing = -1;
+    store->error = NO_ERROR;
+
+    return NO_ERROR;
+}
+
+const uint8_t *blob_Find( uint32_t base, const char *name, uint32_t *length )
+{
+    const blob_header_t *header = ( const blob_header_t * )base;
+    const blob_entry_t *entry;
+    const uint8_t *data = NULL;
+    uint32_t i;
+
+    if ( name == NULL || header->magic != BLOB_MAGIC )
+    {
+        return NULL;
+    }
+
+    // The last live entry of the name is the newest one
+    for ( i = 0; i < BLOB_ENTRY_COUNT; i++ )
+    {
+        entry = blob_Entry( base, i );
+        if ( entry->offset == BLOB_ERASED_WORD )
+        {
+            break;
+        }
+        if ( blob_IsLive( entry ) && entry->offset < header->size && entry->length <= header->size - entry->offset &&
+             strncmp( entry->name, name, BLOB_NAME_MAX ) == 0 )
+        {
+            data = ( const uint8_t * )( base + entry->offset );
+            if ( length != NULL )
+            {
+                *length = entry->length;
+            }
+        }
+    }
+
+    return data;
+}
+
+void blob_Report( const blob_store_t *store )
+{
+    const blob_entry_t *entry;
+    uint32_t i, live = 0;
+
+    for ( i = 0; i < store->entries; i++ )
+    {
+        entry = blob_Entry( store->base, i );
+        if ( blob_IsLive( entry ) )
+        {
+            Log.Print( "  %-11.*s %5d bytes at 0x%08x\r\n", BLOB_NAME_MAX, entry->name, entry->length, store->base + entry->offset );
+            live += entry->length;
+        }
+    }
+    Log.Print( "Blob store: %d of %d entries, %d of %d bytes used, %d bytes live\r\n",
+               store->entries,
+               BLOB_ENTRY_COUNT,
+               store->used - BLOB_PAGE_SIZE,
+               store->size - BLOB_PAGE_SIZE,
+               live );
+    Log.Print( "Blob store: %d stored, %d deleted, %d abandoned, %d CRC errors\r\n",
+               store->stats.stored,
+               store->stats.deleted,
+               store->stats.abandoned,
+               store->stats.crc_errors );
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+const blob_entry_t *blob_Entry( uint32_t base, uint32_t index )
+{
+    // Slot 0 holds the header
+    return ( const blob_entry_t * )( base + ( index + 1 ) * sizeof( blob_entry_t ) );
+}
+
+bool blob_IsLive( const blob_entry_t *entry )
+{
+    return entry->committed == BLOB_MAGIC && entry->deleted == BLOB_ERASED_WORD;
+}
+
+void blob_Retire( const blob_entry_t *entry )
+{
+    if ( entry->deleted == BLOB_ERASED_WORD )
+    {
+        nrfx_nvmc_word_write( ( uint32_t )&entry->deleted, 0 );
+    }
+}
+
+void blob_Abandon( blob_store_t *store )
+{
+    if ( store->writing >= 0 )
+    {
+        blob_Retire( blob_Entry( store->base, store->writing ) );
+        store->stats.abandoned++;
+        store->writing = -1;
+    }
+    store->tail_length = 0;
+}
+
+/**
+ * @} Blob
+ */
+
+/**
+ * @} Application
+ */
@@ -0,0 +1,120 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      blob.h
+ * @brief     Mapped blob store module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Blob
+ * @{
+ */
+#ifndef __BLOB_H__
+#define __BLOB_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <nrfx_nvmc.h>
+#include <lfs.h>
+#include "os.h"
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define BLOB_NAME_MAX                   ( 12 )          /*!< longest name, terminator included */
+#define BLOB_PAGE_SIZE                  ( 4096 )        /*!< NVMC page; the first one of the store holds the index */
+#define BLOB_ENTRY_COUNT                ( BLOB_PAGE_SIZE / sizeof( blob_entry_t ) - 1 ) /*!< the header takes one slot */
+
+#ifndef BLOB_ALIGN
+#define BLOB_ALIGN                      ( 16 )          /*!< start of every blob, a power of two of at least a word */
+#endif
+
+#if ( BLOB_ALIGN & ( BLOB_ALIGN - 1 ) ) != 0 || BLOB_ALIGN < 4
+#error "BLOB_ALIGN must be a power of two of at least 4"
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Index entry in flash. Each word is programmed once: offset, length and name when the blob is begun, CRC and
+ *        committed when its data is complete, deleted when it is removed or replaced.
+ */
+typedef struct
+{
+    uint32_t                    offset;         /*!< of the data from the start of the store */
+    uint32_t                    length;
+    char                        name[ BLOB_NAME_MAX ];
+    uint32_t                    crc;            /*!< CRC-32 of the data */
+    uint32_t                    committed;      /*!< BLOB_MAGIC once the data and CRC are in flash */
+    uint32_t                    deleted;        /*!< 0 once the blob is gone */
+} blob_entry_t;
+
+typedef struct
+{
+    uint32_t                    stored;         /*!< blobs committed */
+    uint32_t                    deleted;
+    uint32_t                    abandoned;      /*!< blobs begun and never committed */
+    uint32_t                    crc_errors;     /*!< blobs retired by Open or refused by Commit */
+} blob_stats_t;
+
+/**
+ * @brief Writer state, owned by the task that programs the store. Readers only need its address.
+ */
+typedef struct
+{
+    uint32_t                    base;           /*!< address of the index page, the data follows it */
+    uint32_t                    size;           /*!< bytes of the store, index included */
+    uint32_t                    entries;        /*!< index entries taken, dead ones included */
+    uint32_t                    used;           /*!< bytes taken from the start of the store, aligned */
+    int32_t                     writing;        /*!< entry of the blob being written, -1 for none */
+    uint32_t                    written;        /*!< bytes of it programmed or held in tail */
+    uint32_t                    crc;            /*!< CRC-32 of them */
+    uint8_t                     tail[ 4 ];      /*!< bytes short of a word, programmed with the next ones */
+    uint32_t                    tail_length;
+    error_code_module_t         error;          /*!< first error of the blob being written */
+    blob_stats_t                stats;
+} blob_store_t;
+
+/**
+ * Specifies the public interface functions of the mapped blob store.
+ */
+typedef struct
+{
+    error_code_module_t ( *Open )( blob_store_t *store, uint32_t base, uint32_t size );
+    error_code_module_t ( *Begin )( blob_store_t *store, const char *name, uint32_t length );
+    error_code_module_t ( *Write )( blob_store_t *store, const uint8_t *data, uint32_t length );
+    error_code_module_t ( *Commit )( blob_store_t *store );
+    error_code_module_t ( *Delete )( blob_store_t *store, const char *name );
+    error_code_module_t ( *Format )( blob_store_t *store );
+    const uint8_t * ( *Find )( uint32_t base, const char *name, uint32_t *length );
+    void ( *Report )( const blob_store_t *store );
+} const blob_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern blob_interface_t blob;
+
+#endif /* __BLOB_H__ */
+
+/**
+ * @} Blob
+ */
+
+/**
+ * @} Applicaton
+ */
@@ -0,0 +1,165 @@
+/** @file blob_priv.h
+ *
+ * @brief       Mapped blob store module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Blob
+ * @{
+ */
+
+#ifndef __BLOB_PRIV_H__
+#define __BLOB_PRIV_H__
+
+/*
+ * @note
+ * Read-only objects (certificates, keys, configuration) kept in flash pages of their own beside the littlefs volume.
+ * Flash is memory mapped, so Find hands back a pointer to the data itself: readers take no copy and need no buffer,
+ * only read access to the pages. A blob is one contiguous run of bytes starting on a BLOB_ALIGN boundary, and is never
+ * changed once committed; storing a name again adds a new blob and retires the old one.
+ *
+ * The first page holds a header and the index. Entries are taken in order and each of their words is programmed once,
+ * so nothing is ever erased but by Format: a blob is begun by programming its offset, length and name, its data goes
+ * in after the blobs before it, and it is committed by programming the CRC of the data read back and then the commit
+ * word. Removing a blob clears its deleted word. A reset halfway leaves an entry that was never committed; it stays
+ * dead, with its space. Find looks for the last committed entry of a name that is not deleted and only reads, so any
+ * task may call it at any time, also before the writer opened the store. Open checks the CRC of every live blob once
+ * and retires those that fail.
+ *
+ * The space of deleted blobs comes back only with Format, which erases the store; the objects change so seldom that
+ * this beats compaction. A store whose header is missing (new, or pages that held something else) is formatted by Open.
+ *
+ * The writer state belongs to the task that programs the store; the module does not lock.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "blob.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define BLOB_MAGIC              ( 0x424f4c42 )          /*!< "BLOB", header and commit word */
+#define BLOB_ERASED_WORD        ( 0xffffffff )
+#define BLOB_CRC_SEED           ( 0xffffffff )
+#define BLOB_ROUND( x )         ( ( ( x ) + BLOB_ALIGN - 1 ) & ~( BLOB_ALIGN - 1 ) )
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/**
+ * @brief First slot of the index page.
+ */
+typedef struct
+{
+    uint32_t magic;                     /*!< BLOB_MAGIC once formatted */
+    uint32_t size;                      /*!< bytes of the store */
+} blob_header_t;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Take over a store, formatting it when it has no header.
+ * @param[out]  store       Writer state.
+ * @param[in]   base        Page aligned address of the store.
+ * @param[in]   size        Bytes of the store, whole pages, two at least.
+ * @return      Error code.
+ */
+static error_code_module_t blob_Open( blob_store_t *store, uint32_t base, uint32_t size );
+
+/**
+ * @brief       Start a blob. A blob begun before and not committed is abandoned.
+ * @param[in]   store       Writer state.
+ * @param[in]   name        Name, shorter than BLOB_NAME_MAX.
+ * @param[in]   length      Bytes the blob will have.
+ * @return      Error code, ERROR_BLOB_FULL when index or data space is short.
+ */
+static error_code_module_t blob_Begin( blob_store_t *store, const char *name, uint32_t length );
+
+/**
+ * @brief       Add data to the blob begun.
+ * @param[in]   store       Writer state.
+ * @param[in]   data        Bytes, any alignment.
+ * @param[in]   length      Length of data.
+ * @return      Error code.
+ */
+static error_code_module_t blob_Write( blob_store_t *store, const uint8_t *data, uint32_t length );
+
+/**
+ * @brief       Check and commit the blob begun, retiring an older blob of the same name.
+ * @param[in]   store       Writer state.
+ * @return      Error code, the first one of the blob if Begin or Write failed.
+ */
+static error_code_module_t blob_Commit( blob_store_t *store );
+
+/**
+ * @brief       Remove a blob. Its space comes back only with Format.
+ * @param[in]   store       Writer state.
+ * @param[in]   name        Name.
+ * @return      Error code, ERROR_BLOB_NOT_FOUND when there is no such blob.
+ */
+static error_code_module_t blob_Delete( blob_store_t *store, const char *name );
+
+/**
+ * @brief       Erase the store and write its header.
+ * @param[in]   store       Writer state.
+ * @return      Error code.
+ */
+static error_code_module_t blob_Format( blob_store_t *store );
+
+/**
+ * @brief       Look a blob up. Only reads flash, so any task with access to the store may call it.
+ * @param[in]   base        Address of the store.
+ * @param[in]   name        Name.
+ * @param[out]  length      Bytes of the blob, may be NULL.
+ * @return      Pointer to the data in flash, NULL when there is no such blob.
+ */
+static const uint8_t *blob_Find( uint32_t base, const char *name, uint32_t *length );
+
+/**
+ * @brief       Print usage and counters.
+ * @param[in]   store       Writer state.
+ */
+static void blob_Report( const blob_store_t *store );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+/**
+ * @brief       Index entry in flash.
+ */
+static const blob_entry_t *blob_Entry( uint32_t base, uint32_t index );
+
+/**
+ * @brief       True for an entry that was committed and not deleted.
+ */
+static bool blob_IsLive( const blob_entry_t *entry );
+
+/**
+ * @brief       Program the deleted word of an entry.
+ */
+static void blob_Retire( const blob_entry_t *entry );
+
+/**
+ * @brief       Drop the blob being written, if any.
+ */
+static void blob_Abandon( blob_store_t *store );
+
+#endif /* __BLOB_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -76,6 +76,87 @@ void cli_Thread( void *parameter_ptr )
             NULL,
             cli_Ongetstatus
         },
+#if DMM_BENCHMARK_ENABLED
+        {
+            "heap-bench",
+            "Measure worst-case heap latency and interrupt-masked time",
+            false,
+            NULL,
+            cli_Onheapbench
+        },
+#endif
+#if ROUTER_BENCHMARK_ENABLED
+        {
+            "route-bench",
+            "Compare MQTT topic routing with per-filter matching: route-bench 256 1000",
+            true,
+            NULL,
+            cli_Onroutebench
+        },
+#endif
+#if TELEMETRY_BENCHMARK_ENABLED
+        {
+            "telemetry-bench",
+            "Compare CBOR telemetry records with sprintf payloads: telemetry-bench 1000",
+            true,
+            NULL,
+            cli_Ontelemetrybench
+        },
+#endif
+#if COMPRESS_BENCHMARK_ENABLED
+        {
+            "compress-bench",
+            "Measure payload compression ratio and throughput: compress-bench 20",
+            true,
+            NULL,
+            cli_Oncompressbench
+        },
+#endif
+#if TLS_BENCHMARK_ENABLED
+        {
+            "tls-bench",
+            "Compare TLS handshakes and download rate per cipher suite: tls-bench example.com 443 3",
+            true,
+            NULL,
+            cli_Ontlsbench
+        },
+#endif
+#if DTLS_BENCHMARK_ENABLED
+        {
+            "dtls-bench",
+            "Compare telemetry over DTLS with MQTT/TLS: dtls-bench example.com 5684 20",
+            true,
+            NULL,
+            cli_Ondtlsbench
+        },
+#endif
+#if COAP_BENCHMARK_ENABLED
+        {
+            "coap-bench",
+            "Measure CoAP requests and block-wise transfers against a stand-in server: coap-bench 100 1024",
+            true,
+            NULL,
+            cli_Oncoapbench
+        },
+#endif
+#if FS_BENCHMARK_ENABLED
+        {
+            "fs-bench",
+            "Compare littlefs geometries and the key-value store on a simulated NVMC volume: fs-bench 100",
+            true,
+            NULL,
+            cli_Onfsbench
+        },
+#endif
+#if DMM_TRACE_ENABLED
+        {
+            "heap-trace",
+            "Show heap usage per task/tag and allocations older than n seconds: heap-trace 60",
+            true,
+            NULL,
+            cli_Onheaptrace
+        },
+#endif
         {
             "show-tasks",
             "Show logs from task list (up to 3)",
@@ -236,7 +317,151 @@ void cli_Ongetstatus( EmbeddedCli *embedded_cli, char *args, void *context )
     twdt.Report();
     dmm.Report( dmm_handle_0 );
     dmm.Report( dmm_handle_1 );
+    pool.Report();
+    fs.Status();
+}
+
+#if DMM_BENCHMARK_ENABLED
+void cli_Onheapbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    dmm.Benchmark();
+}
+#endif
+
+#if ROUTER_BENCHMARK_ENABLED
+void cli_Onroutebench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 2 ] = { CLI_ROUTE_FILTERS, CLI_ROUTE_PUBLISHES };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) || parms[ 0 ] < 0 || parms[ 1 ] < 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        router.Benchmark( parms[ 0 ], parms[ 1 ] );
+    }
+}
+#endif
+
+#if TELEMETRY_BENCHMARK_ENABLED
+void cli_Ontelemetrybench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 1 ] = { CLI_TELEMETRY_RECORDS };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) || parms[ 0 ] < 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        telemetry.Benchmark( parms[ 0 ] );
+    }
+}
+#endif
+
+#if COMPRESS_BENCHMARK_ENABLED
+void cli_Oncompressbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 1 ] = { CLI_COMPRESS_RUNS };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) || parms[ 0 ] < 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        compress.Benchmark( parms[ 0 ] );
+    }
+}
+#endif
+
+#if TLS_BENCHMARK_ENABLED
+void cli_Ontlsbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t port = CLI_TLS_PORT, runs = CLI_TLS_RUNS;
+    uint32_t count = embeddedCliGetTokenCount( args );
+
+    if ( count < 1 || count > 3 ||
+         ( count >= 2 && ( sscanf( embeddedCliGetToken( args, 2 ), "%d", &port ) != 1 || port <= 0 || port > UINT16_MAX ) ) ||
+         ( count == 3 && ( sscanf( embeddedCliGetToken( args, 3 ), "%d", &runs ) != 1 || runs <= 0 ) ) )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        tls.Benchmark( embeddedCliGetToken( args, 1 ), port, runs );
+    }
+}
+#endif
+
+#if DTLS_BENCHMARK_ENABLED
+void cli_Ondtlsbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t port = CLI_DTLS_PORT, records = CLI_DTLS_RECORDS;
+    uint32_t count = embeddedCliGetTokenCount( args );
+
+    if ( count < 1 || count > 3 ||
+         ( count >= 2 && ( sscanf( embeddedCliGetToken( args, 2 ), "%d", &port ) != 1 || port <= 0 || port > UINT16_MAX ) ) ||
+         ( count == 3 && ( sscanf( embeddedCliGetToken( args, 3 ), "%d", &records ) != 1 || records <= 0 ) ) )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        dtls.Benchmark( embeddedCliGetToken( args, 1 ), port, records );
+    }
+}
+#endif
+
+#if COAP_BENCHMARK_ENABLED
+void cli_Oncoapbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 2 ] = { CLI_COAP_REQUESTS, CLI_COAP_SIZE };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) || parms[ 0 ] <= 0 || parms[ 1 ] < 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        coap.Benchmark( parms[ 0 ], parms[ 1 ] );
+    }
+}
+#endif
+
+#if FS_BENCHMARK_ENABLED
+void cli_Onfsbench( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 1 ] = { CLI_FS_OPERATIONS };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) || parms[ 0 ] <= 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        fs.Benchmark( parms[ 0 ] );
+    }
 }
+#endif
+
+#if DMM_TRACE_ENABLED
+void cli_Onheaptrace( EmbeddedCli *embedded_cli, char *args, void *context )
+{
+    int32_t parms[ 1 ] = { CLI_LEAK_AGE };
+
+    if ( cli_Getparms( args, parms ) < embeddedCliGetTokenCount( args ) )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+    }
+    else
+    {
+        dmm.TraceReport( dmm_handle_0 );
+        dmm.LeakCheck( dmm_handle_0, parms[ 0 ] * 1000 );
+    }
+}
+#endif
 
 void cli_Onshowtasks( EmbeddedCli *embedded_cli, char *args, void *context )
 {
@@ -321,10 +546,14 @@ void cli_GetTaskList( TaskHandle_t *handle )
 {
     if ( handle != NULL )
     {
+        TaskHandle_t *task_list;
+
         twdt.List();
-        if( os.QueueReceive( app.GetCliQHandle(), handle, os.Ms2Ticks( TWDT_KICK_TIME ) ) )
+        if( ( task_list = OS_MAILBOX_RECEIVE( app.GetCliQHandle(), TaskHandle_t, TWDT_KICK_TIME ) ) != NULL )
         {
             /* handle receives the task ID list which is passed back to caller */
+            memcpy( handle, task_list, MAX_TASKS * sizeof( TaskHandle_t ) );
+            os.MailboxFree( app.GetCliQHandle(), task_list );
         }
     }
 }
@@ -348,7 +577,7 @@ error_code_module_t cli_Init( void )
     {
         /* Set up CLI task */
         shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-        shared_struct->cli_queue = os.CreateQueue( QUEUE_LEN, MAX_TASKS * sizeof( TaskHandle_t ) );
+        shared_struct->cli_queue = os.CreateMailbox( QUEUE_LEN, MAX_TASKS * sizeof( TaskHandle_t ) );
         static StackType_t task_stack[ configMINIMAL_STACK_SIZE ] __attribute__( ( aligned( 32 ) ) );
         TaskHandle_t handle = os.CreateTask( cli_Thread,
                                              "CLI",
@@ -32,6 +32,13 @@
 #include "modem.h"
 #include "blinky.h"
 #include "slm.h"
+#include "pool.h"
+#include "router.h"
+#include "telemetry.h"
+#include "compress.h"
+#include "dtls.h"
+#include "coap.h"
+#include "fs.h"
 
 /***************************************************************************************************************************
  * Public constants and macros
@@ -32,6 +32,18 @@
 #define CLI_CMD_BUFFER_SIZE     ( 64 )
 #define CLI_HISTORY_SIZE        ( 32 )
 #define CLI_PROMPT              "nRF91 -> "
+#define CLI_LEAK_AGE            ( 60 )
+#define CLI_ROUTE_FILTERS       ( 256 )
+#define CLI_ROUTE_PUBLISHES     ( 1000 )
+#define CLI_TELEMETRY_RECORDS   ( 1000 )
+#define CLI_COMPRESS_RUNS       ( 20 )
+#define CLI_TLS_PORT            ( 443 )
+#define CLI_TLS_RUNS            ( 3 )
+#define CLI_DTLS_PORT           ( 5684 )
+#define CLI_DTLS_RECORDS        ( 20 )
+#define CLI_COAP_REQUESTS       ( 100 )
+#define CLI_COAP_SIZE           ( 1024 )
+#define CLI_FS_OPERATIONS       ( 100 )
 
 /***************************************************************************************************************************
  * Private data structures and typedefs
@@ -161,6 +173,77 @@ static void cli_Ongetlevel( EmbeddedCli *embedded_cli, char *args, void *context
  */
 static void cli_Ongetstatus( EmbeddedCli *embedded_cli, char *args, void *context );
 
+#if DMM_BENCHMARK_ENABLED
+/**
+ * @brief       Measure worst-case heap allocation latency.
+ */
+static void cli_Onheapbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if ROUTER_BENCHMARK_ENABLED
+/**
+ * @brief       Compare routing publishes through the topic trie with matching every filter.
+ * @param[in]   args        Number of filters and number of publishes (default CLI_ROUTE_FILTERS, CLI_ROUTE_PUBLISHES).
+ */
+static void cli_Onroutebench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if TELEMETRY_BENCHMARK_ENABLED
+/**
+ * @brief       Compare size and encode time of CBOR telemetry records with sprintf payloads.
+ * @param[in]   args        Number of records per format (default CLI_TELEMETRY_RECORDS).
+ */
+static void cli_Ontelemetrybench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if COMPRESS_BENCHMARK_ENABLED
+/**
+ * @brief       Measure ratio, throughput and RAM of payload compression.
+ * @param[in]   args        Number of runs per sample (default CLI_COMPRESS_RUNS).
+ */
+static void cli_Oncompressbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if TLS_BENCHMARK_ENABLED
+/**
+ * @brief       Compare full TLS handshakes and download rate for each ECDHE cipher suite.
+ * @param[in]   args        Host, port (default CLI_TLS_PORT) and connects per suite (default CLI_TLS_RUNS).
+ */
+static void cli_Ontlsbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if DTLS_BENCHMARK_ENABLED
+/**
+ * @brief       Compare latency and bytes of telemetry over DTLS with the MQTT/TLS path.
+ * @param[in]   args        Host, port (default CLI_DTLS_PORT) and records per run (default CLI_DTLS_RECORDS).
+ */
+static void cli_Ondtlsbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if COAP_BENCHMARK_ENABLED
+/**
+ * @brief       Measure CoAP requests and block-wise transfers against the stand-in server.
+ * @param[in]   args        Requests per run (default CLI_COAP_REQUESTS) and transfer size (default CLI_COAP_SIZE).
+ */
+static void cli_Oncoapbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if FS_BENCHMARK_ENABLED
+/**
+ * @brief       Compare littlefs geometries on a simulated NVMC volume.
+ * @param[in]   args        Operations per test (default CLI_FS_OPERATIONS).
+ */
+static void cli_Onfsbench( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
+#if DMM_TRACE_ENABLED
+/**
+ * @brief       Show heap usage per task and per tag, and list long-lived allocations.
+ * @param[in]   args        Minimum age in seconds of allocations to list (default CLI_LEAK_AGE).
+ */
+static void cli_Onheaptrace( EmbeddedCli *embedded_cli, char *args, void *context );
+#endif
+
 /**
  * @brief       Show tasks in list only (limited to three tasks).
  * @details     show-tasks task1 task2 task3
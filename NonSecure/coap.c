@@ -0,0 +1,1088 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      coap.c
+ * @brief     CoAP client module
+ * @details   Confirmable and non-confirmable requests, block-wise transfer and Observe over UDP or DTLS.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Coap CoAP client
+ * @brief     CoAP client for constrained uplinks
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "coap_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+coap_interface_t coap =
+{
+    .Init               = &coap_Init,
+    .Open               = &coap_Open,
+    .Close              = &coap_Close,
+    .Request            = &coap_Request,
+    .Observe            = &coap_Observe,
+    .Cancel             = &coap_Cancel,
+    .Poll               = &coap_Poll,
+    .Status             = &coap_Status,
+#if COAP_BENCHMARK_ENABLED
+    .Benchmark          = &coap_Benchmark,
+#endif
+    .isInit             = &coap_isInit,
+};
+
+#if COAP_BENCHMARK_ENABLED
+static uint8_t benchmark_data[ COAP_BENCHMARK_SIZE ];
+static uint8_t benchmark_response[ COAP_BENCHMARK_SIZE ];
+#endif
+
+coap_obj_t coap_obj =
+{
+    .is_init            = false,
+    .fd                 = -1,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t coap_Init( void )
+{
+    error_code_module_t error = NO_ERROR;
+
+    /* Singleton pattern */
+    if ( coap_obj.is_init == false )
+    {
+        coap_obj.send = modem.Send;
+        coap_obj.receive = modem.ReceiveTimeout;
+        coap_obj.mutex_handle = os.CreateMutex();
+        if ( coap_obj.mutex_handle == NULL )
+        {
+            error = ERROR_COAP_INIT;
+        }
+        else
+        {
+            coap_obj.is_init = true;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t coap_Open( const char *transport_protocol, const char *host_name, uint16_t port )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t i;
+
+    if ( transport_protocol == NULL || host_name == NULL || port == 0 )
+    {
+        error = ERROR_COAP_BAD_PARAM;
+    }
+    else if ( coap_obj.is_init == true && os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( coap_obj.fd >= 0 )
+        {
+            modem.Disconnect( coap_obj.fd );
+        }
+        memset( coap_obj.observe, 0, sizeof( coap_obj.observe ) );
+
+        // Tokens and message IDs start from the host name and the time it took to get here
+        coap_obj.random = os.GetTickCountMs();
+        for ( i = 0; host_name[ i ] != 0; i++ )
+        {
+            coap_obj.random = ( coap_obj.random ^ ( uint8_t )host_name[ i ] ) * COAP_RANDOM_PRIME;
+        }
+        coap_obj.random |= 1;
+        coap_obj.message_id = ( uint16_t )coap_Random();
+
+        coap_obj.fd = modem.Connect( transport_protocol, host_name, port, COAP_TIMEOUT, COAP_TIMEOUT );
+        if ( coap_obj.fd < 0 )
+        {
+            Log.ErrorPrint( "CoAP connect to %s:%d failed", host_name, port );
+            error = ERROR_COAP_NOT_CONNECTED;
+        }
+        os.GiveSemaphore( coap_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_COAP_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t coap_Close( void )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( coap_obj.is_init == true && os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( coap_obj.fd >= 0 )
+        {
+            modem.Disconnect( coap_obj.fd );
+            coap_obj.fd = -1;
+        }
+        memset( coap_obj.observe, 0, sizeof( coap_obj.observe ) );
+        os.GiveSemaphore( coap_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_COAP_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t coap_Request( coap_request_t *request )
+{
+    error_code_module_t error = NO_ERROR;
+    coap_writer_t writer;
+    coap_message_t response;
+    uint32_t length, copy, chunk;
+    uint32_t offset = 0, szx = COAP_BLOCK_SZX, block1 = COAP_NONE, block2 = COAP_NONE;
+    bool is_block1, wait;
+
+    if ( request == NULL || request->path == NULL || ( request->payload == NULL && request->payload_length > 0 ) )
+    {
+        return ERROR_COAP_BAD_PARAM;
+    }
+    if ( coap_obj.is_init == false || !os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        return ERROR_COAP_NOT_INIT;
+    }
+
+    // Each block of a block-wise upload waits for 2.31 Continue, so only a short NON request may go unanswered
+    is_block1 = ( request->payload_length > COAP_BLOCK_SIZE );
+    wait = request->confirmable || request->response != NULL || is_block1;
+    request->response_length = 0;
+    request->code = COAP_EMPTY;
+    if ( coap_obj.fd < 0 )
+    {
+        error = ERROR_COAP_NOT_CONNECTED;
+    }
+    else
+    {
+        coap_obj.stats.requests++;
+    }
+
+    while ( error == NO_ERROR )
+    {
+        // Request payload, one block of it when block-wise
+        chunk = 0;
+        if ( offset < request->payload_length )
+        {
+            chunk = request->payload_length - offset;
+            if ( is_block1 )
+            {
+                chunk = ( chunk > COAP_SZX_SIZE( szx ) ) ? COAP_SZX_SIZE( szx ) : chunk;
+                block1 = COAP_BLOCK( offset / COAP_SZX_SIZE( szx ), ( offset + chunk < request->payload_length ), szx );
+            }
+        }
+        else
+        {
+            block1 = COAP_NONE;
+        }
+
+        if ( ( length = coap_Build( &writer, request, NULL, COAP_NONE, block1, block2, offset, chunk ) ) == 0 )
+        {
+            error = ERROR_COAP_FULL;
+            break;
+        }
+        if ( ( error = coap_Exchange( length, request->confirmable, wait, &response ) ) != NO_ERROR || !wait )
+        {
+            break;
+        }
+        request->code = response.code;
+        offset += chunk;
+
+        // Next block of the request, smaller if the server asks for it
+        if ( block1 != COAP_NONE && COAP_BLOCK_MORE( block1 ) )
+        {
+            if ( response.code != COAP_CONTINUE )
+            {
+                break;
+            }
+            if ( response.has_block1 && COAP_BLOCK_SZX_OF( response.block1 ) < szx )
+            {
+                szx = COAP_BLOCK_SZX_OF( response.block1 );
+            }
+            coap_obj.stats.blocks++;
+            continue;
+        }
+
+        // Response payload, then the next block of it while the server has more
+        if ( request->response != NULL && response.payload_length > 0 )
+        {
+            copy = request->response_size - request->response_length;
+            copy = ( response.payload_length < copy ) ? response.payload_length : copy;
+            memcpy( &request->response[ request->response_length ], response.payload, copy );
+            request->response_length += copy;
+            if ( copy < response.payload_length )
+            {
+                error = ERROR_COAP_FULL;
+                break;
+            }
+        }
+        if ( !response.has_block2 || !COAP_BLOCK_MORE( response.block2 ) )
+        {
+            break;
+        }
+        block2 = COAP_BLOCK( COAP_BLOCK_NUM( response.block2 ) + 1, 0, COAP_BLOCK_SZX_OF( response.block2 ) );
+        coap_obj.stats.blocks++;
+    }
+
+    os.GiveSemaphore( coap_obj.mutex_handle );
+
+    return error;
+}
+
+error_code_module_t coap_Observe( const char *path, coap_notify_t handler, void *context )
+{
+    error_code_module_t error = NO_ERROR;
+    coap_request_t request =
+    {
+        .method = coap_get,
+        .path = path,
+        .confirmable = true,
+        .format = COAP_FORMAT_NONE,
+    };
+    coap_observe_t *observe = NULL;
+    coap_writer_t writer;
+    coap_message_t response;
+    uint32_t length;
+
+    if ( path == NULL || strlen( path ) >= COAP_PATH_LENGTH || handler == NULL )
+    {
+        return ERROR_COAP_BAD_PARAM;
+    }
+    if ( coap_obj.is_init == false || !os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        return ERROR_COAP_NOT_INIT;
+    }
+
+    // Registering again replaces the handler and the token
+    if ( coap_obj.fd < 0 )
+    {
+        error = ERROR_COAP_NOT_CONNECTED;
+    }
+    else if ( ( observe = coap_FindObserve( path, NULL ) ) == NULL && ( observe = coap_FindObserve( NULL, NULL ) ) == NULL )
+    {
+        error = ERROR_COAP_FULL;
+    }
+    else if ( ( length = coap_Build( &writer, &request, NULL, 0, COAP_NONE, COAP_NONE, 0, 0 ) ) == 0 )
+    {
+        error = ERROR_COAP_FULL;
+    }
+    else
+    {
+        observe->active = false;
+        strcpy( observe->path, path );
+        memcpy( observe->token, &coap_obj.tx[ COAP_HEADER_SIZE ], COAP_TOKEN_LENGTH );
+        observe->handler = handler;
+        observe->context = context;
+        coap_obj.stats.requests++;
+        error = coap_Exchange( length, true, true, &response );
+    }
+
+    if ( error == NO_ERROR )
+    {
+        handler( response.payload, response.payload_length, response.code, context );
+        if ( response.has_observe && COAP_CLASS( response.code ) == 2 )
+        {
+            observe->active = true;
+            observe->sequence = response.observe;
+            observe->received_ms = os.GetTickCountMs();
+        }
+        else
+        {
+            error = ERROR_COAP_REJECTED;
+        }
+    }
+
+    os.GiveSemaphore( coap_obj.mutex_handle );
+
+    return error;
+}
+
+error_code_module_t coap_Cancel( const char *path )
+{
+    error_code_module_t error = NO_ERROR;
+    coap_request_t request =
+    {
+        .method = coap_get,
+        .path = path,
+        .confirmable = true,
+        .format = COAP_FORMAT_NONE,
+    };
+    coap_observe_t *observe;
+    coap_writer_t writer;
+    coap_message_t response;
+    uint32_t length;
+
+    if ( path == NULL )
+    {
+        return ERROR_COAP_BAD_PARAM;
+    }
+    if ( coap_obj.is_init == false || !os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        return ERROR_COAP_NOT_INIT;
+    }
+
+    // Deregister with the token of the observation; it ends here whatever the server answers
+    if ( ( observe = coap_FindObserve( path, NULL ) ) == NULL )
+    {
+        error = ERROR_COAP_BAD_PARAM;
+    }
+    else
+    {
+        observe->active = false;
+        if ( coap_obj.fd < 0 )
+        {
+            error = ERROR_COAP_NOT_CONNECTED;
+        }
+        else if ( ( length = coap_Build( &writer, &request, observe->token, 1, COAP_NONE, COAP_NONE, 0, 0 ) ) == 0 )
+        {
+            error = ERROR_COAP_FULL;
+        }
+        else
+        {
+            coap_obj.stats.requests++;
+            error = coap_Exchange( length, true, true, &response );
+        }
+    }
+
+    os.GiveSemaphore( coap_obj.mutex_handle );
+
+    return error;
+}
+
+error_code_module_t coap_Poll( uint32_t timeout_ms )
+{
+    error_code_module_t error = NO_ERROR;
+    coap_message_t message;
+    uint32_t start = os.GetTickCountMs();
+    uint32_t elapsed = 0, wait;
+    int32_t received;
+
+    // Short turns on the socket, so requests of other tasks get in between
+    while ( error == NO_ERROR && elapsed < timeout_ms )
+    {
+        wait = ( timeout_ms - elapsed < COAP_POLL_MS ) ? timeout_ms - elapsed : COAP_POLL_MS;
+        if ( coap_obj.is_init == false || !os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+        {
+            error = ERROR_COAP_NOT_INIT;
+        }
+        else
+        {
+            if ( coap_obj.fd < 0 || ( received = coap_obj.receive( coap_obj.fd, coap_obj.rx, sizeof( coap_obj.rx ), wait ) ) < 0 )
+            {
+                error = ERROR_COAP_NOT_CONNECTED;
+            }
+            else if ( received > 0 && coap_Parse( coap_obj.rx, received, &message ) )
+            {
+                coap_Dispatch( &message );
+            }
+            os.GiveSemaphore( coap_obj.mutex_handle );
+        }
+        elapsed = os.GetTickCountMs() - start;
+    }
+
+    return error;
+}
+
+void coap_Status( void )
+{
+    uint32_t i;
+
+    Log.Print( "CoAP is %s.\r\n", coap_obj.fd >= 0 ? "open" : "not open" );
+    Log.Print( "Requests: %d, %d further blocks, %d retransmits, %d timeouts, %d resets\r\n",
+               coap_obj.stats.requests,
+               coap_obj.stats.blocks,
+               coap_obj.stats.retransmits,
+               coap_obj.stats.timeouts,
+               coap_obj.stats.resets );
+    Log.Print( "Notifications: %d, %d stale\r\n", coap_obj.stats.notifications, coap_obj.stats.stale );
+    for ( i = 0; i < COAP_OBSERVE_COUNT; i++ )
+    {
+        if ( coap_obj.observe[ i ].active )
+        {
+            Log.Print( "Observing %s, sequence %d\r\n", coap_obj.observe[ i ].path, coap_obj.observe[ i ].sequence );
+        }
+    }
+}
+
+#if COAP_BENCHMARK_ENABLED
+void coap_Benchmark( uint32_t count, uint32_t size )
+{
+    coap_request_t request =
+    {
+        .path = COAP_BENCH_PATH,
+        .format = COAP_FORMAT_CBOR,
+        .payload = benchmark_data,
+    };
+    uint32_t i;
+    bool is_open = true;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    if ( count == 0 || size > COAP_BENCHMARK_SIZE || cycles_per_us == 0 )
+    {
+        Log.Print( "Transfers of 0 to %d bytes\r\n", COAP_BENCHMARK_SIZE );
+        return;
+    }
+
+    // The stand-in server takes the place of the socket
+    if ( coap_obj.is_init == true && os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( ( is_open = ( coap_obj.fd >= 0 ) ) == false )
+        {
+            coap_obj.fd = COAP_BENCH_FD;
+            coap_obj.send = coap_BenchSend;
+            coap_obj.receive = coap_BenchReceive;
+            memset( &coap_obj.bench, 0, sizeof( coap_obj.bench ) );
+        }
+        os.GiveSemaphore( coap_obj.mutex_handle );
+    }
+    if ( is_open )
+    {
+        Log.Print( "Close CoAP before running the benchmark\r\n" );
+        return;
+    }
+    for ( i = 0; i < COAP_BENCHMARK_SIZE; i++ )
+    {
+        benchmark_data[ i ] = ( uint8_t )( i * 31 + 7 );
+    }
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    Log.Print( "CoAP benchmark against the stand-in server: %d requests per run, %d byte blocks, %d MHz\r\n",
+               count,
+               COAP_BLOCK_SIZE,
+               cycles_per_us );
+
+    // Short requests and responses
+    coap_obj.bench.resource_size = COAP_BENCH_SMALL;
+    request.method = coap_get;
+    request.confirmable = true;
+    request.payload_length = 0;
+    request.response = benchmark_response;
+    request.response_size = sizeof( benchmark_response );
+    coap_BenchRun( "CON GET", &request, count );
+
+    request.confirmable = false;
+    coap_BenchRun( "NON GET", &request, count );
+
+    request.method = coap_put;
+    request.payload_length = COAP_BENCH_SMALL;
+    request.response = NULL;
+    coap_BenchRun( "NON PUT", &request, count );
+
+    // Block-wise transfers of size bytes
+    coap_obj.bench.resource_size = size;
+    request.confirmable = true;
+    request.payload_length = size;
+    coap_BenchRun( "PUT Block1", &request, count );
+
+    request.method = coap_get;
+    request.payload_length = 0;
+    request.response = benchmark_response;
+    coap_BenchRun( "GET Block2", &request, count );
+
+    Log.Print( "RAM: %d bytes of buffers, no heap\r\n", sizeof( coap_obj.tx ) + sizeof( coap_obj.rx ) );
+
+    if ( os.TakeSemaphore( coap_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        coap_obj.fd = -1;
+        coap_obj.send = modem.Send;
+        coap_obj.receive = modem.ReceiveTimeout;
+        os.GiveSemaphore( coap_obj.mutex_handle );
+    }
+}
+#endif
+
+bool coap_isInit( void )
+{
+    return coap_obj.is_init && modem.Registered();
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+error_code_module_t coap_Exchange( uint32_t length, bool confirmable, bool wait, coap_message_t *response )
+{
+    uint16_t message_id = ( coap_obj.tx[ 2 ] << 8 ) | coap_obj.tx[ 3 ];
+    const uint8_t *token = &coap_obj.tx[ COAP_HEADER_SIZE ];
+    uint32_t timeout = COAP_ACK_TIMEOUT + coap_Random() % ( COAP_ACK_TIMEOUT * COAP_RANDOM_FACTOR / 100 );
+    uint32_t start, elapsed, attempt = 0;
+    int32_t received;
+    bool is_acknowledged = !confirmable;
+
+    if ( coap_obj.send( coap_obj.fd, coap_obj.tx, length ) < 0 )
+    {
+        return ERROR_COAP_NOT_CONNECTED;
+    }
+    if ( !wait )
+    {
+        return NO_ERROR;
+    }
+    if ( !confirmable )
+    {
+        timeout = COAP_RESPONSE_TIMEOUT;
+    }
+
+    start = os.GetTickCountMs();
+    for ( ; ; )
+    {
+        elapsed = os.GetTickCountMs() - start;
+        if ( elapsed >= timeout )
+        {
+            if ( is_acknowledged || attempt == COAP_MAX_RETRANSMIT )
+            {
+                coap_obj.stats.timeouts++;
+                return ERROR_COAP_TIMEOUT;
+            }
+
+            // Not acknowledged: send again, then wait twice as long
+            if ( coap_obj.send( coap_obj.fd, coap_obj.tx, length ) < 0 )
+            {
+                return ERROR_COAP_NOT_CONNECTED;
+            }
+            attempt++;
+            coap_obj.stats.retransmits++;
+            timeout <<= 1;
+            start = os.GetTickCountMs();
+            continue;
+        }
+
+        received = coap_obj.receive( coap_obj.fd, coap_obj.rx, sizeof( coap_obj.rx ), timeout - elapsed );
+        if ( received < 0 )
+        {
+            return ERROR_COAP_NOT_CONNECTED;
+        }
+        if ( received == 0 || !coap_Parse( coap_obj.rx, received, response ) )
+        {
+            continue;
+        }
+
+        if ( response->message_id == message_id && response->type == COAP_TYPE_RST )
+        {
+            coap_obj.stats.resets++;
+            return ERROR_COAP_RESET;
+        }
+        if ( response->message_id == message_id && response->type == COAP_TYPE_ACK && response->code == COAP_EMPTY )
+        {
+            // Empty ACK: the response follows separately
+            is_acknowledged = true;
+            timeout = COAP_RESPONSE_TIMEOUT;
+            start = os.GetTickCountMs();
+            continue;
+        }
+        if ( response->type != COAP_TYPE_RST && response->code != COAP_EMPTY &&
+             response->token_length == COAP_TOKEN_LENGTH && memcmp( response->token, token, COAP_TOKEN_LENGTH ) == 0 )
+        {
+            if ( response->type == COAP_TYPE_CON )
+            {
+                coap_Reply( response, COAP_TYPE_ACK );
+            }
+            return NO_ERROR;
+        }
+
+        // Not ours: a notification, or a late answer to an earlier request
+        coap_Dispatch( response );
+    }
+}
+
+uint32_t coap_Build( coap_writer_t *writer, const coap_request_t *request, const uint8_t *token, uint32_t observe,
+                     uint32_t block1, uint32_t block2, uint32_t offset, uint32_t length )
+{
+    uint32_t random;
+
+    if ( token == NULL )
+    {
+        random = coap_Random();
+        token = ( const uint8_t * )&random;
+    }
+
+    coap_Begin( writer,
+                coap_obj.tx,
+                sizeof( coap_obj.tx ),
+                request->confirmable ? COAP_TYPE_CON : COAP_TYPE_NON,
+                request->method,
+                coap_obj.message_id++,
+                token,
+                COAP_TOKEN_LENGTH );
+    if ( observe != COAP_NONE )
+    {
+        coap_OptionUint( writer, COAP_OPTION_OBSERVE, observe );
+    }
+    coap_OptionPath( writer, request->path );
+    if ( length > 0 && request->format != COAP_FORMAT_NONE )
+    {
+        coap_OptionUint( writer, COAP_OPTION_FORMAT, request->format );
+    }
+    if ( block2 != COAP_NONE )
+    {
+        coap_OptionUint( writer, COAP_OPTION_BLOCK2, block2 );
+    }
+    if ( block1 != COAP_NONE )
+    {
+        coap_OptionUint( writer, COAP_OPTION_BLOCK1, block1 );
+        if ( COAP_BLOCK_NUM( block1 ) == 0 )
+        {
+            coap_OptionUint( writer, COAP_OPTION_SIZE1, request->payload_length );
+        }
+    }
+    coap_Payload( writer, &request->payload[ offset ], length );
+
+    return writer->overflow ? 0 : writer->length;
+}
+
+void coap_Begin( coap_writer_t *writer, uint8_t *buffer, uint32_t size, uint8_t type, uint8_t code,
+                 uint16_t message_id, const uint8_t *token, uint8_t token_length )
+{
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->length = COAP_HEADER_SIZE + token_length;
+    writer->option = 0;
+    writer->overflow = ( writer->length > size );
+
+    if ( !writer->overflow )
+    {
+        buffer[ 0 ] = ( COAP_VERSION << 6 ) | ( type << 4 ) | token_length;
+        buffer[ 1 ] = code;
+        buffer[ 2 ] = ( uint8_t )( message_id >> 8 );
+        buffer[ 3 ] = ( uint8_t )message_id;
+        memcpy( &buffer[ COAP_HEADER_SIZE ], token, token_length );
+    }
+}
+
+void coap_Option( coap_writer_t *writer, uint16_t number, const uint8_t *value, uint32_t length )
+{
+    uint32_t delta = number - writer->option;
+    uint8_t delta_nibble = coap_Nibble( delta );
+    uint8_t length_nibble = coap_Nibble( length );
+    uint32_t need = 1 + coap_ExtensionSize( delta_nibble ) + coap_ExtensionSize( length_nibble ) + length;
+
+    if ( writer->overflow || writer->length + need > writer->size )
+    {
+        writer->overflow = true;
+        return;
+    }
+
+    // Option number as delta to the one before, both it and the length extended past 12
+    writer->buffer[ writer->length++ ] = ( delta_nibble << 4 ) | length_nibble;
+    coap_PutExtension( writer, delta, delta_nibble );
+    coap_PutExtension( writer, length, length_nibble );
+    memcpy( &writer->buffer[ writer->length ], value, length );
+    writer->length += length;
+    writer->option = number;
+}
+
+void coap_OptionUint( coap_writer_t *writer, uint16_t number, uint32_t value )
+{
+    uint8_t bytes[ sizeof( uint32_t ) ];
+    uint32_t i, length = 0;
+
+    // Shortest big endian form, no bytes at all for 0
+    while ( length < sizeof( bytes ) && ( value >> ( length * 8 ) ) != 0 )
+    {
+        length++;
+    }
+    for ( i = 0; i < length; i++ )
+    {
+        bytes[ i ] = ( uint8_t )( value >> ( ( length - 1 - i ) * 8 ) );
+    }
+    coap_Option( writer, number, bytes, length );
+}
+
+void coap_OptionPath( coap_writer_t *writer, const char *path )
+{
+    const char *end;
+
+    while ( *path != 0 )
+    {
+        if ( ( end = strchr( path, '/' ) ) == NULL )
+        {
+            end = path + strlen( path );
+        }
+        if ( end > path )
+        {
+            coap_Option( writer, COAP_OPTION_URI_PATH, ( const uint8_t * )path, end - path );
+        }
+        path = ( *end == '/' ) ? end + 1 : end;
+    }
+}
+
+void coap_Payload( coap_writer_t *writer, const uint8_t *payload, uint32_t length )
+{
+    if ( length == 0 )
+    {
+        return;
+    }
+    if ( writer->overflow || writer->length + 1 + length > writer->size )
+    {
+        writer->overflow = true;
+        return;
+    }
+
+    writer->buffer[ writer->length++ ] = COAP_PAYLOAD_MARKER;
+    memcpy( &writer->buffer[ writer->length ], payload, length );
+    writer->length += length;
+}
+
+bool coap_Parse( const uint8_t *data, uint32_t length, coap_message_t *message )
+{
+    uint32_t position, delta, option_length, number = 0;
+
+    if ( length < COAP_HEADER_SIZE || ( data[ 0 ] >> 6 ) != COAP_VERSION || ( data[ 0 ] & 0x0f ) > 8 )
+    {
+        return false;
+    }
+
+    memset( message, 0, sizeof( *message ) );
+    message->type = ( data[ 0 ] >> 4 ) & 0x03;
+    message->token_length = data[ 0 ] & 0x0f;
+    message->code = data[ 1 ];
+    message->message_id = ( data[ 2 ] << 8 ) | data[ 3 ];
+    message->token = &data[ COAP_HEADER_SIZE ];
+    position = COAP_HEADER_SIZE + message->token_length;
+    if ( position > length )
+    {
+        return false;
+    }
+
+    // Options up to the payload marker; only the ones the client acts on are kept
+    while ( position < length && data[ position ] != COAP_PAYLOAD_MARKER )
+    {
+        delta = data[ position ] >> 4;
+        option_length = data[ position++ ] & 0x0f;
+        if ( !coap_Extend( data, length, &position, &delta ) ||
+             !coap_Extend( data, length, &position, &option_length ) ||
+             position + option_length > length )
+        {
+            return false;
+        }
+        number += delta;
+        switch ( number )
+        {
+            case COAP_OPTION_OBSERVE:
+                message->has_observe = true;
+                message->observe = coap_Uint( &data[ position ], option_length );
+                break;
+            case COAP_OPTION_BLOCK1:
+                message->has_block1 = true;
+                message->block1 = coap_Uint( &data[ position ], option_length );
+                break;
+            case COAP_OPTION_BLOCK2:
+                message->has_block2 = true;
+                message->block2 = coap_Uint( &data[ position ], option_length );
+                break;
+            default:
+                break;
+        }
+        position += option_length;
+    }
+
+    // A marker with nothing after it is a format error
+    if ( position < length )
+    {
+        if ( ++position == length )
+        {
+            return false;
+        }
+        message->payload = &data[ position ];
+        message->payload_length = length - position;
+    }
+
+    return true;
+}
+
+bool coap_Extend( const uint8_t *data, uint32_t length, uint32_t *position, uint32_t *value )
+{
+    if ( *value == 13 )
+    {
+        if ( *position + 1 > length )
+        {
+            return false;
+        }
+        *value = data[ ( *position )++ ] + 13;
+    }
+    else if ( *value == 14 )
+    {
+        if ( *position + 2 > length )
+        {
+            return false;
+        }
+        *value = ( ( data[ *position ] << 8 ) | data[ *position + 1 ] ) + 269;
+        *position += 2;
+    }
+    else if ( *value == 15 )
+    {
+        return false;
+    }
+
+    return true;
+}
+
+uint8_t coap_Nibble( uint32_t value )
+{
+    return ( value < 13 ) ? value : ( ( value < 269 ) ? 13 : 14 );
+}
+
+uint32_t coap_ExtensionSize( uint8_t nibble )
+{
+    return ( nibble == 13 ) ? 1 : ( ( nibble == 14 ) ? 2 : 0 );
+}
+
+void coap_PutExtension( coap_writer_t *writer, uint32_t value, uint8_t nibble )
+{
+    if ( nibble == 13 )
+    {
+        writer->buffer[ writer->length++ ] = ( uint8_t )( value - 13 );
+    }
+    else if ( nibble == 14 )
+    {
+        writer->buffer[ writer->length++ ] = ( uint8_t )( ( value - 269 ) >> 8 );
+        writer->buffer[ writer->length++ ] = ( uint8_t )( value - 269 );
+    }
+}
+
+uint32_t coap_Uint( const uint8_t *data, uint32_t length )
+{
+    uint32_t i, value = 0;
+
+    for ( i = 0; i < length && i < sizeof( uint32_t ); i++ )
+    {
+        value = ( value << 8 ) | data[ i ];
+    }
+
+    return value;
+}
+
+void coap_Dispatch( const coap_message_t *message )
+{
+    coap_observe_t *observe = NULL;
+    uint32_t now = os.GetTickCountMs();
+    bool is_fresh;
+
+    // Nothing is outstanding that an ACK or RST could belong to
+    if ( message->type == COAP_TYPE_ACK || message->type == COAP_TYPE_RST || message->code == COAP_EMPTY )
+    {
+        return;
+    }
+    if ( message->token_length == COAP_TOKEN_LENGTH )
+    {
+        observe = coap_FindObserve( NULL, message->token );
+    }
+    if ( observe == NULL )
+    {
+        // Nobody asked for it: tell the server to stop sending
+        coap_Reply( message, COAP_TYPE_RST );
+        return;
+    }
+    if ( message->type == COAP_TYPE_CON )
+    {
+        coap_Reply( message, COAP_TYPE_ACK );
+    }
+
+    // Notifications may arrive out of order; the 24 bit sequence number wraps
+    is_fresh = !message->has_observe ||
+               ( observe->sequence < message->observe && message->observe - observe->sequence < COAP_OBSERVE_HALF ) ||
+               ( observe->sequence > message->observe && observe->sequence - message->observe > COAP_OBSERVE_HALF ) ||
+               now - observe->received_ms > COAP_OBSERVE_FRESH;
+    if ( !is_fresh )
+    {
+        coap_obj.stats.stale++;
+        return;
+    }
+
+    observe->sequence = message->observe;
+    observe->received_ms = now;
+    coap_obj.stats.notifications++;
+    observe->handler( message->payload, message->payload_length, message->code, observe->context );
+
+    // Without Observe option, or with an error, the server has ended the observation
+    if ( !message->has_observe || COAP_CLASS( message->code ) != 2 )
+    {
+        observe->active = false;
+    }
+}
+
+void coap_Reply( const coap_message_t *message, uint8_t type )
+{
+    uint8_t reply[ COAP_HEADER_SIZE ] =
+    {
+        ( COAP_VERSION << 6 ) | ( type << 4 ),
+        COAP_EMPTY,
+        ( uint8_t )( message->message_id >> 8 ),
+        ( uint8_t )message->message_id,
+    };
+
+    coap_obj.send( coap_obj.fd, reply, sizeof( reply ) );
+}
+
+coap_observe_t *coap_FindObserve( const char *path, const uint8_t *token )
+{
+    uint32_t i;
+    coap_observe_t *observe;
+
+    // By path, by token, or else the first free entry
+    for ( i = 0; i < COAP_OBSERVE_COUNT; i++ )
+    {
+        observe = &coap_obj.observe[ i ];
+        if ( path != NULL && observe->active && strcmp( observe->path, path ) == 0 )
+        {
+            return observe;
+        }
+        if ( token != NULL && observe->active && memcmp( observe->token, token, COAP_TOKEN_LENGTH ) == 0 )
+        {
+            return observe;
+        }
+        if ( path == NULL && token == NULL && !observe->active )
+        {
+            return observe;
+        }
+    }
+
+    return NULL;
+}
+
+uint32_t coap_Random( void )
+{
+    // xorshift32
+    coap_obj.random ^= coap_obj.random << 13;
+    coap_obj.random ^= coap_obj.random >> 17;
+    coap_obj.random ^= coap_obj.random << 5;
+
+    return coap_obj.random;
+}
+
+#if COAP_BENCHMARK_ENABLED
+void coap_BenchRun( const char *name, coap_request_t *request, uint32_t count )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t i, start, cycles, blocks = coap_obj.stats.blocks;
+    bool is_match = true;
+
+    coap_obj.bench.sent_bytes = 0;
+    coap_obj.bench.received_bytes = 0;
+    coap_obj.bench.messages = 0;
+    coap_obj.bench.errors = 0;
+
+    start = DWT->CYCCNT;
+    for ( i = 0; i < count && error == NO_ERROR; i++ )
+    {
+        error = coap_Request( request );
+        if ( request->response != NULL )
+        {
+            is_match = is_match && request->response_length == coap_obj.bench.resource_size &&
+                       memcmp( request->response, benchmark_data, request->response_length ) == 0;
+        }
+    }
+    cycles = DWT->CYCCNT - start;
+
+    Log.Print( "%-10s %5d us, %3d messages, %5d bytes up, %5d bytes down, %3d blocks per request%s\r\n",
+               name,
+               cycles / ( SystemCoreClock / 1000000 ) / count,
+               coap_obj.bench.messages / count,
+               coap_obj.bench.sent_bytes / count,
+               coap_obj.bench.received_bytes / count,
+               ( coap_obj.stats.blocks - blocks ) / count,
+               ( error != NO_ERROR || !is_match || coap_obj.bench.errors > 0 ) ? ", FAILED" : "" );
+}
+
+int32_t coap_BenchSend( int32_t fd, uint8_t *buf, uint32_t size )
+{
+    coap_bench_t *bench = &coap_obj.bench;
+    coap_message_t request;
+    coap_writer_t writer;
+    uint32_t num, szx, offset, length, more;
+    uint8_t type;
+    uint16_t message_id;
+
+    bench->sent_bytes += size;
+    bench->messages++;
+
+    // The stand-in answers requests: piggybacked on the ACK of a CON, or in a NON to a NON GET
+    if ( !coap_Parse( buf, size, &request ) || request.code == COAP_EMPTY ||
+         ( request.type == COAP_TYPE_NON && request.code != coap_get ) )
+    {
+        return size;
+    }
+    type = ( request.type == COAP_TYPE_CON ) ? COAP_TYPE_ACK : COAP_TYPE_NON;
+    message_id = ( request.type == COAP_TYPE_CON ) ? request.message_id : bench->message_id++;
+
+    if ( request.code == coap_get )
+    {
+        // Serve the resource in the blocks asked for
+        szx = request.has_block2 ? COAP_BLOCK_SZX_OF( request.block2 ) : COAP_BLOCK_SZX;
+        num = request.has_block2 ? COAP_BLOCK_NUM( request.block2 ) : 0;
+        offset = num * COAP_SZX_SIZE( szx );
+        length = ( offset < bench->resource_size ) ? bench->resource_size - offset : 0;
+        length = ( length > COAP_SZX_SIZE( szx ) ) ? COAP_SZX_SIZE( szx ) : length;
+        more = ( offset + length < bench->resource_size );
+        coap_Begin( &writer, bench->response, sizeof( bench->response ), type, COAP_CONTENT, message_id, request.token, request.token_length );
+        if ( request.has_block2 || more )
+        {
+            coap_OptionUint( &writer, COAP_OPTION_BLOCK2, COAP_BLOCK( num, more, szx ) );
+        }
+        coap_Payload( &writer, &benchmark_data[ offset ], length );
+    }
+    else
+    {
+        // Take the payload, checking each block lands where it belongs
+        offset = request.has_block1 ? COAP_BLOCK_NUM( request.block1 ) * COAP_SZX_SIZE( COAP_BLOCK_SZX_OF( request.block1 ) ) : 0;
+        if ( offset + request.payload_length > COAP_BENCHMARK_SIZE ||
+             ( request.payload_length > 0 && memcmp( request.payload, &benchmark_data[ offset ], request.payload_length ) != 0 ) )
+        {
+            bench->errors++;
+        }
+        bench->received += request.payload_length;
+        more = request.has_block1 && COAP_BLOCK_MORE( request.block1 );
+        coap_Begin( &writer, bench->response, sizeof( bench->response ), type, more ? COAP_CONTINUE : COAP_CHANGED,
+                    message_id, request.token, request.token_length );
+        if ( request.has_block1 )
+        {
+            coap_OptionUint( &writer, COAP_OPTION_BLOCK1, request.block1 );
+        }
+    }
+    bench->response_length = writer.length;
+
+    return size;
+}
+
+int32_t coap_BenchReceive( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms )
+{
+    coap_bench_t *bench = &coap_obj.bench;
+    uint32_t length = bench->response_length;
+
+    if ( length > size )
+    {
+        length = size;
+    }
+    memcpy( buf, bench->response, length );
+    bench->received_bytes += length;
+    bench->response_length = 0;
+
+    return length;
+}
+#endif
+
+/**
+ * @} Coap
+ */
+
+/**
+ * @} Application
+ */
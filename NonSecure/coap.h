@@ -0,0 +1,137 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      coap.h
+ * @brief     CoAP client module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Coap
+ * @{
+ */
+#ifndef __COAP_H__
+#define __COAP_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "os.h"
+#include "log.h"
+#include "eelcodes.h"
+#include "modem.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define COAP_PORT                       ( 5683 )
+#define COAP_SECURE_PORT                ( 5684 )
+
+#ifndef COAP_BLOCK_SZX
+#define COAP_BLOCK_SZX                  ( 4 )           /*!< block-wise transfers in blocks of 2^(n + 4) bytes */
+#endif
+
+#define COAP_BLOCK_SIZE                 ( 1 << ( COAP_BLOCK_SZX + 4 ) )
+
+#ifndef COAP_ACK_TIMEOUT
+#define COAP_ACK_TIMEOUT                ( 2000 )        /*!< first retransmission after 1 to 1.5 times this */
+#endif
+
+#ifndef COAP_MAX_RETRANSMIT
+#define COAP_MAX_RETRANSMIT             ( 4 )           /*!< a confirmable message is sent again at most this often */
+#endif
+
+#ifndef COAP_OBSERVE_COUNT
+#define COAP_OBSERVE_COUNT              ( 2 )           /*!< resources observed at once */
+#endif
+
+#ifndef COAP_BENCHMARK_ENABLED
+#define COAP_BENCHMARK_ENABLED          ( 0 )           /*!< set to 1 to build coap.Benchmark() and its scratch buffer */
+#endif
+
+#if COAP_BLOCK_SZX > 6
+#error "COAP_BLOCK_SZX out of range"
+#endif
+
+#define COAP_CODE( class, detail )      ( ( ( class ) << 5 ) | ( detail ) )
+#define COAP_CLASS( code )              ( ( code ) >> 5 )
+#define COAP_FORMAT_TEXT                ( 0 )           /*!< text/plain; charset=utf-8 */
+#define COAP_FORMAT_JSON                ( 50 )
+#define COAP_FORMAT_CBOR                ( 60 )
+#define COAP_FORMAT_NONE                ( 0xffff )      /*!< no Content-Format option */
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+typedef enum
+{
+    coap_get                = 1,
+    coap_post,
+    coap_put,
+    coap_delete,
+} coap_method_t;
+
+/**
+ * @brief A request and, once it returns, its response. Payloads larger than COAP_BLOCK_SIZE go block-wise both ways.
+ */
+typedef struct
+{
+    coap_method_t               method;
+    const char                  *path;          /*!< "a/b/c", one Uri-Path option per segment */
+    bool                        confirmable;
+    uint16_t                    format;         /*!< Content-Format of payload, COAP_FORMAT_NONE for none */
+    const uint8_t               *payload;
+    uint32_t                    payload_length;
+    uint8_t                     *response;      /*!< NULL: a non-confirmable request is sent and forgotten */
+    uint32_t                    response_size;
+    uint32_t                    response_length;
+    uint8_t                     code;           /*!< response code, COAP_CODE( 2, 5 ) for 2.05 Content */
+} coap_request_t;
+
+/**
+ * @brief Observe handler, called with each notification of the resource. It runs with the client locked, so it must not
+ *        call the CoAP client itself.
+ */
+typedef void ( *coap_notify_t )( const uint8_t *payload, uint32_t length, uint8_t code, void *context );
+
+/**
+ * Specifies the public interface functions of the CoAP client.
+ */
+typedef struct
+{
+    error_code_module_t ( *Init )( void );
+    error_code_module_t ( *Open )( const char *transport_protocol, const char *host_name, uint16_t port );
+    error_code_module_t ( *Close )( void );
+    error_code_module_t ( *Request )( coap_request_t *request );
+    error_code_module_t ( *Observe )( const char *path, coap_notify_t handler, void *context );
+    error_code_module_t ( *Cancel )( const char *path );
+    error_code_module_t ( *Poll )( uint32_t timeout_ms );
+    void ( *Status )( void );
+#if COAP_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t count, uint32_t size );
+#endif
+    bool ( *isInit )( void );
+} const coap_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern coap_interface_t coap;
+
+#endif /* __COAP_H__ */
+
+/**
+ * @} Coap
+ */
+
+/**
+ * @} Applicaton
+ */
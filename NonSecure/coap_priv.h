@@ -0,0 +1,294 @@
+/** @file coap_priv.h
+ *
+ * @brief       CoAP client module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Coap
+ * @{
+ */
+
+#ifndef __COAP_PRIV_H__
+#define __COAP_PRIV_H__
+
+/*
+ * @note
+ * CoAP (RFC 7252) over a UDP or DTLS socket of the modem. One request is in flight at a time: Request builds the
+ * message in a transmit buffer, sends it and reads datagrams into a receive buffer until the matching response arrives.
+ * Both buffers are in coap_obj and hold one block, so no request allocates memory.
+ *
+ * A confirmable message is sent again after COAP_ACK_TIMEOUT, stretched by a random factor up to 1.5, and the wait
+ * doubles with each retransmission, COAP_MAX_RETRANSMIT times at most. A response matches by token: piggybacked in the
+ * ACK, or separate after an empty ACK, in which case it is acknowledged when confirmable. Each message gets a new token
+ * and message ID.
+ *
+ * Payloads larger than COAP_BLOCK_SIZE go block-wise (RFC 7959): Block1 for the request, block by block as long as the
+ * server answers 2.31 Continue, and Block2 for the response, asking for the next block while the server says there are
+ * more. A server asking for smaller blocks gets them.
+ *
+ * Observe (RFC 7641) registers a token with a handler. Notifications arrive while a request waits or during Poll; stale
+ * ones (older sequence number) are dropped, confirmable ones acknowledged and ones of unknown tokens reset.
+ * Notifications must fit in one block.
+ *
+ * With COAP_BENCHMARK_ENABLED, a stand-in server takes the place of the socket: it answers requests in memory, so the
+ * benchmark measures the client and counts the bytes and blocks of each exchange.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "coap.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define COAP_VERSION            ( 1 )
+#define COAP_TYPE_CON           ( 0 )
+#define COAP_TYPE_NON           ( 1 )
+#define COAP_TYPE_ACK           ( 2 )
+#define COAP_TYPE_RST           ( 3 )
+#define COAP_EMPTY              ( 0 )
+#define COAP_CONTINUE           COAP_CODE( 2, 31 )
+#define COAP_CONTENT            COAP_CODE( 2, 5 )
+#define COAP_CHANGED            COAP_CODE( 2, 4 )
+#define COAP_OPTION_OBSERVE     ( 6 )
+#define COAP_OPTION_URI_PATH    ( 11 )
+#define COAP_OPTION_FORMAT      ( 12 )
+#define COAP_OPTION_BLOCK2      ( 23 )
+#define COAP_OPTION_BLOCK1      ( 27 )
+#define COAP_OPTION_SIZE1       ( 60 )
+#define COAP_PAYLOAD_MARKER     ( 0xff )
+#define COAP_HEADER_SIZE        ( 4 )
+#define COAP_TOKEN_LENGTH       ( 4 )
+#define COAP_OPTIONS_MAX        ( 64 )          /*!< room for the options of one message */
+#define COAP_MESSAGE_MAX        ( COAP_HEADER_SIZE + COAP_TOKEN_LENGTH + COAP_OPTIONS_MAX + 1 + COAP_BLOCK_SIZE )
+#define COAP_RANDOM_FACTOR      ( 50 )          /*!< ACK_RANDOM_FACTOR 1.5, in percent above 1 */
+#define COAP_RESPONSE_TIMEOUT   ( 10000 )       /*!< wait for a separate response or the response to a NON request */
+#define COAP_TIMEOUT            ( 5000 )        /*!< connect and send time-out */
+#define COAP_PATH_LENGTH        ( 32 )
+#define COAP_NONE               ( 0xffffffffUL )    /*!< option left out */
+#define COAP_POLL_MS            ( 50 )          /*!< Poll holds the socket this long at a time */
+#define COAP_RANDOM_PRIME       ( 16777619UL )  /*!< FNV-1a prime */
+#define COAP_OBSERVE_HALF       ( 1UL << 23 )   /*!< half the range of the 24 bit Observe sequence number */
+#define COAP_OBSERVE_FRESH      ( 128000 )      /*!< a notification this much later is fresh whatever its number */
+#define COAP_BLOCK_NUM( value ) ( ( value ) >> 4 )
+#define COAP_BLOCK_MORE( value ) ( ( ( value ) >> 3 ) & 1 )
+#define COAP_BLOCK_SZX_OF( value ) ( ( value ) & 7 )
+#define COAP_BLOCK( num, more, szx ) ( ( ( num ) << 4 ) | ( ( more ) << 3 ) | ( szx ) )
+#define COAP_SZX_SIZE( szx )    ( 1UL << ( ( szx ) + 4 ) )
+#if COAP_BENCHMARK_ENABLED
+#define COAP_BENCHMARK_SIZE     ( 4096 )        /*!< largest block-wise transfer of the benchmark */
+#define COAP_BENCH_FD           ( 0 )
+#define COAP_BENCH_PATH         "bench"
+#define COAP_BENCH_SMALL        ( 16 )          /*!< payload of the short requests */
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/**
+ * @brief A received message; token and payload point into the receive buffer.
+ */
+typedef struct
+{
+    uint8_t                     type;
+    uint8_t                     code;
+    uint16_t                    message_id;
+    uint8_t                     token_length;
+    const uint8_t               *token;
+    const uint8_t               *payload;
+    uint32_t                    payload_length;
+    bool                        has_observe;
+    bool                        has_block1;
+    bool                        has_block2;
+    uint32_t                    observe;
+    uint32_t                    block1;
+    uint32_t                    block2;
+} coap_message_t;
+
+/**
+ * @brief Builds a message in a buffer; options must be added in increasing number.
+ */
+typedef struct
+{
+    uint8_t                     *buffer;
+    uint32_t                    size;
+    uint32_t                    length;
+    uint16_t                    option;         /*!< number of the last option */
+    bool                        overflow;
+} coap_writer_t;
+
+typedef struct
+{
+    bool                        active;
+    char                        path[ COAP_PATH_LENGTH ];
+    uint8_t                     token[ COAP_TOKEN_LENGTH ];
+    coap_notify_t               handler;
+    void                        *context;
+    uint32_t                    sequence;       /*!< Observe number of the last notification */
+    uint32_t                    received_ms;    /*!< time of the last notification */
+} coap_observe_t;
+
+typedef struct
+{
+    uint32_t                    requests;
+    uint32_t                    retransmits;
+    uint32_t                    timeouts;
+    uint32_t                    resets;
+    uint32_t                    blocks;         /*!< block-wise messages after the first of a transfer */
+    uint32_t                    notifications;
+    uint32_t                    stale;          /*!< notifications dropped as older than the last */
+} coap_stats_t;
+
+#if COAP_BENCHMARK_ENABLED
+typedef struct
+{
+    uint8_t                     response[ COAP_MESSAGE_MAX ];
+    uint32_t                    response_length;
+    uint32_t                    resource_size;  /*!< bytes served to GET */
+    uint32_t                    received;       /*!< bytes taken by PUT and POST */
+    uint32_t                    errors;         /*!< block payloads not where they belong */
+    uint32_t                    sent_bytes;
+    uint32_t                    received_bytes;
+    uint32_t                    messages;
+    uint16_t                    message_id;
+} coap_bench_t;
+#endif
+
+typedef struct
+{
+    bool                        is_init;
+    int32_t                     fd;
+    uint16_t                    message_id;
+    uint32_t                    random;
+    SemaphoreHandle_t           mutex_handle;
+    int32_t                     ( *send )( int32_t fd, uint8_t *buf, uint32_t size );
+    int32_t                     ( *receive )( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms );
+    uint8_t                     tx[ COAP_MESSAGE_MAX ];
+    uint8_t                     rx[ COAP_MESSAGE_MAX ];
+    coap_observe_t              observe[ COAP_OBSERVE_COUNT ];
+    coap_stats_t                stats;
+#if COAP_BENCHMARK_ENABLED
+    coap_bench_t                bench;
+#endif
+} coap_obj_t;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Initialize the CoAP client.
+ * @return      Error code.
+ */
+static error_code_module_t coap_Init( void );
+
+/**
+ * @brief       Open the socket to a CoAP server.
+ * @param[in]   transport_protocol  "udp", or "dtls" for CoAP over DTLS.
+ * @param[in]   host_name           Host-name of the server.
+ * @param[in]   port                COAP_PORT, or COAP_SECURE_PORT for DTLS.
+ * @return      Error code.
+ */
+static error_code_module_t coap_Open( const char *transport_protocol, const char *host_name, uint16_t port );
+
+/**
+ * @brief       Close the socket and drop all observations.
+ * @return      Error code.
+ */
+static error_code_module_t coap_Close( void );
+
+/**
+ * @brief       Send a request and wait for its response, block-wise when the payloads are larger than a block.
+ * @param[in]   request     Request; response, response_length and code are filled in.
+ * @return      Error code, ERROR_COAP_TIMEOUT without response, ERROR_COAP_RESET when the server refused the message,
+ *              ERROR_COAP_FULL when the response did not fit response_size (response_length is what fitted).
+ */
+static error_code_module_t coap_Request( coap_request_t *request );
+
+/**
+ * @brief       Observe a resource: the handler gets the current state, then each notification.
+ * @param[in]   path        Path of the resource.
+ * @param[in]   handler     Called with each representation of the resource.
+ * @param[in]   context     Passed to handler.
+ * @return      Error code, ERROR_COAP_REJECTED when the server answers without observing.
+ */
+static error_code_module_t coap_Observe( const char *path, coap_notify_t handler, void *context );
+
+/**
+ * @brief       Stop observing a resource.
+ * @param[in]   path        Path of the resource.
+ * @return      Error code.
+ */
+static error_code_module_t coap_Cancel( const char *path );
+
+/**
+ * @brief       Receive notifications for a while.
+ * @param[in]   timeout_ms  How long to wait for datagrams.
+ * @return      Error code.
+ */
+static error_code_module_t coap_Poll( uint32_t timeout_ms );
+
+/**
+ * @brief       Print the message counters and observations.
+ */
+static void coap_Status( void );
+#if COAP_BENCHMARK_ENABLED
+
+/**
+ * @brief       Measure requests per second and block-wise transfers against the stand-in server.
+ * @param[in]   count       Requests per run.
+ * @param[in]   size        Bytes of the block-wise transfers, at most COAP_BENCHMARK_SIZE.
+ */
+static void coap_Benchmark( uint32_t count, uint32_t size );
+#endif
+
+/**
+ * @brief       Check module initialization.
+ * @return      True if the module is initialized.
+ */
+static bool coap_isInit( void );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static error_code_module_t coap_Exchange( uint32_t length, bool confirmable, bool wait, coap_message_t *response );
+static uint32_t coap_Build( coap_writer_t *writer, const coap_request_t *request, const uint8_t *token, uint32_t observe,
+                            uint32_t block1, uint32_t block2, uint32_t offset, uint32_t length );
+static void coap_Begin( coap_writer_t *writer, uint8_t *buffer, uint32_t size, uint8_t type, uint8_t code,
+                        uint16_t message_id, const uint8_t *token, uint8_t token_length );
+static void coap_Option( coap_writer_t *writer, uint16_t number, const uint8_t *value, uint32_t length );
+static void coap_OptionUint( coap_writer_t *writer, uint16_t number, uint32_t value );
+static void coap_OptionPath( coap_writer_t *writer, const char *path );
+static void coap_Payload( coap_writer_t *writer, const uint8_t *payload, uint32_t length );
+static bool coap_Parse( const uint8_t *data, uint32_t length, coap_message_t *message );
+static bool coap_Extend( const uint8_t *data, uint32_t length, uint32_t *position, uint32_t *value );
+static uint8_t coap_Nibble( uint32_t value );
+static uint32_t coap_ExtensionSize( uint8_t nibble );
+static void coap_PutExtension( coap_writer_t *writer, uint32_t value, uint8_t nibble );
+static uint32_t coap_Uint( const uint8_t *data, uint32_t length );
+static void coap_Dispatch( const coap_message_t *message );
+static void coap_Reply( const coap_message_t *message, uint8_t type );
+static coap_observe_t *coap_FindObserve( const char *path, const uint8_t *token );
+static uint32_t coap_Random( void );
+#if COAP_BENCHMARK_ENABLED
+static void coap_BenchRun( const char *name, coap_request_t *request, uint32_t count );
+static int32_t coap_BenchSend( int32_t fd, uint8_t *buf, uint32_t size );
+static int32_t coap_BenchReceive( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms );
+#endif
+
+#endif /* __COAP_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -0,0 +1,404 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      compress.c
+ * @brief     Payload compression module
+ * @details   Streaming LZSS encoder with a fixed RAM footprint, and its decoder.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Compress Payload compression
+ * @brief     LZSS payload compression
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "compress_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+compress_interface_t compress =
+{
+    .Begin              = &compress_Begin,
+    .Write              = &compress_Write,
+    .End                = &compress_End,
+    .Decode             = &compress_Decode,
+    .IsCompressed       = &compress_IsCompressed,
+#if COMPRESS_BENCHMARK_ENABLED
+    .Benchmark          = &compress_Benchmark,
+#endif
+};
+
+#if COMPRESS_BENCHMARK_ENABLED
+static uint8_t benchmark_input[ COMPRESS_BENCHMARK_SIZE ];
+static uint8_t benchmark_output[ COMPRESS_BENCHMARK_SIZE ];
+static uint8_t benchmark_decoded[ COMPRESS_BENCHMARK_SIZE ];
+static compress_t benchmark_encoder;
+#endif
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t compress_Begin( compress_t *encoder, uint8_t *buffer, uint32_t size )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( encoder == NULL || buffer == NULL || size < COMPRESS_HEADER_SIZE )
+    {
+        error = ERROR_COMPRESS_BAD_PARAM;
+    }
+    else
+    {
+        encoder->head = 0;
+        encoder->history_length = 0;
+        encoder->lookahead_length = 0;
+        encoder->bits = 0;
+        encoder->bit_count = 0;
+        encoder->buffer = buffer;
+        encoder->size = size;
+        encoder->consumed = 0;
+        encoder->overflow = false;
+
+        buffer[ 0 ] = COMPRESS_MARKER;
+        buffer[ 1 ] = ( COMPRESS_WINDOW_BITS << 4 ) | COMPRESS_LOOKAHEAD_BITS;
+        encoder->length = COMPRESS_HEADER_SIZE;
+    }
+
+    return error;
+}
+
+error_code_module_t compress_Write( compress_t *encoder, const uint8_t *data, uint32_t length )
+{
+    uint32_t i;
+
+    if ( encoder == NULL || ( data == NULL && length > 0 ) )
+    {
+        return ERROR_COMPRESS_BAD_PARAM;
+    }
+
+    // Encode whenever the lookahead is full; the caller gives up on an overflowed payload, so stop searching
+    for ( i = 0; i < length && !encoder->overflow; i++ )
+    {
+        encoder->lookahead[ encoder->lookahead_length++ ] = data[ i ];
+        if ( encoder->lookahead_length == COMPRESS_LOOKAHEAD )
+        {
+            compress_Token( encoder );
+        }
+    }
+    encoder->consumed += length;
+
+    return encoder->overflow ? ERROR_COMPRESS_FULL : NO_ERROR;
+}
+
+error_code_module_t compress_End( compress_t *encoder, uint32_t *length )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( encoder == NULL || length == NULL )
+    {
+        return ERROR_COMPRESS_BAD_PARAM;
+    }
+
+    while ( encoder->lookahead_length > 0 && !encoder->overflow )
+    {
+        compress_Token( encoder );
+    }
+
+    // Pad the last byte with zero bits
+    if ( encoder->bit_count > 0 )
+    {
+        compress_PutBits( encoder, 0, 8 - encoder->bit_count );
+    }
+
+    if ( encoder->overflow )
+    {
+        error = ERROR_COMPRESS_FULL;
+    }
+    else
+    {
+        *length = encoder->length;
+    }
+
+    return error;
+}
+
+error_code_module_t compress_Decode( const uint8_t *data, uint32_t length, uint8_t *buffer, uint32_t size, uint32_t *decoded )
+{
+    uint8_t window_bits, lookahead_bits;
+    uint32_t position, bit_length, distance, count, output = 0;
+
+    if ( data == NULL || buffer == NULL || decoded == NULL )
+    {
+        return ERROR_COMPRESS_BAD_PARAM;
+    }
+    if ( !compress_IsCompressed( data, length ) )
+    {
+        return ERROR_COMPRESS_BAD_DATA;
+    }
+
+    window_bits = data[ 1 ] >> 4;
+    lookahead_bits = data[ 1 ] & 0x0f;
+    if ( lookahead_bits == 0 || window_bits < lookahead_bits || window_bits + lookahead_bits < 8 )
+    {
+        return ERROR_COMPRESS_BAD_DATA;
+    }
+
+    position = COMPRESS_HEADER_SIZE * 8;
+    bit_length = length * 8;
+    while ( position < bit_length )
+    {
+        if ( compress_GetBits( data, &position, 1 ) == COMPRESS_LITERAL )
+        {
+            if ( bit_length - position < 8 )
+            {
+                break;
+            }
+            if ( output == size )
+            {
+                return ERROR_COMPRESS_FULL;
+            }
+            buffer[ output++ ] = ( uint8_t )compress_GetBits( data, &position, 8 );
+        }
+        else
+        {
+            if ( bit_length - position < ( uint32_t )( window_bits + lookahead_bits ) )
+            {
+                break;
+            }
+            distance = compress_GetBits( data, &position, window_bits ) + 1;
+            count = compress_GetBits( data, &position, lookahead_bits ) + 1;
+            if ( distance > output )
+            {
+                return ERROR_COMPRESS_BAD_DATA;
+            }
+            if ( output + count > size )
+            {
+                return ERROR_COMPRESS_FULL;
+            }
+
+            // Byte by byte, a copy may overlap its own output
+            while ( count-- > 0 )
+            {
+                buffer[ output ] = buffer[ output - distance ];
+                output++;
+            }
+        }
+    }
+    *decoded = output;
+
+    return NO_ERROR;
+}
+
+bool compress_IsCompressed( const uint8_t *data, uint32_t length )
+{
+    return data != NULL && length >= COMPRESS_HEADER_SIZE && data[ 0 ] == COMPRESS_MARKER;
+}
+
+#if COMPRESS_BENCHMARK_ENABLED
+void compress_Benchmark( uint32_t iterations )
+{
+    static const char *const names[ COMPRESS_BENCHMARK_SAMPLES ] =
+    {
+        "JSON record",
+        "JSON batch",
+        "log lines",
+    };
+    uint32_t i, sample, start, input_length, output_length = 0, decoded_length = 0;
+    uint32_t encode_cycles, decode_cycles;
+    bool is_match;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    if ( iterations == 0 || cycles_per_us == 0 )
+    {
+        return;
+    }
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    Log.Print( "Compression benchmark: %d runs per sample, window %d, lookahead %d, %d MHz\r\n",
+               iterations,
+               COMPRESS_WINDOW,
+               COMPRESS_LOOKAHEAD,
+               cycles_per_us );
+    for ( sample = 0; sample < COMPRESS_BENCHMARK_SAMPLES; sample++ )
+    {
+        input_length = compress_BenchSample( benchmark_input, sample );
+        encode_cycles = 0;
+        decode_cycles = 0;
+        is_match = true;
+        for ( i = 0; i < iterations; i++ )
+        {
+            start = DWT->CYCCNT;
+            compress_Begin( &benchmark_encoder, benchmark_output, sizeof( benchmark_output ) );
+            compress_Write( &benchmark_encoder, benchmark_input, input_length );
+            compress_End( &benchmark_encoder, &output_length );
+            encode_cycles += DWT->CYCCNT - start;
+
+            start = DWT->CYCCNT;
+            compress_Decode( benchmark_output, output_length, benchmark_decoded, sizeof( benchmark_decoded ), &decoded_length );
+            decode_cycles += DWT->CYCCNT - start;
+            is_match = is_match && decoded_length == input_length && memcmp( benchmark_input, benchmark_decoded, input_length ) == 0;
+        }
+
+        // Throughput in kB/s: bytes per cycle times cycles per second
+        Log.Print( "%-12s %4d -> %4d bytes (%3d%%), encode %4d kB/s, decode %5d kB/s%s\r\n",
+                   names[ sample ],
+                   input_length,
+                   output_length,
+                   output_length * 100 / input_length,
+                   ( uint32_t )( ( uint64_t )input_length * iterations * SystemCoreClock / encode_cycles / 1000 ),
+                   ( uint32_t )( ( uint64_t )input_length * iterations * SystemCoreClock / decode_cycles / 1000 ),
+                   is_match ? "" : ", MISMATCH" );
+    }
+    Log.Print( "RAM: encoder state %d bytes, decoder none besides its output\r\n", sizeof( compress_t ) );
+}
+#endif
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+void compress_Token( compress_t *encoder )
+{
+    uint32_t distance, count, best_distance = 0, best_count = 0;
+    uint32_t mask = COMPRESS_WINDOW - 1;
+    uint8_t value;
+
+    // Longest match in the window; a match may run on into the lookahead itself
+    for ( distance = 1; distance <= encoder->history_length && best_count < encoder->lookahead_length; distance++ )
+    {
+        for ( count = 0; count < encoder->lookahead_length; count++ )
+        {
+            value = ( count < distance ) ? encoder->history[ ( encoder->head - distance + count ) & mask ]
+                                         : encoder->lookahead[ count - distance ];
+            if ( value != encoder->lookahead[ count ] )
+            {
+                break;
+            }
+        }
+        if ( count > best_count )
+        {
+            best_count = count;
+            best_distance = distance;
+        }
+    }
+
+    if ( best_count >= COMPRESS_MATCH_MIN )
+    {
+        compress_PutBits( encoder, COMPRESS_COPY, 1 );
+        compress_PutBits( encoder, best_distance - 1, COMPRESS_WINDOW_BITS );
+        compress_PutBits( encoder, best_count - 1, COMPRESS_LOOKAHEAD_BITS );
+    }
+    else
+    {
+        best_count = 1;
+        compress_PutBits( encoder, COMPRESS_LITERAL, 1 );
+        compress_PutBits( encoder, encoder->lookahead[ 0 ], 8 );
+    }
+
+    // Move the encoded bytes into the window
+    for ( count = 0; count < best_count; count++ )
+    {
+        encoder->history[ encoder->head ] = encoder->lookahead[ count ];
+        encoder->head = ( encoder->head + 1 ) & mask;
+    }
+    if ( encoder->history_length < COMPRESS_WINDOW )
+    {
+        encoder->history_length = ( encoder->history_length + best_count < COMPRESS_WINDOW ) ?
+                                  encoder->history_length + best_count : COMPRESS_WINDOW;
+    }
+    encoder->lookahead_length -= best_count;
+    memmove( encoder->lookahead, &encoder->lookahead[ best_count ], encoder->lookahead_length );
+}
+
+void compress_PutBits( compress_t *encoder, uint32_t value, uint8_t count )
+{
+    while ( count-- > 0 )
+    {
+        encoder->bits = ( encoder->bits << 1 ) | ( ( value >> count ) & 1 );
+        if ( ++encoder->bit_count == 8 )
+        {
+            if ( encoder->length < encoder->size )
+            {
+                encoder->buffer[ encoder->length++ ] = encoder->bits;
+            }
+            else
+            {
+                encoder->overflow = true;
+            }
+            encoder->bits = 0;
+            encoder->bit_count = 0;
+        }
+    }
+}
+
+uint32_t compress_GetBits( const uint8_t *data, uint32_t *position, uint8_t count )
+{
+    uint32_t value = 0;
+
+    while ( count-- > 0 )
+    {
+        value = ( value << 1 ) | ( ( data[ *position >> 3 ] >> ( 7 - ( *position & 7 ) ) ) & 1 );
+        ( *position )++;
+    }
+
+    return value;
+}
+
+#if COMPRESS_BENCHMARK_ENABLED
+uint32_t compress_BenchSample( uint8_t *buffer, uint32_t sample )
+{
+    uint32_t length = 0, i = 0;
+    int32_t written;
+
+    // Typical payloads: one telemetry record, a batch of them, and log output
+    do
+    {
+        if ( sample == 2 )
+        {
+            written = snprintf( ( char * )&buffer[ length ],
+                                COMPRESS_BENCHMARK_SIZE - length,
+                                "I [%8d] mqtt: Publish message: Hello World!: %d\r\n",
+                                86400000 + i * 1000,
+                                i );
+        }
+        else
+        {
+            written = snprintf( ( char * )&buffer[ length ],
+                                COMPRESS_BENCHMARK_SIZE - length,
+                                "{\"seq\":%d,\"ts\":%d,\"temp\":%d.5,\"hum\":%d,\"bat\":%d,\"rssi\":%d,\"ok\":true,\"msg\":\"Hello World!\"}",
+                                i,
+                                86400000 + i * 1000,
+                                21 + i % 10,
+                                40 + i % 20,
+                                3700 + i % 100,
+                                -90 - ( int32_t )( i % 20 ) );
+        }
+        if ( written > 0 && length + written < COMPRESS_BENCHMARK_SIZE )
+        {
+            length += written;
+        }
+        i++;
+    } while ( sample != 0 && written > 0 && length + written < COMPRESS_BENCHMARK_SIZE );
+
+    return length;
+}
+#endif
+
+/**
+ * @} Compress
+ */
+
+/**
+ * @} Application
+ */
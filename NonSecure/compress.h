@@ -0,0 +1,105 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      compress.h
+ * @brief     Payload compression module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Compress
+ * @{
+ */
+#ifndef __COMPRESS_H__
+#define __COMPRESS_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#ifndef COMPRESS_WINDOW_BITS
+#define COMPRESS_WINDOW_BITS            ( 8 )           /*!< history a match may reach back into, 2^n bytes */
+#endif
+
+#ifndef COMPRESS_LOOKAHEAD_BITS
+#define COMPRESS_LOOKAHEAD_BITS         ( 4 )           /*!< longest match, 2^n bytes */
+#endif
+
+#define COMPRESS_WINDOW                 ( 1 << COMPRESS_WINDOW_BITS )
+#define COMPRESS_LOOKAHEAD              ( 1 << COMPRESS_LOOKAHEAD_BITS )
+#define COMPRESS_MARKER                 ( 0x1e )        /*!< first byte of a compressed payload (content-encoding marker) */
+#define COMPRESS_HEADER_SIZE            ( 2 )           /*!< marker, then window and lookahead bits */
+
+#ifndef COMPRESS_BENCHMARK_ENABLED
+#define COMPRESS_BENCHMARK_ENABLED      ( 0 )           /*!< set to 1 to build compress.Benchmark() and its scratch buffers */
+#endif
+
+#if COMPRESS_WINDOW_BITS > 15 || COMPRESS_LOOKAHEAD_BITS < 1 || COMPRESS_LOOKAHEAD_BITS > COMPRESS_WINDOW_BITS || \
+    COMPRESS_WINDOW_BITS + COMPRESS_LOOKAHEAD_BITS < 8
+#error "COMPRESS_WINDOW_BITS and COMPRESS_LOOKAHEAD_BITS out of range"
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief LZSS encoder streaming input into a buffer of the caller. This is all the RAM it uses.
+ */
+typedef struct
+{
+    uint8_t                     history[ COMPRESS_WINDOW ];     /*!< ring of the bytes already encoded */
+    uint8_t                     lookahead[ COMPRESS_LOOKAHEAD ];/*!< bytes waiting to be encoded */
+    uint16_t                    head;           /*!< next position in history */
+    uint16_t                    history_length;
+    uint16_t                    lookahead_length;
+    uint8_t                     bits;           /*!< bits not yet written to buffer */
+    uint8_t                     bit_count;
+    uint8_t                     *buffer;
+    uint32_t                    size;
+    uint32_t                    length;
+    uint32_t                    consumed;       /*!< input bytes */
+    bool                        overflow;       /*!< output did not fit, End reports it */
+} compress_t;
+
+/**
+ * Specifies the public interface functions of the compression module.
+ */
+typedef struct
+{
+    error_code_module_t ( *Begin )( compress_t *encoder, uint8_t *buffer, uint32_t size );
+    error_code_module_t ( *Write )( compress_t *encoder, const uint8_t *data, uint32_t length );
+    error_code_module_t ( *End )( compress_t *encoder, uint32_t *length );
+    error_code_module_t ( *Decode )( const uint8_t *data, uint32_t length, uint8_t *buffer, uint32_t size, uint32_t *decoded );
+    bool ( *IsCompressed )( const uint8_t *data, uint32_t length );
+#if COMPRESS_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t iterations );
+#endif
+} const compress_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern compress_interface_t compress;
+
+#endif /* __COMPRESS_H__ */
+
+/**
+ * @} Compress
+ */
+
+/**
+ * @} Applicaton
+ */
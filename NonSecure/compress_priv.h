@@ -0,0 +1,129 @@
+/** @file compress_priv.h
+ *
+ * @brief       Payload compression module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Compress
+ * @{
+ */
+
+#ifndef __COMPRESS_PRIV_H__
+#define __COMPRESS_PRIV_H__
+
+/*
+ * @note
+ * LZSS in the manner of heatshrink: the encoder keeps the last COMPRESS_WINDOW bytes it encoded and up to
+ * COMPRESS_LOOKAHEAD bytes still to encode, and nothing else, so its RAM does not depend on the payload. A payload
+ * starts with COMPRESS_MARKER and a byte holding window bits (high nibble) and lookahead bits (low nibble). Then follows
+ * a bit stream, most significant bit first:
+ *   1, 8 bits                  literal byte
+ *   0, window bits, lookahead bits   distance - 1 and length - 1 of a copy of earlier output (they may overlap)
+ * The last byte is padded with zero bits; fewer bits than a whole token remain there, so the decoder stops.
+ *
+ * The encoder searches the whole window for the longest match, which is slow next to a hashed search but needs no
+ * table. Decode needs no state besides the output buffer and uses only the C library; Tools/compress_decode.py is the
+ * same decoder for the backend.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "compress.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define COMPRESS_MATCH_MIN          ( 2 )           /*!< shorter matches cost more bits than literals */
+#define COMPRESS_LITERAL            ( 1 )
+#define COMPRESS_COPY               ( 0 )
+#if COMPRESS_BENCHMARK_ENABLED
+#define COMPRESS_BENCHMARK_SIZE     ( 1024 )
+#define COMPRESS_BENCHMARK_SAMPLES  ( 3 )
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Start a compressed payload.
+ * @param[out]  encoder     Encoder state.
+ * @param[in]   buffer      Where the payload is written.
+ * @param[in]   size        Size of buffer.
+ * @return      Error code.
+ */
+static error_code_module_t compress_Begin( compress_t *encoder, uint8_t *buffer, uint32_t size );
+
+/**
+ * @brief       Compress the next part of the input.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   data        Input.
+ * @param[in]   length      Length of data.
+ * @return      Error code, ERROR_COMPRESS_FULL when the output no longer fits.
+ */
+static error_code_module_t compress_Write( compress_t *encoder, const uint8_t *data, uint32_t length );
+
+/**
+ * @brief       Encode the rest of the input and close the payload.
+ * @param[in]   encoder     Encoder state.
+ * @param[out]  length      Length of the payload.
+ * @return      Error code, ERROR_COMPRESS_FULL when the output did not fit.
+ */
+static error_code_module_t compress_End( compress_t *encoder, uint32_t *length );
+
+/**
+ * @brief       Decompress a payload.
+ * @param[in]   data        Compressed payload, marker included.
+ * @param[in]   length      Length of data.
+ * @param[out]  buffer      Decompressed output.
+ * @param[in]   size        Size of buffer.
+ * @param[out]  decoded     Length of the output.
+ * @return      Error code, ERROR_COMPRESS_BAD_DATA for a malformed payload, ERROR_COMPRESS_FULL when buffer is too small.
+ */
+static error_code_module_t compress_Decode( const uint8_t *data, uint32_t length, uint8_t *buffer, uint32_t size, uint32_t *decoded );
+
+/**
+ * @brief       Check for the content-encoding marker.
+ * @param[in]   data        Payload.
+ * @param[in]   length      Length of data.
+ * @return      True if the payload is compressed.
+ */
+static bool compress_IsCompressed( const uint8_t *data, uint32_t length );
+#if COMPRESS_BENCHMARK_ENABLED
+
+/**
+ * @brief       Measure ratio, throughput and RAM of compressing typical payloads.
+ * @param[in]   iterations  Times each sample is compressed and decoded.
+ */
+static void compress_Benchmark( uint32_t iterations );
+#endif
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static void compress_Token( compress_t *encoder );
+static void compress_PutBits( compress_t *encoder, uint32_t value, uint8_t count );
+static uint32_t compress_GetBits( const uint8_t *data, uint32_t *position, uint8_t count );
+#if COMPRESS_BENCHMARK_ENABLED
+static uint32_t compress_BenchSample( uint8_t *buffer, uint32_t sample );
+#endif
+
+#endif /* __COMPRESS_PRIV_H__ */
+
+/**
+ * @}
+ */
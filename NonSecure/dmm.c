@@ -31,6 +31,15 @@ dmm_interface_t dmm =
     .Free               = &dmm_Free,
     .Report             = &dmm_Report,
     .GetMaxSize         = &dmm_GetMaxSize,
+    .GetStats           = &dmm_GetStats,
+#if DMM_TRACE_ENABLED
+    .AllocTagged        = &dmm_AllocTagged,
+    .TraceReport        = &dmm_TraceReport,
+    .LeakCheck          = &dmm_LeakCheck,
+#endif
+#if DMM_BENCHMARK_ENABLED
+    .Benchmark          = &dmm_Benchmark,
+#endif
 };
 
 dmm_obj_t dmm_obj =
@@ -39,6 +48,11 @@ dmm_obj_t dmm_obj =
     .dynamic_mem_start  = NULL,
 };
 
+#if DMM_BENCHMARK_ENABLED
+static uint8_t benchmark_heap[ DMM_BENCHMARK_HEAP_SIZE ] __attribute__( ( aligned( 8 ) ) );
+static void *benchmark_ptr[ DMM_BENCHMARK_BLOCKS ];
+#endif
+
 /*************************************************************************************************************************************
  * Public Functions Definition
  */
@@ -46,7 +60,7 @@ error_code_module_t dmm_Init( dmm_handle_t handle, void* heap, size_t size )
 {
     error_code_module_t error = NO_ERROR;
     dynamic_mem_node_t *dynamic_mem_start;
-    if ( size > sizeof( dynamic_mem_node_t ) )
+    if ( heap != NULL && handle < NHEAPS && size > sizeof( dynamic_mem_node_t ) )
     {
         dynamic_mem_start = ( dynamic_mem_node_t * ) heap;
         dynamic_mem_start->size = size - sizeof( dynamic_mem_node_t );
@@ -54,9 +68,15 @@ error_code_module_t dmm_Init( dmm_handle_t handle, void* heap, size_t size )
         dynamic_mem_start->next = NULL;
         dynamic_mem_start->prev = NULL;
         dmm_obj.dynamic_mem_start[ handle ] = dynamic_mem_start;
-        dmm_obj.total_size[ handle ] = size;
-        dmm_obj.max_size[ handle ] = 0;
-        dmm_obj.mutex_handle[ handle ] = os.CreateMutex();
+        dmm_obj.deferred[ handle ] = NULL;
+        if ( dmm_obj.mutex_handle[ handle ] == NULL )
+        {
+            dmm_obj.mutex_handle[ handle ] = os.CreateMutex();
+        }
+        memset( &dmm_obj.stats[ handle ], 0, sizeof( dmm_stats_t ) );
+        dmm_obj.stats[ handle ].total_size = size;
+        dmm_obj.stats[ handle ].free_size = dynamic_mem_start->size;
+        dmm_obj.stats[ handle ].largest_free = dynamic_mem_start->size;
 
 #if SYSVIEW_ENABLED
         SEGGER_SYSVIEW_Start();
@@ -72,14 +92,42 @@ error_code_module_t dmm_Init( dmm_handle_t handle, void* heap, size_t size )
 }
 
 void* dmm_Alloc( dmm_handle_t handle, size_t size )
+{
+    return dmm_Allocate( handle, size, NULL, __builtin_return_address( 0 ) );
+}
+
+#if DMM_TRACE_ENABLED
+void* dmm_AllocTagged( dmm_handle_t handle, size_t size, const char* tag )
+{
+    return dmm_Allocate( handle, size, tag, __builtin_return_address( 0 ) );
+}
+#endif
+
+void* dmm_Allocate( dmm_handle_t handle, size_t size, const char *tag, void *caller )
 {
     void *result = NULL;
 
+    if ( handle >= NHEAPS || dmm_obj.dynamic_mem_start[ handle ] == NULL )
+    {
+        return NULL;
+    }
+
+    dmm_stats_t *stats = &dmm_obj.stats[ handle ];
+
+    // the best-fit walk is too long for interrupt context: interrupt handlers take their buffers from the pools
+    if ( os.IsInsideInterrupt() )
+    {
+        return NULL;
+    }
+
     if ( os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
     {
+        uint32_t largest_other;
+        dmm_Drain( handle );
+
         size_t aligned_size = align_size( size );
         dynamic_mem_node_t *best_mem_block =
-            ( dynamic_mem_node_t * ) find_best_mem_block( dmm_obj.dynamic_mem_start[ handle ], aligned_size );
+            ( dynamic_mem_node_t * ) find_best_mem_block( dmm_obj.dynamic_mem_start[ handle ], aligned_size, &largest_other );
 
         // check if we actually found a matching (free, large enough) block
         if ( best_mem_block != NULL ) {
@@ -102,17 +150,43 @@ void* dmm_Alloc( dmm_handle_t handle, size_t size )
             }
             best_mem_block->next = mem_node_allocate;
 
-            // Calculate and record maximum allocated memory
-            calculate_max_size( handle );
+#if DMM_TRACE_ENABLED
+            // record who allocated the block and when
+            mem_node_allocate->owner = os.GetTaskHandle();
+            mem_node_allocate->tag = tag;
+            mem_node_allocate->caller = caller;
+            mem_node_allocate->timestamp = os.GetTickCount();
+#endif
+
+            // update statistics; the search above already visited every free block, so the largest one is known
+            stats->used_size += aligned_size;
+            stats->used_blocks++;
+            stats->free_size -= aligned_size + sizeof( dynamic_mem_node_t );
+            stats->largest_free = ( best_mem_block->size > largest_other ) ? best_mem_block->size : largest_other;
+            if ( stats->used_size > stats->peak_size )
+            {
+                stats->peak_size = stats->used_size;
+            }
 
             // return pointer to newly allocated memory (right after the new list node)
             result = ( void * )( ( uint8_t * ) mem_node_allocate + sizeof( dynamic_mem_node_t ) );
+        }
+        else
+        {
+            stats->alloc_failures++;
+        }
+        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
 
 #if SYSVIEW_ENABLED
-            SEGGER_SYSVIEW_HeapAllocEx( dmm_obj.dynamic_mem_start[ handle ], result, aligned_size, handle );
-#endif
+        if ( result != NULL )
+        {
+            SEGGER_SYSVIEW_HeapAllocEx( dmm_obj.dynamic_mem_start[ handle ], result, align_size( size ), handle );
         }
-        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
+#endif
+    }
+    else
+    {
+        stats->alloc_failures++;
     }
 
     return result;
@@ -130,7 +204,7 @@ void dmm_Free( dmm_handle_t handle, void* ptr )
     dynamic_mem_node_t *current_mem_node = ( dynamic_mem_node_t * )( ( uint8_t * ) ptr - sizeof( dynamic_mem_node_t ) );
 
     // pointer we're trying to free was not dynamically allocated it seems
-    if ( current_mem_node == NULL )
+    if ( current_mem_node == NULL || handle >= NHEAPS )
     {
         return;
     }
@@ -139,55 +213,397 @@ void dmm_Free( dmm_handle_t handle, void* ptr )
     SEGGER_SYSVIEW_HeapFree( dmm_obj.dynamic_mem_start[ handle ], ptr );
 #endif
 
-    // mark block as unused
-    current_mem_node->used = false;
-
-    // merge unused blocks
-    if ( os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
+    // interrupt handlers (and tasks that cannot get the lock) only queue the block, the next heap user releases it
+    if ( !os.IsInsideInterrupt() && os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
     {
-        current_mem_node = merge_next_node_into_current( current_mem_node );
-        merge_current_node_into_previous( current_mem_node );
+        dmm_Drain( handle );
+        dmm_Release( handle, current_mem_node );
         os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
     }
+    else
+    {
+        dmm_Defer( handle, ptr );
+    }
 }
 
-/*Only for debugging purposes; can be turned off through -NDEBUG flag*/
 void dmm_Report( dmm_handle_t handle )
 {
     uint32_t percent_size;
-    dynamic_mem_node_t *dynamic_mem_start = dmm_obj.dynamic_mem_start[ handle ];
+    dmm_stats_t stats;
 
-    Log.Print( "Heap: %d\r\n", handle );
-    while ( dynamic_mem_start != NULL )
+    if ( dmm_GetStats( handle, &stats ) != NO_ERROR )
     {
-        Log.Print( "Block Size:%6d, Head:%12p, Prev:%12p, Next:%12p, Free: %s\r\n",
-                   dynamic_mem_start->size,
-                   dynamic_mem_start,
-                   dynamic_mem_start->prev,
-                   dynamic_mem_start->next,
-                   dynamic_mem_start->used ? "No" : "Yes" );
-        dynamic_mem_start = dynamic_mem_start->next;
+        return;
     }
 
-    if ( dmm_obj.total_size[ handle ] != 0 )
+#if DMM_DEBUG
+    // Only for debugging purposes: holds the heap lock while printing the whole block list
+    if ( os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
     {
-        percent_size = ( dmm_obj.max_size[ handle ] * 1000 / dmm_obj.total_size[ handle ] + 5 ) / 10;
+        dynamic_mem_node_t *dynamic_mem_start = dmm_obj.dynamic_mem_start[ handle ];
+
+        while ( dynamic_mem_start != NULL )
+        {
+            Log.Print( "Block Size:%6d, Head:%12p, Prev:%12p, Next:%12p, Free: %s\r\n",
+                       dynamic_mem_start->size,
+                       dynamic_mem_start,
+                       dynamic_mem_start->prev,
+                       dynamic_mem_start->next,
+                       dynamic_mem_start->used ? "No" : "Yes" );
+            dynamic_mem_start = dynamic_mem_start->next;
+        }
+        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
+    }
+#endif
+
+    if ( stats.total_size != 0 )
+    {
+        percent_size = ( stats.peak_size * 1000 / stats.total_size + 5 ) / 10;
     }
     else
     {
         percent_size = 0;
     }
+    Log.Print( "Heap: %d\r\n", handle );
+    Log.Print( "Memory used: %d in %d blocks, free: %d, largest free block: %d\r\n",
+               stats.used_size,
+               stats.used_blocks,
+               stats.free_size,
+               stats.largest_free );
+    Log.Print( "Fragmentation: %d.%d%%, allocation failures: %d\r\n",
+               stats.fragmentation / 10,
+               stats.fragmentation % 10,
+               stats.alloc_failures );
     Log.Print( "Maximum memory used: %d, %d%% usage\r\n",
-               dmm_obj.max_size[ handle ],
+               stats.peak_size,
                percent_size );
 }
 
-void *find_best_mem_block( dynamic_mem_node_t *dynamic_mem, size_t size )
+error_code_module_t dmm_GetStats( dmm_handle_t handle, dmm_stats_t* stats )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( stats == NULL || handle >= NHEAPS || dmm_obj.dynamic_mem_start[ handle ] == NULL )
+    {
+        error = ERROR_DMM_NULL_POINTER;
+    }
+    else if ( !os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
+    {
+        error = ERROR_DMM_READ;
+    }
+    else
+    {
+        *stats = dmm_obj.stats[ handle ];
+        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
+
+        if ( stats->free_size != 0 )
+        {
+            stats->fragmentation = 1000 - ( uint32_t )( ( ( uint64_t ) stats->largest_free * 1000 ) / stats->free_size );
+        }
+        else
+        {
+            stats->fragmentation = 0;
+        }
+    }
+
+    return error;
+}
+
+#if DMM_TRACE_ENABLED
+void dmm_TraceReport( dmm_handle_t handle )
+{
+    dmm_trace_t *trace = &dmm_obj.trace;
+
+    if ( handle >= NHEAPS || dmm_obj.dynamic_mem_start[ handle ] == NULL )
+    {
+        return;
+    }
+
+    // aggregate under the lock, print afterwards
+    memset( trace->task, 0, sizeof( trace->task ) );
+    memset( trace->tag, 0, sizeof( trace->tag ) );
+    if ( os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
+    {
+        for ( dynamic_mem_node_t *node = dmm_obj.dynamic_mem_start[ handle ]; node != NULL; node = node->next )
+        {
+            if ( node->used )
+            {
+                trace_add( trace->task, MAX_TASKS, node->owner, NULL, node->size );
+                trace_add( trace->tag, DMM_TRACE_TAGS, ( node->tag != NULL ) ? ( const void * )node->tag : node->caller, node->tag, node->size );
+            }
+        }
+        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
+    }
+
+    Log.Print( "Heap: %d, live memory per task:\r\n", handle );
+    for ( uint32_t i = 0; i < MAX_TASKS && trace->task[ i ].blocks != 0; i++ )
+    {
+        Log.Print( "  %-12s %6d bytes in %3d blocks\r\n",
+                   ( trace->task[ i ].key != NULL ) ? os.GetTaskName( ( TaskHandle_t )trace->task[ i ].key ) : "-",
+                   trace->task[ i ].bytes,
+                   trace->task[ i ].blocks );
+    }
+
+    Log.Print( "Heap: %d, live memory per tag:\r\n", handle );
+    for ( uint32_t i = 0; i < DMM_TRACE_TAGS && trace->tag[ i ].blocks != 0; i++ )
+    {
+        if ( trace->tag[ i ].tag != NULL )
+        {
+            Log.Print( "  %-12s %6d bytes in %3d blocks\r\n", trace->tag[ i ].tag, trace->tag[ i ].bytes, trace->tag[ i ].blocks );
+        }
+        else
+        {
+            Log.Print( "  %12p %6d bytes in %3d blocks\r\n", trace->tag[ i ].key, trace->tag[ i ].bytes, trace->tag[ i ].blocks );
+        }
+    }
+}
+
+uint32_t dmm_LeakCheck( dmm_handle_t handle, uint32_t age_ms )
+{
+    dmm_trace_t *trace = &dmm_obj.trace;
+    uint32_t nleaks = 0;
+
+    if ( handle >= NHEAPS || dmm_obj.dynamic_mem_start[ handle ] == NULL )
+    {
+        return 0;
+    }
+
+    // collect under the lock, print afterwards
+    if ( os.TakeSemaphore( dmm_obj.mutex_handle[ handle ], QUEUE_WAIT_TIME ) )
+    {
+        TickType_t now = os.GetTickCount();
+
+        for ( dynamic_mem_node_t *node = dmm_obj.dynamic_mem_start[ handle ]; node != NULL; node = node->next )
+        {
+            uint32_t age = os.Ticks2Ms( now - node->timestamp );
+
+            if ( node->used && age >= age_ms )
+            {
+                if ( nleaks < DMM_TRACE_LEAKS )
+                {
+                    trace->leak[ nleaks ].ptr = ( uint8_t * )node + sizeof( dynamic_mem_node_t );
+                    trace->leak[ nleaks ].size = node->size;
+                    trace->leak[ nleaks ].owner = node->owner;
+                    trace->leak[ nleaks ].tag = node->tag;
+                    trace->leak[ nleaks ].caller = node->caller;
+                    trace->leak[ nleaks ].age_ms = age;
+                }
+                nleaks++;
+            }
+        }
+        os.GiveSemaphore( dmm_obj.mutex_handle[ handle ] );
+    }
+
+    Log.Print( "Heap: %d, %d allocations older than %d ms\r\n", handle, nleaks, age_ms );
+    for ( uint32_t i = 0; i < nleaks && i < DMM_TRACE_LEAKS; i++ )
+    {
+        Log.Print( "  %12p %6d bytes, age %8d ms, task: %-12s tag: %s, caller: %p\r\n",
+                   trace->leak[ i ].ptr,
+                   trace->leak[ i ].size,
+                   trace->leak[ i ].age_ms,
+                   ( trace->leak[ i ].owner != NULL ) ? os.GetTaskName( trace->leak[ i ].owner ) : "-",
+                   ( trace->leak[ i ].tag != NULL ) ? trace->leak[ i ].tag : "-",
+                   trace->leak[ i ].caller );
+    }
+
+    return nleaks;
+}
+
+void trace_add( dmm_trace_entry_t *entry, uint32_t nentries, const void *key, const char *tag, uint32_t size )
+{
+    for ( uint32_t i = 0; i < nentries; i++ )
+    {
+        // entries are filled in order, so the first empty one means the key has not been seen yet
+        if ( entry[ i ].blocks == 0 || entry[ i ].key == key )
+        {
+            entry[ i ].key = key;
+            entry[ i ].tag = tag;
+            entry[ i ].bytes += size;
+            entry[ i ].blocks++;
+            return;
+        }
+    }
+}
+#endif
+
+#if DMM_BENCHMARK_ENABLED
+void dmm_Benchmark( void )
+{
+    uint32_t start, cycles, nblocks = 0;
+    uint32_t alloc_max = 0, alloc_fail = 0, free_max = 0, defer_max = 0, drain = 0;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    dmm_obj.dynamic_mem_start[ dmm_handle_3 ] = NULL;
+    dmm_Init( dmm_handle_3, benchmark_heap, sizeof( benchmark_heap ) );
+    dmm_obj.masked_max = 0;
+
+    // 1. fill the heap with the smallest possible blocks
+    for ( nblocks = 0; nblocks < DMM_BENCHMARK_BLOCKS; nblocks++ )
+    {
+        start = benchmark_cycles();
+        benchmark_ptr[ nblocks ] = dmm_Alloc( dmm_handle_3, 1 );
+        cycles = benchmark_cycles() - start;
+        if ( benchmark_ptr[ nblocks ] == NULL )
+        {
+            break;
+        }
+        alloc_max = ( cycles > alloc_max ) ? cycles : alloc_max;
+    }
+
+    // 2. free every other block: maximum number of blocks, nothing to merge
+    for ( uint32_t i = 0; i < nblocks; i += 2 )
+    {
+        start = benchmark_cycles();
+        dmm_Free( dmm_handle_3, benchmark_ptr[ i ] );
+        cycles = benchmark_cycles() - start;
+        free_max = ( cycles > free_max ) ? cycles : free_max;
+    }
+
+    // 3. a request that fits none of the holes walks the whole list: worst-case allocation
+    start = benchmark_cycles();
+    benchmark_ptr[ 0 ] = dmm_Alloc( dmm_handle_3, 2 * ALIGNMENT + sizeof( dynamic_mem_node_t ) );
+    alloc_fail = benchmark_cycles() - start;
+    dmm_Free( dmm_handle_3, benchmark_ptr[ 0 ] );
+
+    // 4. queue the remaining blocks the way an interrupt handler frees them
+    for ( uint32_t i = 1; i < nblocks; i += 2 )
+    {
+        start = benchmark_cycles();
+        dmm_Defer( dmm_handle_3, benchmark_ptr[ i ] );
+        cycles = benchmark_cycles() - start;
+        defer_max = ( cycles > defer_max ) ? cycles : defer_max;
+    }
+
+    // 5. the next task-context call releases all of them, each one merging with both neighbours
+    start = benchmark_cycles();
+    benchmark_ptr[ 0 ] = dmm_Alloc( dmm_handle_3, 1 );
+    drain = benchmark_cycles() - start;
+    dmm_Free( dmm_handle_3, benchmark_ptr[ 0 ] );
+
+    if ( cycles_per_us == 0 || nblocks == 0 )
+    {
+        return;
+    }
+
+    Log.Print( "Heap benchmark: %d blocks of %d bytes, %d MHz\r\n", nblocks, sizeof( dynamic_mem_node_t ) + ALIGNMENT, cycles_per_us );
+    Log.Print( "Allocate (filling):   max %6d cycles, %4d us\r\n", alloc_max, alloc_max / cycles_per_us );
+    Log.Print( "Allocate (full walk): max %6d cycles, %4d us\r\n", alloc_fail, alloc_fail / cycles_per_us );
+    Log.Print( "Free (no merge):      max %6d cycles, %4d us\r\n", free_max, free_max / cycles_per_us );
+    Log.Print( "Free (interrupt):     max %6d cycles, %4d us\r\n", defer_max, defer_max / cycles_per_us );
+    Log.Print( "Release %3d queued:   %6d cycles, %4d us\r\n", nblocks / 2, drain, drain / cycles_per_us );
+    Log.Print( "Interrupts masked:    max %6d cycles, %4d us (measured)\r\n", dmm_obj.masked_max, dmm_obj.masked_max / cycles_per_us );
+}
+
+uint32_t benchmark_cycles( void )
+{
+    return DWT->CYCCNT;
+}
+
+void benchmark_masked( uint32_t start )
+{
+    uint32_t cycles = benchmark_cycles() - start;
+
+    if ( cycles > dmm_obj.masked_max )
+    {
+        dmm_obj.masked_max = cycles;
+    }
+}
+#endif
+
+void dmm_Release( dmm_handle_t handle, dynamic_mem_node_t *current_mem_node )
+{
+    dmm_stats_t *stats = &dmm_obj.stats[ handle ];
+
+    current_mem_node->used = false;
+
+    // update statistics; every merge with a free neighbour releases one block header
+    stats->used_size -= current_mem_node->size;
+    stats->used_blocks--;
+    stats->free_size += current_mem_node->size;
+    if ( current_mem_node->next != NULL && !current_mem_node->next->used )
+    {
+        stats->free_size += sizeof( dynamic_mem_node_t );
+    }
+    if ( current_mem_node->prev != NULL && !current_mem_node->prev->used )
+    {
+        stats->free_size += sizeof( dynamic_mem_node_t );
+    }
+
+    // the block ends up in the previous one only when that one is free
+    dynamic_mem_node_t *merged_mem_node = current_mem_node;
+    if ( current_mem_node->prev != NULL && !current_mem_node->prev->used )
+    {
+        merged_mem_node = current_mem_node->prev;
+    }
+    merge_next_node_into_current( current_mem_node );
+    merge_current_node_into_previous( current_mem_node );
+
+    // freeing only ever grows blocks, so the merged block is the only candidate for a new largest
+    if ( merged_mem_node->size > stats->largest_free )
+    {
+        stats->largest_free = merged_mem_node->size;
+    }
+}
+
+void dmm_Defer( dmm_handle_t handle, void *ptr )
+{
+    // the payload of a used block is at least ALIGNMENT bytes, enough to hold the link
+    UBaseType_t interrupt_status = os.EnterCritical();
+#if DMM_BENCHMARK_ENABLED
+    uint32_t start = benchmark_cycles();
+#endif
+    *( void ** )ptr = dmm_obj.deferred[ handle ];
+    dmm_obj.deferred[ handle ] = ptr;
+#if DMM_BENCHMARK_ENABLED
+    benchmark_masked( start );
+#endif
+    os.ExitCritical( interrupt_status );
+}
+
+void dmm_Drain( dmm_handle_t handle )
+{
+    void *ptr;
+
+    // detach the whole list at once, so interrupts are masked for a pointer swap only
+    if ( dmm_obj.deferred[ handle ] == NULL )
+    {
+        return;
+    }
+    UBaseType_t interrupt_status = os.EnterCritical();
+#if DMM_BENCHMARK_ENABLED
+    uint32_t start = benchmark_cycles();
+#endif
+    ptr = dmm_obj.deferred[ handle ];
+    dmm_obj.deferred[ handle ] = NULL;
+#if DMM_BENCHMARK_ENABLED
+    benchmark_masked( start );
+#endif
+    os.ExitCritical( interrupt_status );
+
+    while ( ptr != NULL )
+    {
+        void *next = *( void ** )ptr;
+        dmm_Release( handle, ( dynamic_mem_node_t * )( ( uint8_t * ) ptr - sizeof( dynamic_mem_node_t ) ) );
+        ptr = next;
+    }
+}
+
+void *find_best_mem_block( dynamic_mem_node_t *dynamic_mem, size_t size, uint32_t *largest_other )
 {
     // initialize the result pointer with NULL and an invalid block size
     dynamic_mem_node_t *best_mem_block = ( dynamic_mem_node_t * ) NULL;
     uint32_t best_mem_block_size = UINT32_MAX;
 
+    // keep track of the two largest free blocks, so the caller knows the largest block left over after the split
+    dynamic_mem_node_t *largest_mem_block = ( dynamic_mem_node_t * ) NULL;
+    uint32_t largest_size = 0;
+    uint32_t second_largest_size = 0;
+
     // start looking for the best (smallest unused) block at the beginning
     dynamic_mem_node_t *current_mem_block = dynamic_mem;
     while ( current_mem_block )
@@ -202,9 +618,25 @@ void *find_best_mem_block( dynamic_mem_node_t *dynamic_mem, size_t size )
             best_mem_block_size = current_mem_block->size;
         }
 
+        if ( !current_mem_block->used )
+        {
+            if ( current_mem_block->size >= largest_size )
+            {
+                second_largest_size = largest_size;
+                largest_size = current_mem_block->size;
+                largest_mem_block = current_mem_block;
+            }
+            else if ( current_mem_block->size > second_largest_size )
+            {
+                second_largest_size = current_mem_block->size;
+            }
+        }
+
         // move to next block
         current_mem_block = current_mem_block->next;
     }
+
+    *largest_other = ( best_mem_block == largest_mem_block ) ? second_largest_size : largest_size;
     return best_mem_block;
 }
 
@@ -251,34 +683,14 @@ size_t align_size( size_t size )
     return size + ( ALIGNMENT - ( size & ( ALIGNMENT - 1 ) ) );
 }
 
-void calculate_max_size( dmm_handle_t handle )
-{
-    uint32_t total_size = 0;
-    dynamic_mem_node_t *dynamic_mem_current = dmm_obj.dynamic_mem_start[ handle ];
-
-    while ( dynamic_mem_current != NULL )
-    {
-        if ( dynamic_mem_current->used )
-        {
-            total_size += dynamic_mem_current->size;
-        }
-        dynamic_mem_current = dynamic_mem_current->next;
-    }
-
-    if ( total_size > dmm_obj.max_size[ handle ] )
-    {
-        dmm_obj.max_size[ handle ] = total_size;
-    }
-}
-
 uint32_t dmm_GetMaxSize( dmm_handle_t handle )
 {
-    return dmm_obj.max_size[ handle ];
+    return dmm_obj.stats[ handle ].peak_size;
 }
 
 void* malloc( size_t size )
 {
-    return dmm_Alloc( dmm_handle_0, size );
+    return dmm_Allocate( dmm_handle_0, size, NULL, __builtin_return_address( 0 ) );
 }
 
 void free( void* ptr )
@@ -27,6 +27,22 @@
 /***************************************************************************************************************************
  * Public constants and macros
  */
+#ifndef DMM_TRACE_ENABLED
+#define DMM_TRACE_ENABLED               ( 0 )           /*!< set to 1 to record owner task, tag and time of every allocation */
+#endif
+
+#ifndef DMM_BENCHMARK_ENABLED
+#define DMM_BENCHMARK_ENABLED           ( 0 )           /*!< set to 1 to build dmm.Benchmark() and its scratch heap */
+#endif
+
+/**
+ * @brief Allocate memory with a caller/module tag; the tag is dropped when allocation tracing is disabled.
+ */
+#if DMM_TRACE_ENABLED
+#define DMM_ALLOC( handle, numbytes, tag )      dmm.AllocTagged( handle, numbytes, tag )
+#else
+#define DMM_ALLOC( handle, numbytes, tag )      dmm.Alloc( handle, numbytes )
+#endif
 
 /***************************************************************************************************************************
  * Public data structures and typedefs
@@ -42,6 +58,21 @@ typedef enum
     dmm_handle_3,           /*!< user defined */
 } dmm_handle_t;
 
+/**
+ * @brief Heap statistics, maintained incrementally on every allocation and free.
+ */
+typedef struct
+{
+    uint32_t    total_size;         /*!< size of the heap in bytes (including block headers) */
+    uint32_t    used_size;          /*!< bytes currently allocated (excluding block headers) */
+    uint32_t    used_blocks;        /*!< number of blocks currently allocated */
+    uint32_t    peak_size;          /*!< maximum bytes allocated since initialized */
+    uint32_t    free_size;          /*!< bytes currently free (sum of all free blocks) */
+    uint32_t    largest_free;       /*!< size of the largest free block in bytes */
+    uint32_t    fragmentation;      /*!< fragmentation index in 1/1000: 0 = one free block, 1000 = fully fragmented */
+    uint32_t    alloc_failures;     /*!< number of allocations that could not be satisfied */
+} dmm_stats_t;
+
 /**
  * Specifies the public interface functions of the watchdog monitor.
  */
@@ -52,6 +83,15 @@ typedef struct
     void ( *Free )( dmm_handle_t handle, void* allocptr );
     void ( *Report )( dmm_handle_t handle );
     uint32_t ( *GetMaxSize )( dmm_handle_t handle );
+    error_code_module_t ( *GetStats )( dmm_handle_t handle, dmm_stats_t* stats );
+#if DMM_TRACE_ENABLED
+    void* ( *AllocTagged )( dmm_handle_t handle, size_t numbytes, const char* tag );
+    void ( *TraceReport )( dmm_handle_t handle );
+    uint32_t ( *LeakCheck )( dmm_handle_t handle, uint32_t age_ms );
+#endif
+#if DMM_BENCHMARK_ENABLED
+    void ( *Benchmark )( void );
+#endif
 } const dmm_interface_t;
 
 /***************************************************************************************************************************
@@ -45,6 +45,25 @@
  *
  * freelist maintains all the blocks which are not in use; freelist is kept
  * always sorted to improve the efficiency of coalescing
+ *
+ * CONCURRENCY AND LATENCY:
+ *
+ * Each heap is protected by its own mutex, so the best-fit walk over the block list (which grows with the number of
+ * blocks, about 400 for a fully fragmented 8 KB heap) never runs with interrupts masked. dmm.Alloc returns NULL in
+ * interrupt context; interrupt handlers take their buffers from the block pools (pool.h), which do not fall back to
+ * the heap there.
+ *
+ * dmm.Free may be called from interrupt context, e.g. when an interrupt handler hands back a buffer that pool.Alloc
+ * took from the heap. It then does not touch the block list: the block is pushed onto a per-heap deferred list, linked
+ * through its own payload, inside a critical section that only swaps two pointers. The same happens when a task cannot
+ * get the mutex within QUEUE_WAIT_TIME, so a block is never lost. The next dmm.Alloc or dmm.Free in task context
+ * detaches the whole deferred list in one pointer swap and releases the blocks under the mutex. Until then the heap
+ * statistics still count them as used.
+ *
+ * These two pointer swaps are the only places the heap masks interrupts. dmm.Benchmark() (CLI command heap-bench,
+ * enabled with DMM_BENCHMARK_ENABLED) fragments a scratch heap into the smallest possible blocks, measures dmm.Alloc
+ * and dmm.Free (mutex held, interrupts enabled) with the DWT cycle counter, and reports the longest time interrupts
+ * were actually masked by the heap, measured inside the critical sections themselves.
  */
 
 /***************************************************************************************************************************
@@ -58,6 +77,13 @@
  */
 #define NHEAPS                      ( 4 )
 #define ALIGNMENT                   ( 4 )
+#ifndef DMM_DEBUG
+#define DMM_DEBUG                   ( 0 )           /*!< set to 1 to dump the block list in dmm.Report() */
+#endif
+#define DMM_BENCHMARK_HEAP_SIZE     ( 1024 )
+#define DMM_BENCHMARK_BLOCKS        ( DMM_BENCHMARK_HEAP_SIZE / ( sizeof( dynamic_mem_node_t ) + ALIGNMENT ) )
+#define DMM_TRACE_TAGS              ( 16 )          /*!< number of distinct tags aggregated by dmm.TraceReport() */
+#define DMM_TRACE_LEAKS             ( 16 )          /*!< number of long-lived allocations listed by dmm.LeakCheck() */
 
 /***************************************************************************************************************************
  * Private data structures and typedefs
@@ -67,15 +93,54 @@ typedef struct dynamic_mem_node {
     bool used;
     struct dynamic_mem_node *next;
     struct dynamic_mem_node *prev;
+#if DMM_TRACE_ENABLED
+    TaskHandle_t owner;                 /*!< task that allocated the block (NULL before the scheduler runs) */
+    const char *tag;                    /*!< caller/module tag (NULL if allocated without a tag) */
+    void *caller;                       /*!< return address of the allocating call */
+    TickType_t timestamp;               /*!< tick count at allocation time */
+#endif
 } dynamic_mem_node_t;
 
+#if DMM_TRACE_ENABLED
+typedef struct
+{
+    const void                  *key;               /*!< task handle, tag string or caller address */
+    const char                  *tag;               /*!< tag string, NULL if the key is not a tag */
+    uint32_t                    bytes;
+    uint32_t                    blocks;
+} dmm_trace_entry_t;
+
+typedef struct
+{
+    void                        *ptr;
+    uint32_t                    size;
+    TaskHandle_t                owner;
+    const char                  *tag;
+    void                        *caller;
+    uint32_t                    age_ms;
+} dmm_leak_entry_t;
+
+typedef struct
+{
+    dmm_trace_entry_t           task[ MAX_TASKS ];
+    dmm_trace_entry_t           tag[ DMM_TRACE_TAGS ];
+    dmm_leak_entry_t            leak[ DMM_TRACE_LEAKS ];
+} dmm_trace_t;
+#endif
+
 typedef struct
 {
     bool                        is_init;
     dynamic_mem_node_t          *dynamic_mem_start[ NHEAPS ];
-    uint32_t                    total_size[ NHEAPS ];
-    uint32_t                    max_size[ NHEAPS ];
+    dmm_stats_t                 stats[ NHEAPS ];
     SemaphoreHandle_t           mutex_handle[ NHEAPS ];
+    void * volatile             deferred[ NHEAPS ]; /*!< blocks freed from interrupt context, not yet released */
+#if DMM_BENCHMARK_ENABLED
+    uint32_t                    masked_max;         /*!< longest critical section in cycles */
+#endif
+#if DMM_TRACE_ENABLED
+    dmm_trace_t                 trace;              /*!< scratch space for trace reports (CLI task only) */
+#endif
 } dmm_obj_t ;
 
 /***************************************************************************************************************************
@@ -99,38 +164,89 @@ static error_code_module_t dmm_Init( dmm_handle_t handle, void* heap, size_t siz
  * @brief       Allocate memory.
  * @param[in]   handle     handle ID: dmm_handle_x (x = 0, 1, 2, or 3)
  * @param[in]   numbytes        size of memory block to allocate in bytes
- * @return      Pointer to allocated memory block (NULL if error).
+ * @return      Pointer to allocated memory block (NULL if error or called from interrupt context).
  */
 static void* dmm_Alloc( dmm_handle_t handle, size_t numbytes );
 
 /**
  * @brief       Free memory.
  * @param[in]   handle     Handle of heap to report about.
- * @param[in]   ptr             Pointer to memory block to be freed.
+ * @param[in]   ptr             Pointer to memory block to be freed (may be called from interrupt context).
  */
 static void dmm_Free( dmm_handle_t handle, void* ptr );
 
 /**
- * @brief       Print free memory list.
+ * @brief       Print heap statistics.
  * @param[in]   handle     Handle of heap to report about.
  */
 static void dmm_Report( dmm_handle_t handle );
 
 /**
- * @brief       Print free memory list.
+ * @brief       Get maximum memory used.
  * @param[in]   handle     Handle of heap to report about.
  * @return      Maximum bytes used since initialized
  */
 static uint32_t dmm_GetMaxSize( dmm_handle_t handle );
 
+/**
+ * @brief       Get a consistent snapshot of the heap statistics (does not walk the heap).
+ * @param[in]   handle     Handle of heap to report about.
+ * @param[out]  stats      Pointer to statistics structure to fill in.
+ * @return      Error code.
+ */
+static error_code_module_t dmm_GetStats( dmm_handle_t handle, dmm_stats_t* stats );
+
+#if DMM_TRACE_ENABLED
+/**
+ * @brief       Allocate memory and record a caller/module tag with it.
+ * @param[in]   handle          handle ID: dmm_handle_x (x = 0, 1, 2, or 3)
+ * @param[in]   numbytes        size of memory block to allocate in bytes
+ * @param[in]   tag             caller/module tag (string literal, not copied)
+ * @return      Pointer to allocated memory block (NULL if error).
+ */
+static void* dmm_AllocTagged( dmm_handle_t handle, size_t numbytes, const char* tag );
+
+/**
+ * @brief       Print live bytes and blocks per task and per tag.
+ * @param[in]   handle          Handle of heap to report about.
+ */
+static void dmm_TraceReport( dmm_handle_t handle );
+
+/**
+ * @brief       List allocations that have been live for longer than a given time.
+ * @param[in]   handle          Handle of heap to check.
+ * @param[in]   age_ms          Minimum age in ms of an allocation to be reported.
+ * @return      Number of long-lived allocations found.
+ */
+static uint32_t dmm_LeakCheck( dmm_handle_t handle, uint32_t age_ms );
+#endif
+
+#if DMM_BENCHMARK_ENABLED
+/**
+ * @brief       Measure worst-case dmm.Alloc/dmm.Free latency and interrupt-masked time on a maximally fragmented
+ *              scratch heap (uses dmm_handle_3).
+ */
+static void dmm_Benchmark( void );
+#endif
+
 /***************************************************************************************************************************
  * Private prototypes
  */
-void *find_best_mem_block(dynamic_mem_node_t *dynamic_mem, size_t size);
+void *dmm_Allocate( dmm_handle_t handle, size_t size, const char *tag, void *caller );
+void dmm_Release( dmm_handle_t handle, dynamic_mem_node_t *current_mem_node );
+void dmm_Defer( dmm_handle_t handle, void *ptr );
+void dmm_Drain( dmm_handle_t handle );
+void *find_best_mem_block( dynamic_mem_node_t *dynamic_mem, size_t size, uint32_t *largest_other );
 void *merge_next_node_into_current(dynamic_mem_node_t *current_mem_node);
 void *merge_current_node_into_previous(dynamic_mem_node_t *current_mem_node);
 size_t align_size( size_t size );
-void calculate_max_size( dmm_handle_t handle );
+#if DMM_BENCHMARK_ENABLED
+uint32_t benchmark_cycles( void );
+void benchmark_masked( uint32_t start );
+#endif
+#if DMM_TRACE_ENABLED
+void trace_add( dmm_trace_entry_t *entry, uint32_t nentries, const void *key, const char *tag, uint32_t size );
+#endif
 
 #endif /* __DMM_PRIV_H__ */
 
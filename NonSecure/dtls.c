@@ -0,0 +1,423 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      dtls.c
+ * @brief     DTLS datagram telemetry module
+ * @details   Sends telemetry records in DTLS 1.2 datagrams, optionally acknowledged by the server.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Dtls DTLS telemetry
+ * @brief     Low-latency telemetry over DTLS/UDP
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "dtls_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+dtls_interface_t dtls =
+{
+    .Init               = &dtls_Init,
+    .Open               = &dtls_Open,
+    .Close              = &dtls_Close,
+    .Send               = &dtls_Send,
+    .Telemetry          = &dtls_Telemetry,
+    .Status             = &dtls_Status,
+#if DTLS_BENCHMARK_ENABLED
+    .Benchmark          = &dtls_Benchmark,
+#endif
+    .isInit             = &dtls_isInit,
+};
+
+dtls_obj_t dtls_obj =
+{
+    .is_init            = false,
+    .fd                 = -1,
+    .stats.cid_status   = -1,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t dtls_Init( void )
+{
+    error_code_module_t error = NO_ERROR;
+
+    /* Singleton pattern */
+    if ( dtls_obj.is_init == false )
+    {
+        dtls_obj.mutex_handle = os.CreateMutex();
+        if ( dtls_obj.mutex_handle == NULL )
+        {
+            error = ERROR_DTLS_INIT;
+        }
+        else
+        {
+            dtls_obj.is_init = true;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t dtls_Open( const char *host_name, uint16_t port )
+{
+    error_code_module_t error;
+
+    if ( host_name == NULL || strlen( host_name ) >= DTLS_HOST_LENGTH || port == 0 )
+    {
+        error = ERROR_DTLS_BAD_PARAM;
+    }
+    else if ( dtls_obj.is_init == true && os.TakeSemaphore( dtls_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( dtls_obj.fd >= 0 )
+        {
+            modem.Disconnect( dtls_obj.fd );
+            dtls_obj.fd = -1;
+        }
+        strcpy( dtls_obj.host_name, host_name );
+        dtls_obj.port = port;
+        error = dtls_Connect();
+        os.GiveSemaphore( dtls_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_DTLS_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t dtls_Close( void )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( dtls_obj.is_init == true && os.TakeSemaphore( dtls_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( dtls_obj.fd >= 0 )
+        {
+            modem.Disconnect( dtls_obj.fd );
+            dtls_obj.fd = -1;
+        }
+        dtls_obj.port = 0;
+        os.GiveSemaphore( dtls_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_DTLS_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t dtls_Send( const uint8_t *payload, uint32_t length, bool confirm )
+{
+    error_code_module_t error;
+
+    if ( ( payload == NULL && length > 0 ) || length > DTLS_PAYLOAD_MAX )
+    {
+        error = ERROR_DTLS_BAD_PARAM;
+    }
+    else if ( dtls_obj.is_init == true && os.TakeSemaphore( dtls_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        memcpy( &dtls_obj.buffer[ DTLS_HEADER_SIZE ], payload, length );
+        error = dtls_Transmit( length, confirm );
+        os.GiveSemaphore( dtls_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_DTLS_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t dtls_Telemetry( dtls_encode_t encode, void *encode_context, bool confirm )
+{
+    error_code_module_t error;
+    telemetry_t encoder;
+    uint32_t length;
+
+    if ( encode == NULL )
+    {
+        error = ERROR_DTLS_BAD_PARAM;
+    }
+    else if ( dtls_obj.is_init == true && os.TakeSemaphore( dtls_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        // The record is encoded behind the header, so it is not copied again before it is sent
+        telemetry.Begin( &encoder, &dtls_obj.buffer[ DTLS_HEADER_SIZE ], DTLS_PAYLOAD_MAX, dtls_obj.sequence, os.GetTickCountMs() );
+        encode( &encoder, encode_context );
+        if ( telemetry.End( &encoder, &length ) == NO_ERROR )
+        {
+            error = dtls_Transmit( length, confirm );
+        }
+        else
+        {
+            error = ERROR_DTLS_FULL;
+        }
+        os.GiveSemaphore( dtls_obj.mutex_handle );
+    }
+    else
+    {
+        error = ERROR_DTLS_NOT_INIT;
+    }
+
+    return error;
+}
+
+void dtls_Status( void )
+{
+    if ( dtls_obj.port == 0 )
+    {
+        Log.Print( "DTLS is not open.\r\n" );
+    }
+    else
+    {
+        Log.Print( "DTLS server: %s:%d, %s\r\n", dtls_obj.host_name, dtls_obj.port, dtls_obj.fd >= 0 ? "connected" : "not connected" );
+    }
+    Log.Print( "Handshakes: %d, last %d ms, connection ID status %d\r\n",
+               dtls_obj.stats.connects,
+               dtls_obj.stats.connect_ms,
+               dtls_obj.stats.cid_status );
+    Log.Print( "Datagrams: %d sent, %d confirmed, %d retries, %d lost, %d failed\r\n",
+               dtls_obj.stats.sent,
+               dtls_obj.stats.confirmed,
+               dtls_obj.stats.retries,
+               dtls_obj.stats.lost,
+               dtls_obj.stats.failed );
+    if ( dtls_obj.stats.confirmed > 0 )
+    {
+        Log.Print( "Acknowledged after %d ms on average\r\n", dtls_obj.stats.ack_ms / dtls_obj.stats.confirmed );
+    }
+}
+
+#if DTLS_BENCHMARK_ENABLED
+void dtls_Benchmark( const char *host_name, uint16_t port, uint32_t count )
+{
+    error_code_module_t error = NO_ERROR;
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+    telemetry_t encoder;
+    uint8_t record[ DTLS_PAYLOAD_MAX ];
+    uint32_t i, start, elapsed, length, confirmed, ack_ms, publish;
+
+    if ( count == 0 || dtls_Open( host_name, port ) != NO_ERROR )
+    {
+        Log.Print( "DTLS connect to %s:%d failed\r\n", host_name, port );
+        return;
+    }
+
+    // The record sent below, to count its bytes
+    telemetry.Begin( &encoder, record, sizeof( record ), 0, os.GetTickCountMs() );
+    dtls_BenchRecord( &encoder, NULL );
+    telemetry.End( &encoder, &length );
+
+    Log.Print( "Telemetry benchmark: %d records of about %d bytes, sizes for AES-CBC-SHA256 records\r\n", count, length );
+    Log.Print( "DTLS handshake: %d ms\r\n", dtls_obj.stats.connect_ms );
+
+    // Send and forget: only the time to hand the datagram to the modem
+    start = os.GetTickCountMs();
+    for ( i = 0; i < count && error == NO_ERROR; i++ )
+    {
+        error = dtls_Telemetry( dtls_BenchRecord, NULL, false );
+    }
+    elapsed = os.GetTickCountMs() - start;
+    Log.Print( "DTLS sent:      %5d ms per record, %d bytes up\r\n",
+               elapsed / count,
+               DTLS_UDP_IP + dtls_RecordBytes( DTLS_DTLS_HEADER, DTLS_HEADER_SIZE + length ) );
+
+    // Confirmed: one round trip per record
+    confirmed = dtls_obj.stats.confirmed;
+    ack_ms = dtls_obj.stats.ack_ms;
+    for ( i = 0; i < count && error == NO_ERROR; i++ )
+    {
+        error = dtls_Telemetry( dtls_BenchRecord, NULL, true );
+    }
+    confirmed = dtls_obj.stats.confirmed - confirmed;
+    Log.Print( "DTLS confirmed: %5d ms per record, %d bytes up, %d bytes down, %d of %d acknowledged\r\n",
+               confirmed > 0 ? ( dtls_obj.stats.ack_ms - ack_ms ) / confirmed : 0,
+               DTLS_UDP_IP + dtls_RecordBytes( DTLS_DTLS_HEADER, DTLS_HEADER_SIZE + length ),
+               DTLS_UDP_IP + dtls_RecordBytes( DTLS_DTLS_HEADER, DTLS_HEADER_SIZE ),
+               confirmed,
+               count );
+    dtls_Close();
+
+    // The same records as QoS1 publishes, one PUBACK at a time
+    if ( !mqtt.isInit() )
+    {
+        Log.Print( "MQTT/TLS:       not connected\r\n" );
+        return;
+    }
+    start = os.GetTickCountMs();
+    for ( i = 0; i < count && mqtt_status == MQTTSuccess; i++ )
+    {
+        mqtt_status = mqtt.Telemetry( DTLS_BENCH_TOPIC, dtls_BenchRecord, NULL, NULL, NULL );
+        if ( mqtt_status == MQTTSuccess )
+        {
+            mqtt_status = mqtt.Flush( DTLS_BENCH_FLUSH );
+        }
+    }
+    elapsed = os.GetTickCountMs() - start;
+    if ( mqtt_status != MQTTSuccess )
+    {
+        Log.Print( "MQTT/TLS:       failed: %s\r\n", MQTT_Status_strerror( mqtt_status ) );
+        return;
+    }
+
+    // Fixed header, topic, packet identifier, record
+    publish = 2 + 2 + strlen( DTLS_BENCH_TOPIC ) + 2 + length;
+    Log.Print( "MQTT/TLS:       %5d ms per record, %d bytes up, %d bytes down, TCP acknowledgements not counted\r\n",
+               elapsed / count,
+               DTLS_TCP_IP + dtls_RecordBytes( DTLS_TLS_HEADER, publish ),
+               DTLS_TCP_IP + dtls_RecordBytes( DTLS_TLS_HEADER, DTLS_MQTT_PUBACK ) );
+}
+#endif
+
+bool dtls_isInit( void )
+{
+    return dtls_obj.is_init && modem.Registered();
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+error_code_module_t dtls_Connect( void )
+{
+    uint32_t start = os.GetTickCountMs();
+
+    // The DTLS handshake happens here
+    dtls_obj.fd = modem.Connect( "dtls", dtls_obj.host_name, dtls_obj.port, DTLS_TIMEOUT, DTLS_TIMEOUT );
+    if ( dtls_obj.fd < 0 )
+    {
+        Log.ErrorPrint( "DTLS connect to %s:%d failed", dtls_obj.host_name, dtls_obj.port );
+        return ERROR_DTLS_NOT_CONNECTED;
+    }
+    dtls_obj.stats.connects++;
+    dtls_obj.stats.connect_ms = os.GetTickCountMs() - start;
+
+#ifdef NRF_SO_SEC_DTLS_CID_STATUS
+    int cid_status;
+    nrf_socklen_t length = sizeof( cid_status );
+    if ( nrf_getsockopt( dtls_obj.fd, NRF_SOL_SECURE, NRF_SO_SEC_DTLS_CID_STATUS, &cid_status, &length ) == 0 )
+    {
+        dtls_obj.stats.cid_status = cid_status;
+    }
+#endif
+
+    return NO_ERROR;
+}
+
+error_code_module_t dtls_Transmit( uint32_t length, bool confirm )
+{
+    uint16_t sequence = dtls_obj.sequence++;
+    uint32_t attempt, start;
+    int32_t sent = -1;
+
+    if ( dtls_obj.port == 0 )
+    {
+        return ERROR_DTLS_NOT_CONNECTED;
+    }
+
+    dtls_obj.buffer[ 0 ] = confirm ? DTLS_FLAG_CONFIRM : 0;
+    dtls_obj.buffer[ 1 ] = ( uint8_t )( sequence >> 8 );
+    dtls_obj.buffer[ 2 ] = ( uint8_t )sequence;
+    length += DTLS_HEADER_SIZE;
+
+    // A socket that failed is opened again, once per datagram
+    if ( dtls_obj.fd >= 0 )
+    {
+        sent = modem.Send( dtls_obj.fd, dtls_obj.buffer, length );
+    }
+    if ( sent < 0 )
+    {
+        if ( dtls_obj.fd >= 0 )
+        {
+            modem.Disconnect( dtls_obj.fd );
+        }
+        if ( dtls_Connect() == NO_ERROR )
+        {
+            sent = modem.Send( dtls_obj.fd, dtls_obj.buffer, length );
+        }
+    }
+    if ( sent < 0 )
+    {
+        dtls_obj.stats.failed++;
+        return ERROR_DTLS_NOT_CONNECTED;
+    }
+    dtls_obj.stats.sent++;
+
+    if ( confirm )
+    {
+        start = os.GetTickCountMs();
+        for ( attempt = 0; !dtls_WaitAck( sequence, DTLS_ACK_TIMEOUT ); attempt++ )
+        {
+            if ( attempt == DTLS_RETRIES || modem.Send( dtls_obj.fd, dtls_obj.buffer, length ) < 0 )
+            {
+                dtls_obj.stats.lost++;
+                return ERROR_DTLS_NO_ACK;
+            }
+            dtls_obj.stats.retries++;
+        }
+        dtls_obj.stats.confirmed++;
+        dtls_obj.stats.ack_ms += os.GetTickCountMs() - start;
+    }
+
+    return NO_ERROR;
+}
+
+bool dtls_WaitAck( uint16_t sequence, uint32_t timeout_ms )
+{
+    uint8_t ack[ DTLS_HEADER_SIZE ];
+    uint32_t start = os.GetTickCountMs();
+    uint32_t elapsed = 0;
+    int32_t length;
+
+    while ( elapsed < timeout_ms )
+    {
+        length = modem.ReceiveTimeout( dtls_obj.fd, ack, sizeof( ack ), timeout_ms - elapsed );
+        if ( length < 0 )
+        {
+            break;
+        }
+        if ( length == DTLS_HEADER_SIZE && ( ack[ 0 ] & DTLS_FLAG_ACK ) && ( ( ack[ 1 ] << 8 ) | ack[ 2 ] ) == sequence )
+        {
+            return true;
+        }
+        elapsed = os.GetTickCountMs() - start;
+    }
+
+    return false;
+}
+
+#if DTLS_BENCHMARK_ENABLED
+void dtls_BenchRecord( telemetry_t *encoder, void *context )
+{
+    telemetry.Float( encoder, "temp", 21.5f );
+    telemetry.Int( encoder, "rssi", -87 );
+    telemetry.Int( encoder, "batt", 3712 );
+    telemetry.Bool( encoder, "door", false );
+}
+
+uint32_t dtls_RecordBytes( uint32_t header, uint32_t plaintext )
+{
+    // Explicit IV, then the plaintext and MAC padded with at least one byte to whole AES blocks
+    return header + DTLS_CBC_IV + ( ( plaintext + DTLS_CBC_MAC ) / 16 + 1 ) * 16;
+}
+#endif
+
+/**
+ * @} Dtls
+ */
+
+/**
+ * @} Application
+ */
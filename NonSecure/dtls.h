@@ -0,0 +1,89 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      dtls.h
+ * @brief     DTLS datagram telemetry module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Dtls
+ * @{
+ */
+#ifndef __DTLS_H__
+#define __DTLS_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "os.h"
+#include "log.h"
+#include "eelcodes.h"
+#include "modem.h"
+#include "telemetry.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define DTLS_HEADER_SIZE                ( 3 )           /*!< flags, then sequence number (big endian) */
+#define DTLS_PAYLOAD_MAX                ( SHORT_MSG_MAX ) /*!< largest payload of one datagram */
+
+#ifndef DTLS_ACK_TIMEOUT
+#define DTLS_ACK_TIMEOUT                ( 2000 )        /*!< wait for an acknowledgement before sending again */
+#endif
+
+#ifndef DTLS_RETRIES
+#define DTLS_RETRIES                    ( 2 )           /*!< times a confirmed datagram is sent again */
+#endif
+
+#ifndef DTLS_BENCHMARK_ENABLED
+#define DTLS_BENCHMARK_ENABLED          ( 0 )           /*!< set to 1 to build dtls.Benchmark() */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Writes the fields of a telemetry record; the encoder already holds the sequence number and time.
+ */
+typedef void ( *dtls_encode_t )( telemetry_t *encoder, void *context );
+
+/**
+ * Specifies the public interface functions of the DTLS telemetry module.
+ */
+typedef struct
+{
+    error_code_module_t ( *Init )( void );
+    error_code_module_t ( *Open )( const char *host_name, uint16_t port );
+    error_code_module_t ( *Close )( void );
+    error_code_module_t ( *Send )( const uint8_t *payload, uint32_t length, bool confirm );
+    error_code_module_t ( *Telemetry )( dtls_encode_t encode, void *encode_context, bool confirm );
+    void ( *Status )( void );
+#if DTLS_BENCHMARK_ENABLED
+    void ( *Benchmark )( const char *host_name, uint16_t port, uint32_t count );
+#endif
+    bool ( *isInit )( void );
+} const dtls_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern dtls_interface_t dtls;
+
+#endif /* __DTLS_H__ */
+
+/**
+ * @} Dtls
+ */
+
+/**
+ * @} Applicaton
+ */
@@ -0,0 +1,175 @@
+/** @file dtls_priv.h
+ *
+ * @brief       DTLS datagram telemetry module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Dtls
+ * @{
+ */
+
+#ifndef __DTLS_PRIV_H__
+#define __DTLS_PRIV_H__
+
+/*
+ * @note
+ * Telemetry over a DTLS 1.2 socket of the modem (NRF_SPROTO_DTLS1v2). Once the handshake is done, a record costs one
+ * datagram and no round trip, and a lost datagram does not hold back the ones after it. Where the modem supports it,
+ * the socket accepts a DTLS connection ID (RFC 9146) from the server, so the session survives NAT rebinding and PSM
+ * without a new handshake.
+ *
+ * Each datagram starts with DTLS_HEADER_SIZE bytes: flags, then a 16 bit sequence number (big endian), then the
+ * payload. A sender that asks for confirmation sets DTLS_FLAG_CONFIRM; the server then answers with the header alone,
+ * DTLS_FLAG_ACK set and the same sequence number. Without the flag the datagram is sent and forgotten. A confirmed
+ * datagram is sent again after DTLS_ACK_TIMEOUT, DTLS_RETRIES times at most. Datagrams from the server other than the
+ * expected acknowledgement are dropped.
+ *
+ * The socket is opened by Open and again by the first send after it failed. Callers take turns on a mutex, so a
+ * confirmed send holds off other senders until it is acknowledged or given up.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "dtls.h"
+#if DTLS_BENCHMARK_ENABLED
+#include "mqtt.h"
+#endif
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define DTLS_HOST_LENGTH        ( 64 )
+#define DTLS_TIMEOUT            ( 5000 )        /*!< handshake and send time-out */
+#define DTLS_FLAG_CONFIRM       ( 1 << 0 )      /*!< sender asks for an acknowledgement */
+#define DTLS_FLAG_ACK           ( 1 << 7 )      /*!< acknowledgement of the datagram with the same sequence number */
+#if DTLS_BENCHMARK_ENABLED
+#define DTLS_BENCH_TOPIC        "bench"
+#define DTLS_BENCH_FLUSH        ( 10000 )
+#define DTLS_DTLS_HEADER        ( 13 )          /*!< DTLS record header */
+#define DTLS_TLS_HEADER         ( 5 )           /*!< TLS record header */
+#define DTLS_CBC_IV             ( 16 )          /*!< explicit IV of an AES-CBC record */
+#define DTLS_CBC_MAC            ( 32 )          /*!< HMAC-SHA256 */
+#define DTLS_UDP_IP             ( 28 )
+#define DTLS_TCP_IP             ( 40 )
+#define DTLS_MQTT_PUBACK        ( 4 )
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+typedef struct
+{
+    uint32_t                    sent;           /*!< datagrams, retries not counted */
+    uint32_t                    confirmed;
+    uint32_t                    retries;
+    uint32_t                    lost;           /*!< confirmed datagrams never acknowledged */
+    uint32_t                    failed;         /*!< datagrams the socket did not take */
+    uint32_t                    ack_ms;         /*!< sum of send to acknowledgement times */
+    uint32_t                    connects;
+    uint32_t                    connect_ms;     /*!< time of the last handshake */
+    int32_t                     cid_status;     /*!< NRF_SO_SEC_DTLS_CID_STATUS of the last handshake, -1 unknown */
+} dtls_stats_t;
+
+typedef struct
+{
+    bool                        is_init;
+    int32_t                     fd;
+    char                        host_name[ DTLS_HOST_LENGTH ];
+    uint16_t                    port;
+    uint16_t                    sequence;
+    SemaphoreHandle_t           mutex_handle;
+    uint8_t                     buffer[ DTLS_HEADER_SIZE + DTLS_PAYLOAD_MAX ];
+    dtls_stats_t                stats;
+} dtls_obj_t;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Initialize the DTLS telemetry module.
+ * @return      Error code.
+ */
+static error_code_module_t dtls_Init( void );
+
+/**
+ * @brief       Set the server and connect to it.
+ * @param[in]   host_name   Host-name of the server.
+ * @param[in]   port        UDP port of the server.
+ * @return      Error code, ERROR_DTLS_NOT_CONNECTED when the handshake failed (the next send tries again).
+ */
+static error_code_module_t dtls_Open( const char *host_name, uint16_t port );
+
+/**
+ * @brief       Close the socket and forget the server.
+ * @return      Error code.
+ */
+static error_code_module_t dtls_Close( void );
+
+/**
+ * @brief       Send a payload in one datagram.
+ * @param[in]   payload     Payload.
+ * @param[in]   length      Length of payload, at most DTLS_PAYLOAD_MAX.
+ * @param[in]   confirm     Wait for the server to acknowledge it.
+ * @return      Error code, ERROR_DTLS_NO_ACK when a confirmed datagram was not acknowledged.
+ */
+static error_code_module_t dtls_Send( const uint8_t *payload, uint32_t length, bool confirm );
+
+/**
+ * @brief       Encode a telemetry record straight into the datagram and send it.
+ * @param[in]   encode          Writes the fields of the record.
+ * @param[in]   encode_context  Passed to encode.
+ * @param[in]   confirm         Wait for the server to acknowledge it.
+ * @return      Error code, ERROR_DTLS_FULL when the record does not fit DTLS_PAYLOAD_MAX.
+ */
+static error_code_module_t dtls_Telemetry( dtls_encode_t encode, void *encode_context, bool confirm );
+
+/**
+ * @brief       Print the connection and datagram counters.
+ */
+static void dtls_Status( void );
+#if DTLS_BENCHMARK_ENABLED
+
+/**
+ * @brief       Compare latency and bytes on the air of telemetry over DTLS with the MQTT/TLS path.
+ * @param[in]   host_name   Host-name of the DTLS server.
+ * @param[in]   port        UDP port of the DTLS server.
+ * @param[in]   count       Records per run.
+ * @details     Uses the MQTT session when one is subscribed. Closes the DTLS socket when done.
+ */
+static void dtls_Benchmark( const char *host_name, uint16_t port, uint32_t count );
+#endif
+
+/**
+ * @brief       Check module initialization.
+ * @return      True if the module is initialized.
+ */
+static bool dtls_isInit( void );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static error_code_module_t dtls_Connect( void );
+static error_code_module_t dtls_Transmit( uint32_t length, bool confirm );
+static bool dtls_WaitAck( uint16_t sequence, uint32_t timeout_ms );
+#if DTLS_BENCHMARK_ENABLED
+static void dtls_BenchRecord( telemetry_t *encoder, void *context );
+static uint32_t dtls_RecordBytes( uint32_t header, uint32_t plaintext );
+#endif
+
+#endif /* __DTLS_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -16,13 +16,13 @@ typedef enum
     ERROR_EEL                       = (0x0100),    /*!< Module Error/event log. */
     ERROR_BOARD                     = (0x0200),    /*!< Module board. */
     ERROR_OS                        = (0x0300),    /*!< Module operating system. */
-    // 0x0400
+    ERROR_DTLS                      = (0x0400),    /*!< Module DTLS telemetry. */
     ERROR_TMMGR                     = (0x0500),    /*!< Module timer. */
-    // 0x0600
-    // 0x0700
-    // 0x0800
-    // 0x0900
-    // 0x0a00
+    ERROR_POOL                      = (0x0600),    /*!< Module fixed-size block pools. */
+    ERROR_TRANSPORT                 = (0x0700),    /*!< Module buffered transport. */
+    ERROR_ROUTER                    = (0x0800),    /*!< Module MQTT topic router. */
+    ERROR_JOURNAL                   = (0x0900),    /*!< Module publish journal. */
+    ERROR_TELEMETRY                 = (0x0A00),    /*!< Module telemetry encoder. */
     ERROR_MQTT                      = (0x0B00),    /*!< Module MQTT interface. */
     ERROR_FS                        = (0x0C00),    /*!< Module FS interface. */
     ERROR_SLM                       = (0x0D00),    /*!< Module SLM interface. */
@@ -35,7 +35,7 @@ typedef enum
     ERROR_MODEM                     = (0x1400),    /*!< Module modem interface. */
     ERROR_APP                       = (0x1500),    /*!< Module application. */
     ERROR_TLS                       = (0x1600),    /*!< Module TLS interface. */
-    // 0x1700
+    ERROR_COMPRESS                  = (0x1700),    /*!< Module payload compression. */
     ERROR_DMM                       = (0x1800),    /*!< Module dynamic memory manager. */
     ERROR_SPIM                      = (0x1900),    /*!< Module serial periperal interface master. */
     ERROR_SPIS                      = (0x1A00),    /*!< Module serial periperal interface slave. */
@@ -49,6 +49,10 @@ typedef enum
     ERROR_FST                       = (0x2200),    /*!< Module firmware update storage. */
     ERROR_TEMP                      = (0x2300),    /*!< Module TEMP. */
     ERROR_UC                        = (0x2400),    /*!< Module UC User configuration. */
+    ERROR_COAP                      = (0x2500),    /*!< Module CoAP client. */
+    ERROR_NVMC                      = (0x2600),    /*!< Module NVMC block device. */
+    ERROR_BLOB                      = (0x2700),    /*!< Module mapped blob store. */
+    ERROR_KV                        = (0x2800),    /*!< Module key-value store. */
 } error_code_modules_number_t ;
 
 typedef enum
@@ -96,6 +100,8 @@ typedef enum
     ERROR_FS_NOT_INIT               = (ERROR_FS + 0x0003),
     ERROR_FS_BAD_PARAM              = (ERROR_FS + 0x0004),
     ERROR_FS_EVENT_PROCESSING       = (ERROR_FS + 0x0005),
+    ERROR_FS_NOT_FOUND              = (ERROR_FS + 0x0006),
+    ERROR_FS_IO                     = (ERROR_FS + 0x0007),
 
     //--- SLM -------------------------------------------------------------------------------------
     ERROR_SLM_GENERAL               = (ERROR_SLM + 0x0000),
@@ -179,6 +185,7 @@ typedef enum
     ERROR_TLS_NOT_INIT              = (ERROR_TLS + 0x0003),
     ERROR_TLS_BAD_PARAM             = (ERROR_TLS + 0x0004),
     ERROR_TLS_EVENT_PROCESSING      = (ERROR_TLS + 0x0005),
+    ERROR_TLS_FULL                  = (ERROR_TLS + 0x0006),
 
     //--- ERROR_DMM -------------------------------------------------------------------------------
     ERROR_DMM_GENERAL               = (ERROR_DMM + 0x0000),
@@ -189,6 +196,51 @@ typedef enum
     ERROR_DMM_WRITE                 = (ERROR_DMM + 0x0005),
     ERROR_DMM_READ                  = (ERROR_DMM + 0x0006),
 
+    //--- ERROR_POOL ------------------------------------------------------------------------------
+    ERROR_POOL_GENERAL              = (ERROR_POOL + 0x0000),
+    ERROR_POOL_ALREADY_INIT         = (ERROR_POOL + 0x0001),
+    ERROR_POOL_NOT_INIT             = (ERROR_POOL + 0x0002),
+    ERROR_POOL_BAD_PARAM            = (ERROR_POOL + 0x0003),
+
+    //--- ERROR_TRANSPORT -------------------------------------------------------------------------
+    ERROR_TRANSPORT_GENERAL         = (ERROR_TRANSPORT + 0x0000),
+    ERROR_TRANSPORT_BAD_PARAM       = (ERROR_TRANSPORT + 0x0001),
+
+    //--- ERROR_ROUTER ----------------------------------------------------------------------------
+    ERROR_ROUTER_GENERAL            = (ERROR_ROUTER + 0x0000),
+    ERROR_ROUTER_BAD_PARAM          = (ERROR_ROUTER + 0x0001),
+    ERROR_ROUTER_FULL               = (ERROR_ROUTER + 0x0002),
+    ERROR_ROUTER_NOT_FOUND          = (ERROR_ROUTER + 0x0003),
+
+    //--- ERROR_JOURNAL ---------------------------------------------------------------------------
+    ERROR_JOURNAL_GENERAL           = (ERROR_JOURNAL + 0x0000),
+    ERROR_JOURNAL_BAD_PARAM         = (ERROR_JOURNAL + 0x0001),
+    ERROR_JOURNAL_FULL              = (ERROR_JOURNAL + 0x0002),
+    ERROR_JOURNAL_EMPTY             = (ERROR_JOURNAL + 0x0003),
+    ERROR_JOURNAL_NOT_FOUND         = (ERROR_JOURNAL + 0x0004),
+    ERROR_JOURNAL_BAD_CRC           = (ERROR_JOURNAL + 0x0005),
+    ERROR_JOURNAL_FS                = (ERROR_JOURNAL + 0x0006),
+
+    //--- ERROR_TELEMETRY -------------------------------------------------------------------------
+    ERROR_TELEMETRY_GENERAL         = (ERROR_TELEMETRY + 0x0000),
+    ERROR_TELEMETRY_BAD_PARAM       = (ERROR_TELEMETRY + 0x0001),
+    ERROR_TELEMETRY_FULL            = (ERROR_TELEMETRY + 0x0002),
+
+    //--- ERROR_COMPRESS --------------------------------------------------------------------------
+    ERROR_COMPRESS_GENERAL          = (ERROR_COMPRESS + 0x0000),
+    ERROR_COMPRESS_BAD_PARAM        = (ERROR_COMPRESS + 0x0001),
+    ERROR_COMPRESS_FULL             = (ERROR_COMPRESS + 0x0002),
+    ERROR_COMPRESS_BAD_DATA         = (ERROR_COMPRESS + 0x0003),
+
+    //--- ERROR_DTLS ------------------------------------------------------------------------------
+    ERROR_DTLS_GENERAL              = (ERROR_DTLS + 0x0000),
+    ERROR_DTLS_INIT                 = (ERROR_DTLS + 0x0001),
+    ERROR_DTLS_NOT_INIT             = (ERROR_DTLS + 0x0002),
+    ERROR_DTLS_BAD_PARAM            = (ERROR_DTLS + 0x0003),
+    ERROR_DTLS_NOT_CONNECTED        = (ERROR_DTLS + 0x0004),
+    ERROR_DTLS_FULL                 = (ERROR_DTLS + 0x0005),
+    ERROR_DTLS_NO_ACK               = (ERROR_DTLS + 0x0006),
+
     //--- ERROR_SPIM ------------------------------------------------------------------------------
     ERROR_SPIM_GENERAL              = (ERROR_SPIM + 0x0000),
     ERROR_SPIM_INIT                 = (ERROR_SPIM + 0x0001),
@@ -301,6 +353,35 @@ typedef enum
     EEROR_UC_NULL_POINTER           = (ERROR_UC + 0x0004),
     EEROR_UC_FLASH_WRITE            = (ERROR_UC + 0x0005),
 
+    //--- ERROR_COAP ------------------------------------------------------------------------------
+    ERROR_COAP_GENERAL              = (ERROR_COAP + 0x0000),
+    ERROR_COAP_INIT                 = (ERROR_COAP + 0x0001),
+    ERROR_COAP_NOT_INIT             = (ERROR_COAP + 0x0002),
+    ERROR_COAP_BAD_PARAM            = (ERROR_COAP + 0x0003),
+    ERROR_COAP_NOT_CONNECTED        = (ERROR_COAP + 0x0004),
+    ERROR_COAP_TIMEOUT              = (ERROR_COAP + 0x0005),
+    ERROR_COAP_RESET                = (ERROR_COAP + 0x0006),
+    ERROR_COAP_FULL                 = (ERROR_COAP + 0x0007),
+    ERROR_COAP_REJECTED             = (ERROR_COAP + 0x0008),
+
+    //--- ERROR_NVMC ------------------------------------------------------------------------------
+    ERROR_NVMC_GENERAL              = (ERROR_NVMC + 0x0000),
+    ERROR_NVMC_BAD_PARAM            = (ERROR_NVMC + 0x0001),
+
+    //--- ERROR_BLOB ------------------------------------------------------------------------------
+    ERROR_BLOB_GENERAL              = (ERROR_BLOB + 0x0000),
+    ERROR_BLOB_BAD_PARAM            = (ERROR_BLOB + 0x0001),
+    ERROR_BLOB_FULL                 = (ERROR_BLOB + 0x0002),
+    ERROR_BLOB_NOT_FOUND            = (ERROR_BLOB + 0x0003),
+    ERROR_BLOB_BAD_STATE            = (ERROR_BLOB + 0x0004),
+    ERROR_BLOB_BAD_CRC              = (ERROR_BLOB + 0x0005),
+
+    //--- ERROR_KV --------------------------------------------------------------------------------
+    ERROR_KV_GENERAL                = (ERROR_KV + 0x0000),
+    ERROR_KV_BAD_PARAM              = (ERROR_KV + 0x0001),
+    ERROR_KV_FULL                   = (ERROR_KV + 0x0002),
+    ERROR_KV_NOT_FOUND              = (ERROR_KV + 0x0003),
+
 } error_code_module_t ;
 
 #endif //eelCodes_H__
@@ -26,11 +26,48 @@
 fs_interface_t fs =
 {
     .Init               = &fs_Init,
+    .JournalAppend      = &fs_JournalAppend,
+    .JournalRead        = &fs_JournalRead,
+    .JournalAck         = &fs_JournalAck,
+    .JournalStatus      = &fs_JournalStatus,
+    .KvGet              = &fs_KvGet,
+    .KvSet              = &fs_KvSet,
+    .KvDelete           = &fs_KvDelete,
+    .Read               = &fs_Read,
+    .Write              = &fs_Write,
+    .Append             = &fs_Append,
+    .Stat               = &fs_Stat,
+    .Delete             = &fs_Delete,
+    .Status             = &fs_Status,
+    .BlobFind           = &fs_BlobFind,
+    .BlobStore          = &fs_BlobStore,
+    .BlobDelete         = &fs_BlobDelete,
+    .BlobFormat         = &fs_BlobFormat,
+#if FS_BENCHMARK_ENABLED
+    .Benchmark          = &fs_Benchmark,
+#endif
 };
 
+#if FS_BENCHMARK_ENABLED
+static fs_bench_t fs_bench;
+
+static const fs_geometry_t fs_bench_geometry[] =
+{
+    /* read, prog, cache, lookahead */
+    {  4,  4,  16, 16 },                /* the settings before FS_CACHE_SIZE */
+    {  4,  4,  32,  8 },
+    {  4,  4,  64,  8 },
+    {  4,  4, 128,  8 },
+    {  4,  4, 256,  8 },
+    { 16, 16,  64,  8 },
+    {  4,  4,  64, 32 },
+};
+#endif
+
 fs_obj_t fs_obj =
 {
     .is_init            = false,
+    .blob_mutex         = NULL,
 };
 
 uint8_t nvdata[ NVDATA_SIZE ] __attribute__( ( section( ".nvdata" ) ) );
@@ -40,16 +77,24 @@ uint8_t nvdata[ NVDATA_SIZE ] __attribute__( ( section( ".nvdata" ) ) );
  */
 void fs_Thread( void * parameter_ptr )
 {
-    error_code_module_t error;
-    fs_msg_t msg;
-    uint8_t read_buffer[ FS_BUFFER_SIZE ];
-    uint8_t prog_buffer[ FS_BUFFER_SIZE ];
-    uint8_t lookahead_buffer[ FS_BUFFER_SIZE ];
-    uint8_t file_buffer[ FS_BUFFER_SIZE ];
+    fs_msg_t *msg;
+    lfs_t lfs;
+    journal_t publish_journal;
+    fs_service_t service;
+    nvmc_device_t device;
+    nvmc_device_t kv_device;
+    kv_store_t kv_store;
+    blob_store_t blobs;
+    bool ahead = false;
+    int result;
+    uint8_t read_buffer[ FS_CACHE_SIZE ] __attribute__( ( aligned( 4 ) ) );
+    uint8_t prog_buffer[ FS_CACHE_SIZE ] __attribute__( ( aligned( 4 ) ) );
+    uint8_t lookahead_buffer[ FS_LOOKAHEAD_SIZE ] __attribute__( ( aligned( 4 ) ) );
+    uint8_t file_buffer[ FS_CACHE_SIZE ] __attribute__( ( aligned( 4 ) ) );
     const struct lfs_config cfg =
     {
         // Board context
-        .context = NULL,
+        .context = &device,
 
         // block device operations - functions provided by host device
         .read  = fs_read,
@@ -58,13 +103,13 @@ void fs_Thread( void * parameter_ptr )
         .sync  = fs_sync,
 
         // block device configuration
-        .read_size = 4,
-        .prog_size = 4,
-        .block_size = 4096,
-        .block_count = 29,
-        .cache_size = FS_BUFFER_SIZE,
-        .lookahead_size = FS_BUFFER_SIZE,
-        .block_cycles = 500,
+        .read_size = FS_READ_SIZE,
+        .prog_size = FS_PROG_SIZE,
+        .block_size = FS_BLOCK_SIZE,
+        .block_count = FS_BLOCK_COUNT,
+        .cache_size = FS_CACHE_SIZE,
+        .lookahead_size = FS_LOOKAHEAD_SIZE,
+        .block_cycles = FS_BLOCK_CYCLES,
 
         // static allocation
         .read_buffer = read_buffer,
@@ -80,105 +125,771 @@ void fs_Thread( void * parameter_ptr )
 
     twdt.Configure( TWDT_TIMEOUT );
     Log.InfoPrint( "File system task started" );
+    nvmc.Open( &device, FS_VOLUME_BASE, FS_BLOCK_SIZE, FS_BLOCK_COUNT );
+
+    // The volume stays mounted: the journal is kept on it
+    if ( ( result = lfs_mount( &lfs, &cfg ) ) != 0 )
+    {
+        Log.ErrorPrint( "File system volume does not mount, error=%d: formatting it, all files are lost", result );
+        lfs_format( &lfs, &cfg );
+        if ( ( result = lfs_mount( &lfs, &cfg ) ) != 0 )
+        {
+            Log.ErrorPrint( "File system volume does not mount after formatting, error=%d", result );
+        }
+    }
 
-    fs_test_nvmc( &cfg, &file_cfg );
+    nvmc.Open( &kv_device, FS_KV_BASE, FS_BLOCK_SIZE, FS_KV_BLOCKS );
+    kv.Open( &kv_store, &kv_device );
+    fs_test_nvmc( &kv_store );
+    journal.Open( &publish_journal, &lfs );
+    blob.Open( &blobs, FS_BLOB_BASE, FS_BLOB_SIZE );
+    memset( &service, 0, sizeof( service ) );
+    service.lfs = &lfs;
+    service.journal = &publish_journal;
+    service.device = &device;
+    service.kv = &kv_store;
+    service.blobs = &blobs;
+    service.file_cfg = &file_cfg;
 
     for( ; ; )
     {
         twdt.Update();
-        if ( os.QueueReceive( app.GetFsQHandle(), &msg, os.Ms2Ticks( TWDT_KICK_TIME ) ) )
+
+        // A request that ended an append batch is served before the mailbox
+        if ( ( msg = service.pending ) != NULL ||
+             ( msg = OS_MAILBOX_RECEIVE( app.GetFsQHandle(), fs_msg_t, ahead ? FS_AHEAD_POLL : FS_IDLE_TIME ) ) != NULL )
+        {
+            service.pending = NULL;
+            if ( fs_Process( &service, msg ) )
+            {
+                os.MailboxFree( app.GetFsQHandle(), msg );
+            }
+        }
+        else if ( ahead )
         {
-            // To do: add processing of file system requests here
+            ahead = nvmc.EraseAhead( &device );
+        }
+        else
+        {
+            // Nothing else to do, so write what the journal has collected and erase the blocks littlefs takes next
+            journal.Flush( &publish_journal );
+            kv.Idle( &kv_store );
+            nvmc.Plan( &device, &lfs );
+            ahead = nvmc.EraseAhead( &device );
         }
     }
 }
 
-void fs_test_nvmc( const struct lfs_config *cfg, const struct lfs_file_config *file_cfg )
+bool fs_Process( fs_service_t *service, fs_msg_t *msg )
+{
+    journal_record_t record;
+    uint32_t length;
+    bool done = true;
+
+    switch ( msg->type )
+    {
+        case fstype_journal_append:
+            msg->error = journal.Append( service->journal, msg->msg, msg->topic_length, ( uint8_t * )&msg->msg[ msg->topic_length ], msg->payload_length );
+            if ( msg->error != NO_ERROR )
+            {
+                Log.ErrorPrint( "Journal append failed, error=0x%04x", msg->error );
+            }
+            break;
+
+        case fstype_journal_read:
+            msg->error = journal.Read( service->journal, msg->sequence, &record, ( uint8_t * )msg->msg, sizeof( msg->msg ) );
+            if ( msg->error == NO_ERROR )
+            {
+                msg->sequence = record.sequence;
+                msg->topic_length = record.topic_length;
+                msg->payload_length = record.payload_length;
+            }
+
+            // The sender waits for the answer and frees the request
+            msg->answered = true;
+            os.TaskNotifyGive( msg->handle, OS_NOTIFY_REPLY );
+            done = false;
+            break;
+
+        case fstype_journal_ack:
+            msg->error = journal.Ack( service->journal, msg->sequence );
+            break;
+
+        case fstype_journal_status:
+            journal.Report( service->journal );
+            break;
+
+        case fstype_kv_get:
+            msg->error = kv.Get( service->kv, ( uint16_t )msg->sequence, msg->msg, sizeof( msg->msg ), &length );
+            msg->payload_length = ( msg->error == NO_ERROR ) ? length : 0;
+
+            // The sender waits for the answer and frees the request
+            msg->answered = true;
+            os.TaskNotifyGive( msg->handle, OS_NOTIFY_REPLY );
+            done = false;
+            break;
+
+        case fstype_kv_set:
+            msg->error = kv.Set( service->kv, ( uint16_t )msg->sequence, msg->msg, msg->payload_length );
+            break;
+
+        case fstype_kv_delete:
+            msg->error = kv.Delete( service->kv, ( uint16_t )msg->sequence );
+            break;
+
+        case fstype_read:
+        case fstype_write:
+        case fstype_stat:
+        case fstype_delete:
+            fs_File( service, msg );
+            break;
+
+        case fstype_append:
+            fs_AppendBatch( service, msg );
+            break;
+
+        case fstype_blob_begin:
+        case fstype_blob_data:
+        case fstype_blob_commit:
+        case fstype_blob_delete:
+        case fstype_blob_format:
+            fs_Blob( service, msg );
+            break;
+
+        case fstype_status:
+            fs_Report( service );
+            break;
+
+        default:
+            break;
+    }
+
+    return done;
+}
+
+void fs_File( fs_service_t *service, fs_msg_t *msg )
 {
-    lfs_t lfs;
     lfs_file_t file;
-    // configuration of the filesystem is provided by this struct
-    uint32_t boot_count = 0;
-    TickType_t time = os.GetTickCount();
+    struct lfs_info info;
+    fs_result_t result = { .path = msg->path, .data = NULL, .length = 0, .size = 0 };
+    int32_t status = LFS_ERR_OK;
 
-    if ( lfs_mount( &lfs, cfg ) != 0 )
+    msg->started = os.GetTickCount();
+    switch ( msg->type )
     {
-        lfs_format( &lfs, cfg );
-        lfs_mount( &lfs, cfg );
+        case fstype_read:
+            status = lfs_file_opencfg( service->lfs, &file, msg->path, LFS_O_RDONLY, service->file_cfg );
+            if ( status >= 0 )
+            {
+                status = lfs_file_seek( service->lfs, &file, msg->offset, LFS_SEEK_SET );
+                if ( status >= 0 )
+                {
+                    status = lfs_file_read( service->lfs, &file, msg->msg, msg->payload_length );
+                }
+                if ( status >= 0 )
+                {
+                    // The answer goes back in the request
+                    result.data = ( const uint8_t * )msg->msg;
+                    result.length = status;
+                    result.size = lfs_file_size( service->lfs, &file );
+                }
+                lfs_file_close( service->lfs, &file );
+            }
+            break;
+
+        case fstype_write:
+            status = lfs_file_opencfg( service->lfs, &file, msg->path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC, service->file_cfg );
+            if ( status >= 0 )
+            {
+                status = lfs_file_write( service->lfs, &file, msg->msg, msg->payload_length );
+                if ( status >= 0 )
+                {
+                    // The new content is there once the file is closed
+                    result.length = status;
+                    result.size = status;
+                    status = lfs_file_close( service->lfs, &file );
+                }
+                else
+                {
+                    lfs_file_close( service->lfs, &file );
+                }
+            }
+            break;
+
+        case fstype_stat:
+            status = lfs_stat( service->lfs, msg->path, &info );
+            if ( status >= 0 )
+            {
+                result.size = info.size;
+            }
+            break;
+
+        case fstype_delete:
+            status = lfs_remove( service->lfs, msg->path );
+            break;
+
+        default:
+            break;
     }
 
-    // read current count
-    lfs_file_opencfg( &lfs, &file, "boot_count", LFS_O_RDWR | LFS_O_CREAT, file_cfg );
-    lfs_file_read( &lfs, &file, &boot_count, sizeof( boot_count ) );
-    Log.InfoPrint( "boot_count initialized: %d", boot_count );
+    msg->error = fs_Error( status );
+    fs_Complete( service, msg, &result );
+}
 
-    // update boot count
-    boot_count += 1;
-    lfs_file_rewind( &lfs, &file );
-    lfs_file_write( &lfs, &file, &boot_count, sizeof( boot_count ) );
-    Log.InfoPrint( "boot_count written: %d", boot_count );
+void fs_Blob( fs_service_t *service, fs_msg_t *msg )
+{
+    fs_result_t result = { .path = msg->path, .data = NULL, .length = 0, .size = 0 };
 
-    // remember the storage is not updated until the file is closed successfully
-    lfs_file_close( &lfs, &file );
+    msg->started = os.GetTickCount();
+    switch ( msg->type )
+    {
+        case fstype_blob_begin:
+            // Begin and data answer nobody, their errors come out at the commit
+            blob.Begin( service->blobs, msg->path, msg->offset );
+            break;
 
-    // read current time
-    lfs_file_opencfg( &lfs, &file, "time", LFS_O_RDWR | LFS_O_CREAT, file_cfg );
-    lfs_file_read( &lfs, &file, &time, sizeof( time ) );
-    Log.InfoPrint( "time initialized: %d, %d (ms)", time, os.Ticks2Ms( time ) );
+        case fstype_blob_data:
+            blob.Write( service->blobs, ( const uint8_t * )msg->msg, msg->payload_length );
+            break;
 
-    // update time
-    time += os.GetTickCount();
-    lfs_file_rewind( &lfs, &file );
-    lfs_file_write( &lfs, &file, &time, sizeof( time ) );
-    Log.InfoPrint( "time written: %d, %d (ms)", time, os.Ticks2Ms( time ) );
+        case fstype_blob_commit:
+            msg->error = blob.Commit( service->blobs );
+            if ( msg->error == NO_ERROR )
+            {
+                result.data = blob.Find( FS_BLOB_BASE, msg->path, &result.length );
+                result.size = result.length;
+            }
+            fs_Complete( service, msg, &result );
+            break;
 
-    // remember the storage is not updated until the file is closed successfully
-    lfs_file_close( &lfs, &file );
+        case fstype_blob_delete:
+            msg->error = blob.Delete( service->blobs, msg->path );
+            fs_Complete( service, msg, &result );
+            break;
 
-    // Read back to see if value persisted (works for RAM disk too)
-    boot_count = 0;
-    Log.InfoPrint( "boot_count initialized: %d", boot_count );
-    lfs_file_opencfg( &lfs, &file, "boot_count", LFS_O_RDWR | LFS_O_CREAT, file_cfg );
-    lfs_file_read( &lfs, &file, &boot_count, sizeof( boot_count ) );
-    Log.InfoPrint( "boot_count read: %d", boot_count );
-    lfs_file_close( &lfs, &file );
+        case fstype_blob_format:
+            msg->error = blob.Format( service->blobs );
+            fs_Complete( service, msg, &result );
+            break;
 
-    // Read back to see if value persisted (works for RAM disk too)
-    time = 0;
-    Log.InfoPrint( "time initialized: %d, %d (ms)", time, os.Ticks2Ms( time ) );
-    lfs_file_opencfg( &lfs, &file, "time", LFS_O_RDWR | LFS_O_CREAT, file_cfg );
-    lfs_file_read( &lfs, &file, &time, sizeof( boot_count ) );
-    Log.InfoPrint( "time read: %d, %d (ms)", time, os.Ticks2Ms( time ) );
+        default:
+            break;
+    }
+}
 
-    // Close files
-    lfs_file_close( &lfs, &file );
+void fs_AppendBatch( fs_service_t *service, fs_msg_t *msg )
+{
+    lfs_file_t file;
+    fs_msg_t *batch[ FS_COALESCE_MAX ];
+    fs_msg_t *next;
+    fs_result_t result;
+    error_code_module_t error;
+    uint32_t count = 0, written = 0, size = 0;
+    int32_t status;
+    bool opened;
+
+    msg->started = os.GetTickCount();
+    status = lfs_file_opencfg( service->lfs, &file, msg->path, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, service->file_cfg );
+    opened = ( status >= 0 );
+    if ( opened )
+    {
+        size = lfs_file_size( service->lfs, &file );
+    }
+
+    // Take the appends to the same file from the front of the mailbox, up to the first other request
+    batch[ count++ ] = msg;
+    while ( opened && count < FS_COALESCE_MAX && service->pending == NULL &&
+            ( next = OS_MAILBOX_RECEIVE( app.GetFsQHandle(), fs_msg_t, 0 ) ) != NULL )
+    {
+        if ( next->type == fstype_append && strcmp( next->path, msg->path ) == 0 )
+        {
+            next->started = os.GetTickCount();
+            batch[ count++ ] = next;
+        }
+        else
+        {
+            service->pending = next;
+        }
+    }
 
-    // release any resources we were using
-    lfs_unmount( &lfs );
+    // One open file for the batch: the data goes out in cache sized programs and the metadata in a single commit
+    while ( status >= 0 && written < count )
+    {
+        status = lfs_file_write( service->lfs, &file, batch[ written ]->msg, batch[ written ]->payload_length );
+        if ( status >= 0 )
+        {
+            written++;
+        }
+    }
+    if ( opened )
+    {
+        if ( status >= 0 )
+        {
+            status = lfs_file_close( service->lfs, &file );
+        }
+        else
+        {
+            // littlefs commits nothing of a file that failed a write, so the whole batch shares the error
+            lfs_file_close( service->lfs, &file );
+        }
+    }
+    service->commits++;
+    service->coalesced += count - 1;
+
+    error = fs_Error( status );
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        result.path = batch[ i ]->path;
+        result.data = NULL;
+        result.length = ( error == NO_ERROR ) ? batch[ i ]->payload_length : 0;
+        size += result.length;
+        result.size = size;
+        batch[ i ]->error = error;
+        fs_Complete( service, batch[ i ], &result );
+
+        // The first append is freed by the task loop
+        if ( i > 0 )
+        {
+            os.MailboxFree( app.GetFsQHandle(), batch[ i ] );
+        }
+    }
 }
 
-int32_t fs_read( const struct lfs_config *cfg, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size )
+void fs_Complete( fs_service_t *service, fs_msg_t *msg, const fs_result_t *result )
 {
-    // read data
-    memcpy( buffer, &nvdata[ block * cfg->block_size + off ], size );
+    fs_stats_t *stats = &service->stats[ msg->type - fstype_read ];
+    uint32_t wait_ms = os.Ticks2Ms( msg->started - msg->posted );
+    uint32_t busy_ms = os.Ticks2Ms( os.GetTickCount() - msg->started );
 
-    return 0;
+    stats->count++;
+    if ( msg->error != NO_ERROR )
+    {
+        stats->errors++;
+    }
+    stats->wait_ms += wait_ms;
+    stats->busy_ms += busy_ms;
+    if ( wait_ms + busy_ms > stats->max_ms )
+    {
+        stats->max_ms = wait_ms + busy_ms;
+    }
+
+    if ( msg->done != NULL )
+    {
+        msg->done( msg->error, result, msg->context );
+    }
 }
 
-int32_t fs_prog( const struct lfs_config *cfg, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size )
+void fs_Report( const fs_service_t *service )
 {
-    // program data
-    nrfx_nvmc_bytes_write( ( uint32_t ) &nvdata[ block * cfg->block_size + off ], buffer, size );
+    static const char * const names[ FS_OP_COUNT ] = { "read", "write", "append", "stat", "delete", "blob", "blob delete", "blob format" };
+    const fs_stats_t *stats;
 
-    return 0;
+    for ( uint32_t i = 0; i < FS_OP_COUNT; i++ )
+    {
+        stats = &service->stats[ i ];
+        if ( stats->count > 0 )
+        {
+            Log.Print( "FS %s: %d requests, %d errors, mean %d ms queued + %d ms busy, max %d ms\r\n",
+                       names[ i ],
+                       stats->count,
+                       stats->errors,
+                       stats->wait_ms / stats->count,
+                       stats->busy_ms / stats->count,
+                       stats->max_ms );
+        }
+    }
+    Log.Print( "FS append: %d commits, %d appends coalesced\r\n", service->commits, service->coalesced );
+    nvmc.Report( service->device );
+    kv.Report( service->kv );
+    blob.Report( service->blobs );
 }
 
-int32_t fs_erase( const struct lfs_config *cfg, lfs_block_t block )
+#if FS_BENCHMARK_ENABLED
+void fs_BenchGeometry( const fs_geometry_t *geometry, uint32_t count )
 {
-    // erase block (flash page = 4096 bytes)
-    nrfx_nvmc_page_erase( ( uint32_t ) &nvdata[ block * cfg->block_size ] );
+    const struct lfs_config cfg =
+    {
+        .context = &fs_bench.device,
+        .read  = fs_read,
+        .prog  = fs_prog,
+        .erase = fs_erase,
+        .sync  = fs_sync,
+        .read_size = geometry->read_size,
+        .prog_size = geometry->prog_size,
+        .block_size = FS_BLOCK_SIZE,
+        .block_count = FS_BENCH_BLOCKS,
+        .cache_size = geometry->cache_size,
+        .lookahead_size = geometry->lookahead_size,
+        .block_cycles = FS_BLOCK_CYCLES,
+        .read_buffer = fs_bench.cache[ 0 ],
+        .prog_buffer = fs_bench.cache[ 1 ],
+        .lookahead_buffer = fs_bench.lookahead,
+    };
+    const struct lfs_file_config file_cfg =
+    {
+        .buffer = fs_bench.cache[ 2 ],
+        .attrs = NULL,
+        .attr_count = 0,
+    };
+    struct lfs_info info;
+    lfs_t *lfs = &fs_bench.lfs;
+    lfs_file_t *file = &fs_bench.file;
+    char name[ FS_BENCH_NAME_MAX ];
+    uint8_t record[ FS_BENCH_RECORD ];
+    uint32_t i, value, random = 0x2545f491;
 
-    return 0;
+    Log.Print( "read %d, prog %d, cache %d, lookahead %d: %d bytes of RAM with the journal caches\r\n",
+               geometry->read_size,
+               geometry->prog_size,
+               geometry->cache_size,
+               geometry->lookahead_size,
+               5 * geometry->cache_size + geometry->lookahead_size );
+
+    memset( fs_bench.volume, 0xff, sizeof( fs_bench.volume ) );
+    nvmc.Open( &fs_bench.device, ( uint32_t )fs_bench.volume, FS_BLOCK_SIZE, FS_BENCH_BLOCKS );
+    fs_bench.device.program = fs_BenchProgram;
+    fs_bench.device.erase = fs_BenchErase;
+    if ( lfs_format( lfs, &cfg ) != 0 || lfs_mount( lfs, &cfg ) != 0 )
+    {
+        Log.Print( "Format failed\r\n" );
+        return;
+    }
+    Log.Print( "  test     reads  progs   runs  words  skip erases  skip  CPU us NVMC ms direct\r\n" );
+
+    // Appends of one record each, opened and closed like a journal flush
+    memset( record, 0x5a, sizeof( record ) );
+    memcpy( name, "append", sizeof( "append" ) );
+    fs_BenchIdle();
+    fs_BenchStart();
+    for ( i = 0; i < count; i++ )
+    {
+        if ( lfs_file_opencfg( lfs, file, name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND, &file_cfg ) < 0 )
+        {
+            fs_bench.errors++;
+            continue;
+        }
+        if ( lfs_file_write( lfs, file, record, FS_BENCH_RECORD ) != FS_BENCH_RECORD )
+        {
+            fs_bench.errors++;
+        }
+        if ( lfs_file_close( lfs, file ) != 0 )
+        {
+            fs_bench.errors++;
+        }
+    }
+    fs_BenchStop( "append" );
+    lfs_remove( lfs, name );
+
+    // Reads of a few bytes at random offsets of an open file
+    memcpy( name, "random", sizeof( "random" ) );
+    if ( lfs_file_opencfg( lfs, file, name, LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC, &file_cfg ) >= 0 )
+    {
+        for ( i = 0; i < FS_BENCH_FILE; i += FS_BENCH_READ )
+        {
+            lfs_file_write( lfs, file, record, FS_BENCH_READ );
+        }
+        lfs_file_close( lfs, file );
+    }
+    fs_BenchIdle();
+    fs_BenchStart();
+    if ( lfs_file_opencfg( lfs, file, name, LFS_O_RDONLY, &file_cfg ) < 0 )
+    {
+        fs_bench.errors++;
+    }
+    else
+    {
+        for ( i = 0; i < count; i++ )
+        {
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            if ( lfs_file_seek( lfs, file, random % ( FS_BENCH_FILE - FS_BENCH_READ ), LFS_SEEK_SET ) < 0 ||
+                 lfs_file_read( lfs, file, record, FS_BENCH_READ ) != FS_BENCH_READ )
+            {
+                fs_bench.errors++;
+            }
+        }
+        lfs_file_close( lfs, file );
+    }
+    fs_BenchStop( "random" );
+    lfs_remove( lfs, name );
+
+    // Metadata only: a file is looked up, then created with a few bytes or removed
+    fs_BenchIdle();
+    fs_BenchStart();
+    for ( i = 0; i < count; i++ )
+    {
+        snprintf( name, sizeof( name ), "m%d", i % FS_BENCH_FILES );
+        if ( lfs_stat( lfs, name, &info ) == 0 )
+        {
+            if ( lfs_remove( lfs, name ) != 0 )
+            {
+                fs_bench.errors++;
+            }
+        }
+        else if ( lfs_file_opencfg( lfs, file, name, LFS_O_WRONLY | LFS_O_CREAT, &file_cfg ) < 0 ||
+                  lfs_file_write( lfs, file, &i, sizeof( i ) ) != sizeof( i ) ||
+                  lfs_file_close( lfs, file ) != 0 )
+        {
+            fs_bench.errors++;
+        }
+    }
+    fs_BenchStop( "metadata" );
+
+    // One value in a file of its own, read and rewritten in place as boot_count was
+    memcpy( name, "counter", sizeof( "counter" ) );
+    fs_BenchIdle();
+    fs_BenchStart();
+    for ( i = 0; i < count; i++ )
+    {
+        if ( lfs_file_opencfg( lfs, file, name, LFS_O_RDWR | LFS_O_CREAT, &file_cfg ) < 0 )
+        {
+            fs_bench.errors++;
+            continue;
+        }
+        value = 0;
+        if ( lfs_file_read( lfs, file, &value, sizeof( value ) ) < 0 )
+        {
+            fs_bench.errors++;
+        }
+        value++;
+        if ( lfs_file_rewind( lfs, file ) < 0 || lfs_file_write( lfs, file, &value, sizeof( value ) ) != sizeof( value ) )
+        {
+            fs_bench.errors++;
+        }
+        if ( lfs_file_close( lfs, file ) != 0 )
+        {
+            fs_bench.errors++;
+        }
+    }
+    fs_BenchStop( "counter" );
+
+    lfs_unmount( lfs );
+}
+
+void fs_BenchKv( uint32_t count )
+{
+    uint32_t i, value = 0;
+
+    Log.Print( "Key-value store on %d pages of the simulated volume\r\n", FS_KV_BLOCKS );
+    memset( fs_bench.volume, 0xff, FS_KV_BLOCKS * FS_BLOCK_SIZE );
+    nvmc.Open( &fs_bench.device, ( uint32_t )fs_bench.volume, FS_BLOCK_SIZE, FS_KV_BLOCKS );
+    fs_bench.device.program = fs_BenchProgram;
+    fs_bench.device.erase = fs_BenchErase;
+    if ( kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR )
+    {
+        Log.Print( "Format failed\r\n" );
+        return;
+    }
+    Log.Print( "  test     reads  progs   runs  words  skip erases  skip  CPU us NVMC ms direct\r\n" );
+
+    // The same counter as the littlefs test: read, add one, write
+    fs_BenchStart();
+    for ( i = 0; i < count; i++ )
+    {
+        if ( kv.Get( &fs_bench.kv, fs_key_boot_count, &value, sizeof( value ), NULL ) != NO_ERROR )
+        {
+            value = 0;
+        }
+        value++;
+        if ( kv.Set( &fs_bench.kv, fs_key_boot_count, &value, sizeof( value ) ) != NO_ERROR )
+        {
+            fs_bench.errors++;
+        }
+    }
+    fs_BenchStop( "counter" );
+
+    // A reset throws the index away; the log gives it back with the last value
+    value = 0;
+    fs_BenchStart();
+    if ( kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR ||
+         kv.Get( &fs_bench.kv, fs_key_boot_count, &value, sizeof( value ), NULL ) != NO_ERROR || value != count )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchStop( "open" );
+
+    // Sets of a few keys until the store went round the ring: the latest value of each key, and only that, is kept
+    fs_BenchStart();
+    for ( i = 0; fs_bench.kv.stats.compactions <= FS_KV_BLOCKS && i < FS_KV_BLOCKS * FS_BLOCK_SIZE; i++ )
+    {
+        if ( kv.Set( &fs_bench.kv, FS_BENCH_KV_KEY + i % FS_BENCH_KV_KEYS, &i, sizeof( i ) ) != NO_ERROR )
+        {
+            fs_bench.errors++;
+        }
+    }
+    fs_BenchKvCheck( i );
+    if ( kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchKvCheck( i );
+    fs_BenchStop( "compact" );
+
+    // A reset while a record was programmed: the header is in, the value is not
+    fs_BenchStart();
+    value = FS_BENCH_KV_TORN;
+    fs_BenchProgram( fs_bench.device.base + fs_bench.kv.page * FS_BLOCK_SIZE + fs_bench.kv.head, &value, 1 );
+    if ( kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR || fs_bench.kv.stats.crc_errors != 1 )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchKvCheck( i );
+
+    // ... and one that left a length no record has: nothing after it is read, and the next set compacts
+    value = FS_BENCH_KV_BAD;
+    fs_BenchProgram( fs_bench.device.base + fs_bench.kv.page * FS_BLOCK_SIZE + fs_bench.kv.head, &value, 1 );
+    if ( kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR || fs_bench.kv.stats.crc_errors != 2 )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchKvCheck( i );
+    value = i++;
+    if ( kv.Set( &fs_bench.kv, FS_BENCH_KV_KEY + value % FS_BENCH_KV_KEYS, &value, sizeof( value ) ) != NO_ERROR ||
+         fs_bench.kv.stats.compactions != 1 || kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchKvCheck( i );
+    fs_BenchStop( "torn" );
+
+    // A reset during a compaction: the next page holds copied records but no header, so the old page stays in charge
+    fs_BenchStart();
+    value = ( fs_bench.kv.page + 1 ) % FS_KV_BLOCKS;
+    if ( nvmc.Erase( &fs_bench.device, value ) < 0 ||
+         nvmc.Prog( &fs_bench.device, value, FS_BENCH_KV_RECORD, ( const void * )( fs_bench.device.base + fs_bench.kv.page * FS_BLOCK_SIZE + FS_BENCH_KV_RECORD ),
+                    FS_BENCH_KV_KEYS * FS_BENCH_KV_RECORD ) < 0 ||
+         kv.Open( &fs_bench.kv, &fs_bench.device ) != NO_ERROR || fs_bench.kv.page == value )
+    {
+        fs_bench.errors++;
+    }
+    fs_BenchKvCheck( i );
+    fs_BenchStop( "reset" );
+    kv.Report( &fs_bench.kv );
+}
+
+void fs_BenchKvCheck( uint32_t sets )
+{
+    uint32_t value, length;
+
+    // The benchmark keys hold the number of the set that wrote them last
+    for ( uint32_t i = sets - FS_BENCH_KV_KEYS; i < sets; i++ )
+    {
+        if ( kv.Get( &fs_bench.kv, FS_BENCH_KV_KEY + i % FS_BENCH_KV_KEYS, &value, sizeof( value ), &length ) != NO_ERROR ||
+             length != sizeof( value ) || value != i )
+        {
+            fs_bench.errors++;
+        }
+    }
+}
+
+void fs_BenchIdle( void )
+{
+    nvmc.Plan( &fs_bench.device, &fs_bench.lfs );
+    while ( nvmc.EraseAhead( &fs_bench.device ) )
+    {
+    }
+}
+
+void fs_BenchStart( void )
+{
+    memset( &fs_bench.device.stats, 0, sizeof( fs_bench.device.stats ) );
+    fs_bench.errors = 0;
+    fs_bench.start = DWT->CYCCNT;
+}
+
+void fs_BenchStop( const char *name )
+{
+    uint32_t cycles = DWT->CYCCNT - fs_bench.start;
+    const nvmc_stats_t *stats = &fs_bench.device.stats;
+    uint64_t nvmc_us = ( uint64_t )stats->words * FS_NVMC_WORD_US + ( uint64_t )stats->erases * FS_NVMC_ERASE_US;
+    uint64_t direct_us = ( uint64_t )( stats->words + stats->words_skipped ) * FS_NVMC_WORD_US +
+                         ( uint64_t )( stats->erases + stats->erases_skipped ) * FS_NVMC_ERASE_US;
+
+    Log.Print( "  %-8s %5d %6d %6d %6d %5d %6d %5d %7d %7d %6d\r\n",
+               name,
+               stats->reads,
+               stats->programs,
+               stats->runs,
+               stats->words,
+               stats->words_skipped,
+               stats->erases,
+               stats->erases_skipped,
+               cycles / ( SystemCoreClock / 1000000 ),
+               ( uint32_t )( nvmc_us / 1000 ),
+               ( uint32_t )( direct_us / 1000 ) );
+    if ( fs_bench.errors > 0 )
+    {
+        Log.Print( "  %d errors\r\n", fs_bench.errors );
+    }
+}
+
+void fs_BenchProgram( uint32_t address, const uint32_t *words, uint32_t count )
+{
+    uint32_t *target = ( uint32_t * )address;
+
+    // Like the NVMC, a program can only clear bits
+    for ( uint32_t i = 0; i < count; i++ )
+    {
+        target[ i ] &= words[ i ];
+    }
+}
+
+void fs_BenchErase( uint32_t address, uint32_t duration_ms )
+{
+    ( void )duration_ms;
+    memset( ( void * )address, 0xff, FS_BLOCK_SIZE );
+}
+#endif
+
+error_code_module_t fs_Error( int32_t result )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( result == LFS_ERR_NOENT )
+    {
+        error = ERROR_FS_NOT_FOUND;
+    }
+    else if ( result < 0 )
+    {
+        error = ERROR_FS_IO;
+    }
+
+    return error;
+}
+
+void fs_test_nvmc( kv_store_t *store )
+{
+    uint32_t boot_count = 0;
+    TickType_t time = 0;
+
+    // One record per value: an update is a single program, with no file to open and commit
+    kv.Get( store, fs_key_boot_count, &boot_count, sizeof( boot_count ), NULL );
+    Log.InfoPrint( "boot_count read: %d", boot_count );
+    boot_count += 1;
+    kv.Set( store, fs_key_boot_count, &boot_count, sizeof( boot_count ) );
+    Log.InfoPrint( "boot_count written: %d", boot_count );
+
+    kv.Get( store, fs_key_time, &time, sizeof( time ), NULL );
+    Log.InfoPrint( "time read: %d, %d (ms)", time, os.Ticks2Ms( time ) );
+    time += os.GetTickCount();
+    kv.Set( store, fs_key_time, &time, sizeof( time ) );
+    Log.InfoPrint( "time written: %d, %d (ms)", time, os.Ticks2Ms( time ) );
+}
+
+int32_t fs_read( const struct lfs_config *cfg, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size )
+{
+    return nvmc.Read( ( nvmc_device_t * )cfg->context, block, off, buffer, size );
+}
+
+int32_t fs_prog( const struct lfs_config *cfg, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size )
+{
+    return nvmc.Prog( ( nvmc_device_t * )cfg->context, block, off, buffer, size );
+}
+
+int32_t fs_erase( const struct lfs_config *cfg, lfs_block_t block )
+{
+    return nvmc.Erase( ( nvmc_device_t * )cfg->context, block );
 }
 
 int32_t fs_sync( const struct lfs_config *cfg )
@@ -204,7 +915,7 @@ error_code_module_t fs_Init( void )
 
         /* Set up file system task */
         shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-        shared_struct->fs_queue = os.CreateQueue( QUEUE_LEN, sizeof( fs_msg_t ) );
+        shared_struct->fs_queue = OS_CREATE_MAILBOX( QUEUE_LEN_LONG, fs_msg_t );
         static StackType_t task_stack[ configMINIMAL_STACK_SIZE ] __attribute__( ( aligned( 32 ) ) );
         TaskHandle_t handle = os.CreateTask( fs_Thread,
                                              "FS",
@@ -229,7 +940,15 @@ error_code_module_t fs_Init( void )
         os.AllocateRegions( handle, regions );
 
         /* init local RAM objects */
-        fs_obj.is_init = true;
+        fs_obj.blob_mutex = os.CreateMutex();
+        if ( fs_obj.blob_mutex == NULL )
+        {
+            error = ERROR_FS_INIT;
+        }
+        else
+        {
+            fs_obj.is_init = true;
+        }
     }
     else
     {
@@ -239,6 +958,356 @@ error_code_module_t fs_Init( void )
     return error;
 }
 
+error_code_module_t fs_JournalAppend( const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length, uint32_t timeout )
+{
+    return fs_Request( fstype_journal_append, 0, topic, topic_length, payload, payload_length, timeout );
+}
+
+error_code_module_t fs_JournalRead( uint32_t after, uint32_t *sequence, char *topic, uint8_t *payload, uint16_t *payload_length )
+{
+    error_code_module_t error = NO_ERROR;
+    fs_msg_t *msg;
+
+    if ( fs_obj.is_init == false )
+    {
+        error = ERROR_FS_NOT_INIT;
+    }
+    else if ( sequence == NULL || topic == NULL || payload == NULL || payload_length == NULL )
+    {
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( ( msg = OS_MAILBOX_ALLOC( app.GetFsQHandle(), fs_msg_t, QUEUE_WAIT_TIME ) ) == NULL )
+    {
+        error = ERROR_FS_EVENT_PROCESSING;
+    }
+    else
+    {
+        msg->type = fstype_journal_read;
+        msg->handle = os.GetTaskHandle();
+        msg->answered = false;
+        msg->sequence = after;
+        if ( !os.MailboxSend( app.GetFsQHandle(), msg, QUEUE_WAIT_TIME ) )
+        {
+            /* Message failed to send */
+            os.MailboxFree( app.GetFsQHandle(), msg );
+            error = ERROR_FS_EVENT_PROCESSING;
+        }
+        else
+        {
+            // The file system task answers every read, and the answer is in the request; until then the request is its own
+            while ( !msg->answered )
+            {
+                if ( os.TaskNotifyTake( OS_NOTIFY_REPLY, true, TWDT_KICK_TIME ) == 0 )
+                {
+                    Log.ErrorPrint( "Waiting for journal" );
+                }
+            }
+            error = msg->error;
+            if ( error == NO_ERROR )
+            {
+                *sequence = msg->sequence;
+                memcpy( topic, msg->msg, msg->topic_length );
+                topic[ msg->topic_length ] = '\0';
+                memcpy( payload, &msg->msg[ msg->topic_length ], msg->payload_length );
+                *payload_length = msg->payload_length;
+            }
+            os.MailboxFree( app.GetFsQHandle(), msg );
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t fs_JournalAck( uint32_t sequence )
+{
+    return fs_Request( fstype_journal_ack, sequence, NULL, 0, NULL, 0, 0 );
+}
+
+error_code_module_t fs_JournalStatus( void )
+{
+    return fs_Request( fstype_journal_status, 0, NULL, 0, NULL, 0, QUEUE_WAIT_TIME );
+}
+
+error_code_module_t fs_KvGet( uint16_t key, void *value, uint32_t size, uint32_t *length )
+{
+    error_code_module_t error = NO_ERROR;
+    fs_msg_t *msg;
+
+    if ( fs_obj.is_init == false )
+    {
+        error = ERROR_FS_NOT_INIT;
+    }
+    else if ( value == NULL )
+    {
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( ( msg = OS_MAILBOX_ALLOC( app.GetFsQHandle(), fs_msg_t, QUEUE_WAIT_TIME ) ) == NULL )
+    {
+        error = ERROR_FS_EVENT_PROCESSING;
+    }
+    else
+    {
+        msg->type = fstype_kv_get;
+        msg->handle = os.GetTaskHandle();
+        msg->answered = false;
+        msg->sequence = key;
+        if ( !os.MailboxSend( app.GetFsQHandle(), msg, QUEUE_WAIT_TIME ) )
+        {
+            /* Message failed to send */
+            os.MailboxFree( app.GetFsQHandle(), msg );
+            error = ERROR_FS_EVENT_PROCESSING;
+        }
+        else
+        {
+            // The file system task answers every get, and the value is in the request; until then the request is its own
+            while ( !msg->answered )
+            {
+                if ( os.TaskNotifyTake( OS_NOTIFY_REPLY, true, TWDT_KICK_TIME ) == 0 )
+                {
+                    Log.ErrorPrint( "Waiting for key-value store" );
+                }
+            }
+            error = msg->error;
+            if ( error == NO_ERROR && msg->payload_length > size )
+            {
+                error = ERROR_FS_BAD_PARAM;
+            }
+            else if ( error == NO_ERROR )
+            {
+                memcpy( value, msg->msg, msg->payload_length );
+                if ( length != NULL )
+                {
+                    *length = msg->payload_length;
+                }
+            }
+            os.MailboxFree( app.GetFsQHandle(), msg );
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t fs_KvSet( uint16_t key, const void *value, uint32_t length )
+{
+    if ( value == NULL || length == 0 || length > KV_VALUE_MAX )
+    {
+        return ERROR_FS_BAD_PARAM;
+    }
+
+    return fs_Request( fstype_kv_set, key, NULL, 0, ( const uint8_t * )value, length, QUEUE_WAIT_TIME );
+}
+
+error_code_module_t fs_KvDelete( uint16_t key )
+{
+    return fs_Request( fstype_kv_delete, key, NULL, 0, NULL, 0, QUEUE_WAIT_TIME );
+}
+
+error_code_module_t fs_Read( const char *path, uint32_t offset, uint32_t size, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_read, path, offset, NULL, size, done, context );
+}
+
+error_code_module_t fs_Write( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_write, path, 0, data, length, done, context );
+}
+
+error_code_module_t fs_Append( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_append, path, 0, data, length, done, context );
+}
+
+error_code_module_t fs_Stat( const char *path, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_stat, path, 0, NULL, 0, done, context );
+}
+
+error_code_module_t fs_Delete( const char *path, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_delete, path, 0, NULL, 0, done, context );
+}
+
+error_code_module_t fs_Status( void )
+{
+    return fs_Request( fstype_status, 0, NULL, 0, NULL, 0, QUEUE_WAIT_TIME );
+}
+
+const uint8_t *fs_BlobFind( const char *name, uint32_t *length )
+{
+    // Only reads flash, so the file system task is not asked and need not run yet
+    return blob.Find( FS_BLOB_BASE, name, length );
+}
+
+error_code_module_t fs_BlobStore( const char *name, const uint8_t *data, uint32_t length, fs_done_t done, void *context )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t sent, chunk;
+
+    if ( fs_obj.is_init == false )
+    {
+        error = ERROR_FS_NOT_INIT;
+    }
+    else if ( name == NULL || strlen( name ) >= BLOB_NAME_MAX || data == NULL || length == 0 )
+    {
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( !os.TakeSemaphore( fs_obj.blob_mutex, QUEUE_WAIT_TIME ) )
+    {
+        error = ERROR_FS_EVENT_PROCESSING;
+    }
+    else
+    {
+        // A request missing on the way makes the commit fail, and the next begin drops what was written
+        error = fs_FileRequest( fstype_blob_begin, name, length, NULL, 0, NULL, NULL );
+        for ( sent = 0; error == NO_ERROR && sent < length; sent += chunk )
+        {
+            chunk = ( length - sent < FS_DATA_MAX ) ? length - sent : FS_DATA_MAX;
+            error = fs_FileRequest( fstype_blob_data, name, sent, &data[ sent ], chunk, NULL, NULL );
+        }
+        if ( error == NO_ERROR )
+        {
+            error = fs_FileRequest( fstype_blob_commit, name, 0, NULL, 0, done, context );
+        }
+        os.GiveSemaphore( fs_obj.blob_mutex );
+    }
+
+    return error;
+}
+
+error_code_module_t fs_BlobDelete( const char *name, fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_blob_delete, name, 0, NULL, 0, done, context );
+}
+
+error_code_module_t fs_BlobFormat( fs_done_t done, void *context )
+{
+    return fs_FileRequest( fstype_blob_format, "", 0, NULL, 0, done, context );
+}
+
+#if FS_BENCHMARK_ENABLED
+void fs_Benchmark( uint32_t count )
+{
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    if ( count == 0 || cycles_per_us == 0 )
+    {
+        Log.Print( "At least one operation per test\r\n" );
+        return;
+    }
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    Log.Print( "littlefs on a simulated volume of %d x %d bytes, %d operations per test, %d MHz\r\n",
+               FS_BENCH_BLOCKS,
+               FS_BLOCK_SIZE,
+               count,
+               cycles_per_us );
+    Log.Print( "NVMC model: %d us per word programmed, %d us per page erased\r\n", FS_NVMC_WORD_US, FS_NVMC_ERASE_US );
+    for ( uint32_t i = 0; i < sizeof( fs_bench_geometry ) / sizeof( fs_bench_geometry[ 0 ] ); i++ )
+    {
+        fs_BenchGeometry( &fs_bench_geometry[ i ], count );
+    }
+    fs_BenchKv( count );
+    Log.Print( "Built with read %d, prog %d, cache %d, lookahead %d\r\n", FS_READ_SIZE, FS_PROG_SIZE, FS_CACHE_SIZE, FS_LOOKAHEAD_SIZE );
+}
+#endif
+
+error_code_module_t fs_Request( fstype_t type, uint32_t sequence, const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length, uint32_t timeout )
+{
+    error_code_module_t error = NO_ERROR;
+    fs_msg_t *msg;
+
+    if ( fs_obj.is_init == false )
+    {
+        error = ERROR_FS_NOT_INIT;
+    }
+    else if ( topic_length + payload_length > SHORT_MSG_MAX )
+    {
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( ( msg = OS_MAILBOX_ALLOC( app.GetFsQHandle(), fs_msg_t, timeout ) ) == NULL )
+    {
+        error = ERROR_FS_EVENT_PROCESSING;
+    }
+    else
+    {
+        msg->type = type;
+        msg->handle = os.GetTaskHandle();
+        msg->error = NO_ERROR;
+        msg->sequence = sequence;
+        msg->topic_length = topic_length;
+        msg->payload_length = payload_length;
+        if ( topic_length > 0 )
+        {
+            memcpy( msg->msg, topic, topic_length );
+        }
+        if ( payload_length > 0 )
+        {
+            memcpy( &msg->msg[ topic_length ], payload, payload_length );
+        }
+        if ( !os.MailboxSend( app.GetFsQHandle(), msg, timeout ) )
+        {
+            /* Message failed to send */
+            os.MailboxFree( app.GetFsQHandle(), msg );
+            error = ERROR_FS_EVENT_PROCESSING;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t fs_FileRequest( fstype_t type, const char *path, uint32_t offset, const uint8_t *data, uint32_t length, fs_done_t done, void *context )
+{
+    error_code_module_t error = NO_ERROR;
+    fs_msg_t *msg;
+
+    if ( fs_obj.is_init == false )
+    {
+        error = ERROR_FS_NOT_INIT;
+    }
+    else if ( path == NULL || strlen( path ) >= FS_PATH_MAX || length > FS_DATA_MAX || ( data == NULL && type != fstype_read && length > 0 ) )
+    {
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( ( type == fstype_write || type == fstype_append || type == fstype_delete ) && strcmp( path, JOURNAL_NAME ) == 0 )
+    {
+        // The journal file is changed by the journal only
+        error = ERROR_FS_BAD_PARAM;
+    }
+    else if ( ( msg = OS_MAILBOX_ALLOC( app.GetFsQHandle(), fs_msg_t, QUEUE_WAIT_TIME ) ) == NULL )
+    {
+        error = ERROR_FS_EVENT_PROCESSING;
+    }
+    else
+    {
+        msg->type = type;
+        msg->handle = os.GetTaskHandle();
+        msg->error = NO_ERROR;
+        msg->topic_length = 0;
+        msg->payload_length = length;
+        if ( data != NULL && length > 0 )
+        {
+            memcpy( msg->msg, data, length );
+        }
+        memcpy( msg->path, path, strlen( path ) + 1 );
+        msg->offset = offset;
+        msg->done = done;
+        msg->context = context;
+        msg->posted = os.GetTickCount();
+        if ( !os.MailboxSend( app.GetFsQHandle(), msg, QUEUE_WAIT_TIME ) )
+        {
+            /* Message failed to send */
+            os.MailboxFree( app.GetFsQHandle(), msg );
+            error = ERROR_FS_EVENT_PROCESSING;
+        }
+    }
+
+    return error;
+}
+
 /**
  * @} fs
  */
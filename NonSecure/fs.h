@@ -25,18 +25,125 @@
 #include "app.h"
 #include "log.h"
 #include "twdt.h"
+#include "journal.h"
+#include "nvmc.h"
+#include "blob.h"
+#include "kv.h"
 #include "eelcodes.h"
 
 /***************************************************************************************************************************
  * Public constants and macros
  */
 
+#define FS_PATH_MAX                     ( 32 )          /*!< longest file name, terminator included */
+#define FS_DATA_MAX                     ( SHORT_MSG_MAX ) /*!< most bytes read or written by one request */
+#define FS_BLOCK_SIZE                   ( 4096 )        /*!< NVMC page, the unit of erase */
+
+#ifndef FS_READ_SIZE
+#define FS_READ_SIZE                    ( 4 )           /*!< flash is memory mapped, any size reads the same */
+#endif
+
+#ifndef FS_PROG_SIZE
+#define FS_PROG_SIZE                    ( 4 )           /*!< NVMC programs whole words */
+#endif
+
+#ifndef FS_CACHE_SIZE
+#define FS_CACHE_SIZE                   ( 64 )          /*!< read, program and per file cache; fs-bench for the trade-off */
+#endif
+
+#ifndef FS_LOOKAHEAD_SIZE
+#define FS_LOOKAHEAD_SIZE               ( 8 )           /*!< one bit per block, 8 bytes cover 64 blocks */
+#endif
+
+#ifndef FS_BLOCK_CYCLES
+#define FS_BLOCK_CYCLES                 ( 500 )         /*!< erase cycles before metadata moves to another block */
+#endif
+
+#ifndef FS_KV_BLOCKS
+#define FS_KV_BLOCKS                    ( 2 )           /*!< pages of nvdata in the ring of the key-value store, see the memory map */
+#endif
+
+#ifndef FS_BLOB_BLOCKS
+#define FS_BLOB_BLOCKS                  ( 4 )           /*!< pages of nvdata kept for mapped blobs, index included, see the memory map */
+#endif
+
+#ifndef FS_BENCHMARK_ENABLED
+#define FS_BENCHMARK_ENABLED            ( 0 )           /*!< set to 1 to build fs.Benchmark() and its simulated volume */
+#endif
+
+#if ( FS_CACHE_SIZE % FS_READ_SIZE ) != 0 || ( FS_CACHE_SIZE % FS_PROG_SIZE ) != 0 || ( FS_BLOCK_SIZE % FS_CACHE_SIZE ) != 0
+#error "FS_CACHE_SIZE must be a multiple of FS_READ_SIZE and FS_PROG_SIZE and divide FS_BLOCK_SIZE"
+#endif
+
+#if ( FS_LOOKAHEAD_SIZE % 8 ) != 0
+#error "FS_LOOKAHEAD_SIZE must be a multiple of 8"
+#endif
+
+#if FS_KV_BLOCKS < 2
+#error "The key-value store compacts into another page, so it needs two at least"
+#endif
+
+#if FS_BLOB_BLOCKS < 2 || FS_BLOCK_SIZE != BLOB_PAGE_SIZE
+#error "The blob store takes whole pages, an index page and one for data at least"
+#endif
+
+#if FS_CACHE_SIZE > JOURNAL_CACHE_MAX
+#error "FS_CACHE_SIZE is larger than the journal supports"
+#endif
+
 /***************************************************************************************************************************
  * Public data structures and typedefs
  */
+
+/**
+ * @brief Keys of the key-value store.
+ */
+typedef enum
+{
+    fs_key_boot_count           = 1,
+    fs_key_time,                                /*!< ticks up to the last boot */
+} fs_key_t;
+
+/**
+ * @brief Outcome of a file request, valid during the completion callback only.
+ */
+typedef struct
+{
+    const char                  *path;
+    const uint8_t               *data;          /*!< bytes read, or the blob stored in flash; NULL for other requests */
+    uint32_t                    length;         /*!< bytes read or written */
+    uint32_t                    size;           /*!< file size after the request */
+} fs_result_t;
+
+/**
+ * @brief Completion callback. It runs in the file system task, which is unprivileged and reaches shared memory only, so it
+ *        should hand the result on (mailbox, task notification) rather than work on the data of the caller.
+ */
+typedef void ( *fs_done_t )( error_code_module_t error, const fs_result_t *result, void *context );
+
 typedef struct
 {
     error_code_module_t ( *Init )( void );
+    error_code_module_t ( *JournalAppend )( const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length, uint32_t timeout );
+    error_code_module_t ( *JournalRead )( uint32_t after, uint32_t *sequence, char *topic, uint8_t *payload, uint16_t *payload_length );
+    error_code_module_t ( *JournalAck )( uint32_t sequence );
+    error_code_module_t ( *JournalStatus )( void );
+    error_code_module_t ( *KvGet )( uint16_t key, void *value, uint32_t size, uint32_t *length );
+    error_code_module_t ( *KvSet )( uint16_t key, const void *value, uint32_t length );
+    error_code_module_t ( *KvDelete )( uint16_t key );
+    error_code_module_t ( *Read )( const char *path, uint32_t offset, uint32_t size, fs_done_t done, void *context );
+    error_code_module_t ( *Write )( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+    error_code_module_t ( *Append )( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+    error_code_module_t ( *Stat )( const char *path, fs_done_t done, void *context );
+    error_code_module_t ( *Delete )( const char *path, fs_done_t done, void *context );
+    error_code_module_t ( *Status )( void );
+    const uint8_t * ( *BlobFind )( const char *name, uint32_t *length );
+    error_code_module_t ( *BlobStore )( const char *name, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+    error_code_module_t ( *BlobDelete )( const char *name, fs_done_t done, void *context );
+    error_code_module_t ( *BlobFormat )( fs_done_t done, void *context );
+#if FS_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t count );
+#endif
 } const fs_interface_t;
 
 /***************************************************************************************************************************
@@ -30,6 +30,53 @@
 #ifndef __NRF_FS_PRIV_H__
 #define __NRF_FS_PRIV_H__
 
+/*
+ * @note
+ * The volume is owned by the file system task; other tasks post requests to its mailbox and go on. Journal appends and
+ * acknowledgements are fire and forget, a journal read waits for its answer. File requests (read, write, append, stat,
+ * delete) are answered through a completion callback run by the file system task, so no caller ever waits for a page
+ * erase or program. Data travels in the request: a write carries a copy of its bytes and a read answers with the bytes
+ * read, FS_DATA_MAX at most either way.
+ *
+ * littlefs commits the metadata of a file when it is closed, so each append that opens and closes the file costs a
+ * commit of its own. Appends to one file that follow each other in the mailbox are therefore written through one open
+ * file and committed once; the callbacks run after that commit. The first other request met ends the batch and is
+ * served next, so requests still complete in the order they were posted.
+ *
+ * Per request type the task counts requests and errors, the time spent queued and in littlefs, and the longest time
+ * from post to completion. Times are in ticks turned into ms, as the unprivileged task cannot read the cycle counter.
+ *
+ * Geometry: flash reads are memcpys from mapped memory, so their cost is the number of calls, not the bytes; a program
+ * costs about FS_NVMC_WORD_US per word whatever the call size, and a page erase FS_NVMC_ERASE_US. A larger cache
+ * therefore cuts the read calls of metadata lookups and lets a commit program in fewer, longer runs, at the price of
+ * five caches of RAM on the file system task stack (read, program, file and the two of the journal). The lookahead
+ * bitmap needs one bit per block, and 8 bytes cover the 29 blocks of the volume; more buys nothing. fs.Benchmark()
+ * runs the same littlefs and NVMC driver on a simulated volume in RAM with a table of geometries, counting device calls
+ * and adding the NVMC busy time they model, so the trade-off can be measured on target without touching the live
+ * volume. Each test starts after the erases ahead an idle file system would do, and is also costed as if every word
+ * were programmed and every erase done on request, as fs_prog and fs_erase did before the driver. The counter test
+ * updates one value kept in a file, as boot_count was, and is run again on the key-value store for comparison.
+ *
+ * Flash access goes through the nvmc driver (see nvmc_priv.h). When no request came for FS_IDLE_TIME, the task writes
+ * the journal batch and plans the erases ahead; it then does one per turn and polls the mailbox in between.
+ *
+ * The first FS_KV_BLOCKS pages of nvdata hold the key-value store (see kv_priv.h), which keeps counters and settings
+ * such as the boot count: an update is one program of a record instead of a littlefs file rewritten and committed.
+ * fs.KvGet waits for its answer like a journal read, sets and deletes are fire and forget. When idle the task lets
+ * the store compact before the erases ahead of littlefs are planned.
+ *
+ * The next FS_BLOB_BLOCKS pages of nvdata hold the mapped blob store (see blob_priv.h).
+ * fs.BlobFind reads its index in place and returns a pointer into nvdata, so it needs no request and no copy; the
+ * caller needs read access to nvdata, which privileged tasks have. Storing a blob is a begin request, data requests of
+ * FS_DATA_MAX bytes at most and a commit request, which gets the callback; a mutex keeps two writers from interleaving
+ * their requests.
+ *
+ * The littlefs volume takes the last FS_BLOCK_COUNT pages of nvdata, the pages nvdata had before the stores were added,
+ * so an existing volume still mounts and keeps its files. The stores are in front of it and nvdata grows with them:
+ * changing FS_KV_BLOCKS or FS_BLOB_BLOCKS needs the same change to the UNPRIVILEGED_DATA_NS segment of the memory
+ * map, which ends with the flash. A volume that does not mount is formatted, which is logged as an error.
+ */
+
 /***************************************************************************************************************************
  * Includes
  */
@@ -40,23 +87,143 @@
 * Private constants and macros
 */
 
-#define NVDATA_SIZE             ( 0x1d000 )
-#define FS_BUFFER_SIZE          ( 16 )
+#define FS_BLOCK_COUNT          ( 29 )                  /*!< pages of the littlefs volume, changing it loses the volume */
+#define FS_STORE_BLOCKS         ( FS_KV_BLOCKS + FS_BLOB_BLOCKS )
+#define NVDATA_SIZE             ( ( FS_STORE_BLOCKS + FS_BLOCK_COUNT ) * FS_BLOCK_SIZE )
+#define FS_KV_BASE              ( ( uint32_t )&nvdata[ 0 ] )
+#define FS_BLOB_BASE            ( ( uint32_t )&nvdata[ FS_KV_BLOCKS * FS_BLOCK_SIZE ] )
+#define FS_VOLUME_BASE          ( ( uint32_t )&nvdata[ FS_STORE_BLOCKS * FS_BLOCK_SIZE ] )
+#define FS_BLOB_SIZE            ( FS_BLOB_BLOCKS * FS_BLOCK_SIZE )
+#define FS_IDLE_TIME            ( JOURNAL_FLUSH_MS )    /*!< wait for requests before the journal batch is written */
+#define FS_AHEAD_POLL           ( 0 )                   /*!< wait for requests between erases ahead */
+#define FS_COALESCE_MAX         ( QUEUE_LEN_LONG )      /*!< appends committed together, at most the whole mailbox */
+#define FS_OP_COUNT             ( fstype_blob_format - fstype_read + 1 )
+
+#ifndef FS_NVMC_WORD_US
+#define FS_NVMC_WORD_US         ( 41 )                  /*!< NVMC time to program one word */
+#endif
+
+#ifndef FS_NVMC_ERASE_US
+#define FS_NVMC_ERASE_US        ( 85000 )               /*!< NVMC time to erase one page */
+#endif
+
+#if FS_BENCHMARK_ENABLED
+#define FS_BENCH_BLOCKS         ( 8 )                   /*!< pages of the simulated volume */
+#define FS_BENCH_CACHE_MAX      ( 256 )                 /*!< largest cache of the geometries measured */
+#define FS_BENCH_LOOKAHEAD_MAX  ( 32 )
+#define FS_BENCH_RECORD         ( 32 )                  /*!< bytes of one append */
+#define FS_BENCH_READ           ( 16 )                  /*!< bytes of one random read */
+#define FS_BENCH_FILE           ( 8192 )                /*!< size of the file read at random */
+#define FS_BENCH_KV_KEY         ( 0x100 )               /*!< first key of the compaction test */
+#define FS_BENCH_KV_KEYS        ( 4 )                   /*!< keys the compaction test sets in turn */
+#define FS_BENCH_KV_RECORD      ( 8 )                   /*!< bytes of a record of a 4 byte value, and of a page header */
+#define FS_BENCH_KV_TORN        ( 0x00040100 )          /*!< header of a 4 byte record of FS_BENCH_KV_KEY, value not programmed */
+#define FS_BENCH_KV_BAD         ( 0x00ff0100 )          /*!< header word with a length no record has */
+#define FS_BENCH_FILES          ( 16 )                  /*!< files created and removed by the metadata test */
+#define FS_BENCH_NAME_MAX       ( 8 )
+#endif
 
 /***************************************************************************************************************************
 * Private data structures and typedefs
 */
 
+typedef enum
+{
+    fstype_journal_append,
+    fstype_journal_read,
+    fstype_journal_ack,
+    fstype_journal_status,
+    fstype_kv_get,
+    fstype_kv_set,
+    fstype_kv_delete,
+    fstype_read,
+    fstype_write,
+    fstype_append,
+    fstype_stat,
+    fstype_delete,
+    fstype_blob_commit,
+    fstype_blob_delete,
+    fstype_blob_format,
+    fstype_blob_begin,
+    fstype_blob_data,
+    fstype_status,
+} fstype_t;
+
 typedef struct
 {
-    TaskHandle_t handle;
-    char msg[ SHORT_MSG_MAX ];
+    fstype_t type;
+    TaskHandle_t handle;                /*!< task notified when a read or get is answered */
+    volatile bool answered;             /*!< set by the file system task with the answer of a read or get */
+    error_code_module_t error;
+    uint32_t sequence;                  /*!< also key of a key-value request */
+    uint16_t topic_length;
+    uint16_t payload_length;            /*!< also data length of a file request */
+    char msg[ SHORT_MSG_MAX ];          /*!< topic followed by payload, or data of a file request */
+    char path[ FS_PATH_MAX ];
+    uint32_t offset;                    /*!< where a read starts, or length of a blob begun */
+    fs_done_t done;
+    void *context;
+    TickType_t posted;
+    TickType_t started;
 } fs_msg_t;
 
+typedef struct
+{
+    uint32_t count;
+    uint32_t errors;
+    uint32_t wait_ms;                   /*!< sum of time queued */
+    uint32_t busy_ms;                   /*!< sum of time in littlefs */
+    uint32_t max_ms;                    /*!< longest time from post to completion */
+} fs_stats_t;
+
+/**
+ * @brief State of the file system task, kept on its stack.
+ */
+typedef struct
+{
+    lfs_t *lfs;
+    journal_t *journal;
+    nvmc_device_t *device;
+    kv_store_t *kv;
+    blob_store_t *blobs;
+    const struct lfs_file_config *file_cfg;
+    fs_msg_t *pending;                  /*!< request that ended an append batch, served next */
+    uint32_t commits;                   /*!< append batches */
+    uint32_t coalesced;                 /*!< appends committed with an earlier one */
+    fs_stats_t stats[ FS_OP_COUNT ];
+} fs_service_t;
+
 typedef struct
 {
     bool                        is_init;
+    SemaphoreHandle_t           blob_mutex;     /*!< held while the requests of one blob are posted */
 } fs_obj_t;
+#if FS_BENCHMARK_ENABLED
+
+typedef struct
+{
+    uint16_t read_size;
+    uint16_t prog_size;
+    uint16_t cache_size;
+    uint16_t lookahead_size;
+} fs_geometry_t;
+
+/**
+ * @brief Simulated volume of the benchmark and the device calls littlefs made on it.
+ */
+typedef struct
+{
+    uint8_t volume[ FS_BENCH_BLOCKS * FS_BLOCK_SIZE ] __attribute__( ( aligned( 4 ) ) );
+    uint8_t cache[ 3 ][ FS_BENCH_CACHE_MAX ] __attribute__( ( aligned( 4 ) ) );
+    uint8_t lookahead[ FS_BENCH_LOOKAHEAD_MAX ] __attribute__( ( aligned( 4 ) ) );
+    lfs_t lfs;
+    lfs_file_t file;
+    nvmc_device_t device;               /*!< the driver of the live volume, over the simulated flash */
+    kv_store_t kv;
+    uint32_t errors;                    /*!< littlefs calls that failed */
+    uint32_t start;                     /*!< cycle counter when the test started */
+} fs_bench_t;
+#endif
 
 /***************************************************************************************************************************
 * Private variables
@@ -72,6 +239,170 @@ typedef struct
  */
 static error_code_module_t fs_Init( void );
 
+/**
+ * @brief       Store a publish in the journal.
+ * @param[in]   topic           Topic name.
+ * @param[in]   topic_length    Length of topic.
+ * @param[in]   payload         Message payload.
+ * @param[in]   payload_length  Length of payload.
+ * @param[in]   timeout         Wait for a free request in ms.
+ * @return      Error code.
+ */
+static error_code_module_t fs_JournalAppend( const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length, uint32_t timeout );
+
+/**
+ * @brief       Read the oldest stored publish after a given sequence. Waits for the file system task.
+ * @param[in]   after           Sequence of the previous publish read, 0 to start at the oldest one.
+ * @param[out]  sequence        Sequence of the publish.
+ * @param[out]  topic           Topic name, SHORT_MSG_MAX + 1 bytes.
+ * @param[out]  payload         Message payload, SHORT_MSG_MAX bytes.
+ * @param[out]  payload_length  Length of payload.
+ * @return      Error code, ERROR_JOURNAL_EMPTY when there is no such publish.
+ */
+static error_code_module_t fs_JournalRead( uint32_t after, uint32_t *sequence, char *topic, uint8_t *payload, uint16_t *payload_length );
+
+/**
+ * @brief       Remove a stored publish once it was delivered.
+ * @param[in]   sequence        Sequence of the publish.
+ * @return      Error code.
+ */
+static error_code_module_t fs_JournalAck( uint32_t sequence );
+
+/**
+ * @brief       Print journal usage from the file system task.
+ * @return      Error code.
+ */
+static error_code_module_t fs_JournalStatus( void );
+
+/**
+ * @brief       Read a value of the key-value store. Waits for the file system task.
+ * @param[in]   key         Key.
+ * @param[out]  value       Value.
+ * @param[in]   size        Size of value, KV_VALUE_MAX at most is used.
+ * @param[out]  length      Bytes of the value, may be NULL.
+ * @return      Error code, ERROR_KV_NOT_FOUND when the key has no value.
+ */
+static error_code_module_t fs_KvGet( uint16_t key, void *value, uint32_t size, uint32_t *length );
+
+/**
+ * @brief       Set a value of the key-value store.
+ * @param[in]   key         Key.
+ * @param[in]   value       Value, copied into the request.
+ * @param[in]   length      Bytes of the value, KV_VALUE_MAX at most.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_KvSet( uint16_t key, const void *value, uint32_t length );
+
+/**
+ * @brief       Remove a key of the key-value store.
+ * @param[in]   key         Key.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_KvDelete( uint16_t key );
+
+/**
+ * @brief       Read from a file.
+ * @param[in]   path        File name.
+ * @param[in]   offset      First byte read.
+ * @param[in]   size        Bytes to read, FS_DATA_MAX at most.
+ * @param[in]   done        Called with the bytes read, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request, ERROR_FS_NOT_FOUND is passed to done.
+ */
+static error_code_module_t fs_Read( const char *path, uint32_t offset, uint32_t size, fs_done_t done, void *context );
+
+/**
+ * @brief       Create or replace a file.
+ * @param[in]   path        File name.
+ * @param[in]   data        New content, copied into the request.
+ * @param[in]   length      Length of data, FS_DATA_MAX at most.
+ * @param[in]   done        Called once the file is committed, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_Write( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+
+/**
+ * @brief       Append to a file, creating it if needed. Appends to one file queued back to back are committed together.
+ * @param[in]   path        File name.
+ * @param[in]   data        Bytes to append, copied into the request.
+ * @param[in]   length      Length of data, FS_DATA_MAX at most.
+ * @param[in]   done        Called once the bytes are committed, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_Append( const char *path, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+
+/**
+ * @brief       Get the size of a file.
+ * @param[in]   path        File name.
+ * @param[in]   done        Called with the size, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_Stat( const char *path, fs_done_t done, void *context );
+
+/**
+ * @brief       Remove a file.
+ * @param[in]   path        File name.
+ * @param[in]   done        Called once the file is gone, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_Delete( const char *path, fs_done_t done, void *context );
+
+/**
+ * @brief       Print file request counters and latencies from the file system task.
+ * @return      Error code.
+ */
+static error_code_module_t fs_Status( void );
+
+/**
+ * @brief       Look a blob up in place.
+ * @param[in]   name        Blob name.
+ * @param[out]  length      Bytes of the blob, may be NULL.
+ * @return      Pointer to the blob in nvdata, NULL when there is no such blob.
+ */
+static const uint8_t *fs_BlobFind( const char *name, uint32_t *length );
+
+/**
+ * @brief       Store a blob, replacing one of the same name once it is committed.
+ * @param[in]   name        Blob name, shorter than BLOB_NAME_MAX.
+ * @param[in]   data        Content, copied into the requests; the caller may reuse it on return.
+ * @param[in]   length      Length of data.
+ * @param[in]   done        Called once the blob is committed, with a pointer to it in nvdata; may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the requests.
+ */
+static error_code_module_t fs_BlobStore( const char *name, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
+
+/**
+ * @brief       Remove a blob. Its space comes back only with fs.BlobFormat.
+ * @param[in]   name        Blob name.
+ * @param[in]   done        Called once the blob is gone, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_BlobDelete( const char *name, fs_done_t done, void *context );
+
+/**
+ * @brief       Erase the blob store, which gives back the space of deleted blobs.
+ * @param[in]   done        Called once the store is empty, may be NULL.
+ * @param[in]   context     Passed to done.
+ * @return      Error code of posting the request.
+ */
+static error_code_module_t fs_BlobFormat( fs_done_t done, void *context );
+#if FS_BENCHMARK_ENABLED
+
+/**
+ * @brief       Compare littlefs geometries on a simulated NVMC volume: appends, random reads, metadata changes and
+ *              counter updates; then the same counter in the key-value store.
+ * @param[in]   count       Operations per test.
+ * @details     Runs in the calling task; the live volume is not touched.
+ */
+static void fs_Benchmark( uint32_t count );
+#endif
+
 /**
  * @brief       Read a block
  */
@@ -100,9 +431,108 @@ int32_t fs_sync( const struct lfs_config *cfg );
  */
 
 /**
- * @brief       Non-volatile memory test.
+ * @brief       Non-volatile memory test: counts boots and run time in the key-value store.
+ */
+static void fs_test_nvmc( kv_store_t *store );
+
+/**
+ * @brief       Carry out a file system request.
+ * @param[in]   service     State of the file system task.
+ * @param[in]   msg         Request.
+ * @return      True when the request is done with and can be freed, false when the sender frees it.
+ */
+static bool fs_Process( fs_service_t *service, fs_msg_t *msg );
+
+/**
+ * @brief       Carry out a file request other than an append.
+ * @param[in]   service     State of the file system task.
+ * @param[in]   msg         Request.
+ */
+static void fs_File( fs_service_t *service, fs_msg_t *msg );
+
+/**
+ * @brief       Carry out a blob store request.
+ * @param[in]   service     State of the file system task.
+ * @param[in]   msg         Request.
+ */
+static void fs_Blob( fs_service_t *service, fs_msg_t *msg );
+
+/**
+ * @brief       Append a request and the appends to the same file queued behind it, then commit them once.
+ * @param[in]   service     State of the file system task.
+ * @param[in]   msg         First append.
+ */
+static void fs_AppendBatch( fs_service_t *service, fs_msg_t *msg );
+
+/**
+ * @brief       Count a finished file request and call its completion callback.
+ * @param[in]   service     State of the file system task.
+ * @param[in]   msg         Request.
+ * @param[in]   result      Outcome passed to the callback.
+ */
+static void fs_Complete( fs_service_t *service, fs_msg_t *msg, const fs_result_t *result );
+
+/**
+ * @brief       Print file request counters and latencies.
+ * @param[in]   service     State of the file system task.
+ */
+static void fs_Report( const fs_service_t *service );
+
+/**
+ * @brief       Turn a littlefs result into an error code.
+ */
+static error_code_module_t fs_Error( int32_t result );
+
+#if FS_BENCHMARK_ENABLED
+
+/**
+ * @brief       Run the tests with one geometry on a freshly formatted simulated volume.
+ */
+static void fs_BenchGeometry( const fs_geometry_t *geometry, uint32_t count );
+
+/**
+ * @brief       Update a counter in the key-value store on the simulated flash, then rebuild its index as after a reset;
+ *              then go round the ring of pages and replay records and compactions cut short by a reset.
+ */
+static void fs_BenchKv( uint32_t count );
+
+/**
+ * @brief       Check that the compaction test keys hold the last values set.
+ * @param[in]   sets        Sets made so far, key FS_BENCH_KV_KEY + n % FS_BENCH_KV_KEYS was given n by the n-th.
+ */
+static void fs_BenchKvCheck( uint32_t sets );
+
+/**
+ * @brief       Let the driver erase ahead as it would while the file system is idle.
+ */
+static void fs_BenchIdle( void );
+
+/**
+ * @brief       Clear the device counters and start timing a test.
+ */
+static void fs_BenchStart( void );
+
+/**
+ * @brief       Print the device counters, CPU time and modelled NVMC time of a test, through the driver and direct.
+ */
+static void fs_BenchStop( const char *name );
+
+/**
+ * @brief       Simulated flash under the driver, with NVMC semantics (a program only clears bits).
+ */
+static void fs_BenchProgram( uint32_t address, const uint32_t *words, uint32_t count );
+static void fs_BenchErase( uint32_t address, uint32_t duration_ms );
+#endif
+
+/**
+ * @brief       Post a request to the file system task.
+ */
+static error_code_module_t fs_Request( fstype_t type, uint32_t sequence, const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length, uint32_t timeout );
+
+/**
+ * @brief       Post a file request to the file system task.
  */
-static void fs_test_nvmc( const struct lfs_config *cfg, const struct lfs_file_config *file_cfg );
+static error_code_module_t fs_FileRequest( fstype_t type, const char *path, uint32_t offset, const uint8_t *data, uint32_t length, fs_done_t done, void *context );
 
 #endif /* __FS_PRIV_H__ */
 
@@ -0,0 +1,546 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      journal.c
+ * @brief     Publish journal module
+ * @details   Keeps undelivered publishes in a littlefs file until they are acknowledged.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Journal Publish journal
+ * @brief     Store-and-forward journal of MQTT publishes
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "journal_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+journal_interface_t journal =
+{
+    .Open               = &journal_Open,
+    .Append             = &journal_Append,
+    .Read               = &journal_Read,
+    .Ack                = &journal_Ack,
+    .Flush              = &journal_Flush,
+    .Report             = &journal_Report,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t journal_Open( journal_t *journal, lfs_t *lfs )
+{
+    error_code_module_t error = NO_ERROR;
+    journal_record_t record;
+    lfs_soff_t size;
+    uint32_t offset, last = 0;
+    int32_t result;
+
+    if ( journal == NULL || lfs == NULL || lfs->cfg->cache_size > JOURNAL_CACHE_MAX )
+    {
+        error = ERROR_JOURNAL_BAD_PARAM;
+    }
+    else
+    {
+        memset( journal, 0, sizeof( journal_t ) );
+        journal->lfs = lfs;
+        journal->file_cfg.buffer = journal->cache[ 0 ];
+        journal->copy_cfg.buffer = journal->cache[ 1 ];
+        journal->next_sequence = 1;
+
+        // Drop a compaction cut short by a reset; the journal itself is still complete
+        lfs_remove( lfs, JOURNAL_TEMP_NAME );
+
+        result = lfs_file_opencfg( lfs, &journal->file, JOURNAL_NAME, LFS_O_RDWR, &journal->file_cfg );
+        if ( result < 0 && result != LFS_ERR_NOENT )
+        {
+            error = ERROR_JOURNAL_FS;
+        }
+        else if ( result >= 0 )
+        {
+            size = lfs_file_size( lfs, &journal->file );
+            if ( lfs_getattr( lfs, JOURNAL_NAME, JOURNAL_ATTR_HEAD, &journal->head, sizeof( journal->head ) ) != sizeof( journal->head ) ||
+                 journal->head > size )
+            {
+                journal->head = 0;
+            }
+
+            // Check the records that are still needed
+            offset = journal->head;
+            lfs_file_seek( lfs, &journal->file, offset, LFS_SEEK_SET );
+            while ( offset < size && journal_ReadRecord( journal, &record, journal->batch, JOURNAL_DATA_MAX ) )
+            {
+                if ( journal->count == 0 )
+                {
+                    journal->head_sequence = record.sequence;
+                }
+                last = record.sequence;
+                journal->count++;
+                offset += JOURNAL_RECORD_SIZE( &record );
+            }
+            if ( offset < size )
+            {
+                Log.ErrorPrint( "Journal cut at %d of %d bytes", offset, size );
+                journal->stats.crc_errors++;
+                lfs_file_truncate( lfs, &journal->file, offset );
+            }
+            lfs_file_close( lfs, &journal->file );
+
+            journal->tail = offset;
+            journal->head_saved = journal->head;
+            if ( journal->count > 0 )
+            {
+                journal->next_sequence = last + 1;
+            }
+        }
+        if ( journal->count == 0 )
+        {
+            journal->head_sequence = journal->next_sequence;
+        }
+        Log.InfoPrint( "Journal opened: %d records", journal->count );
+    }
+
+    return error;
+}
+
+error_code_module_t journal_Append( journal_t *journal, const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length )
+{
+    error_code_module_t error = NO_ERROR;
+    journal_record_t record;
+    uint32_t length = topic_length + payload_length;
+    uint32_t size = sizeof( journal_record_t ) + length;
+    uint32_t head;
+    uint8_t *data;
+
+    if ( journal == NULL || journal->lfs == NULL || length > JOURNAL_DATA_MAX )
+    {
+        return ERROR_JOURNAL_BAD_PARAM;
+    }
+
+    // Make room according to the drop policy, giving up when no record could be dropped
+    while ( error == NO_ERROR && journal->tail - journal->head + journal->batch_used + size > JOURNAL_SIZE_MAX )
+    {
+        if ( JOURNAL_POLICY == journal_drop_newest || journal->count == 0 )
+        {
+            journal->stats.dropped++;
+            error = ERROR_JOURNAL_FULL;
+        }
+        else
+        {
+            // The oldest record can only be dropped once it is in the file
+            if ( journal->head == journal->tail )
+            {
+                error = journal_Flush( journal );
+            }
+            if ( error == NO_ERROR )
+            {
+                head = journal->head;
+                error = journal_Advance( journal, 1 );
+                if ( error == NO_ERROR && journal->head == head )
+                {
+                    error = ERROR_JOURNAL_FS;
+                }
+            }
+        }
+    }
+
+    if ( error == NO_ERROR && journal->batch_used + size > JOURNAL_BATCH_SIZE )
+    {
+        error = journal_Flush( journal );
+    }
+
+    if ( error == NO_ERROR )
+    {
+        if ( journal->batch_used == 0 )
+        {
+            journal->batch_time = os.GetTickCountMs();
+        }
+        record.sequence = journal->next_sequence++;
+        record.topic_length = topic_length;
+        record.payload_length = payload_length;
+        data = &journal->batch[ journal->batch_used + sizeof( journal_record_t ) ];
+        memcpy( data, topic, topic_length );
+        memcpy( &data[ topic_length ], payload, payload_length );
+        record.crc = journal_Crc( &record, data, length );
+        memcpy( &journal->batch[ journal->batch_used ], &record, sizeof( journal_record_t ) );
+        journal->batch_used += size;
+        journal->batch_count++;
+        journal->count++;
+        journal->stats.appended++;
+
+        if ( os.GetTickCountMs() - journal->batch_time >= JOURNAL_FLUSH_MS )
+        {
+            error = journal_Flush( journal );
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t journal_Read( journal_t *journal, uint32_t after, journal_record_t *record, uint8_t *data, uint32_t size )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t offset, bit = 0;
+    bool found = false;
+
+    if ( journal == NULL || journal->lfs == NULL || record == NULL || data == NULL || size < JOURNAL_DATA_MAX )
+    {
+        return ERROR_JOURNAL_BAD_PARAM;
+    }
+
+    // Records in the batch are read from the file like the others
+    if ( journal->batch_used > 0 )
+    {
+        error = journal_Flush( journal );
+    }
+
+    // Continue after the last record read, unless the caller starts over
+    offset = ( journal->cursor_sequence != 0 && journal->cursor_sequence == after + 1 ) ? journal->cursor : journal->head;
+    if ( error == NO_ERROR && offset < journal->tail )
+    {
+        if ( lfs_file_opencfg( journal->lfs, &journal->file, JOURNAL_NAME, LFS_O_RDONLY, &journal->file_cfg ) < 0 )
+        {
+            error = ERROR_JOURNAL_FS;
+        }
+        else
+        {
+            lfs_file_seek( journal->lfs, &journal->file, offset, LFS_SEEK_SET );
+            while ( !found && error == NO_ERROR && offset < journal->tail && bit < JOURNAL_ACK_WINDOW )
+            {
+                if ( !journal_ReadRecord( journal, record, data, JOURNAL_DATA_MAX ) )
+                {
+                    journal->stats.crc_errors++;
+                    error = ERROR_JOURNAL_BAD_CRC;
+                }
+                else
+                {
+                    // Skip records already read or acknowledged; one past the window could not be acknowledged
+                    offset += JOURNAL_RECORD_SIZE( record );
+                    bit = record->sequence - journal->head_sequence;
+                    found = ( record->sequence > after && bit < JOURNAL_ACK_WINDOW && ( ( journal->acked >> bit ) & 1 ) == 0 );
+                }
+            }
+            lfs_file_close( journal->lfs, &journal->file );
+        }
+    }
+
+    if ( found )
+    {
+        journal->cursor = offset;
+        journal->cursor_sequence = record->sequence + 1;
+        journal->stats.read++;
+    }
+    else if ( error == NO_ERROR )
+    {
+        error = ERROR_JOURNAL_EMPTY;
+    }
+
+    return error;
+}
+
+error_code_module_t journal_Ack( journal_t *journal, uint32_t sequence )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t bit;
+
+    if ( journal == NULL || journal->lfs == NULL )
+    {
+        error = ERROR_JOURNAL_BAD_PARAM;
+    }
+    else
+    {
+        bit = sequence - journal->head_sequence;
+        if ( sequence < journal->head_sequence || sequence >= journal->next_sequence || bit >= JOURNAL_ACK_WINDOW )
+        {
+            // The record is read again after a reset
+            Log.ErrorPrint( "Journal ack %d lost, head at %d", sequence, journal->head_sequence );
+            journal->stats.acks_lost++;
+            error = ERROR_JOURNAL_NOT_FOUND;
+        }
+        else
+        {
+            journal->acked |= 1UL << bit;
+            journal->stats.acked++;
+            error = journal_Advance( journal, 0 );
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t journal_Flush( journal_t *journal )
+{
+    error_code_module_t error = NO_ERROR;
+    int32_t result;
+
+    if ( journal == NULL || journal->lfs == NULL )
+    {
+        return ERROR_JOURNAL_BAD_PARAM;
+    }
+
+    // One write and one metadata commit for the whole batch
+    if ( journal->batch_used > 0 )
+    {
+        result = lfs_file_opencfg( journal->lfs,
+                                   &journal->file,
+                                   JOURNAL_NAME,
+                                   LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND,
+                                   &journal->file_cfg );
+        if ( result >= 0 )
+        {
+            result = lfs_file_write( journal->lfs, &journal->file, journal->batch, journal->batch_used );
+            if ( result != ( int32_t )journal->batch_used )
+            {
+                lfs_file_truncate( journal->lfs, &journal->file, journal->tail );
+            }
+            else
+            {
+                result = lfs_file_close( journal->lfs, &journal->file );
+            }
+        }
+
+        if ( result == 0 )
+        {
+            journal->tail += journal->batch_used;
+            journal->stats.flushes++;
+        }
+        else
+        {
+            // Give up the batch rather than retry it forever
+            Log.ErrorPrint( "Journal write failed: %d", result );
+            lfs_file_close( journal->lfs, &journal->file );
+            journal->stats.dropped += journal->batch_count;
+            journal->count -= journal->batch_count;
+            journal->next_sequence -= journal->batch_count;
+            error = ERROR_JOURNAL_FS;
+        }
+        journal->batch_used = 0;
+        journal->batch_count = 0;
+    }
+
+    // Records acknowledged while they were still in the batch
+    if ( error == NO_ERROR )
+    {
+        error = journal_Advance( journal, 0 );
+    }
+    if ( error == NO_ERROR )
+    {
+        error = journal_Compact( journal );
+    }
+    if ( error == NO_ERROR )
+    {
+        journal_SaveHead( journal );
+    }
+
+    return error;
+}
+
+void journal_Report( const journal_t *journal )
+{
+    Log.Print( "Journal: %d records, %d bytes stored, %d bytes in RAM\r\n",
+               journal->count,
+               journal->tail - journal->head + journal->batch_used,
+               journal->batch_used );
+    Log.Print( "Journal: sequence %d to %d, file %d bytes, head at %d\r\n",
+               journal->head_sequence,
+               journal->next_sequence - 1,
+               journal->tail,
+               journal->head );
+    Log.Print( "Journal: %d appended, %d dropped, %d read, %d acknowledged, %d acks lost\r\n",
+               journal->stats.appended,
+               journal->stats.dropped,
+               journal->stats.read,
+               journal->stats.acked,
+               journal->stats.acks_lost );
+    Log.Print( "Journal: %d flushes, %d compactions, %d CRC errors\r\n",
+               journal->stats.flushes,
+               journal->stats.compactions,
+               journal->stats.crc_errors );
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+uint32_t journal_Crc( const journal_record_t *record, const void *data, uint32_t length )
+{
+    uint32_t crc = lfs_crc( JOURNAL_CRC_SEED, record, offsetof( journal_record_t, crc ) );
+
+    return lfs_crc( crc, data, length );
+}
+
+bool journal_ReadRecord( journal_t *journal, journal_record_t *record, uint8_t *data, uint32_t size )
+{
+    uint32_t length;
+    bool valid = ( lfs_file_read( journal->lfs, &journal->file, record, sizeof( journal_record_t ) ) == sizeof( journal_record_t ) );
+
+    if ( valid )
+    {
+        length = record->topic_length + record->payload_length;
+        valid = ( length <= size &&
+                  lfs_file_read( journal->lfs, &journal->file, data, length ) == ( lfs_ssize_t )length &&
+                  journal_Crc( record, data, length ) == record->crc );
+    }
+
+    return valid;
+}
+
+error_code_module_t journal_Advance( journal_t *journal, uint32_t drop )
+{
+    error_code_module_t error = NO_ERROR;
+    journal_record_t record;
+
+    // Move head past the acknowledged records at the front, and past drop more records
+    if ( journal->head < journal->tail && ( ( journal->acked & 1 ) != 0 || drop > 0 ) )
+    {
+        if ( lfs_file_opencfg( journal->lfs, &journal->file, JOURNAL_NAME, LFS_O_RDONLY, &journal->file_cfg ) < 0 )
+        {
+            error = ERROR_JOURNAL_FS;
+        }
+        else
+        {
+            lfs_file_seek( journal->lfs, &journal->file, journal->head, LFS_SEEK_SET );
+            while ( journal->head < journal->tail && ( ( journal->acked & 1 ) != 0 || drop > 0 ) )
+            {
+                // A record that cannot be read, or runs past tail, would keep head where it is
+                if ( lfs_file_read( journal->lfs, &journal->file, &record, sizeof( record ) ) != sizeof( record ) ||
+                     ( uint32_t )record.topic_length + record.payload_length > JOURNAL_DATA_MAX ||
+                     JOURNAL_RECORD_SIZE( &record ) > journal->tail - journal->head )
+                {
+                    error = ERROR_JOURNAL_FS;
+                    break;
+                }
+                if ( ( journal->acked & 1 ) == 0 )
+                {
+                    drop--;
+                    journal->stats.dropped++;
+                }
+                journal->head += JOURNAL_RECORD_SIZE( &record );
+                journal->head_sequence++;
+                journal->acked >>= 1;
+                journal->count--;
+                lfs_file_seek( journal->lfs, &journal->file, journal->head, LFS_SEEK_SET );
+            }
+            lfs_file_close( journal->lfs, &journal->file );
+        }
+
+        // The record after the last one read is gone
+        if ( journal->cursor_sequence != 0 && journal->cursor < journal->head )
+        {
+            journal->cursor_sequence = 0;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t journal_Compact( journal_t *journal )
+{
+    error_code_module_t error = NO_ERROR;
+    uint32_t offset, length;
+    int32_t result;
+
+    if ( journal->head > 0 && journal->head == journal->tail && journal->batch_used == 0 )
+    {
+        // Everything was delivered
+        result = lfs_remove( journal->lfs, JOURNAL_NAME );
+        if ( result == 0 || result == LFS_ERR_NOENT )
+        {
+            journal->head = 0;
+            journal->tail = 0;
+            journal->head_saved = 0;
+            journal->cursor_sequence = 0;
+        }
+        else
+        {
+            error = ERROR_JOURNAL_FS;
+        }
+    }
+    else if ( journal->head >= JOURNAL_SIZE_MAX / 2 && journal->batch_used == 0 )
+    {
+        // Copy the records still needed to a new file, using the empty batch as buffer
+        result = lfs_file_opencfg( journal->lfs, &journal->file, JOURNAL_NAME, LFS_O_RDONLY, &journal->file_cfg );
+        if ( result >= 0 )
+        {
+            result = lfs_file_opencfg( journal->lfs,
+                                       &journal->copy,
+                                       JOURNAL_TEMP_NAME,
+                                       LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC,
+                                       &journal->copy_cfg );
+            if ( result >= 0 )
+            {
+                lfs_file_seek( journal->lfs, &journal->file, journal->head, LFS_SEEK_SET );
+                for ( offset = journal->head; offset < journal->tail && result >= 0; offset += length )
+                {
+                    length = journal->tail - offset;
+                    if ( length > JOURNAL_BATCH_SIZE )
+                    {
+                        length = JOURNAL_BATCH_SIZE;
+                    }
+                    result = lfs_file_read( journal->lfs, &journal->file, journal->batch, length );
+                    if ( result == ( int32_t )length )
+                    {
+                        result = lfs_file_write( journal->lfs, &journal->copy, journal->batch, length );
+                    }
+                    if ( result != ( int32_t )length )
+                    {
+                        result = LFS_ERR_IO;
+                    }
+                }
+                if ( lfs_file_close( journal->lfs, &journal->copy ) < 0 )
+                {
+                    result = LFS_ERR_IO;
+                }
+            }
+            lfs_file_close( journal->lfs, &journal->file );
+        }
+
+        // Renaming replaces the journal in one step
+        if ( result >= 0 )
+        {
+            result = lfs_rename( journal->lfs, JOURNAL_TEMP_NAME, JOURNAL_NAME );
+        }
+        if ( result >= 0 )
+        {
+            journal->tail -= journal->head;
+            journal->cursor -= journal->head;
+            journal->head = 0;
+            journal->head_saved = 0;
+            journal->stats.compactions++;
+        }
+        else
+        {
+            Log.ErrorPrint( "Journal compaction failed: %d", result );
+            lfs_remove( journal->lfs, JOURNAL_TEMP_NAME );
+            error = ERROR_JOURNAL_FS;
+        }
+    }
+
+    return error;
+}
+
+void journal_SaveHead( journal_t *journal )
+{
+    if ( journal->head != journal->head_saved && journal->tail > 0 &&
+         lfs_setattr( journal->lfs, JOURNAL_NAME, JOURNAL_ATTR_HEAD, &journal->head, sizeof( journal->head ) ) == 0 )
+    {
+        journal->head_saved = journal->head;
+    }
+}
+
+/**
+ * @} Journal
+ */
+
+/**
+ * @} Application
+ */
@@ -0,0 +1,148 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      journal.h
+ * @brief     Publish journal module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Journal
+ * @{
+ */
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <lfs.h>
+#include "os.h"
+#include "app.h"
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define JOURNAL_NAME                    "journal"
+#define JOURNAL_DATA_MAX                ( SHORT_MSG_MAX )   /*!< longest topic plus payload of a record */
+#ifndef JOURNAL_CACHE_MAX
+#define JOURNAL_CACHE_MAX               ( 64 )          /*!< largest littlefs cache size supported */
+#endif
+#define JOURNAL_ACK_WINDOW              ( 32 )          /*!< records past the oldest one that may be acknowledged first */
+
+#ifndef JOURNAL_SIZE_MAX
+#define JOURNAL_SIZE_MAX                ( 16384 )       /*!< bytes of records kept before the drop policy applies */
+#endif
+
+#ifndef JOURNAL_POLICY
+#define JOURNAL_POLICY                  ( journal_drop_oldest ) /*!< record given up when the journal is full */
+#endif
+
+#ifndef JOURNAL_BATCH_SIZE
+#define JOURNAL_BATCH_SIZE              ( 256 )         /*!< bytes of new records collected in RAM per flash write */
+#endif
+
+#ifndef JOURNAL_FLUSH_MS
+#define JOURNAL_FLUSH_MS                ( 2000 )        /*!< longest time a new record waits in RAM */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Record given up when a new record does not fit.
+ */
+typedef enum
+{
+    journal_drop_oldest,
+    journal_drop_newest,
+} journal_policy_t;
+
+/**
+ * @brief Record header, followed in the file by topic and payload.
+ */
+typedef struct
+{
+    uint32_t                    sequence;
+    uint16_t                    topic_length;
+    uint16_t                    payload_length;
+    uint32_t                    crc;            /*!< CRC-32 of the fields above, topic and payload */
+} journal_record_t;
+
+typedef struct
+{
+    uint32_t                    appended;
+    uint32_t                    dropped;        /*!< records given up by the drop policy */
+    uint32_t                    read;
+    uint32_t                    acked;
+    uint32_t                    acks_lost;      /*!< acknowledgements of records no longer or not yet in the window */
+    uint32_t                    flushes;        /*!< batches written */
+    uint32_t                    compactions;
+    uint32_t                    crc_errors;
+} journal_stats_t;
+
+/**
+ * @brief Journal state. The file holds records from head to tail; records after tail are still in the batch.
+ */
+typedef struct
+{
+    lfs_t                       *lfs;
+    lfs_file_t                  file;
+    lfs_file_t                  copy;           /*!< target of a compaction */
+    struct lfs_file_config      file_cfg;
+    struct lfs_file_config      copy_cfg;
+    uint8_t                     cache[ 2 ][ JOURNAL_CACHE_MAX ];
+    uint32_t                    head;           /*!< file offset of the oldest record kept */
+    uint32_t                    head_sequence;  /*!< sequence of the record at head */
+    uint32_t                    head_saved;     /*!< head as last stored with the file */
+    uint32_t                    tail;           /*!< file size */
+    uint32_t                    next_sequence;
+    uint32_t                    count;          /*!< records kept, including the batch */
+    uint32_t                    acked;          /*!< acknowledged records, bit 0 is the record at head */
+    uint32_t                    cursor;         /*!< file offset of the record after the last one read */
+    uint32_t                    cursor_sequence;/*!< sequence after the last one read, 0 when cursor is not valid */
+    uint8_t                     batch[ JOURNAL_BATCH_SIZE ];
+    uint32_t                    batch_used;
+    uint32_t                    batch_count;
+    uint32_t                    batch_time;     /*!< time the oldest record in the batch was added */
+    journal_stats_t             stats;
+} journal_t;
+
+/**
+ * Specifies the public interface functions of the publish journal.
+ */
+typedef struct
+{
+    error_code_module_t ( *Open )( journal_t *journal, lfs_t *lfs );
+    error_code_module_t ( *Append )( journal_t *journal, const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length );
+    error_code_module_t ( *Read )( journal_t *journal, uint32_t after, journal_record_t *record, uint8_t *data, uint32_t size );
+    error_code_module_t ( *Ack )( journal_t *journal, uint32_t sequence );
+    error_code_module_t ( *Flush )( journal_t *journal );
+    void ( *Report )( const journal_t *journal );
+} const journal_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern journal_interface_t journal;
+
+#endif /* __JOURNAL_H__ */
+
+/**
+ * @} Journal
+ */
+
+/**
+ * @} Applicaton
+ */
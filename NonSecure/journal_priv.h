@@ -0,0 +1,127 @@
+/** @file journal_priv.h
+ *
+ * @brief       Publish journal module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Journal
+ * @{
+ */
+
+#ifndef __JOURNAL_PRIV_H__
+#define __JOURNAL_PRIV_H__
+
+/*
+ * @note
+ * Publishes that could not be delivered are kept in one append-only littlefs file. Each record carries a sequence
+ * number and a CRC over header, topic and payload. New records are collected in RAM and written in one file write per
+ * batch: when the batch is full, when its oldest record is JOURNAL_FLUSH_MS old, before a read, and when the file
+ * system task is idle. Records still in the batch are lost on power failure.
+ *
+ * Records are read back in order from head, but no further than JOURNAL_ACK_WINDOW records past it, so that every
+ * record handed out can be acknowledged. An acknowledged record is only marked; head moves past the oldest records
+ * once they are all acknowledged, and its offset is stored as an attribute of the file when the journal is flushed.
+ * After a reset, records acknowledged since then are read again, so delivery is at least once. The space before head is
+ * given back by copying the rest of the file to a new one once head passes half of JOURNAL_SIZE_MAX, or by removing the
+ * file when every record is acknowledged. When a new record does not fit, JOURNAL_POLICY either drops the oldest
+ * records or refuses the new one.
+ *
+ * On open the records from head are checked, and the file is cut off at the first record that is incomplete or fails
+ * its CRC. The journal does not lock: it belongs to the file system task.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "journal.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define JOURNAL_TEMP_NAME           JOURNAL_NAME ".tmp"
+#define JOURNAL_ATTR_HEAD           ( 0x48 )        /*!< littlefs attribute type holding head */
+#define JOURNAL_CRC_SEED            ( 0xffffffff )
+#define JOURNAL_RECORD_SIZE( r )    ( sizeof( journal_record_t ) + ( r )->topic_length + ( r )->payload_length )
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Open the journal on a mounted file system and check the stored records.
+ * @param[out]  journal     Journal state.
+ * @param[in]   lfs         Mounted file system.
+ * @return      Error code.
+ */
+static error_code_module_t journal_Open( journal_t *journal, lfs_t *lfs );
+
+/**
+ * @brief       Add a record. It is written to flash with the next batch.
+ * @param[in]   journal     Journal state.
+ * @param[in]   topic       Topic name.
+ * @param[in]   topic_length Length of topic.
+ * @param[in]   payload     Message payload.
+ * @param[in]   payload_length Length of payload.
+ * @return      Error code, ERROR_JOURNAL_FULL when the drop policy refused the record.
+ */
+static error_code_module_t journal_Append( journal_t *journal, const char *topic, uint16_t topic_length, const uint8_t *payload, uint16_t payload_length );
+
+/**
+ * @brief       Read the oldest record after a given sequence that is not acknowledged.
+ * @param[in]   journal     Journal state.
+ * @param[in]   after       Sequence of the previous record read, 0 to start at the oldest record.
+ * @param[out]  record      Record header.
+ * @param[out]  data        Topic followed by payload.
+ * @param[in]   size        Size of data.
+ * @return      Error code, ERROR_JOURNAL_EMPTY when there is no such record within JOURNAL_ACK_WINDOW of head.
+ */
+static error_code_module_t journal_Read( journal_t *journal, uint32_t after, journal_record_t *record, uint8_t *data, uint32_t size );
+
+/**
+ * @brief       Mark a record delivered, so its space can be reused.
+ * @param[in]   journal     Journal state.
+ * @param[in]   sequence    Sequence of the record.
+ * @return      Error code.
+ */
+static error_code_module_t journal_Ack( journal_t *journal, uint32_t sequence );
+
+/**
+ * @brief       Write the batch, store head and give back space of acknowledged records.
+ * @param[in]   journal     Journal state.
+ * @return      Error code.
+ */
+static error_code_module_t journal_Flush( journal_t *journal );
+
+/**
+ * @brief       Print journal usage.
+ * @param[in]   journal     Journal state.
+ */
+static void journal_Report( const journal_t *journal );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static uint32_t journal_Crc( const journal_record_t *record, const void *data, uint32_t length );
+static bool journal_ReadRecord( journal_t *journal, journal_record_t *record, uint8_t *data, uint32_t size );
+static error_code_module_t journal_Advance( journal_t *journal, uint32_t drop );
+static error_code_module_t journal_Compact( journal_t *journal );
+static void journal_SaveHead( journal_t *journal );
+
+#endif /* __JOURNAL_PRIV_H__ */
+
+/**
+ * @}
+ */
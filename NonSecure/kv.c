@@ -0,0 +1,370 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      kv.c
+ * @brief     Key-value store module
+ * @details   Log of small records on NVMC pages of their own, with a RAM index and compaction into a ring of pages.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Kv Key-value store
+ * @brief     Counters and settings, one word aligned program per update
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "kv_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+kv_interface_t kv =
+{
+    .Open               = &kv_Open,
+    .Get                = &kv_Get,
+    .Set                = &kv_Set,
+    .Delete             = &kv_Delete,
+    .Compact            = &kv_Compact,
+    .Idle               = &kv_Idle,
+    .Report             = &kv_Report,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t kv_Open( kv_store_t *store, nvmc_device_t *device )
+{
+    const kv_page_t *header;
+    uint32_t page, word, length;
+    int32_t active = -1;
+
+    if ( store == NULL || device == NULL || device->block_count < 2 || device->block_size > 0x10000 )
+    {
+        return ERROR_KV_BAD_PARAM;
+    }
+
+    memset( store, 0, sizeof( kv_store_t ) );
+    store->device = device;
+    for ( page = 0; page < device->block_count; page++ )
+    {
+        header = ( const kv_page_t * )kv_Address( store, page, 0 );
+        if ( header->magic == KV_MAGIC && ( active < 0 || header->sequence > store->sequence ) )
+        {
+            active = page;
+            store->sequence = header->sequence;
+        }
+    }
+
+    if ( active < 0 )
+    {
+        // A compaction of nothing from the last page starts the ring at the first one
+        Log.InfoPrint( "Formatting key-value store" );
+        store->page = device->block_count - 1;
+        return kv_Compact( store );
+    }
+
+    // The last record of a key wins
+    store->page = active;
+    for ( store->head = KV_HEADER_SIZE; store->head + sizeof( uint32_t ) <= device->block_size; )
+    {
+        word = *( const uint32_t * )kv_Address( store, store->page, store->head );
+        if ( word == KV_ERASED_WORD )
+        {
+            break;
+        }
+
+        length = KV_LENGTH( word );
+        if ( length > KV_VALUE_MAX || store->head + KV_RECORD_SIZE( length ) > device->block_size )
+        {
+            // Not written by Set, so nothing after it can be found; the next Set compacts
+            store->stats.crc_errors++;
+            store->head = device->block_size;
+            break;
+        }
+        if ( KV_CHECK( word ) != kv_Check( KV_KEY( word ), length, ( const void * )kv_Address( store, store->page, store->head + sizeof( uint32_t ) ) ) )
+        {
+            store->stats.crc_errors++;
+        }
+        else if ( !kv_Index( store, KV_KEY( word ), length, store->head ) )
+        {
+            Log.ErrorPrint( "Key %d dropped, index full", KV_KEY( word ) );
+        }
+        store->head += KV_RECORD_SIZE( length );
+    }
+
+    return NO_ERROR;
+}
+
+error_code_module_t kv_Get( kv_store_t *store, uint16_t key, void *value, uint32_t size, uint32_t *length )
+{
+    const kv_slot_t *slot = kv_Slot( store, key );
+    uint32_t address, word;
+
+    if ( slot == NULL )
+    {
+        return ERROR_KV_NOT_FOUND;
+    }
+
+    // The index points at the record, the value is read where it is
+    address = kv_Address( store, store->page, slot->offset );
+    word = *( const uint32_t * )address;
+    if ( value == NULL || KV_LENGTH( word ) > size )
+    {
+        return ERROR_KV_BAD_PARAM;
+    }
+    memcpy( value, ( const void * )( address + sizeof( uint32_t ) ), KV_LENGTH( word ) );
+    if ( length != NULL )
+    {
+        *length = KV_LENGTH( word );
+    }
+
+    return NO_ERROR;
+}
+
+error_code_module_t kv_Set( kv_store_t *store, uint16_t key, const void *value, uint32_t length )
+{
+    const kv_slot_t *slot = kv_Slot( store, key );
+    error_code_module_t error = NO_ERROR;
+    uint32_t address;
+
+    if ( value == NULL || length == 0 || length > KV_VALUE_MAX || key == KV_KEY( KV_ERASED_WORD ) )
+    {
+        error = ERROR_KV_BAD_PARAM;
+    }
+    else if ( slot == NULL && store->count >= KV_KEYS_MAX )
+    {
+        error = ERROR_KV_FULL;
+    }
+    else
+    {
+        if ( slot != NULL )
+        {
+            address = kv_Address( store, store->page, slot->offset );
+            if ( KV_LENGTH( *( const uint32_t * )address ) == length &&
+                 memcmp( ( const void * )( address + sizeof( uint32_t ) ), value, length ) == 0 )
+            {
+                store->stats.unchanged++;
+                return NO_ERROR;
+            }
+        }
+
+        error = kv_Append( store, key, value, length );
+        if ( error == NO_ERROR )
+        {
+            store->stats.sets++;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t kv_Delete( kv_store_t *store, uint16_t key )
+{
+    error_code_module_t error = ERROR_KV_NOT_FOUND;
+
+    if ( kv_Slot( store, key ) != NULL )
+    {
+        error = kv_Append( store, key, NULL, 0 );
+        if ( error == NO_ERROR )
+        {
+            store->stats.deletes++;
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t kv_Compact( kv_store_t *store )
+{
+    nvmc_device_t *device = store->device;
+    const kv_page_t header = { .magic = KV_MAGIC, .sequence = store->sequence + 1 };
+    uint32_t next = ( store->page + 1 ) % device->block_count;
+    uint32_t i, head = KV_HEADER_SIZE, size;
+    kv_slot_t *slot;
+
+    if ( nvmc.Erase( device, next ) < 0 )
+    {
+        return ERROR_KV_GENERAL;
+    }
+
+    // The records first and the header last, so a reset on the way leaves the old page in charge
+    for ( i = 0; i < store->count; i++ )
+    {
+        slot = &store->index[ i ];
+        size = KV_RECORD_SIZE( KV_LENGTH( *( const uint32_t * )kv_Address( store, store->page, slot->offset ) ) );
+        if ( nvmc.Prog( device, next, head, ( const void * )kv_Address( store, store->page, slot->offset ), size ) < 0 )
+        {
+            return ERROR_KV_GENERAL;
+        }
+        head += size;
+    }
+    if ( nvmc.Prog( device, next, 0, &header, sizeof( header ) ) < 0 )
+    {
+        return ERROR_KV_GENERAL;
+    }
+
+    // Now the new page holds the latest records in index order
+    head = KV_HEADER_SIZE;
+    for ( i = 0; i < store->count; i++ )
+    {
+        slot = &store->index[ i ];
+        size = KV_RECORD_SIZE( KV_LENGTH( *( const uint32_t * )kv_Address( store, store->page, slot->offset ) ) );
+        slot->offset = head;
+        head += size;
+    }
+    store->stats.copied += store->count;
+    store->stats.compactions++;
+    store->page = next;
+    store->sequence = header.sequence;
+    store->head = head;
+
+    return NO_ERROR;
+}
+
+bool kv_Idle( kv_store_t *store )
+{
+    uint32_t i, live = KV_HEADER_SIZE;
+
+    if ( store->device->block_size - store->head >= KV_COMPACT_FREE )
+    {
+        return false;
+    }
+
+    // Only worth an erase when it gives room back
+    for ( i = 0; i < store->count; i++ )
+    {
+        live += KV_RECORD_SIZE( KV_LENGTH( *( const uint32_t * )kv_Address( store, store->page, store->index[ i ].offset ) ) );
+    }
+
+    return live < store->head && kv_Compact( store ) == NO_ERROR;
+}
+
+void kv_Report( const kv_store_t *store )
+{
+    Log.Print( "KV: %d keys, page %d of %d, sequence %d, %d of %d bytes used\r\n",
+               store->count,
+               store->page,
+               store->device->block_count,
+               store->sequence,
+               store->head,
+               store->device->block_size );
+    Log.Print( "KV: %d sets, %d unchanged, %d deletes, %d compactions moving %d records, %d records skipped\r\n",
+               store->stats.sets,
+               store->stats.unchanged,
+               store->stats.deletes,
+               store->stats.compactions,
+               store->stats.copied,
+               store->stats.crc_errors );
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+error_code_module_t kv_Append( kv_store_t *store, uint16_t key, const void *value, uint32_t length )
+{
+    uint32_t record[ 1 + KV_VALUE_MAX / sizeof( uint32_t ) ];
+    uint32_t size = KV_RECORD_SIZE( length );
+    error_code_module_t error = NO_ERROR;
+
+    if ( store->head + size > store->device->block_size )
+    {
+        if ( ( error = kv_Compact( store ) ) != NO_ERROR )
+        {
+            return error;
+        }
+        if ( store->head + size > store->device->block_size )
+        {
+            return ERROR_KV_FULL;
+        }
+    }
+
+    // Header and value in one program
+    memset( record, 0xff, sizeof( record ) );
+    record[ 0 ] = KV_WORD( key, length, kv_Check( key, length, value ) );
+    if ( length > 0 )
+    {
+        memcpy( &record[ 1 ], value, length );
+    }
+    if ( nvmc.Prog( store->device, store->page, store->head, record, size ) < 0 )
+    {
+        return ERROR_KV_GENERAL;
+    }
+
+    kv_Index( store, key, length, store->head );
+    store->head += size;
+
+    return error;
+}
+
+bool kv_Index( kv_store_t *store, uint16_t key, uint32_t length, uint32_t offset )
+{
+    kv_slot_t *slot = kv_Slot( store, key );
+
+    if ( length == 0 )
+    {
+        if ( slot != NULL )
+        {
+            *slot = store->index[ --store->count ];
+        }
+        return true;
+    }
+
+    if ( slot == NULL )
+    {
+        if ( store->count >= KV_KEYS_MAX )
+        {
+            return false;
+        }
+        slot = &store->index[ store->count++ ];
+        slot->key = key;
+    }
+    slot->offset = ( uint16_t )offset;
+
+    return true;
+}
+
+kv_slot_t *kv_Slot( const kv_store_t *store, uint16_t key )
+{
+    for ( uint32_t i = 0; i < store->count; i++ )
+    {
+        if ( store->index[ i ].key == key )
+        {
+            return ( kv_slot_t * )&store->index[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+uint32_t kv_Address( const kv_store_t *store, uint32_t page, uint32_t offset )
+{
+    return store->device->base + page * store->device->block_size + offset;
+}
+
+uint8_t kv_Check( uint16_t key, uint32_t length, const void *value )
+{
+    uint8_t bytes[ 3 ] = { ( uint8_t )key, ( uint8_t )( key >> 8 ), ( uint8_t )length };
+    uint32_t crc = lfs_crc( KV_CRC_SEED, bytes, sizeof( bytes ) );
+
+    if ( length > 0 )
+    {
+        crc = lfs_crc( crc, value, length );
+    }
+
+    return ( uint8_t )crc;
+}
+
+/**
+ * @} Kv
+ */
+
+/**
+ * @} Application
+ */
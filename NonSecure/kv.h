@@ -0,0 +1,109 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      kv.h
+ * @brief     Key-value store module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Kv
+ * @{
+ */
+#ifndef __KV_H__
+#define __KV_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <lfs.h>
+#include "os.h"
+#include "log.h"
+#include "nvmc.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define KV_VALUE_MAX                    ( 16 )          /*!< longest value, a multiple of a word */
+
+#ifndef KV_KEYS_MAX
+#define KV_KEYS_MAX                     ( 16 )          /*!< keys the RAM index holds */
+#endif
+
+#ifndef KV_COMPACT_FREE
+#define KV_COMPACT_FREE                 ( 512 )         /*!< bytes left in the page below which an idle store compacts */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Where the latest record of a key is.
+ */
+typedef struct
+{
+    uint16_t                    key;
+    uint16_t                    offset;         /*!< of the record in the active page */
+} kv_slot_t;
+
+typedef struct
+{
+    uint32_t                    sets;           /*!< records written */
+    uint32_t                    unchanged;      /*!< sets of the value a key had, not written */
+    uint32_t                    deletes;
+    uint32_t                    compactions;
+    uint32_t                    copied;         /*!< records moved by compactions */
+    uint32_t                    crc_errors;     /*!< records skipped by Open */
+} kv_stats_t;
+
+/**
+ * @brief Store state, owned by the task that owns the pages.
+ */
+typedef struct
+{
+    nvmc_device_t               *device;        /*!< pages of the store, in a ring */
+    uint32_t                    page;           /*!< active page */
+    uint32_t                    sequence;       /*!< of the active page, one up per compaction */
+    uint32_t                    head;           /*!< offset of the next record in the active page */
+    uint32_t                    count;          /*!< keys in the index */
+    kv_slot_t                   index[ KV_KEYS_MAX ];
+    kv_stats_t                  stats;
+} kv_store_t;
+
+/**
+ * Specifies the public interface functions of the key-value store.
+ */
+typedef struct
+{
+    error_code_module_t ( *Open )( kv_store_t *store, nvmc_device_t *device );
+    error_code_module_t ( *Get )( kv_store_t *store, uint16_t key, void *value, uint32_t size, uint32_t *length );
+    error_code_module_t ( *Set )( kv_store_t *store, uint16_t key, const void *value, uint32_t length );
+    error_code_module_t ( *Delete )( kv_store_t *store, uint16_t key );
+    error_code_module_t ( *Compact )( kv_store_t *store );
+    bool ( *Idle )( kv_store_t *store );
+    void ( *Report )( const kv_store_t *store );
+} const kv_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern kv_interface_t kv;
+
+#endif /* __KV_H__ */
+
+/**
+ * @} Kv
+ */
+
+/**
+ * @} Applicaton
+ */
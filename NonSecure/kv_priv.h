@@ -0,0 +1,171 @@
+/** @file kv_priv.h
+ *
+ * @brief       Key-value store module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Kv
+ * @{
+ */
+
+#ifndef __KV_PRIV_H__
+#define __KV_PRIV_H__
+
+/*
+ * @note
+ * Small values (counters, settings) kept as a log of records in NVMC pages of their own. A record is a header word
+ * (key, value length and a check byte over both and the value) followed by the value padded to whole words, so setting
+ * a 4 byte value is one program of two words through the nvmc driver: no file to open, no metadata to commit, no erase.
+ * A RAM index holds the offset of the latest record of each key, so a lookup is a search of KV_KEYS_MAX slots and a
+ * read of mapped flash. A record of length 0 deletes its key. Setting the value a key already has writes nothing.
+ *
+ * Only one page is active. When a record does not fit, or when the store is idle and less than KV_COMPACT_FREE bytes
+ * are left, the latest record of each key is copied to the next page of the ring and that page becomes the active
+ * one; going round the ring spreads the erases over all pages. A page starts with a header (magic and sequence) that is
+ * programmed only after the records were copied, so a reset during a compaction leaves the new page without a header
+ * and the old one active. Open takes the page with the highest sequence and replays its records into the index;
+ * a record that fails its check byte (a reset while it was programmed) is skipped. Every word is programmed once
+ * between erases.
+ *
+ * The store state belongs to the task that owns the pages; the module does not lock.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "kv.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define KV_MAGIC                ( 0x4b565354 )          /*!< "KVST" */
+#define KV_ERASED_WORD          ( 0xffffffff )
+#define KV_CRC_SEED             ( 0xffffffff )
+#define KV_HEADER_SIZE          ( sizeof( kv_page_t ) )
+#define KV_RECORD_SIZE( n )     ( sizeof( uint32_t ) + ( ( ( n ) + 3 ) & ~3U ) )
+#define KV_WORD( key, length, check ) ( ( uint32_t )( key ) | ( ( uint32_t )( length ) << 16 ) | ( ( uint32_t )( check ) << 24 ) )
+#define KV_KEY( word )          ( ( uint16_t )( ( word ) & 0xffff ) )
+#define KV_LENGTH( word )       ( ( ( word ) >> 16 ) & 0xff )
+#define KV_CHECK( word )        ( ( uint8_t )( ( word ) >> 24 ) )
+
+#if ( KV_VALUE_MAX % 4 ) != 0 || KV_VALUE_MAX > 255
+#error "KV_VALUE_MAX must be a multiple of 4 below 256"
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/**
+ * @brief Page header, programmed once the page holds the records copied into it.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t sequence;
+} kv_page_t;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Find the active page and build the index, formatting the store when no page is valid.
+ * @param[out]  store       Store state.
+ * @param[in]   device      Opened device over the pages of the store, two at least.
+ * @return      Error code.
+ */
+static error_code_module_t kv_Open( kv_store_t *store, nvmc_device_t *device );
+
+/**
+ * @brief       Read the value of a key.
+ * @param[in]   store       Store state.
+ * @param[in]   key         Key.
+ * @param[out]  value       Value.
+ * @param[in]   size        Size of value.
+ * @param[out]  length      Bytes of the value, may be NULL.
+ * @return      Error code, ERROR_KV_NOT_FOUND when the key has no value.
+ */
+static error_code_module_t kv_Get( kv_store_t *store, uint16_t key, void *value, uint32_t size, uint32_t *length );
+
+/**
+ * @brief       Set the value of a key with one record.
+ * @param[in]   store       Store state.
+ * @param[in]   key         Key.
+ * @param[in]   value       Value.
+ * @param[in]   length      Bytes of the value, 1 to KV_VALUE_MAX.
+ * @return      Error code, ERROR_KV_FULL when the index has no room for a new key.
+ */
+static error_code_module_t kv_Set( kv_store_t *store, uint16_t key, const void *value, uint32_t length );
+
+/**
+ * @brief       Remove a key.
+ * @param[in]   store       Store state.
+ * @param[in]   key         Key.
+ * @return      Error code, ERROR_KV_NOT_FOUND when the key has no value.
+ */
+static error_code_module_t kv_Delete( kv_store_t *store, uint16_t key );
+
+/**
+ * @brief       Copy the latest records to the next page of the ring and make it the active one.
+ * @param[in]   store       Store state.
+ * @return      Error code.
+ */
+static error_code_module_t kv_Compact( kv_store_t *store );
+
+/**
+ * @brief       Compact when little room is left, for a task that has nothing else to do.
+ * @param[in]   store       Store state.
+ * @return      True when it compacted.
+ */
+static bool kv_Idle( kv_store_t *store );
+
+/**
+ * @brief       Print usage and counters.
+ * @param[in]   store       Store state.
+ */
+static void kv_Report( const kv_store_t *store );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+/**
+ * @brief       Append a record to the active page, compacting first when it does not fit.
+ */
+static error_code_module_t kv_Append( kv_store_t *store, uint16_t key, const void *value, uint32_t length );
+
+/**
+ * @brief       Point the index at a record, or drop the key for a record of length 0.
+ * @return      False when a new key does not fit in the index.
+ */
+static bool kv_Index( kv_store_t *store, uint16_t key, uint32_t length, uint32_t offset );
+
+/**
+ * @brief       Slot of a key, NULL when the key has no value.
+ */
+static kv_slot_t *kv_Slot( const kv_store_t *store, uint16_t key );
+
+/**
+ * @brief       Address of a byte of a page.
+ */
+static uint32_t kv_Address( const kv_store_t *store, uint32_t page, uint32_t offset );
+
+/**
+ * @brief       Check byte of a record.
+ */
+static uint8_t kv_Check( uint16_t key, uint32_t length, const void *value );
+
+#endif /* __KV_PRIV_H__ */
+
+/**
+ * @}
+ */
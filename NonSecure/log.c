@@ -51,7 +51,7 @@ log_obj_t log_obj =
 void log_Thread( void *parameter_ptr )
 {
     uint32_t i;
-    log_qmessage_t msg;
+    log_qmessage_t *msg;
     TickType_t msg_time = os.Ticks2Ms( os.GetTickCount() );
     char time_buf[128];
 
@@ -67,6 +67,13 @@ void log_Thread( void *parameter_ptr )
             os.GetTaskName( os.GetTaskHandle() ),                  // Task name
             time_buf,                                              // Timestamp
             "Log task started" );                                  // Message
+    if ( ( ( shared_struct_t *)shared_mem )->log_early_drops != 0 )
+    {
+        printf( "[%-12s] <%s>: %d messages logged before the log mailbox existed were dropped\r\n",
+                os.GetTaskName( os.GetTaskHandle() ),
+                time_buf,
+                ( ( shared_struct_t *)shared_mem )->log_early_drops );
+    }
 
     for( ; ; )
     {
@@ -76,40 +83,43 @@ void log_Thread( void *parameter_ptr )
          * The period will be indefinite if INCLUDE_vTaskSuspend is set to 1 in
          * FreeRTOSConfig.h.
          */
-        if( os.QueueReceive( app.GetLogHandle(), &msg, os.Ms2Ticks( TWDT_KICK_TIME ) ) )
+        if( ( msg = OS_MAILBOX_RECEIVE( app.GetLogHandle(), log_qmessage_t, TWDT_KICK_TIME ) ) != NULL )
         {
-            switch ( msg.log_level )
+            switch ( msg->log_level )
             {
             case loglevel_char:
-                putchar( msg.data[ 0 ] );
+                putchar( msg->data[ 0 ] );
                 break;
 
             case loglevel_force:
-                printf( "%s", msg.data );
+                printf( "%s", msg->data );
                 break;
 
             case loglevel_task:
-                log_obj.task_list.type = msg.task_list.type;
+                log_obj.task_list.type = msg->task_list.type;
                 for ( i = 0; i < LOG_MAX_LIST; i++ )
                 {
-                    log_obj.task_list.handle[ i ] = msg.task_list.handle[ i ];
+                    log_obj.task_list.handle[ i ] = msg->task_list.handle[ i ];
                 }
                 break;
 
             default:
                 /* xLogMessage now contains the received data. */
-                msg_time = os.Ticks2Ms( msg.ticks );
+                msg_time = os.Ticks2Ms( msg->ticks );
 
                 if ( log_Show( msg ) )
                 {
                     log_GetTimestamp( msg_time, time_buf );
                     printf( "[%-12s] <%s>: %s\r\n",
-                            os.GetTaskName( msg.handle ),               // Task name
+                            os.GetTaskName( msg->handle ),               // Task name
                             time_buf,                                   // Timestamp
-                            msg.data );                                 // Message
+                            msg->data );                                 // Message
                 }
                 break;
             }
+
+            /* Return message buffer to the mailbox */
+            os.MailboxFree( app.GetLogHandle(), msg );
         }
     }
 }
@@ -128,7 +138,7 @@ error_code_module_t log_Init( void )
     {
         /* Set up log task */
         shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-        shared_struct->log_queue = os.CreateQueue( QUEUE_LEN_LONG, sizeof( log_qmessage_t ) );
+        shared_struct->log_queue = OS_CREATE_MAILBOX( QUEUE_LEN_LONG, log_qmessage_t );
         static StackType_t task_stack[ configMINIMAL_STACK_SIZE ] __attribute__( ( aligned( 32 ) ) );
         TaskHandle_t handle = os.CreateTask( log_Thread,
                                              "Log",
@@ -205,20 +215,45 @@ void log_InsanePrint( const char *fmt, ... )
 
 void log_LevelPrint( log_level_t log_level, const char *fmt, va_list args )
 {
-    log_qmessage_t log_msg;
-
-    /* Using the stack to allocate a fixed size (128 bytes) log buffer
-     * temporarily. This can be modified or perhaps dynamically allocated
-     * using the FreeRTOS heap in the future.
+    /* Format the message straight into a buffer owned by the log mailbox,
+     * which is handed over to the log task by pointer.
      */
-    vsnprintf( log_msg.data, SHORT_MSG_MAX, fmt, args );
-    log_msg.ticks = os.GetTickCount();
-    log_msg.log_level = log_level;
-    log_msg.handle = os.GetTaskHandle();
+    log_qmessage_t *log_msg = log_Alloc();
+
+    if ( log_msg != NULL )
+    {
+        vsnprintf( log_msg->data, SHORT_MSG_MAX, fmt, args );
+        log_msg->ticks = os.GetTickCount();
+        log_msg->log_level = log_level;
+        log_msg->handle = os.GetTaskHandle();
+        log_Send( log_msg );
+    }
+}
+
+log_qmessage_t *log_Alloc( void )
+{
+    shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
+    MailboxHandle_t handle = app.GetLogHandle();
+    UBaseType_t interrupt_status;
 
-    if ( !os.QueueSend( app.GetLogHandle(), &log_msg, os.Ms2Ticks( QUEUE_WAIT_TIME ) ) )
+    if ( handle == NULL )
+    {
+        /* Logged before the log mailbox was created: count it, so the log task can report it */
+        interrupt_status = os.EnterCritical();
+        shared_struct->log_early_drops++;
+        os.ExitCritical( interrupt_status );
+        return NULL;
+    }
+
+    return OS_MAILBOX_ALLOC( handle, log_qmessage_t, QUEUE_WAIT_TIME );
+}
+
+void log_Send( log_qmessage_t *log_msg )
+{
+    if ( !os.MailboxSend( app.GetLogHandle(), log_msg, QUEUE_WAIT_TIME ) )
     {
         /* Message failed to send */
+        os.MailboxFree( app.GetLogHandle(), log_msg );
     }
 }
 
@@ -265,13 +300,13 @@ bool log_GetNetTime( void *buf )
 
 void log_SetListType( log_tasklist_t task_list )
 {
-    log_qmessage_t log_msg;
+    log_qmessage_t *log_msg = log_Alloc();
 
-    log_msg.log_level = loglevel_task;
-    log_msg.task_list = task_list;
-    if ( !os.QueueSend( app.GetLogHandle(), &log_msg, os.Ms2Ticks( QUEUE_WAIT_TIME ) ) )
+    if ( log_msg != NULL )
     {
-        /* Message failed to send */
+        log_msg->log_level = loglevel_task;
+        log_msg->task_list = task_list;
+        log_Send( log_msg );
     }
 }
 
@@ -285,7 +320,7 @@ log_level_t log_GetLevel( void )
     return log_obj.log_level;
 }
 
-bool log_Show( log_qmessage_t msg )
+bool log_Show( const log_qmessage_t *msg )
 {
     bool flag = true;
     uint32_t i;
@@ -295,7 +330,7 @@ bool log_Show( log_qmessage_t msg )
         flag = log_obj.task_list.type == logtask_show ? false : true;
         for ( i = 0; log_obj.task_list.handle[ i ] != NULL && i < LOG_MAX_LIST; i++ )
         {
-            if ( msg.handle ==  log_obj.task_list.handle[ i ] )
+            if ( msg->handle ==  log_obj.task_list.handle[ i ] )
             {
                 flag = !flag;
                 break;
@@ -303,7 +338,7 @@ bool log_Show( log_qmessage_t msg )
         }
     }
 
-    if ( msg.log_level > log_obj.log_level )
+    if ( msg->log_level > log_obj.log_level )
     {
         flag = false;
     }
@@ -313,13 +348,13 @@ bool log_Show( log_qmessage_t msg )
 
 void log_Putchar( char c )
 {
-    log_qmessage_t log_msg;
+    log_qmessage_t *log_msg = log_Alloc();
 
-    log_msg.data[ 0 ] = c;
-    log_msg.log_level = loglevel_char;
-    if ( !os.QueueSend( app.GetLogHandle(), &log_msg, os.Ms2Ticks( QUEUE_WAIT_TIME ) ) )
+    if ( log_msg != NULL )
     {
-        /* Message failed to send */
+        log_msg->data[ 0 ] = c;
+        log_msg->log_level = loglevel_char;
+        log_Send( log_msg );
     }
 }
 
@@ -149,12 +149,24 @@ static void log_Thread( void * parameter_ptr );
  */
 static void log_LevelPrint( log_level_t log_level, const char *fmt, va_list args );
 
+/**
+ * @brief       Take a message buffer from the log mailbox, counting the messages dropped while it does not exist yet.
+ * @return      Message buffer, NULL when there is none.
+ */
+static log_qmessage_t *log_Alloc( void );
+
+/**
+ * @brief       Post a message to the log task (the message buffer is returned to the mailbox if that fails).
+ * @param[in]   log_msg Message buffer taken from the log mailbox
+ */
+static void log_Send( log_qmessage_t *log_msg );
+
 /**
  * @brief       Show or hide log message from task
  * @param[in]   msg     Log message that contains the task that is logging
  * @return      True to show log for task x, False to not show log for task x
  */
-static bool log_Show( log_qmessage_t msg );
+static bool log_Show( const log_qmessage_t *msg );
 
 /**
  * @brief       Get network time
@@ -34,10 +34,13 @@ modem_interface_t modem =
     .Registered         = &modem_Registered,
     .Status             = &modem_Status,
     .Receive            = &modem_Receive,
+    .ReceiveTimeout     = &modem_ReceiveTimeout,
     .Send               = &modem_Send,
+    .SendV              = &modem_SendV,
     .StriStr            = &modem_StriStr,
     .Strip              = &modem_Strip,
     .GetTime            = &modem_GetTime,
+    .SessionCache       = &modem_SessionCache,
 };
 
 modem_obj_t modem_obj =
@@ -86,7 +89,7 @@ void nrf_modem_os_init( void )
 void *nrf_modem_os_shm_tx_alloc( size_t bytes )
 {
     /* Allocate a buffer on the TX area of shared memory. */
-    return dmm.Alloc( dmm_handle_1, bytes );
+    return DMM_ALLOC( dmm_handle_1, bytes, "modem" );
 }
 
 void nrf_modem_os_shm_tx_free( void *mem )
@@ -173,7 +176,7 @@ int32_t nrf_modem_os_timedwait( uint32_t context, int32_t *timeout )
         //Log.DebugPrint( "[modem_os_timedwait] sleeping: %d", *timeout >= 0 ? *timeout : -1 );
         modem_obj.sleeping_task.handle = os.GetTaskHandle();
         modem_obj.sleeping_task.start_time = now;
-        os.TaskNotifyTake( false, sleep_time );
+        os.TaskNotifyTake( OS_NOTIFY_MODEM, false, sleep_time );
         if ( sleep_time == portMAX_DELAY )
         {
             result = 0;
@@ -366,7 +369,7 @@ void nrf_modem_os_application_irq_clear( void )
 void EGU1_IRQHandler( void )
 {
     nrf_modem_application_irq_handler();
-    os.TaskNotifyGive( modem_obj.sleeping_task.handle );
+    os.TaskNotifyGive( modem_obj.sleeping_task.handle, OS_NOTIFY_MODEM );
 }
 
 void nrf_modem_os_trace_irq_set( void )
@@ -524,6 +527,32 @@ static int eval_address_table( bool search_only, const void * name, void * data_
     return status;
 }
 
+modem_session_t *modem_Session( const char *host_name )
+{
+    uint32_t i;
+    modem_session_t *session = &modem_obj.session[ 0 ];
+
+    for ( i = 0; i < SESSION_TABLE_ENTRY_CNT; i++ )
+    {
+        if ( strncmp( modem_obj.session[ i ].host_name, host_name, SERVER_NAME_LENGTH_MAX ) == 0 )
+        {
+            return &modem_obj.session[ i ];
+        }
+        if ( modem_obj.session[ i ].last_used < session->last_used )
+        {
+            session = &modem_obj.session[ i ];
+        }
+    }
+
+    // New host: reuse the entry connected to longest ago (unused entries have never connected)
+    memset( session, 0, sizeof( modem_session_t ) );
+    strncpy( session->host_name, host_name, SERVER_NAME_LENGTH_MAX - 1 );
+    session->cache = MODEM_SESSION_CACHE;
+    session->last_used = os.GetTickCountMs();
+
+    return session;
+}
+
 /*************************************************************************************************************************************
  * Public Functions Definition
  */
@@ -718,6 +747,9 @@ int32_t modem_Connect( const char *transport_protocol,
 {
     int32_t err = 0;
     int fd = -1;
+    uint32_t connect_ms;
+    bool is_dtls = ( modem_StriStr( transport_protocol, "DTLS" ) != NULL );
+    modem_session_t *session = NULL;
     struct nrf_addrinfo *addr_info = NULL;
     nrf_sockaddr_in_t *remote_addr = NULL;
     struct nrf_addrinfo hints =
@@ -812,19 +844,35 @@ int32_t modem_Connect( const char *transport_protocol,
     }
     else if ( modem_StriStr( transport_protocol, "TLS" ) != NULL )
     {
-        fd = nrf_socket( NRF_AF_INET, NRF_SOCK_STREAM, NRF_SPROTO_TLS1v2 );
-        Log.DebugPrint( "Opening TLS socket handle: %d", fd );
+        if ( is_dtls )
+        {
+            fd = nrf_socket( NRF_AF_INET, NRF_SOCK_DGRAM, NRF_SPROTO_DTLS1v2 );
+        }
+        else
+        {
+            fd = nrf_socket( NRF_AF_INET, NRF_SOCK_STREAM, NRF_SPROTO_TLS1v2 );
+        }
+        Log.DebugPrint( "Opening %s socket handle: %d", is_dtls ? "DTLS" : "TLS", fd );
         if ( fd > -1 )
         {
+            session = modem_Session( host_name );
             if ( tolower( transport_protocol[ 0 ] ) == 'm' )
             {
                 Log.DebugPrint( "Setup mTLS protocol for %s", host_name );
-                err = tls.Setup( fd, host_name, tag_mtls );
+                err = tls.Setup( fd, host_name, tag_mtls, session->cache );
             }
             else
             {
-                err = tls.Setup( fd, host_name, tag_tls );
+                err = tls.Setup( fd, host_name, tag_tls, session->cache );
             }
+#ifdef NRF_SO_SEC_DTLS_CID
+            if ( is_dtls && err == 0 )
+            {
+                // Let the server give us a connection ID, so the session outlives NAT rebinding and PSM
+                int cid = NRF_SO_SEC_DTLS_CID_SUPPORTED;
+                err = nrf_setsockopt( fd, NRF_SOL_SECURE, NRF_SO_SEC_DTLS_CID, &cid, sizeof( cid ) );
+            }
+#endif
             Log.DebugPrint( "Did setup TLS return: %d (errorno: %d)", err, ( err == 0 ? 0 : errno ) );
         }
         else
@@ -859,11 +907,41 @@ int32_t modem_Connect( const char *transport_protocol,
         return -1;
     }
 
+    // The TLS handshake happens here
+    connect_ms = os.GetTickCountMs();
 #ifdef NRFXLIB_V1
     err = nrf_connect( fd, (const nrf_sockaddr_in_t *)remote_addr, sizeof( nrf_sockaddr_in_t ) );
 #else
     err = nrf_connect( fd, (const nrf_sockaddr_t *)remote_addr, sizeof( nrf_sockaddr_in_t ) );
 #endif
+    connect_ms = os.GetTickCountMs() - connect_ms;
+    if ( session != NULL )
+    {
+        session->last_used = os.GetTickCountMs();
+        if ( err != 0 )
+        {
+            session->failed++;
+        }
+        else
+        {
+            switch ( tls.Handshake( fd ) )
+            {
+                case tls_handshake_full:
+                    session->full++;
+                    session->full_ms += connect_ms;
+                    break;
+                case tls_handshake_resumed:
+                    session->resumed++;
+                    session->resumed_ms += connect_ms;
+                    break;
+                default:
+                    session->unknown++;
+                    session->unknown_ms += connect_ms;
+                    break;
+            }
+            Log.DebugPrint( "TLS connect to %s took %d ms", host_name, connect_ms );
+        }
+    }
     if ( err != 0 )
     {
         if ( remote_addr != NULL )
@@ -984,6 +1062,39 @@ void modem_Status( void )
             }
         }
     }
+
+    for ( i = 0; i < SESSION_TABLE_ENTRY_CNT; i++ )
+    {
+        modem_session_t *session = &modem_obj.session[ i ];
+
+        if ( session->host_name[ 0 ] != 0 )
+        {
+            Log.Print( "TLS %s: cache %s, %d failed\r\n", session->host_name, session->cache ? "on" : "off", session->failed );
+            Log.Print( "\tFull handshakes: %d (%d ms avg), resumed: %d (%d ms avg), unknown: %d (%d ms avg)\r\n",
+                       session->full,
+                       session->full > 0 ? session->full_ms / session->full : 0,
+                       session->resumed,
+                       session->resumed > 0 ? session->resumed_ms / session->resumed : 0,
+                       session->unknown,
+                       session->unknown > 0 ? session->unknown_ms / session->unknown : 0 );
+        }
+    }
+}
+
+error_code_module_t modem_SessionCache( const char *host_name, bool enable )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( host_name == NULL || strlen( host_name ) >= SERVER_NAME_LENGTH_MAX )
+    {
+        error = ERROR_MODEM_BAD_PARAM;
+    }
+    else
+    {
+        modem_Session( host_name )->cache = enable;
+    }
+
+    return error;
 }
 
 error_code_module_t modem_GetTime( uint32_t *network_time_ms )
@@ -1060,6 +1171,36 @@ int32_t modem_Receive( int32_t fd, uint8_t *buf, uint32_t size )
     return result;
 }
 
+int32_t modem_ReceiveTimeout( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms )
+{
+    int32_t result = 0;
+    uint32_t start = os.GetTickCountMs();
+
+    do
+    {
+        if ( os.TakeSemaphore( modem_obj.mutex_handle, RECEIVE_POLL_MS ) )
+        {
+            result = nrf_recv( fd, buf, size, NRF_MSG_DONTWAIT );
+            if ( result == 0 && size > 0 )
+            {
+                // Connection closed by the peer
+                result = -1;
+            }
+            else if ( result < 0 && errno == NRF_EAGAIN )
+            {
+                result = 0;
+            }
+            os.GiveSemaphore( modem_obj.mutex_handle );
+        }
+        if ( result == 0 && os.GetTickCountMs() - start < timeout_ms )
+        {
+            os.Delay( RECEIVE_POLL_MS );
+        }
+    } while ( result == 0 && os.GetTickCountMs() - start < timeout_ms );
+
+    return result;
+}
+
 int32_t modem_Send( int32_t fd, uint8_t *buf, uint32_t size )
 {
     int32_t result;
@@ -1078,6 +1219,65 @@ int32_t modem_Send( int32_t fd, uint8_t *buf, uint32_t size )
     return result;
 }
 
+int32_t modem_SendV( int32_t fd, TransportOutVector_t *iov, size_t count )
+{
+    int32_t result = 0, sent = 0;
+    size_t i, offset, length, size = 0, copied = 0, fill = 0;
+    const uint8_t *segment;
+    bool done = false;
+
+    if ( count == 1 )
+    {
+        return modem_Send( fd, ( uint8_t * )iov[ 0 ].iov_base, iov[ 0 ].iov_len );
+    }
+
+    for ( i = 0; i < count; i++ )
+    {
+        size += iov[ i ].iov_len;
+    }
+
+    if ( size > 0 && !os.TakeSemaphore( modem_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        return -1;
+    }
+
+    // Gather segments, handing the buffer to the modem whenever it is full and after the last byte
+    for ( i = 0; i < count && !done; i++ )
+    {
+        segment = ( const uint8_t * )iov[ i ].iov_base;
+        for ( offset = 0; offset < iov[ i ].iov_len && !done; offset += length )
+        {
+            length = iov[ i ].iov_len - offset;
+            if ( length > MODEM_GATHER_SIZE - fill )
+            {
+                length = MODEM_GATHER_SIZE - fill;
+            }
+            memcpy( &modem_obj.gather[ fill ], &segment[ offset ], length );
+            fill += length;
+            copied += length;
+
+            if ( fill == MODEM_GATHER_SIZE || copied == size )
+            {
+                result = nrf_send( fd, modem_obj.gather, fill, 0 );
+                if ( result > 0 )
+                {
+                    sent += result;
+                }
+                // Stop at an error or a partial send, the caller sends the rest
+                done = ( result != ( int32_t )fill );
+                fill = 0;
+            }
+        }
+    }
+
+    if ( size > 0 )
+    {
+        os.GiveSemaphore( modem_obj.mutex_handle );
+    }
+
+    return ( sent == 0 && result < 0 ) ? result : sent;
+}
+
 /**
  * @} Modem
  */
@@ -41,6 +41,7 @@
 #include "app.h"
 #include "log.h"
 #include "tls.h"
+#include "transport_interface.h"
 #include "eelcodes.h"
 #include "embedded_cli.h"
 
@@ -65,6 +66,10 @@
 #define NRF_MODEM_NETWORK_IRQ_PRIORITY      ( 0 )
 #endif
 
+#ifndef MODEM_SESSION_CACHE
+#define MODEM_SESSION_CACHE                 ( 1 )       /*!< resume TLS sessions unless turned off for a host */
+#endif
+
 /***************************************************************************************************************************
  * Public data structures and typedefs
  */
@@ -92,10 +97,13 @@ typedef struct
     bool                ( *Registered )( void );
     void                ( *Status )( void );
     int32_t             ( *Receive)( int32_t fd, uint8_t *buf, uint32_t size );
+    int32_t             ( *ReceiveTimeout )( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms );
     int32_t             ( *Send )( int32_t fd, uint8_t *buf, uint32_t size );
+    int32_t             ( *SendV )( int32_t fd, TransportOutVector_t *iov, size_t count );
     char*               ( *StriStr )( const char *buffer, const char *search_string );
     void                ( *Strip )( char *buffer, char strip );
     error_code_module_t ( *GetTime )( uint32_t *network_time_ms );
+    error_code_module_t ( *SessionCache )( const char *host_name, bool enable );
 } const modem_interface_t;
 
 /* Create one contiguous memory space for the three buffers required by the modem driver */
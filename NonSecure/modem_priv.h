@@ -27,6 +27,9 @@
 #define ADDRESS_TABLE_ENTRY_CNT             ( 5 )
 #define RECEIVE_RETRY_MAX                   ( 20 )
 #define MIN_WAIT_MS                         ( 20 )
+#define RECEIVE_POLL_MS                     ( 10 )
+#define SESSION_TABLE_ENTRY_CNT             ( ADDRESS_TABLE_ENTRY_CNT )
+#define MODEM_GATHER_SIZE                   ( LONG_MSG_MAX )    /*!< bytes of a gathered send passed to the modem at once */
 
 #define SHM_TX_MAX                  (128) //8
 #define SHM_TX_CHUNK_SIZE           (NRF_MODEM_SHMEM_TX_SIZE / SHM_TX_MAX)
@@ -59,6 +62,31 @@ typedef struct
     uint32_t                    ipaddr;
 } socket_t;
 
+/*
+ * @note
+ * The modem does the TLS handshake inside nrf_connect(). With NRF_SO_SEC_SESSION_CACHE on, it keeps the session of
+ * each server and resumes it on the next connect (abbreviated handshake: no certificate exchange, no ECDHE), which is
+ * what makes an MQTT reconnect cheap. The session table below keeps, per host, whether caching is on and how the
+ * handshakes went: full or resumed as reported by NRF_SO_SEC_HANDSHAKE_STATUS (unknown with modem libraries that do not
+ * have it), and the time nrf_connect() took for each kind.
+ *
+ * The cache lives in the modem. It does not survive AT+CFUN=0 (modem_Stop) or a reset, and the modem offers no way to
+ * save it, so the first connect after either is a full handshake.
+ */
+typedef struct
+{
+    char                        host_name[ SERVER_NAME_LENGTH_MAX ];
+    bool                        cache;              /*!< let the modem cache and resume the session */
+    uint32_t                    full;               /*!< full handshakes */
+    uint32_t                    resumed;            /*!< resumed sessions */
+    uint32_t                    unknown;            /*!< handshakes the modem did not classify */
+    uint32_t                    failed;             /*!< connects that failed */
+    uint32_t                    full_ms;            /*!< total connect time of full handshakes */
+    uint32_t                    resumed_ms;         /*!< total connect time of resumed sessions */
+    uint32_t                    unknown_ms;
+    uint32_t                    last_used;          /*!< time of last connect, the oldest entry is reused */
+} modem_session_t;
+
 typedef struct
 {
     bool                        is_init;
@@ -67,7 +95,9 @@ typedef struct
     socket_t                    socket[ ADDRESS_TABLE_ENTRY_CNT ];
     sleeping_task_t             sleeping_task;
     address_table_hdl_t         address_table_hdl;
+    modem_session_t             session[ SESSION_TABLE_ENTRY_CNT ];
     SemaphoreHandle_t           mutex_handle;
+    uint8_t                     gather[ MODEM_GATHER_SIZE ];    /*!< segments of a gathered send, under the mutex */
 } modem_obj_t;
 
 #ifndef NRFXLIB_V1
@@ -113,7 +143,7 @@ static error_code_module_t modem_Stop( void );
 /**
  * @brief       Implements the socket connection to a remote server.
  * @details     API to create as socket that supports most transport protocol.
- * @param[in]   transport_protocol  Network transport protocol such as UDP, TCP, TLS and MTLS (mutually auth TLS)
+ * @param[in]   transport_protocol  Network transport protocol such as UDP, TCP, TLS, MTLS (mutually auth TLS), DTLS and MDTLS
  * @param[in]   host_name           Host-name of the server
  * @param[in]   port                IP port of the server
  * @param[in]   receive_timeout_ms  Receiving time-out in milliseconds
@@ -161,6 +191,20 @@ static void modem_Status( void );
  */
 static int32_t modem_Receive( int32_t fd, uint8_t *buf, uint32_t size );
 
+/**
+ * @brief       Implements a socket receive that gives up after a time limit. The modem mutex is released between polls,
+ *              so sends are not held up while nothing arrives.
+ * @param[in]   fd                  Socket file descriptor (FD)
+ * @param[in]   buf                 User supplied buffer pointer
+ * @param[in]   size                Maximum size of buffer
+ * @param[in]   timeout_ms          Maximum time to wait for data
+ *
+ * @return:     number of bytes received when successful
+ *              zero when no data arrived in time
+ *              negative when error
+ */
+static int32_t modem_ReceiveTimeout( int32_t fd, uint8_t *buf, uint32_t size, uint32_t timeout_ms );
+
 /**
  * @brief       Implements a blocking socket send to a remote server.
  * @param[in]   fd                  Socket file descriptor (FD)
@@ -171,6 +215,19 @@ static int32_t modem_Receive( int32_t fd, uint8_t *buf, uint32_t size );
  *              negative when error
  */
 static int32_t modem_Send( int32_t fd, uint8_t *buf, uint32_t size );
+
+/**
+ * @brief       Implements a blocking gathered socket send to a remote server. The segments are copied into a buffer of
+ *              the modem module and passed to the modem in one send per MODEM_GATHER_SIZE bytes, so a packet up to
+ *              that size leaves the device as one TLS record. Nothing is allocated.
+ * @param[in]   fd                  Socket file descriptor (FD)
+ * @param[in]   iov                 Segments to send
+ * @param[in]   count               Number of segments
+ *
+ * @return:     number of bytes sent when successful, fewer than the segments hold when the modem took only part
+ *              negative when error before anything was sent
+ */
+static int32_t modem_SendV( int32_t fd, TransportOutVector_t *iov, size_t count );
 /**
  * @brief case agnostic string search.
  * @param[in]   buffer          String buffer to be searched.
@@ -192,6 +249,14 @@ static void modem_Strip( char *buffer, char strip );
  */
 static error_code_module_t modem_GetTime( uint32_t *network_time_ms );
 
+/**
+ * @brief Turn TLS session caching for a host on or off. Takes effect with the next connect.
+ * @param[in]   host_name       Host-name of the server.
+ * @param[in]   enable          Cache and resume sessions (true) or do a full handshake every time (false).
+ * @return  error code
+ */
+static error_code_module_t modem_SessionCache( const char *host_name, bool enable );
+
 /***************************************************************************************************************************
  * Private prototypes
  */
@@ -226,6 +291,13 @@ static void address_table_init( void );
  */
 static int eval_address_table( bool search_only, const void * name, void * data_ptr );
 
+/**
+ * @brief Find the session entry of a host, or take the least recently used one.
+ * @param[in]       host_name       Host-name of the server.
+ * @return  session entry
+ */
+static modem_session_t *modem_Session( const char *host_name );
+
 #ifndef NRFXLIB_V1
 static void modem_Fault( struct nrf_modem_fault_info *fault_info );
 #endif
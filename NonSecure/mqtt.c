@@ -29,28 +29,31 @@ mqtt_interface_t mqtt =
     .Subscribe          = &mqtt_Subscribe,
     .Unsubscribe        = &mqtt_Unsubscribe,
     .Send               = &mqtt_Send,
+    .Publish            = &mqtt_Publish,
+    .Telemetry          = &mqtt_Telemetry,
+    .Flush              = &mqtt_Flush,
+    .Route              = &mqtt_Route,
+    .Unroute            = &mqtt_Unroute,
+    .Compress           = &mqtt_Compress,
     .Status             = &mqtt_Status,
+#if MQTT_BENCHMARK_ENABLED
+    .Benchmark          = &mqtt_Benchmark,
+#endif
 };
 
 mqtt_obj_t mqtt_obj =
 {
     .is_init            = false,
     .is_subscribed      = false,
+    .is_connected       = false,
     .sequence_number    = 0,
+    .window             = MQTT_WINDOW_SIZE,
     .net_context.socket = -1,
     .session            =
     {
-        .context =
-        {
-            .networkBuffer =
-            {
-                .pBuffer = NULL,
-                .size = 0,
-            },
-        },
         .connection_info =
         {
-            .cleanSession = true,
+            .cleanSession = false,
             .pClientIdentifier = MQTT_ID,
             .clientIdentifierLength = MQTT_ID_LENGTH,
             .keepAliveSeconds = MQTT_KEEP_ALIVE,
@@ -78,17 +81,32 @@ mqtt_obj_t mqtt_obj =
             },
         },
     },
+    .resubscribe_args   =
+    {
+        .pSubscribeInfo = mqtt_obj.session.subscribe_info,
+        .numSubscriptions = MQTT_TOPIC_COUNT,
+    },
     .buffer             =
     {
-        .pBuffer = NULL,
-        .size = 0,
+        .pBuffer = mqtt_obj.network_buffer,
+        .size = LONG_MSG_MAX,
     },
-    .transport          =
+    .socket_transport   =
     {
         .pNetworkContext = &mqtt_obj.net_context,
         .recv = mqtt_Receive,
         .send = mqtt_Transmit,
+        .writev = mqtt_TransmitV,
+    },
+#if MQTT_BENCHMARK_ENABLED
+    .bench_transport    =
+    {
+        .pNetworkContext = &mqtt_obj.net_context,
+        .recv = mqtt_BenchReceive,
+        .send = mqtt_BenchTransmit,
+        .writev = mqtt_BenchTransmitV,
     },
+#endif
 };
 
 /*************************************************************************************************************************************
@@ -98,15 +116,104 @@ mqtt_obj_t mqtt_obj =
 error_code_module_t mqtt_Init( void )
 {
     error_code_module_t error = NO_ERROR;
+    shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
+    uint32_t i;
+    MQTTAgentMessageInterface_t message_interface =
+    {
+        .pMsgCtx = &mqtt_obj.message_context,
+        .send = mqtt_MessageSend,
+        .recv = mqtt_MessageReceive,
+        .getCommand = mqtt_CommandGet,
+        .releaseCommand = mqtt_CommandRelease,
+    };
 
     /* Singleton pattern */
     if ( mqtt_obj.is_init == false )
     {
         /* init local RAM objects */
         strcpy( mqtt_obj.session.topic, MQTT_TOPIC );
-        mqtt_obj.timer_handle = os.CreateTimer( "MQTT_Timer", MQTT_KEEP_ALIVE * 500, true, NULL, mqtt_Timeout );
+
+        // Seed the reconnect jitter with the client ID, so devices of a fleet draw different waits
+        mqtt_obj.random = MQTT_RANDOM_SEED;
+        for ( i = 0; i < MQTT_ID_LENGTH; i++ )
+        {
+            mqtt_obj.random = ( mqtt_obj.random ^ ( uint8_t )MQTT_ID[ i ] ) * MQTT_RANDOM_PRIME;
+        }
+
+        shared_struct->mqtt_queue = OS_CREATE_MAILBOX( QUEUE_LEN_LONG, MQTTAgentCommand_t );
+        mqtt_obj.message_context.mailbox = shared_struct->mqtt_queue;
+        mqtt_obj.free_slots = os.CreateQueue( MQTT_WINDOW_SIZE, sizeof( MQTTAgentCommandContext_t * ) );
+        mqtt_obj.event_handle = os.CreateEvent();
         mqtt_obj.mutex_handle = os.CreateMutex();
-        mqtt_obj.is_init = true;
+        mqtt_obj.route_mutex = os.CreateMutex();
+        mqtt_obj.compress_mutex = os.CreateMutex();
+        if ( mqtt_obj.message_context.mailbox == NULL || mqtt_obj.free_slots == NULL || mqtt_obj.event_handle == NULL ||
+             !mqtt_SetWindow( MQTT_WINDOW_SIZE ) )
+        {
+            error = ERROR_MQTT_INIT;
+        }
+        if ( error == NO_ERROR )
+        {
+            error = transport.Wrap( &mqtt_obj.transport,
+                                    &mqtt_obj.read_ahead,
+                                    &mqtt_obj.socket_transport,
+                                    mqtt_obj.read_ahead_buffer,
+                                    sizeof( mqtt_obj.read_ahead_buffer ) );
+        }
+        if ( error == NO_ERROR )
+        {
+            error = router.Init( &mqtt_obj.router, mqtt_obj.route_levels, MQTT_ROUTE_LEVELS, mqtt_obj.routes, MQTT_ROUTE_COUNT );
+        }
+        if ( error == NO_ERROR )
+        {
+            error = router.Add( &mqtt_obj.router, mqtt_obj.session.topic, strlen( mqtt_obj.session.topic ), mqtt_PrintPublish, NULL );
+        }
+        if ( error == NO_ERROR )
+        {
+            error = router.Init( &mqtt_obj.compress_topics,
+                                 mqtt_obj.compress_levels,
+                                 MQTT_COMPRESS_LEVELS,
+                                 mqtt_obj.compress_routes,
+                                 MQTT_COMPRESS_COUNT );
+        }
+        if ( error == NO_ERROR && MQTTAgent_Init( &mqtt_obj.agent,
+                                                  &message_interface,
+                                                  &mqtt_obj.buffer,
+                                                  &mqtt_obj.transport,
+                                                  os.GetTickCountMs,
+                                                  mqtt_Incoming,
+                                                  NULL ) != MQTTSuccess )
+        {
+            error = ERROR_MQTT_INIT;
+        }
+
+        /* Set up MQTT agent task */
+        if ( error == NO_ERROR )
+        {
+            static StackType_t task_stack[ configMINIMAL_STACK_SIZE ] __attribute__( ( aligned( 32 ) ) );
+            mqtt_obj.task_handle = os.CreateTask( mqtt_Thread,
+                                                  "MQTT",
+                                                  task_stack,
+                                                  sizeof( task_stack ) / sizeof( StackType_t ),
+                                                  NULL,
+                                                  TASK_LOW_PRIORITY | portPRIVILEGE_BIT );
+            MemoryRegion_t regions[] =
+            {
+                { ( void *)shared_mem,  SHAREDMEM_SIZE,            tskMPU_REGION_READ_WRITE | tskMPU_REGION_EXECUTE_NEVER },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+                { 0,                    0,                         0                                                      },
+            };
+            os.AllocateRegions( mqtt_obj.task_handle, regions );
+            mqtt_obj.is_init = true;
+        }
     }
     else
     {
@@ -116,230 +223,286 @@ error_code_module_t mqtt_Init( void )
     return error;
 }
 
-void mqtt_Callback( MQTTContext_t *mqtt_context, MQTTPacketInfo_t *packet_info, MQTTDeserializedInfo_t *deserialized_info )
+void mqtt_Thread( void *parameter_ptr )
 {
-    if ( ( packet_info->type & 0xf0 ) == MQTT_PACKET_TYPE_PUBLISH )
-    {
-        mqtt_ProcessIncomingPublish( deserialized_info->pPublishInfo );
-    }
-    else
+    MQTTStatus_t mqtt_status;
+
+    twdt.Configure( TWDT_TIMEOUT );
+    Log.InfoPrint( "MQTT task started" );
+
+    /**
+     * @details
+     * Logical flow:
+     *      1. Cancel commands posted while not connected
+     *      2. Session opened?
+     *          2a. Session opened:
+     *              Connect to broker
+     *              Run agent command loop until disconnect or connection failure
+     *              Close socket
+     *              Connection failed: reconnect with backoff and run the command loop again
+     *          2b. Session not opened:
+     *              Wait for idle poll time
+     */
+    for( ; ; )
     {
-        mqtt_ProcessResponse( packet_info, deserialized_info->packetIdentifier );
+        twdt.Update();
+        MQTTAgent_CancelAll( &mqtt_obj.agent );
+
+        if ( os.TaskNotifyTake( OS_NOTIFY_WAKE, true, MQTT_IDLE_POLL ) && !mqtt_obj.closing )
+        {
+            mqtt_obj.state = mqtt_state_connecting;
+            mqtt_status = mqtt_Connect();
+            if ( mqtt_status == MQTTSuccess )
+            {
+                do
+                {
+                    mqtt_obj.state = mqtt_state_connected;
+                    os.SetEvent( mqtt_obj.event_handle, MQTT_EVENT_CONNECTED );
+                    mqtt_status = MQTTAgent_CommandLoop( &mqtt_obj.agent );
+                    mqtt_Disconnect( mqtt_status );
+                } while ( mqtt_status != MQTTSuccess && mqtt_Reconnect() == MQTTSuccess );
+                mqtt_obj.state = mqtt_state_idle;
+                os.SetEvent( mqtt_obj.event_handle, MQTT_EVENT_DISCONNECTED );
+            }
+            else
+            {
+                mqtt_Disconnect( mqtt_status );
+                mqtt_obj.state = mqtt_state_idle;
+                os.SetEvent( mqtt_obj.event_handle, MQTT_EVENT_FAILED );
+            }
+        }
     }
 }
 
-void mqtt_Timeout( TimerHandle_t handle )
+MQTTStatus_t mqtt_Connect( void )
 {
-    if ( mqtt_obj.is_subscribed && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    bool mqtt_session_present;
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+#if MQTT_BENCHMARK_ENABLED
+    if ( mqtt_obj.bench.active )
     {
-        MQTT_Ping( &mqtt_obj.session.context );
-        MQTT_ProcessLoop( &mqtt_obj.session.context, MQTT_TIMEOUT );
-        os.GiveSemaphore( mqtt_obj.mutex_handle );
+        mqtt_obj.agent.mqttContext.transportInterface = mqtt_obj.bench_transport;
     }
-    Log.InfoPrint( "MQTT Time out" );
-}
+    else
+#endif
+    {
+        // Connect to remote server
+        mqtt_obj.net_context.socket = modem.Connect( "tls", MQTT_ENDPOINT, MQTT_PORT, 5000, 5000 );
+        if ( mqtt_obj.net_context.socket < 0 )
+        {
+            mqtt_status = MQTTServerRefused;
+        }
 
-void mqtt_ProcessIncomingPublish( MQTTPublishInfo_t *publish_info )
-{
-    char temp;
-    char *ptr;
+        // Discard anything read ahead on a previous connection
+        transport.Reset( &mqtt_obj.read_ahead );
+        mqtt_obj.agent.mqttContext.transportInterface = mqtt_obj.transport;
+    }
 
-    if ( modem.StriStr( publish_info->pTopicName, mqtt_obj.session.topic ) != NULL )
+    // Connect to MQTT broker
+    if ( mqtt_status == MQTTSuccess )
     {
-        ptr = ( char * )publish_info->pTopicName;
-        temp = ptr[ publish_info->topicNameLength ];
-        ptr[ publish_info->topicNameLength ] = 0;
-        Log.InfoPrint( "Subscribed topic: %s", ptr );
-        ptr[ publish_info->topicNameLength ] = temp;
-        ptr = ( char * )publish_info->pPayload;
-        temp = ptr[ publish_info->payloadLength ];
-        ptr[ publish_info->payloadLength ] = 0;
-        Log.InfoPrint( "Data: %s", ptr );
-        ptr[ publish_info->payloadLength ] = temp;
+        mqtt_status = MQTT_Connect( &mqtt_obj.agent.mqttContext,
+                                    &mqtt_obj.session.connection_info,
+                                    NULL,
+                                    MQTT_TIMEOUT << 1,
+                                    &mqtt_session_present );
+        Log.DebugPrint( "MQTT username: %s", mqtt_obj.session.connection_info.pUserName );
     }
-    else
+
+    // Publishes of a previous connection are sent again if the broker kept the session, and dropped otherwise
+    if ( mqtt_status == MQTTSuccess )
     {
-        Log.DebugPrint( "Topic: %s", publish_info->pTopicName );
+        mqtt_obj.session_present = mqtt_session_present;
+        mqtt_status = MQTTAgent_ResumeSession( &mqtt_obj.agent, mqtt_session_present );
+    }
+    if ( mqtt_status == MQTTSuccess )
+    {
+        mqtt_obj.is_connected = true;
+        Log.InfoPrint( "MQTT connection established with %s.", MQTT_ENDPOINT );
     }
+
+    return mqtt_status;
 }
 
-void mqtt_ProcessResponse( MQTTPacketInfo_t *packet_info, uint16_t packet_identifier )
+void mqtt_Disconnect( MQTTStatus_t mqtt_status )
 {
-    uint8_t *payload = NULL;
-    size_t size = 0;
-    MQTTStatus_t mqtt_status;
+    mqtt_obj.is_connected = false;
 
-    switch( packet_info->type )
+    // Log any errors
+    if ( mqtt_status != MQTTSuccess )
     {
-    case MQTT_PACKET_TYPE_PUBACK:
-        Log.DebugPrint( "PUBACK received for packet Id %u.", packet_identifier );
-        break;
+        Log.ErrorPrint( "MQTT connection failed: %s", MQTT_Status_strerror( mqtt_status ) );
+    }
 
-    case MQTT_PACKET_TYPE_SUBACK:
-        /* A SUBACK from the broker, containing the server response to our subscription request, has been received.
-         * It contains the status code indicating server approval/rejection for the subscription to the single topic
-         * requested. The SUBACK will be parsed to obtain the status code, and this status code will be stored in global
-         * variable #xTopicFilterContext. */
-        mqtt_status = MQTT_GetSubAckStatusCodes( packet_info, &payload, &size );
-        if ( mqtt_status != MQTTSuccess )
+    // Disconnect from remote server
+    if ( mqtt_obj.net_context.socket >= 0 )
+    {
+        if ( modem.Disconnect( mqtt_obj.net_context.socket ) != NO_ERROR )
         {
-            Log.ErrorPrint( "SUBACK failure: %d", mqtt_status );
+            Log.ErrorPrint( "Disconnect failure" );
         }
-        break;
-
-    case MQTT_PACKET_TYPE_UNSUBACK:
-        Log.DebugPrint( "Unsubscribed from the topic %s.", mqtt_obj.session.topic );
-        break;
-
-    case MQTT_PACKET_TYPE_PINGRESP:
-        /* Nothing to be done from application as library handles
-         * PINGRESP with the use of MQTT_ProcessLoop API function. */
-        Log.DebugPrint( "PINGRESP should not be handled by the application callback when using MQTT_ProcessLoop." );
-        break;
-
-    /* Any other packet type is invalid. */
-    default:
-        Log.ErrorPrint( "mqtt_ProcessResponse() called with unknown packet type:(%02x).", packet_info->type );
+        mqtt_obj.net_context.socket = -1;
     }
+    Log.InfoPrint( "Disconnect from %s.", MQTT_ENDPOINT );
 }
 
-MQTTStatus_t mqtt_Subscribe( char *topic )
+MQTTStatus_t mqtt_Reconnect( void )
 {
-    bool mqtt_session_present;
-    MQTTStatus_t mqtt_status = MQTTSuccess;
+    MQTTStatus_t mqtt_status = MQTTServerRefused;
+    BackoffAlgorithmContext_t backoff;
+    uint16_t delay_ms;
+    uint32_t drop_time = os.GetTickCountMs();
+    uint32_t wait_start, elapsed;
+    MQTTAgentCommandInfo_t command_info =
+    {
+        .cmdCompleteCallback = NULL,
+        .pCmdCompleteCallbackContext = NULL,
+        .blockTimeMs = 0,
+    };
 
-    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    if ( mqtt_obj.closing )
     {
-        os.TimerStart( mqtt_obj.timer_handle, QUEUE_WAIT_TIME );
-        if ( mqtt_obj.buffer.pBuffer == NULL )
-        {
-            if ( ( mqtt_obj.buffer.pBuffer = malloc( LONG_MSG_MAX ) ) != NULL )
-            {
-                // Set up MQTT buffer
-                mqtt_obj.buffer.size = LONG_MSG_MAX;
-                mqtt_status = MQTTSuccess;
-            }
-            else
-            {
-                mqtt_status = MQTTNoMemory;
-            }
+        return mqtt_status;
+    }
+
+    mqtt_obj.reconnect_stats.drops++;
+    mqtt_obj.random ^= drop_time;
+    if ( mqtt_obj.random == 0 )
+    {
+        mqtt_obj.random = MQTT_RANDOM_SEED;
+    }
+    BackoffAlgorithm_InitializeParams( &backoff, MQTT_RECONNECT_BASE_MS, MQTT_RECONNECT_MAX_MS, MQTT_RECONNECT_ATTEMPTS );
 
+    while ( mqtt_status != MQTTSuccess &&
+            !mqtt_obj.closing &&
+            BackoffAlgorithm_GetNextBackoff( &backoff, mqtt_Random(), &delay_ms ) == BackoffAlgorithmSuccess )
+    {
+        // Wait while kicking the watchdog; closing the session cuts the wait short
+        mqtt_obj.state = mqtt_state_backoff;
+        Log.InfoPrint( "MQTT reconnect in %d ms", delay_ms );
+        wait_start = os.GetTickCountMs();
+        while ( !mqtt_obj.closing && ( elapsed = os.GetTickCountMs() - wait_start ) < delay_ms )
+        {
+            twdt.Update();
+            os.TaskNotifyTake( OS_NOTIFY_WAKE, true, ( delay_ms - elapsed < TWDT_KICK_TIME ) ? delay_ms - elapsed : TWDT_KICK_TIME );
         }
 
-        // Connect to remote server
-        if ( mqtt_status == MQTTSuccess && !mqtt_obj.is_subscribed )
+        if ( !mqtt_obj.closing )
         {
-            mqtt_obj.net_context.socket = modem.Connect( "tls", MQTT_ENDPOINT, MQTT_PORT, 5000, 5000 );
-            if ( mqtt_obj.net_context.socket >= 0 )
-            {
-                // Initialize MQTT client
-                mqtt_status = MQTT_Init( &mqtt_obj.session.context,
-                                         &mqtt_obj.transport,
-                                         os.GetTickCountMs,
-                                         mqtt_Callback,
-                                         &mqtt_obj.buffer );
-                // Connect to MQTT broker
-                if ( mqtt_status == MQTTSuccess )
-                {
-                    mqtt_status = MQTT_Connect( &mqtt_obj.session.context,
-                                                &mqtt_obj.session.connection_info,
-                                                NULL,
-                                                MQTT_TIMEOUT << 1,
-                                                &mqtt_session_present );
-                    Log.DebugPrint( "MQTT username: %s", mqtt_obj.session.connection_info.pUserName );
-                    Log.InfoPrint( "MQTT connection established with %s.", MQTT_ENDPOINT );
-                }
-            }
-            else
+            mqtt_obj.state = mqtt_state_connecting;
+            mqtt_obj.reconnect_stats.attempts++;
+            mqtt_status = mqtt_Connect();
+            if ( mqtt_status != MQTTSuccess )
             {
-                mqtt_status = MQTTServerRefused;
+                mqtt_Disconnect( mqtt_status );
             }
+        }
+    }
 
-            // Subscribe to MQTT topic
-            if ( mqtt_status == MQTTSuccess )
-            {
-                if ( topic != NULL )
-                {
-                    strcpy( mqtt_obj.session.topic, topic );
-                    mqtt_obj.session.subscribe_info[ 0 ].topicFilterLength = strlen( topic );
-                }
-                mqtt_status = MQTT_Subscribe( &mqtt_obj.session.context,
-                                              mqtt_obj.session.subscribe_info,
-                                              MQTT_TOPIC_COUNT,
-                                              MQTT_GetPacketId( &mqtt_obj.session.context ) );
-                Log.InfoPrint( "Subscribed topic: %s", topic );
-            }
-            if ( mqtt_status == MQTTSuccess )
-            {
-                mqtt_status = MQTT_ProcessLoop( &mqtt_obj.session.context, MQTT_TIMEOUT );
-            }
-            if ( mqtt_status == MQTTSuccess )
+    if ( mqtt_status == MQTTSuccess )
+    {
+        elapsed = os.GetTickCountMs() - drop_time;
+        mqtt_obj.reconnect_stats.reconnects++;
+        mqtt_obj.reconnect_stats.last_ms = elapsed;
+        mqtt_obj.reconnect_stats.total_ms += elapsed;
+        if ( elapsed > mqtt_obj.reconnect_stats.max_ms )
+        {
+            mqtt_obj.reconnect_stats.max_ms = elapsed;
+        }
+        if ( mqtt_obj.session_present )
+        {
+            mqtt_obj.reconnect_stats.resumed++;
+        }
+        else
+        {
+            // The records replayed before went with the session
+            mqtt_obj.replayed = 0;
+            if ( mqtt_obj.is_subscribed )
             {
-                mqtt_obj.is_subscribed = true;
+                // The broker lost the subscription along with the session
+                MQTTAgent_Subscribe( &mqtt_obj.agent, &mqtt_obj.resubscribe_args, &command_info );
             }
         }
-        os.GiveSemaphore( mqtt_obj.mutex_handle );
+        mqtt_obj.replay = true;
+        Log.InfoPrint( "MQTT reconnected after %d ms, session %s", elapsed, mqtt_obj.session_present ? "resumed" : "lost" );
     }
-    else
+    else if ( !mqtt_obj.closing )
     {
-        mqtt_status = MQTTIllegalState;
+        mqtt_obj.reconnect_stats.exhausted++;
+        Log.ErrorPrint( "MQTT reconnect gave up after %d attempts", backoff.attemptsDone );
     }
 
     return mqtt_status;
 }
 
-MQTTStatus_t mqtt_Unsubscribe( void )
+uint32_t mqtt_Random( void )
 {
-    MQTTStatus_t mqtt_status = MQTTSuccess;
+    // xorshift32
+    mqtt_obj.random ^= mqtt_obj.random << 13;
+    mqtt_obj.random ^= mqtt_obj.random >> 17;
+    mqtt_obj.random ^= mqtt_obj.random << 5;
 
-    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
-    {
-        os.TimerStop( mqtt_obj.timer_handle, QUEUE_WAIT_TIME );
-        if ( mqtt_obj.is_subscribed )
-        {
-            // Unsubscribe from MQTT topic
-            mqtt_status = MQTT_Unsubscribe( &mqtt_obj.session.context,
-                                            mqtt_obj.session.subscribe_info,
-                                            MQTT_TOPIC_COUNT,
-                                            MQTT_GetPacketId( &mqtt_obj.session.context ) );
-            Log.InfoPrint( "Unsubscribed topic: %s", mqtt_obj.session.topic );
-            if ( mqtt_status == MQTTSuccess )
-            {
-                mqtt_status = MQTT_ProcessLoop( &mqtt_obj.session.context, MQTT_TIMEOUT );
-            }
-            // Disconnect from MQTT broker
-            if ( mqtt_status == MQTTSuccess )
-            {
-                MQTT_Disconnect( &mqtt_obj.session.context );
-                Log.InfoPrint( "Disconnect from %s.", MQTT_ENDPOINT );
-            }
+    return mqtt_obj.random;
+}
 
-            // Log any errors
-            if ( mqtt_status != MQTTSuccess )
-            {
-                Log.ErrorPrint( "MQTT transaction failed: %d", mqtt_status );
-            }
+void mqtt_Incoming( MQTTAgentContext_t *agent, uint16_t packet_id, MQTTPublishInfo_t *publish_info )
+{
+    uint32_t routed = 0;
 
-            // Disconnect from remote server
-            if ( modem.Disconnect( mqtt_obj.net_context.socket ) != NO_ERROR )
-            {
-                Log.ErrorPrint( "Disconnect failure" );
-            }
-            else
-            {
-                mqtt_obj.net_context.socket = -1;
-            }
+    mqtt_obj.rx_packets++;
+    if ( os.TakeSemaphore( mqtt_obj.route_mutex, QUEUE_WAIT_TIME ) )
+    {
+        routed = router.Route( &mqtt_obj.router, publish_info );
+        os.GiveSemaphore( mqtt_obj.route_mutex );
+    }
+    if ( routed == 0 )
+    {
+        Log.DebugPrint( "Topic: %s", publish_info->pTopicName );
+    }
+}
 
-            mqtt_obj.is_subscribed = false;
-        }
+void mqtt_PrintPublish( const MQTTPublishInfo_t *publish_info, void *context )
+{
+    char temp;
+    char *ptr;
 
-        // Free MQTT buffer
-        if ( mqtt_obj.buffer.pBuffer != NULL )
+    ptr = ( char * )publish_info->pTopicName;
+    temp = ptr[ publish_info->topicNameLength ];
+    ptr[ publish_info->topicNameLength ] = 0;
+    Log.InfoPrint( "Subscribed topic: %s", ptr );
+    ptr[ publish_info->topicNameLength ] = temp;
+    ptr = ( char * )publish_info->pPayload;
+    temp = ptr[ publish_info->payloadLength ];
+    ptr[ publish_info->payloadLength ] = 0;
+    Log.InfoPrint( "Data: %s", ptr );
+    ptr[ publish_info->payloadLength ] = temp;
+}
+
+void mqtt_SetTopic( const char *topic )
+{
+    // Move the session topic's route along with the topic
+    if ( topic != mqtt_obj.session.topic && os.TakeSemaphore( mqtt_obj.route_mutex, QUEUE_WAIT_TIME ) )
+    {
+        router.Remove( &mqtt_obj.router, mqtt_obj.session.topic, strlen( mqtt_obj.session.topic ), mqtt_PrintPublish );
+        strcpy( mqtt_obj.session.topic, topic );
+        if ( router.Add( &mqtt_obj.router, mqtt_obj.session.topic, strlen( mqtt_obj.session.topic ), mqtt_PrintPublish, NULL ) != NO_ERROR )
         {
-            free( mqtt_obj.buffer.pBuffer );
-            mqtt_obj.buffer.pBuffer = NULL;
-            mqtt_obj.buffer.size = 0;
+            Log.ErrorPrint( "No route for topic %s", mqtt_obj.session.topic );
         }
+        os.GiveSemaphore( mqtt_obj.route_mutex );
+    }
+    mqtt_obj.session.subscribe_info[ 0 ].topicFilterLength = strlen( mqtt_obj.session.topic );
+    mqtt_obj.session.publish_info.topicNameLength = strlen( mqtt_obj.session.topic );
+}
+
+MQTTStatus_t mqtt_Subscribe( char *topic )
+{
+    MQTTStatus_t mqtt_status;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        mqtt_status = mqtt_Open( topic );
         os.GiveSemaphore( mqtt_obj.mutex_handle );
     }
     else
@@ -350,93 +513,146 @@ MQTTStatus_t mqtt_Unsubscribe( void )
     return mqtt_status;
 }
 
-int32_t mqtt_Receive( NetworkContext_t *context, void *buffer, size_t size )
+MQTTStatus_t mqtt_Unsubscribe( void )
 {
-    return modem.Receive( context->socket, buffer, size );
+    MQTTStatus_t mqtt_status;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        mqtt_status = mqtt_Close();
+        os.GiveSemaphore( mqtt_obj.mutex_handle );
+    }
+    else
+    {
+        mqtt_status = MQTTIllegalState;
+    }
+
+    return mqtt_status;
 }
 
-int32_t mqtt_Transmit( NetworkContext_t *context, const void * buffer, size_t size )
+MQTTStatus_t mqtt_Start( void )
 {
-    return modem.Send( context->socket, ( uint8_t *)buffer, size );
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+    EventBits_t bits;
+
+    // Wake the agent task and wait for the connection
+    if ( !mqtt_obj.is_connected )
+    {
+        os.ClearEvent( mqtt_obj.event_handle, MQTT_EVENT_CONNECTED | MQTT_EVENT_FAILED | MQTT_EVENT_DISCONNECTED );
+        mqtt_obj.closing = false;
+        if ( mqtt_obj.state == mqtt_state_idle )
+        {
+            os.TaskNotifyGive( mqtt_obj.task_handle, OS_NOTIFY_WAKE );
+        }
+        bits = os.WaitForEvent( mqtt_obj.event_handle,
+                                MQTT_EVENT_CONNECTED | MQTT_EVENT_FAILED,
+                                true,
+                                false,
+                                MQTT_CONNECT_TIMEOUT );
+        mqtt_status = ( bits & MQTT_EVENT_CONNECTED ) ? MQTTSuccess : MQTTServerRefused;
+    }
+
+    return mqtt_status;
 }
 
-MQTTStatus_t mqtt_Send( char *topic, char *msg )
+MQTTStatus_t mqtt_Stop( void )
 {
-    bool mqtt_session_present, stay_in_session = false;
-    char publish_message[ SHORT_MSG_MAX ];
-    MQTTStatus_t mqtt_status;
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+    MQTTAgentCommandInfo_t command_info =
+    {
+        .cmdCompleteCallback = NULL,
+        .pCmdCompleteCallbackContext = NULL,
+        .blockTimeMs = QUEUE_WAIT_TIME,
+    };
 
-    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    // No reconnect once the session is closed
+    os.ClearEvent( mqtt_obj.event_handle, MQTT_EVENT_DISCONNECTED );
+    mqtt_obj.closing = true;
+
+    // The agent task leaves its command loop after sending DISCONNECT
+    if ( mqtt_obj.is_connected )
     {
-        os.TimerReset( mqtt_obj.timer_handle, QUEUE_WAIT_TIME );
-        if ( topic != NULL )
+        mqtt_status = MQTTAgent_Disconnect( &mqtt_obj.agent, &command_info );
+        if ( mqtt_status == MQTTSuccess &&
+             !( os.WaitForEvent( mqtt_obj.event_handle, MQTT_EVENT_DISCONNECTED, true, false, MQTT_CONNECT_TIMEOUT ) &
+                MQTT_EVENT_DISCONNECTED ) )
         {
-            strcpy( mqtt_obj.session.topic, topic );
-            mqtt_obj.session.subscribe_info[ 0 ].topicFilterLength = strlen( topic );
-            mqtt_obj.session.publish_info.topicNameLength = strlen( topic );
+            mqtt_status = MQTTSendFailed;
         }
-        else
+    }
+    else if ( mqtt_obj.state != mqtt_state_idle )
+    {
+        // Wake the agent task from its backoff wait
+        os.TaskNotifyGive( mqtt_obj.task_handle, OS_NOTIFY_WAKE );
+        if ( !( os.WaitForEvent( mqtt_obj.event_handle, MQTT_EVENT_DISCONNECTED, true, false, MQTT_CONNECT_TIMEOUT ) &
+                MQTT_EVENT_DISCONNECTED ) )
         {
-            mqtt_obj.session.subscribe_info[ 0 ].topicFilterLength = strlen( mqtt_obj.session.subscribe_info[ 0 ].pTopicFilter );
-            mqtt_obj.session.publish_info.topicNameLength = strlen( mqtt_obj.session.publish_info.pTopicName );
+            mqtt_status = MQTTSendFailed;
         }
+    }
 
-        if ( mqtt_obj.buffer.pBuffer == NULL )
-        {
-            if ( ( mqtt_obj.buffer.pBuffer = malloc( LONG_MSG_MAX ) ) != NULL )
-            {
-                // Set up MQTT buffer
-                mqtt_obj.buffer.size = LONG_MSG_MAX;
-                mqtt_status = MQTTSuccess;
-            }
-            else
-            {
-                mqtt_status = MQTTNoMemory;
-            }
+    return mqtt_status;
+}
 
-            // Subscribe
-            if ( mqtt_status == MQTTSuccess )
+MQTTStatus_t mqtt_Open( char *topic )
+{
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+    if ( !mqtt_obj.is_subscribed )
+    {
+        mqtt_status = mqtt_Start();
+
+        // Subscribe to MQTT topic
+        if ( mqtt_status == MQTTSuccess )
+        {
+            if ( topic != NULL )
             {
-                mqtt_status = mqtt_Subscribe( ( char * )mqtt_obj.session.subscribe_info[ 0 ].pTopicFilter );
+                mqtt_SetTopic( topic );
             }
-
-            stay_in_session = false;
+            mqtt_status = mqtt_Command( true );
+            Log.InfoPrint( "Subscribed topic: %s", mqtt_obj.session.topic );
+        }
+        if ( mqtt_status == MQTTSuccess )
+        {
+            mqtt_obj.is_subscribed = true;
+            mqtt_obj.replay = false;
+            mqtt_obj.replayed = 0;
+            mqtt_Replay();
         }
         else
         {
-            stay_in_session = true;
-            mqtt_status = MQTTSuccess;
+            Log.ErrorPrint( "MQTT transaction failed: %s", MQTT_Status_strerror( mqtt_status ) );
+            mqtt_Stop();
         }
+    }
 
-        // Publish to MQTT topic
-        if ( mqtt_status == MQTTSuccess )
+    return mqtt_status;
+}
+
+MQTTStatus_t mqtt_Close( void )
+{
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+    if ( mqtt_obj.is_subscribed )
+    {
+        // Collect outstanding PUBACKs; anything left fails when the connection closes
+        if ( mqtt_WaitWindow( MQTT_FLUSH_TIMEOUT ) != MQTTSuccess )
         {
-            sprintf( publish_message, "\"%s: %d\"", msg, mqtt_obj.sequence_number++ );
-            mqtt_obj.session.publish_info.pPayload = publish_message;
-            mqtt_obj.session.publish_info.payloadLength = strlen( publish_message );
-            mqtt_status = MQTT_Publish( &mqtt_obj.session.context,
-                                        &mqtt_obj.session.publish_info,
-                                        MQTT_GetPacketId( &mqtt_obj.session.context ) );
-            Log.InfoPrint( "Publish message: %s", publish_message );
+            Log.ErrorPrint( "%d publishes not acknowledged", mqtt_obj.window - os.QueueMessagesWaiting( mqtt_obj.free_slots ) );
         }
+
+        // Unsubscribe from MQTT topic
+        mqtt_status = mqtt_Command( false );
+        Log.InfoPrint( "Unsubscribed topic: %s", mqtt_obj.session.topic );
+
+        // Disconnect from MQTT broker
         if ( mqtt_status == MQTTSuccess )
         {
-            mqtt_status = MQTT_ProcessLoop( &mqtt_obj.session.context, MQTT_TIMEOUT );
+            mqtt_status = mqtt_Stop();
         }
-        if ( !stay_in_session )
+        else
         {
-            if ( mqtt_status == MQTTSuccess )
-            {
-                mqtt_status = mqtt_Unsubscribe();
-            }
-
-            // Free MQTT buffer
-            if ( mqtt_obj.buffer.pBuffer != NULL )
-            {
-                free( mqtt_obj.buffer.pBuffer );
-                mqtt_obj.buffer.pBuffer = NULL;
-                mqtt_obj.buffer.size = 0;
-            }
+            mqtt_Stop();
         }
 
         // Log any errors
@@ -444,29 +660,661 @@ MQTTStatus_t mqtt_Send( char *topic, char *msg )
         {
             Log.ErrorPrint( "MQTT transaction failed: %s", MQTT_Status_strerror( mqtt_status ) );
         }
-        os.GiveSemaphore( mqtt_obj.mutex_handle );
-    }
-    else
-    {
-        mqtt_status = MQTTIllegalState;
+
+        mqtt_obj.is_subscribed = false;
     }
 
     return mqtt_status;
 }
 
-void mqtt_Status( void )
+MQTTStatus_t mqtt_Command( bool subscribe )
 {
-    if ( mqtt_obj.is_subscribed )
+    MQTTStatus_t mqtt_status;
+    MQTTAgentCommandContext_t command_context =
     {
-        Log.Print( "MQTT is subscribed.\r\n" );
-        Log.Print( "MQTT username: %s\r\n", mqtt_obj.session.connection_info.pUserName );
-        Log.Print( "MQTT connection established with %s.\r\n", MQTT_ENDPOINT );
+        .task = os.GetTaskHandle(),
+        .status = MQTTSuccess,
+    };
+    MQTTAgentSubscribeArgs_t subscribe_args =
+    {
+        .pSubscribeInfo = mqtt_obj.session.subscribe_info,
+        .numSubscriptions = MQTT_TOPIC_COUNT,
+    };
+    MQTTAgentCommandInfo_t command_info =
+    {
+        .cmdCompleteCallback = mqtt_CommandDone,
+        .pCmdCompleteCallbackContext = &command_context,
+        .blockTimeMs = QUEUE_WAIT_TIME,
+    };
+
+    if ( !mqtt_obj.is_connected )
+    {
+        mqtt_status = MQTTIllegalState;
+    }
+    else if ( subscribe )
+    {
+        mqtt_status = MQTTAgent_Subscribe( &mqtt_obj.agent, &subscribe_args, &command_info );
+    }
+    else
+    {
+        mqtt_status = MQTTAgent_Unsubscribe( &mqtt_obj.agent, &subscribe_args, &command_info );
+    }
+
+    // The agent completes every posted command, if only by cancelling it, so the context on this stack stays in use
+    // until the notification arrives
+    if ( mqtt_status == MQTTSuccess )
+    {
+        while ( !command_context.done )
+        {
+            if ( os.TaskNotifyTake( OS_NOTIFY_REPLY, true, MQTT_COMMAND_TIMEOUT ) == 0 )
+            {
+                Log.ErrorPrint( "Waiting for %s", subscribe ? "SUBACK" : "UNSUBACK" );
+            }
+        }
+        mqtt_status = command_context.status;
+    }
+
+    return mqtt_status;
+}
+
+void mqtt_CommandDone( MQTTAgentCommandContext_t *command_context, MQTTAgentReturnInfo_t *return_info )
+{
+    command_context->status = return_info->returnCode;
+    if ( return_info->returnCode == MQTTSuccess &&
+         return_info->pSubackCodes != NULL &&
+         return_info->pSubackCodes[ 0 ] == MQTTSubAckFailure )
+    {
+        command_context->status = MQTTServerRefused;
+    }
+    command_context->done = true;
+    os.TaskNotifyGive( command_context->task, OS_NOTIFY_REPLY );
+}
+
+int32_t mqtt_Receive( NetworkContext_t *context, void *buffer, size_t size )
+{
+    return modem.ReceiveTimeout( context->socket, buffer, size, MQTT_RECV_WAIT );
+}
+
+int32_t mqtt_Transmit( NetworkContext_t *context, const void * buffer, size_t size )
+{
+    return modem.Send( context->socket, ( uint8_t *)buffer, size );
+}
+
+int32_t mqtt_TransmitV( NetworkContext_t *context, TransportOutVector_t *iov, size_t count )
+{
+    return modem.SendV( context->socket, iov, count );
+}
+
+bool mqtt_MessageSend( MQTTAgentMessageContext_t *message_context, MQTTAgentCommand_t * const *command, uint32_t timeout_ms )
+{
+    return os.MailboxSend( message_context->mailbox, *command, timeout_ms );
+}
+
+bool mqtt_MessageReceive( MQTTAgentMessageContext_t *message_context, MQTTAgentCommand_t **command, uint32_t timeout_ms )
+{
+    uint32_t i;
+
+    // Come back to the process loop soon while ACKs are outstanding, so PUBACKs do not wait for the next command
+    for ( i = 0; i < MQTT_AGENT_MAX_OUTSTANDING_ACKS; i++ )
+    {
+        if ( mqtt_obj.agent.pPendingAcks[ i ].packetId != MQTT_PACKET_ID_INVALID )
+        {
+            timeout_ms = MQTT_ACK_POLL;
+            break;
+        }
+    }
+    twdt.Update();
+    *command = OS_MAILBOX_RECEIVE( message_context->mailbox, MQTTAgentCommand_t, timeout_ms );
+
+    return ( *command != NULL );
+}
+
+MQTTAgentCommand_t *mqtt_CommandGet( uint32_t timeout_ms )
+{
+    return OS_MAILBOX_ALLOC( mqtt_obj.message_context.mailbox, MQTTAgentCommand_t, timeout_ms );
+}
+
+bool mqtt_CommandRelease( MQTTAgentCommand_t *command )
+{
+    os.MailboxFree( mqtt_obj.message_context.mailbox, command );
+
+    return true;
+}
+
+MQTTStatus_t mqtt_Send( char *topic, char *msg )
+{
+    bool stay_in_session;
+    uint8_t publish_message[ SHORT_MSG_MAX ];
+    uint32_t publish_length = 0;
+    uint32_t sequence_number;
+    MQTTStatus_t mqtt_status;
+#if MQTT_PAYLOAD_CBOR
+    telemetry_t encoder;
+#endif
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( topic != NULL )
+        {
+            mqtt_SetTopic( topic );
+        }
+
+        if ( mqtt_obj.is_subscribed && mqtt_obj.state == mqtt_state_idle )
+        {
+            // The agent task gave up reconnecting: open the session again
+            mqtt_obj.is_subscribed = false;
+            mqtt_status = mqtt_Open( NULL );
+            stay_in_session = true;
+        }
+        else if ( !mqtt_obj.is_subscribed )
+        {
+            // Connect and subscribe for this message only
+            mqtt_status = mqtt_Open( NULL );
+            stay_in_session = false;
+        }
+        else
+        {
+            stay_in_session = true;
+            mqtt_status = MQTTSuccess;
+
+            // Messages stored while the connection was down go out first
+            if ( mqtt_obj.replay && mqtt_obj.is_connected )
+            {
+                mqtt_obj.replay = false;
+                mqtt_Replay();
+            }
+        }
+
+        // Build the payload
+        sequence_number = mqtt_obj.sequence_number++;
+#if MQTT_PAYLOAD_CBOR
+        telemetry.Begin( &encoder, publish_message, sizeof( publish_message ), sequence_number, os.GetTickCountMs() );
+        telemetry.Text( &encoder, MQTT_MESSAGE_KEY, msg );
+        if ( telemetry.End( &encoder, &publish_length ) != NO_ERROR )
+        {
+            publish_length = 0;
+        }
+#else
+        publish_length = snprintf( ( char * )publish_message, sizeof( publish_message ), "\"%s: %d\"", msg, sequence_number );
+        if ( publish_length >= sizeof( publish_message ) )
+        {
+            publish_length = 0;
+        }
+#endif
+        if ( publish_length == 0 && mqtt_status == MQTTSuccess )
+        {
+            mqtt_status = MQTTNoMemory;
+        }
+
+        // Publish to MQTT topic, or keep the message for the next session
+        if ( mqtt_status == MQTTSuccess )
+        {
+            mqtt_status = mqtt_Enqueue( mqtt_obj.session.topic, publish_message, publish_length, true, 0, NULL, NULL );
+            Log.InfoPrint( "Publish message: %s: %d", msg, sequence_number );
+        }
+        if ( mqtt_status != MQTTSuccess &&
+             publish_length > 0 &&
+             fs.JournalAppend( mqtt_obj.session.topic,
+                               strlen( mqtt_obj.session.topic ),
+                               publish_message,
+                               publish_length,
+                               QUEUE_WAIT_TIME ) == NO_ERROR )
+        {
+            Log.InfoPrint( "Stored message: %s: %d", msg, sequence_number );
+        }
+        if ( !stay_in_session )
+        {
+            // Waits for the PUBACK before disconnecting
+            if ( mqtt_status == MQTTSuccess )
+            {
+                mqtt_status = mqtt_Close();
+            }
+            else
+            {
+                mqtt_Close();
+            }
+        }
+
+        // Log any errors
+        if ( mqtt_status != MQTTSuccess )
+        {
+            Log.ErrorPrint( "MQTT transaction failed: %s", MQTT_Status_strerror( mqtt_status ) );
+        }
+        os.GiveSemaphore( mqtt_obj.mutex_handle );
+    }
+    else
+    {
+        mqtt_status = MQTTIllegalState;
+    }
+
+    return mqtt_status;
+}
+
+MQTTStatus_t mqtt_Publish( char *topic, char *msg, mqtt_complete_t callback, void *context )
+{
+    MQTTStatus_t mqtt_status;
+
+    // No lock: publishes of several tasks are serialized by the agent
+    if ( mqtt_obj.is_init == true && mqtt_obj.is_subscribed )
+    {
+        mqtt_status = mqtt_Enqueue( topic != NULL ? topic : mqtt_obj.session.topic, ( uint8_t * )msg, strlen( msg ), false, 0, callback, context );
+    }
+    else
+    {
+        mqtt_status = MQTTIllegalState;
+    }
+
+    return mqtt_status;
+}
+
+MQTTStatus_t mqtt_Telemetry( char *topic, mqtt_encode_t encode, void *encode_context, mqtt_complete_t callback, void *context )
+{
+    MQTTStatus_t mqtt_status = MQTTIllegalState;
+    MQTTAgentCommandContext_t *slot = NULL;
+    telemetry_t encoder;
+    uint32_t payload_length;
+    size_t topic_length = 0;
+
+    if ( mqtt_obj.is_init == true && mqtt_obj.is_subscribed && encode != NULL )
+    {
+        topic = ( topic != NULL ) ? topic : mqtt_obj.session.topic;
+        topic_length = strlen( topic );
+        mqtt_status = mqtt_TakeSlot( &slot, topic, topic_length + MQTT_TELEMETRY_MAX );
+    }
+
+    // The record is encoded in the slot buffer, so it is not copied again before it is sent
+    if ( mqtt_status == MQTTSuccess )
+    {
+        telemetry.Begin( &encoder, &slot->buffer[ topic_length ], MQTT_TELEMETRY_MAX, mqtt_obj.sequence_number++, os.GetTickCountMs() );
+        encode( &encoder, encode_context );
+        if ( telemetry.End( &encoder, &payload_length ) == NO_ERROR )
+        {
+            mqtt_status = mqtt_PostSlot( slot, topic_length, payload_length, false, 0, callback, context );
+        }
+        else
+        {
+            mqtt_ReleaseSlot( slot );
+            mqtt_status = MQTTNoMemory;
+        }
+    }
+
+    return mqtt_status;
+}
+
+MQTTStatus_t mqtt_Flush( uint32_t timeout_ms )
+{
+    MQTTStatus_t mqtt_status;
+
+    if ( mqtt_obj.is_init == true && mqtt_obj.is_subscribed )
+    {
+        mqtt_status = mqtt_WaitWindow( timeout_ms );
+    }
+    else
+    {
+        mqtt_status = MQTTIllegalState;
+    }
+
+    return mqtt_status;
+}
+
+error_code_module_t mqtt_Route( const char *filter, router_handler_t handler, void *context )
+{
+    error_code_module_t error;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.route_mutex, QUEUE_WAIT_TIME ) )
+    {
+        error = router.Add( &mqtt_obj.router, filter, strlen( filter ), handler, context );
+        os.GiveSemaphore( mqtt_obj.route_mutex );
+    }
+    else
+    {
+        error = ERROR_MQTT_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t mqtt_Unroute( const char *filter, router_handler_t handler )
+{
+    error_code_module_t error;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.route_mutex, QUEUE_WAIT_TIME ) )
+    {
+        error = router.Remove( &mqtt_obj.router, filter, strlen( filter ), handler );
+        os.GiveSemaphore( mqtt_obj.route_mutex );
+    }
+    else
+    {
+        error = ERROR_MQTT_NOT_INIT;
+    }
+
+    return error;
+}
+
+error_code_module_t mqtt_Compress( const char *filter, bool enable )
+{
+    error_code_module_t error;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.compress_mutex, QUEUE_WAIT_TIME ) )
+    {
+        if ( enable )
+        {
+            error = router.Add( &mqtt_obj.compress_topics, filter, strlen( filter ), mqtt_CompressMatch, NULL );
+        }
+        else
+        {
+            error = router.Remove( &mqtt_obj.compress_topics, filter, strlen( filter ), mqtt_CompressMatch );
+        }
+        os.GiveSemaphore( mqtt_obj.compress_mutex );
+    }
+    else
+    {
+        error = ERROR_MQTT_NOT_INIT;
+    }
+
+    return error;
+}
+
+MQTTStatus_t mqtt_Enqueue( const char *topic, const uint8_t *payload, size_t payload_length, bool store, uint32_t sequence, mqtt_complete_t callback, void *context )
+{
+    MQTTAgentCommandContext_t *slot = NULL;
+    size_t topic_length = strlen( topic );
+    size_t compressed_length;
+    MQTTStatus_t mqtt_status = mqtt_TakeSlot( &slot, topic, topic_length + payload_length );
+
+    if ( mqtt_status == MQTTSuccess )
+    {
+        compressed_length = mqtt_Deflate( topic, topic_length, payload, payload_length, &slot->buffer[ topic_length ] );
+        if ( compressed_length > 0 )
+        {
+            payload_length = compressed_length;
+        }
+        else
+        {
+            memcpy( &slot->buffer[ topic_length ], payload, payload_length );
+        }
+        mqtt_status = mqtt_PostSlot( slot, topic_length, payload_length, store, sequence, callback, context );
+    }
+
+    return mqtt_status;
+}
+
+size_t mqtt_Deflate( const char *topic, size_t topic_length, const uint8_t *payload, size_t payload_length, uint8_t *buffer )
+{
+    uint32_t compressed_length = 0;
+    MQTTPublishInfo_t publish_info = { 0 };
+
+    // A failed publish is journalled compressed, and its replay must not wrap it a second time
+    if ( payload_length >= MQTT_COMPRESS_MIN && !compress.IsCompressed( payload, payload_length ) &&
+         os.TakeSemaphore( mqtt_obj.compress_mutex, QUEUE_WAIT_TIME ) )
+    {
+        publish_info.pTopicName = topic;
+        publish_info.topicNameLength = topic_length;
+        if ( router.Route( &mqtt_obj.compress_topics, &publish_info ) > 0 )
+        {
+            // Only a payload that gets smaller fits the buffer
+            if ( compress.Begin( &mqtt_obj.compressor, buffer, payload_length - 1 ) == NO_ERROR &&
+                 compress.Write( &mqtt_obj.compressor, payload, payload_length ) == NO_ERROR &&
+                 compress.End( &mqtt_obj.compressor, &compressed_length ) == NO_ERROR )
+            {
+                mqtt_obj.compress_stats.compressed++;
+                mqtt_obj.compress_stats.bytes_in += payload_length;
+                mqtt_obj.compress_stats.bytes_out += compressed_length;
+            }
+            else
+            {
+                mqtt_obj.compress_stats.incompressible++;
+                compressed_length = 0;
+            }
+        }
+        os.GiveSemaphore( mqtt_obj.compress_mutex );
+    }
+
+    return compressed_length;
+}
+
+void mqtt_CompressMatch( const MQTTPublishInfo_t *publish_info, void *context )
+{
+    // Nothing to do: Route counting the match is the answer
+}
+
+MQTTStatus_t mqtt_TakeSlot( MQTTAgentCommandContext_t **slot, const char *topic, size_t size )
+{
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+    // Take a slot of the window, waiting for a PUBACK if there is none
+    if ( !os.QueueReceive( mqtt_obj.free_slots, slot, 0 ) )
+    {
+        mqtt_obj.window_stats.window_full++;
+        if ( !os.QueueReceive( mqtt_obj.free_slots, slot, MQTT_FLUSH_TIMEOUT ) )
+        {
+            mqtt_status = MQTTRecvFailed;
+        }
+    }
+
+    // Keep topic and payload until the PUBACK arrives
+    if ( mqtt_status == MQTTSuccess && ( ( *slot )->buffer = pool.Alloc( size ) ) == NULL )
+    {
+        os.QueueSend( mqtt_obj.free_slots, slot, 0 );
+        mqtt_status = MQTTNoMemory;
+    }
+    if ( mqtt_status == MQTTSuccess )
+    {
+        memcpy( ( *slot )->buffer, topic, strlen( topic ) );
+    }
+
+    return mqtt_status;
+}
+
+MQTTStatus_t mqtt_PostSlot( MQTTAgentCommandContext_t *slot, size_t topic_length, size_t payload_length, bool store, uint32_t sequence, mqtt_complete_t callback, void *context )
+{
+    MQTTStatus_t mqtt_status;
+    MQTTAgentCommandInfo_t command_info =
+    {
+        .cmdCompleteCallback = mqtt_PublishDone,
+        .pCmdCompleteCallbackContext = slot,
+        .blockTimeMs = QUEUE_WAIT_TIME,
+    };
+
+    slot->task = NULL;
+    slot->status = MQTTSuccess;
+    slot->callback = callback;
+    slot->context = context;
+    slot->store = store;
+    slot->sequence = sequence;
+    slot->publish_info = mqtt_obj.session.publish_info;
+    slot->publish_info.pTopicName = ( const char * )slot->buffer;
+    slot->publish_info.topicNameLength = topic_length;
+    slot->publish_info.pPayload = &slot->buffer[ topic_length ];
+    slot->publish_info.payloadLength = payload_length;
+    mqtt_status = MQTTAgent_Publish( &mqtt_obj.agent, &slot->publish_info, &command_info );
+    if ( mqtt_status == MQTTSuccess )
+    {
+        mqtt_obj.window_stats.published++;
+    }
+    else
+    {
+        mqtt_ReleaseSlot( slot );
+    }
+
+    return mqtt_status;
+}
+
+void mqtt_ReleaseSlot( MQTTAgentCommandContext_t *slot )
+{
+    pool.Free( slot->buffer );
+    slot->buffer = NULL;
+    os.QueueSend( mqtt_obj.free_slots, &slot, 0 );
+}
+
+void mqtt_PublishDone( MQTTAgentCommandContext_t *command_context, MQTTAgentReturnInfo_t *return_info )
+{
+    uint16_t packet_id = 0;
+    uint32_t i;
+
+    // The PUBACK entry is still listed while its command completes
+    for ( i = 0; i < MQTT_AGENT_MAX_OUTSTANDING_ACKS; i++ )
+    {
+        if ( mqtt_obj.agent.pPendingAcks[ i ].packetId != MQTT_PACKET_ID_INVALID &&
+             mqtt_obj.agent.pPendingAcks[ i ].pOriginalCommand->pCmdContext == command_context )
+        {
+            packet_id = mqtt_obj.agent.pPendingAcks[ i ].packetId;
+            break;
+        }
+    }
+
+    if ( command_context->callback != NULL )
+    {
+        command_context->callback( packet_id, return_info->returnCode, command_context->context );
+    }
+    if ( return_info->returnCode == MQTTSuccess )
+    {
+        mqtt_obj.window_stats.acked++;
+        if ( command_context->sequence != 0 )
+        {
+            fs.JournalAck( command_context->sequence );
+        }
+    }
+    else
+    {
+        mqtt_obj.window_stats.failed++;
+
+        // A replayed record that failed is still in the journal, and the next replay starts from it
+        if ( command_context->sequence != 0 && command_context->sequence <= mqtt_obj.replayed )
+        {
+            mqtt_obj.replayed = command_context->sequence - 1;
+        }
+
+        // A replayed record is still in the journal; a new message is added to it, if it fits a record
+        if ( command_context->store &&
+             fs.JournalAppend( command_context->publish_info.pTopicName,
+                               command_context->publish_info.topicNameLength,
+                               command_context->publish_info.pPayload,
+                               command_context->publish_info.payloadLength,
+                               0 ) != NO_ERROR )
+        {
+            mqtt_obj.window_stats.lost++;
+            Log.ErrorPrint( "Publish of %d bytes lost, not journalled", command_context->publish_info.payloadLength );
+        }
+    }
+    mqtt_ReleaseSlot( command_context );
+}
+
+uint32_t mqtt_Replay( void )
+{
+    char topic[ SHORT_MSG_MAX + 1 ];
+    uint8_t payload[ SHORT_MSG_MAX ];
+    uint16_t payload_length;
+    uint32_t sequence = mqtt_obj.replayed;
+    uint32_t count = 0;
+
+    // Stored messages go out in order, pipelined through the window like any other publish; those enqueued before are
+    // still with the agent
+    while ( mqtt_obj.is_connected &&
+            fs.JournalRead( sequence, &sequence, topic, payload, &payload_length ) == NO_ERROR &&
+            mqtt_Enqueue( topic, payload, payload_length, false, sequence, NULL, NULL ) == MQTTSuccess )
+    {
+        mqtt_obj.replayed = sequence;
+        count++;
+    }
+    if ( count > 0 )
+    {
+        Log.InfoPrint( "Replayed %d stored messages", count );
+    }
+
+    return count;
+}
+
+MQTTStatus_t mqtt_WaitWindow( uint32_t timeout_ms )
+{
+    uint32_t start = os.GetTickCountMs();
+
+    while ( os.QueueMessagesWaiting( mqtt_obj.free_slots ) < mqtt_obj.window )
+    {
+        if ( os.GetTickCountMs() - start >= timeout_ms )
+        {
+            return MQTTRecvFailed;
+        }
+        os.Delay( MQTT_ACK_POLL );
+    }
+
+    return MQTTSuccess;
+}
+
+bool mqtt_SetWindow( uint32_t window )
+{
+    MQTTAgentCommandContext_t *slot;
+    bool result = true;
+    uint32_t i;
+
+    // Only called while no publish is in flight
+    while ( os.QueueReceive( mqtt_obj.free_slots, &slot, 0 ) );
+    for ( i = 0; i < window && result; i++ )
+    {
+        slot = &mqtt_obj.inflight[ i ];
+        result = os.QueueSend( mqtt_obj.free_slots, &slot, 0 );
+    }
+    mqtt_obj.window = window;
+
+    return result;
+}
+
+void mqtt_Status( void )
+{
+    if ( mqtt_obj.is_subscribed )
+    {
+        Log.Print( "MQTT is subscribed.\r\n" );
+        Log.Print( "MQTT username: %s\r\n", mqtt_obj.session.connection_info.pUserName );
         Log.Print( "Subscribed topic: %s\r\n", mqtt_obj.session.topic );
     }
     else
     {
         Log.Print( "MQTT is not subscribed.\r\n" );
     }
+    if ( mqtt_obj.is_connected )
+    {
+        Log.Print( "MQTT connection established with %s.\r\n", MQTT_ENDPOINT );
+    }
+    else if ( mqtt_obj.state != mqtt_state_idle )
+    {
+        Log.Print( "MQTT reconnecting to %s.\r\n", MQTT_ENDPOINT );
+    }
+    Log.Print( "Publish window: %d of %d in flight\r\n",
+               mqtt_obj.window - os.QueueMessagesWaiting( mqtt_obj.free_slots ),
+               mqtt_obj.window );
+    Log.Print( "Publishes: %d sent, %d acknowledged, %d failed, %d lost, %d waited for window\r\n",
+               mqtt_obj.window_stats.published,
+               mqtt_obj.window_stats.acked,
+               mqtt_obj.window_stats.failed,
+               mqtt_obj.window_stats.lost,
+               mqtt_obj.window_stats.window_full );
+    Log.Print( "Compression: %d publishes, %d -> %d bytes, %d not smaller\r\n",
+               mqtt_obj.compress_stats.compressed,
+               mqtt_obj.compress_stats.bytes_in,
+               mqtt_obj.compress_stats.bytes_out,
+               mqtt_obj.compress_stats.incompressible );
+    transport.Report( &mqtt_obj.read_ahead, mqtt_obj.rx_packets );
+    if ( os.TakeSemaphore( mqtt_obj.route_mutex, QUEUE_WAIT_TIME ) )
+    {
+        router.Report( &mqtt_obj.router );
+        os.GiveSemaphore( mqtt_obj.route_mutex );
+    }
+    Log.Print( "Reconnects: %d drops, %d attempts, %d reconnected, %d resumed, %d given up\r\n",
+               mqtt_obj.reconnect_stats.drops,
+               mqtt_obj.reconnect_stats.attempts,
+               mqtt_obj.reconnect_stats.reconnects,
+               mqtt_obj.reconnect_stats.resumed,
+               mqtt_obj.reconnect_stats.exhausted );
+    if ( mqtt_obj.reconnect_stats.reconnects > 0 )
+    {
+        Log.Print( "Reconnect time: last %d ms, mean %d ms, max %d ms (backoff %d to %d ms)\r\n",
+                   mqtt_obj.reconnect_stats.last_ms,
+                   mqtt_obj.reconnect_stats.total_ms / mqtt_obj.reconnect_stats.reconnects,
+                   mqtt_obj.reconnect_stats.max_ms,
+                   MQTT_RECONNECT_BASE_MS,
+                   MQTT_RECONNECT_MAX_MS );
+    }
+    fs.JournalStatus();
 }
 
 bool mqtt_isInit( void )
@@ -474,6 +1322,177 @@ bool mqtt_isInit( void )
     return mqtt_obj.is_init && modem.Registered();
 }
 
+#if MQTT_BENCHMARK_ENABLED
+void mqtt_Benchmark( uint32_t latency_ms, uint32_t count )
+{
+    uint32_t window, i, start, elapsed;
+    MQTTStatus_t mqtt_status = MQTTSuccess;
+
+    if ( mqtt_obj.is_init == true && os.TakeSemaphore( mqtt_obj.mutex_handle, QUEUE_WAIT_TIME ) )
+    {
+        if ( mqtt_obj.is_subscribed || mqtt_obj.is_connected )
+        {
+            Log.Print( "Unsubscribe before running the benchmark\r\n" );
+        }
+        else
+        {
+            // The agent task connects to the simulated link instead of the broker
+            memset( &mqtt_obj.bench, 0, sizeof( mqtt_obj.bench ) );
+            mqtt_obj.bench.latency_ms = latency_ms;
+            mqtt_obj.bench.active = true;
+            mqtt_status = mqtt_Start();
+
+            Log.Print( "QoS1 publishes over simulated link, %d ms round trip, %d messages\r\n", latency_ms, count );
+            for ( window = 1; window <= MQTT_WINDOW_SIZE && mqtt_status == MQTTSuccess; window <<= 1 )
+            {
+                mqtt_SetWindow( window );
+                start = os.GetTickCountMs();
+                for ( i = 0; i < count && mqtt_status == MQTTSuccess; i++ )
+                {
+                    mqtt_status = mqtt_Enqueue( MQTT_BENCH_TOPIC, ( uint8_t * )MQTT_BENCH_MESSAGE, strlen( MQTT_BENCH_MESSAGE ), false, 0, NULL, NULL );
+                }
+                if ( mqtt_status == MQTTSuccess )
+                {
+                    mqtt_status = mqtt_WaitWindow( MQTT_FLUSH_TIMEOUT );
+                }
+                elapsed = os.GetTickCountMs() - start;
+                if ( elapsed == 0 )
+                {
+                    elapsed = 1;
+                }
+
+                Log.Print( "Window %2d: %6d ms, %d.%02d messages/s\r\n",
+                           window,
+                           elapsed,
+                           count * 1000 / elapsed,
+                           ( count * 100000 / elapsed ) % 100 );
+            }
+            if ( mqtt_status != MQTTSuccess )
+            {
+                Log.Print( "Benchmark failed: %s\r\n", MQTT_Status_strerror( mqtt_status ) );
+            }
+
+            // Disconnecting fails anything left over from a failed run and returns its slots
+            mqtt_Stop();
+            mqtt_WaitWindow( MQTT_FLUSH_TIMEOUT );
+            mqtt_SetWindow( MQTT_WINDOW_SIZE );
+            mqtt_obj.bench.active = false;
+        }
+        os.GiveSemaphore( mqtt_obj.mutex_handle );
+    }
+}
+
+void mqtt_BenchRespond( const uint8_t *packet, uint32_t length, uint32_t delay_ms )
+{
+    mqtt_bench_t *bench = &mqtt_obj.bench;
+    mqtt_bench_response_t *response;
+
+    if ( bench->count < MQTT_BENCH_RESPONSES )
+    {
+        response = &bench->response[ ( bench->head + bench->count ) % MQTT_BENCH_RESPONSES ];
+        memcpy( response->packet, packet, length );
+        response->length = length;
+        response->due = os.GetTickCountMs() + delay_ms;
+        bench->count++;
+    }
+}
+
+int32_t mqtt_BenchReceive( NetworkContext_t *context, void *buffer, size_t size )
+{
+    mqtt_bench_t *bench = &mqtt_obj.bench;
+
+    if ( bench->offset >= bench->current.length )
+    {
+        // Nothing to read until the broker would have answered the oldest packet
+        if ( bench->count == 0 || ( int32_t )( bench->response[ bench->head ].due - os.GetTickCountMs() ) > 0 )
+        {
+            return 0;
+        }
+        bench->current = bench->response[ bench->head ];
+        bench->head = ( bench->head + 1 ) % MQTT_BENCH_RESPONSES;
+        bench->count--;
+        bench->offset = 0;
+    }
+
+    if ( size > bench->current.length - bench->offset )
+    {
+        size = bench->current.length - bench->offset;
+    }
+    memcpy( buffer, &bench->current.packet[ bench->offset ], size );
+    bench->offset += size;
+
+    return size;
+}
+
+int32_t mqtt_BenchTransmit( NetworkContext_t *context, const void * buffer, size_t size )
+{
+    mqtt_bench_t *bench = &mqtt_obj.bench;
+    const uint8_t *packet = buffer;
+    uint32_t remaining_length = 0, shift = 0, i = 1, topic_length;
+    uint8_t response[ 4 ];
+
+    if ( bench->skip == 0 )
+    {
+        // Fixed header: type, remaining length
+        do
+        {
+            remaining_length |= ( packet[ i ] & 0x7f ) << shift;
+            shift += 7;
+        } while ( packet[ i++ ] & 0x80 );
+        bench->skip = i + remaining_length;
+
+        switch ( packet[ 0 ] & 0xf0 )
+        {
+        case MQTT_PACKET_TYPE_CONNECT:
+            response[ 0 ] = MQTT_PACKET_TYPE_CONNACK;
+            response[ 1 ] = 2;
+            response[ 2 ] = 0;
+            response[ 3 ] = 0;
+            mqtt_BenchRespond( response, 4, 0 );
+            break;
+
+        case MQTT_PACKET_TYPE_PUBLISH:
+            // Variable header: topic, packet id
+            topic_length = ( packet[ i ] << 8 ) | packet[ i + 1 ];
+            i += 2 + topic_length;
+            response[ 0 ] = MQTT_PACKET_TYPE_PUBACK;
+            response[ 1 ] = 2;
+            response[ 2 ] = packet[ i ];
+            response[ 3 ] = packet[ i + 1 ];
+            mqtt_BenchRespond( response, 4, bench->latency_ms );
+            break;
+
+        case MQTT_PACKET_TYPE_PINGREQ:
+            response[ 0 ] = MQTT_PACKET_TYPE_PINGRESP;
+            response[ 1 ] = 0;
+            mqtt_BenchRespond( response, 2, bench->latency_ms );
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    // Track the rest of the packet when header and payload are sent separately
+    bench->skip = ( size >= bench->skip ) ? 0 : bench->skip - size;
+
+    return size;
+}
+
+int32_t mqtt_BenchTransmitV( NetworkContext_t *context, TransportOutVector_t *iov, size_t count )
+{
+    int32_t size = 0;
+    size_t i;
+
+    for ( i = 0; i < count; i++ )
+    {
+        size += mqtt_BenchTransmit( context, iov[ i ].iov_base, iov[ i ].iov_len );
+    }
+
+    return size;
+}
+#endif
+
 /**
  * @} Mqtt
  */
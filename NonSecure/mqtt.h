@@ -22,9 +22,17 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "core_mqtt.h"
+#include "core_mqtt_agent.h"
+#include "backoff_algorithm.h"
 #include "transport_interface.h"
+#include "transport.h"
+#include "router.h"
+#include "telemetry.h"
+#include "compress.h"
+#include "fs.h"
 #include "os.h"
 #include "dmm.h"
+#include "pool.h"
 #include "app.h"
 #include "log.h"
 #include "twdt.h"
@@ -34,6 +42,38 @@
  * Public constants and macros
  */
 
+#ifndef MQTT_WINDOW_SIZE
+#define MQTT_WINDOW_SIZE                ( 4 )           /*!< QoS1 publishes allowed in flight before waiting for PUBACK */
+#endif
+
+#ifndef MQTT_PAYLOAD_CBOR
+#define MQTT_PAYLOAD_CBOR               ( 1 )           /*!< Send publishes a CBOR record; 0 for the quoted text payload */
+#endif
+
+#ifndef MQTT_TELEMETRY_MAX
+#define MQTT_TELEMETRY_MAX              ( SHORT_MSG_MAX ) /*!< largest record of Telemetry */
+#endif
+
+#ifndef MQTT_COMPRESS_MIN
+#define MQTT_COMPRESS_MIN               ( 64 )          /*!< shorter payloads are sent as they are, even on compressed topics */
+#endif
+
+#ifndef MQTT_RECONNECT_BASE_MS
+#define MQTT_RECONNECT_BASE_MS          ( 1000 )        /*!< longest wait before the first reconnect attempt */
+#endif
+
+#ifndef MQTT_RECONNECT_MAX_MS
+#define MQTT_RECONNECT_MAX_MS           ( 60000 )       /*!< cap of the wait between reconnect attempts (at most 65535) */
+#endif
+
+#ifndef MQTT_RECONNECT_ATTEMPTS
+#define MQTT_RECONNECT_ATTEMPTS         ( BACKOFF_ALGORITHM_RETRY_FOREVER ) /*!< attempts before the session is given up */
+#endif
+
+#ifndef MQTT_BENCHMARK_ENABLED
+#define MQTT_BENCHMARK_ENABLED          ( 0 )
+#endif
+
 /***************************************************************************************************************************
  * Public data structures and typedefs
  */
@@ -49,13 +89,32 @@ typedef enum
     mqtt_stat,
 } mqtt_type_t;
 
+/**
+ * @brief Completion callback of a windowed publish, called with MQTTSuccess when the PUBACK is received.
+ */
+typedef void ( *mqtt_complete_t )( uint16_t packet_id, MQTTStatus_t status, void *context );
+
+/**
+ * @brief Adds the fields of a telemetry record. Sequence number and time stamp are already in it.
+ */
+typedef void ( *mqtt_encode_t )( telemetry_t *encoder, void *context );
+
 typedef struct
 {
     error_code_module_t ( *Init )( void );
     MQTTStatus_t ( *Subscribe )( char *topic );
     MQTTStatus_t ( *Unsubscribe )( void );
     MQTTStatus_t ( *Send )( char* topic, char *msg );
+    MQTTStatus_t ( *Publish )( char *topic, char *msg, mqtt_complete_t callback, void *context );
+    MQTTStatus_t ( *Telemetry )( char *topic, mqtt_encode_t encode, void *encode_context, mqtt_complete_t callback, void *context );
+    MQTTStatus_t ( *Flush )( uint32_t timeout_ms );
+    error_code_module_t ( *Route )( const char *filter, router_handler_t handler, void *context );
+    error_code_module_t ( *Unroute )( const char *filter, router_handler_t handler );
+    error_code_module_t ( *Compress )( const char *filter, bool enable );
     void ( *Status )( void );
+#if MQTT_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t latency_ms, uint32_t count );
+#endif
     bool ( *isInit )( void );
 } const mqtt_interface_t;
 
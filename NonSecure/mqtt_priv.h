@@ -44,6 +44,66 @@
 #define MQTT_TOPIC              "test"
 #define MQTT_TOPIC_LENGTH       ( ( sizeof( MQTT_TOPIC ) - 1 ) )
 #define MQTT_MESSAGE_EXAMPLE    "Hello World!"
+#define MQTT_MESSAGE_KEY        "msg"           /*!< field of the CBOR record holding the text of Send */
+#define MQTT_FLUSH_TIMEOUT      ( 10000 )
+#define MQTT_CONNECT_TIMEOUT    ( 15000 )       /*!< socket and TLS setup plus CONNACK */
+#define MQTT_COMMAND_TIMEOUT    ( 10000 )       /*!< report a subscribe or unsubscribe still waiting for its ACK */
+#define MQTT_IDLE_POLL          ( 1000 )        /*!< agent task: cancel stale commands while not connected */
+#define MQTT_ACK_POLL           ( 10 )          /*!< agent task: command wait while ACKs are outstanding */
+#define MQTT_RECV_WAIT          ( 20 )          /*!< agent task: socket receive wait per transport read */
+#define MQTT_ROUTE_LEVELS       ( 32 )
+#define MQTT_ROUTE_COUNT        ( 8 )
+#define MQTT_COMPRESS_LEVELS    ( 16 )
+#define MQTT_COMPRESS_COUNT     ( 4 )           /*!< topic filters publishing compressed payloads */
+#define MQTT_EVENT_CONNECTED    ( 1 << 0 )
+#define MQTT_EVENT_FAILED       ( 1 << 1 )
+#define MQTT_EVENT_DISCONNECTED ( 1 << 2 )
+#define MQTT_RANDOM_SEED        ( 2166136261UL )    /*!< FNV-1a offset basis, hashed with the client ID */
+#define MQTT_RANDOM_PRIME       ( 16777619UL )      /*!< FNV-1a prime */
+#if MQTT_BENCHMARK_ENABLED
+#define MQTT_BENCH_TOPIC        "bench"
+#define MQTT_BENCH_MESSAGE      "0123456789abcdef0123456789abcdef"
+#define MQTT_BENCH_RESPONSES    ( MQTT_WINDOW_SIZE + 1 )
+#endif
+
+#if MQTT_WINDOW_SIZE < 1 || MQTT_WINDOW_SIZE > MQTT_STATE_ARRAY_MAX_COUNT
+#error "MQTT_WINDOW_SIZE must be between 1 and MQTT_STATE_ARRAY_MAX_COUNT"
+#endif
+
+/*
+ * @note
+ * The connection is owned by the MQTT agent task (coreMQTT-Agent). Other tasks never touch the socket: Subscribe,
+ * Unsubscribe and Publish post commands to the agent's mailbox and return, or wait on a task notification, while the
+ * agent task sends the packets, runs the process loop and keeps the connection alive. Opening a session wakes the agent
+ * task, which connects and runs MQTTAgent_CommandLoop() until it is told to disconnect or the connection fails; while
+ * not connected it cancels whatever is posted to it. No network I/O happens in the timer task.
+ *
+ * QoS1 publishes are pipelined: up to MQTT_WINDOW_SIZE of them may wait for their PUBACK at the same time. Each one
+ * owns a window slot (a command context plus a pool buffer holding topic and payload) until the agent reports its
+ * completion through mqtt_PublishDone(), which calls the callback given to Publish and returns the slot. Incoming
+ * publishes are routed from the agent task; the router has its own mutex, so handlers can be added at any time. The
+ * project builds coreMQTT with MQTT_STATE_INDEXED, so finding the state record of an acknowledged packet does not scan
+ * the whole window.
+ *
+ * When the connection of an open session drops, the agent task connects again after a random wait of up to
+ * MQTT_RECONNECT_BASE_MS, doubling the limit after every failed attempt up to MQTT_RECONNECT_MAX_MS ("full jitter", so a
+ * fleet that lost its broker at the same moment does not come back at the same moment). Sessions are persistent
+ * (cleanSession = false): if the broker kept the session, publishes still waiting for their PUBACK are sent again with
+ * the DUP flag; otherwise they fail and the subscription is made again. Commands posted while reconnecting wait in the
+ * mailbox. Closing the session stops the attempts.
+ *
+ * Messages of Send that cannot be delivered are handed to the publish journal of the file system task. Opening a
+ * session replays the journal through the window before anything new is published; a replayed record is removed from
+ * the journal when its PUBACK arrives, so a record may be delivered twice but is not lost. A replay carries on after the
+ * last record it enqueued: the agent resends those itself when the broker kept the session. The replay starts over
+ * when the session is opened or lost, and from a replayed record that failed.
+ *
+ * Payloads of at least MQTT_COMPRESS_MIN bytes published to a topic that matches a filter given to Compress are
+ * compressed (compress module) straight into the window slot, if that makes them smaller. MQTT 3.1.1 has no content
+ * type, so the receiver tells them apart by COMPRESS_MARKER, which starts neither a CBOR record nor text. There is one
+ * encoder, guarded by its own mutex. A publish that fails goes to the journal as it was sent, so a replayed payload
+ * may already be compressed; one that starts with COMPRESS_MARKER is never compressed again.
+ */
 
 /***************************************************************************************************************************
  * Private data structures and typedefs
@@ -56,24 +116,141 @@ struct NetworkContext
 
 typedef struct
 {
-    MQTTContext_t               context;
     MQTTConnectInfo_t           connection_info;
     MQTTPublishInfo_t           publish_info;
     MQTTSubscribeInfo_t         subscribe_info[ MQTT_TOPIC_COUNT ];
     char                        topic[ SHORT_MSG_MAX ];
 } mqtt_session_t;
 
+/**
+ * @brief Messaging context of the agent: commands are posted to a mailbox that also provides the command buffers.
+ */
+struct MQTTAgentMessageContext
+{
+    MailboxHandle_t             mailbox;
+};
+
+/**
+ * @brief Completion context of a command. Subscribe and unsubscribe use one on the caller's stack and wait for the
+ *        notification; each window slot holds one for a publish.
+ */
+struct MQTTAgentCommandContext
+{
+    TaskHandle_t                task;               /*!< task to notify on completion, NULL for publishes */
+    MQTTStatus_t                status;
+    mqtt_complete_t             callback;
+    void                        *context;
+    MQTTPublishInfo_t           publish_info;
+    uint8_t                     *buffer;            /*!< topic followed by payload */
+    bool                        store;              /*!< keep the publish in the journal if it fails */
+    uint32_t                    sequence;           /*!< journal record being replayed, 0 for none */
+    volatile bool               done;               /*!< set by the agent when it completed the command */
+};
+
+typedef enum
+{
+    mqtt_state_idle,                                /*!< no session */
+    mqtt_state_connecting,
+    mqtt_state_connected,
+    mqtt_state_backoff,                             /*!< waiting to reconnect after the connection dropped */
+} mqtt_state_t;
+
+typedef struct
+{
+    uint32_t                    drops;              /*!< connections lost while the session was open */
+    uint32_t                    attempts;           /*!< reconnect attempts */
+    uint32_t                    reconnects;         /*!< drops followed by a new connection */
+    uint32_t                    resumed;            /*!< reconnects where the broker kept the session */
+    uint32_t                    exhausted;          /*!< drops after which the session was given up */
+    uint32_t                    last_ms;            /*!< time from drop to reconnect, last reconnect */
+    uint32_t                    max_ms;
+    uint32_t                    total_ms;           /*!< sum over all reconnects, for the mean */
+} mqtt_reconnect_stats_t;
+
+typedef struct
+{
+    uint32_t                    published;          /*!< QoS1 publishes sent */
+    uint32_t                    acked;              /*!< PUBACKs matched */
+    uint32_t                    failed;             /*!< publishes dropped by a disconnect */
+    uint32_t                    lost;               /*!< failed publishes the journal did not take */
+    uint32_t                    window_full;        /*!< publishes that had to wait for a free slot */
+} mqtt_window_stats_t;
+
+typedef struct
+{
+    uint32_t                    compressed;         /*!< publishes sent compressed */
+    uint32_t                    incompressible;     /*!< publishes on compressed topics that did not get smaller */
+    uint32_t                    bytes_in;           /*!< payload bytes before compression */
+    uint32_t                    bytes_out;          /*!< the same payloads compressed */
+} mqtt_compress_stats_t;
+
+#if MQTT_BENCHMARK_ENABLED
+typedef struct
+{
+    uint8_t                     packet[ 4 ];
+    uint32_t                    length;
+    uint32_t                    due;                /*!< time the simulated broker sends the packet */
+} mqtt_bench_response_t;
+
+typedef struct
+{
+    bool                        active;             /*!< next connection uses the simulated link */
+    uint32_t                    latency_ms;         /*!< simulated round-trip time */
+    uint32_t                    skip;               /*!< bytes of current outgoing packet still to come */
+    mqtt_bench_response_t       response[ MQTT_BENCH_RESPONSES ];
+    uint32_t                    head;
+    uint32_t                    count;
+    mqtt_bench_response_t       current;            /*!< response being read by coreMQTT */
+    uint32_t                    offset;
+} mqtt_bench_t;
+#endif
+
 typedef struct
 {
     bool                        is_init;
     bool                        is_subscribed;
+    volatile bool               is_connected;
+    volatile mqtt_state_t       state;              /*!< set by the agent task */
+    volatile bool               closing;            /*!< session closed, stop reconnecting */
+    volatile bool               replay;             /*!< reconnected: replay the journal with the next Send */
+    volatile uint32_t           replayed;           /*!< last journal record enqueued by a replay, 0 for none */
+    bool                        session_present;    /*!< broker kept the session on the last connect */
+    uint32_t                    random;             /*!< jitter generator state */
     uint32_t                    sequence_number;
+    uint32_t                    rx_packets;
     NetworkContext_t            net_context;
     mqtt_session_t              session;
+    MQTTAgentContext_t          agent;
+    MQTTAgentMessageContext_t   message_context;
     MQTTFixedBuffer_t           buffer;
+    uint8_t                     network_buffer[ LONG_MSG_MAX ];
+    TransportInterface_t        socket_transport;
     TransportInterface_t        transport;
-    SemaphoreHandle_t           mutex_handle;
-    TimerHandle_t               timer_handle;
+    transport_buffer_t          read_ahead;
+    uint8_t                     read_ahead_buffer[ TRANSPORT_READ_AHEAD_SIZE ];
+    TaskHandle_t                task_handle;
+    EventGroupHandle_t          event_handle;
+    SemaphoreHandle_t           mutex_handle;       /*!< serializes opening and closing the session */
+    SemaphoreHandle_t           route_mutex;        /*!< protects the router */
+    QueueHandle_t               free_slots;         /*!< window slots available to publishes */
+    uint32_t                    window;
+    MQTTAgentCommandContext_t   inflight[ MQTT_WINDOW_SIZE ];
+    mqtt_window_stats_t         window_stats;
+    mqtt_reconnect_stats_t      reconnect_stats;
+    MQTTAgentSubscribeArgs_t    resubscribe_args;   /*!< subscribe posted by the agent task after a lost session */
+    router_table_t              router;
+    router_node_t               route_levels[ MQTT_ROUTE_LEVELS ];
+    router_route_t              routes[ MQTT_ROUTE_COUNT ];
+    SemaphoreHandle_t           compress_mutex;     /*!< protects the compressed topics and the encoder */
+    router_table_t              compress_topics;
+    router_node_t               compress_levels[ MQTT_COMPRESS_LEVELS ];
+    router_route_t              compress_routes[ MQTT_COMPRESS_COUNT ];
+    compress_t                  compressor;
+    mqtt_compress_stats_t       compress_stats;
+#if MQTT_BENCHMARK_ENABLED
+    TransportInterface_t        bench_transport;
+    mqtt_bench_t                bench;
+#endif
 } mqtt_obj_t ;
 
 /***************************************************************************************************************************
@@ -92,24 +269,120 @@ static error_code_module_t mqtt_Init( void );
 static MQTTStatus_t mqtt_Send( char *topic, char *msg );
 static MQTTStatus_t mqtt_Subscribe( char *topic );
 static MQTTStatus_t mqtt_Unsubscribe( void );
+
+/**
+ * @brief       Post a QoS1 publish to the agent task without waiting for its PUBACK. Blocks only while the window is full.
+ * @param[in]   topic       Topic name (NULL for the session topic).
+ * @param[in]   msg         Message payload (null-terminated).
+ * @param[in]   callback    Called when the publish is acknowledged or dropped (may be NULL).
+ * @param[in]   context     Passed to callback.
+ * @return      MQTT status of posting the publish.
+ */
+static MQTTStatus_t mqtt_Publish( char *topic, char *msg, mqtt_complete_t callback, void *context );
+
+/**
+ * @brief       Post a QoS1 publish of a CBOR telemetry record, encoded straight into the buffer the agent sends from.
+ * @param[in]   topic           Topic name (NULL for the session topic).
+ * @param[in]   encode          Adds the fields of the record.
+ * @param[in]   encode_context  Passed to encode.
+ * @param[in]   callback        Called when the publish is acknowledged or dropped (may be NULL).
+ * @param[in]   context         Passed to callback.
+ * @return      MQTT status of posting the publish, MQTTNoMemory when the record exceeds MQTT_TELEMETRY_MAX.
+ */
+static MQTTStatus_t mqtt_Telemetry( char *topic, mqtt_encode_t encode, void *encode_context, mqtt_complete_t callback, void *context );
+
+/**
+ * @brief       Wait until all windowed publishes are acknowledged.
+ * @param[in]   timeout_ms  Maximum time to wait.
+ * @return      MQTT status.
+ */
+static MQTTStatus_t mqtt_Flush( uint32_t timeout_ms );
+
+/**
+ * @brief       Register a handler for incoming publishes matching a topic filter. The broker only delivers topics covered
+ *              by the subscription of the session.
+ * @param[in]   filter      Topic filter, may contain '+' and '#' wildcards.
+ * @param[in]   handler     Called from the MQTT agent task for each matching publish.
+ * @param[in]   context     Passed to handler.
+ * @return      Error code.
+ */
+static error_code_module_t mqtt_Route( const char *filter, router_handler_t handler, void *context );
+
+/**
+ * @brief       Remove a handler registered with mqtt_Route.
+ * @param[in]   filter      Topic filter as registered.
+ * @param[in]   handler     Handler to remove, NULL to remove all handlers of the filter.
+ * @return      Error code.
+ */
+static error_code_module_t mqtt_Unroute( const char *filter, router_handler_t handler );
+
+/**
+ * @brief       Compress payloads published to topics matching a filter, or stop doing so.
+ * @param[in]   filter      Topic filter, may contain '+' and '#' wildcards.
+ * @param[in]   enable      True to compress, false to remove the filter.
+ * @return      Error code.
+ */
+static error_code_module_t mqtt_Compress( const char *filter, bool enable );
 static void mqtt_Status( void );
 static bool mqtt_isInit( void );
+#if MQTT_BENCHMARK_ENABLED
+
+/**
+ * @brief       Measure windowed publish throughput over a simulated link that acknowledges each publish after a fixed
+ *              latency. Prints messages per second for window sizes 1, 2, 4 ... MQTT_WINDOW_SIZE.
+ * @param[in]   latency_ms  Simulated round-trip time.
+ * @param[in]   count       Messages to publish per window size.
+ */
+static void mqtt_Benchmark( uint32_t latency_ms, uint32_t count );
+#endif
 
-static void mqtt_Callback( MQTTContext_t *mqtt_context, MQTTPacketInfo_t *packet_info, MQTTDeserializedInfo_t *deserialized_info );
-static void mqtt_ProcessResponse( MQTTPacketInfo_t *packet_info, uint16_t packet_identifier );
-static void mqtt_ProcessIncomingPublish( MQTTPublishInfo_t *publish_info );
-static void mqtt_Timeout( TimerHandle_t handle );
+static void mqtt_Incoming( MQTTAgentContext_t *agent, uint16_t packet_id, MQTTPublishInfo_t *publish_info );
+static void mqtt_CommandDone( MQTTAgentCommandContext_t *command_context, MQTTAgentReturnInfo_t *return_info );
+static void mqtt_PublishDone( MQTTAgentCommandContext_t *command_context, MQTTAgentReturnInfo_t *return_info );
+static bool mqtt_MessageSend( MQTTAgentMessageContext_t *message_context, MQTTAgentCommand_t * const *command, uint32_t timeout_ms );
+static bool mqtt_MessageReceive( MQTTAgentMessageContext_t *message_context, MQTTAgentCommand_t **command, uint32_t timeout_ms );
+static MQTTAgentCommand_t *mqtt_CommandGet( uint32_t timeout_ms );
+static bool mqtt_CommandRelease( MQTTAgentCommand_t *command );
 
 /***************************************************************************************************************************
  * Private prototypes
  */
 
 /**
- * @brief       MQTT client thread function. Executes and responds to requests.
+ * @brief       MQTT agent thread function. Connects when a session is opened and runs the agent command loop until it
+ *              disconnects.
  * @param[in]   parameter_ptr    Initial parameters passed into thread at start of thread.
  */
+static void mqtt_Thread( void *parameter_ptr );
 static int32_t mqtt_Receive( NetworkContext_t *context, void *buffer, size_t size );
 static int32_t mqtt_Transmit( NetworkContext_t *context, const void * buffer, size_t size );
+static int32_t mqtt_TransmitV( NetworkContext_t *context, TransportOutVector_t *iov, size_t count );
+static MQTTStatus_t mqtt_Connect( void );
+static void mqtt_Disconnect( MQTTStatus_t mqtt_status );
+static MQTTStatus_t mqtt_Reconnect( void );
+static uint32_t mqtt_Random( void );
+static MQTTStatus_t mqtt_Start( void );
+static MQTTStatus_t mqtt_Stop( void );
+static MQTTStatus_t mqtt_Open( char *topic );
+static MQTTStatus_t mqtt_Close( void );
+static MQTTStatus_t mqtt_Command( bool subscribe );
+static MQTTStatus_t mqtt_Enqueue( const char *topic, const uint8_t *payload, size_t payload_length, bool store, uint32_t sequence, mqtt_complete_t callback, void *context );
+static MQTTStatus_t mqtt_TakeSlot( MQTTAgentCommandContext_t **slot, const char *topic, size_t size );
+static MQTTStatus_t mqtt_PostSlot( MQTTAgentCommandContext_t *slot, size_t topic_length, size_t payload_length, bool store, uint32_t sequence, mqtt_complete_t callback, void *context );
+static void mqtt_ReleaseSlot( MQTTAgentCommandContext_t *slot );
+static size_t mqtt_Deflate( const char *topic, size_t topic_length, const uint8_t *payload, size_t payload_length, uint8_t *buffer );
+static void mqtt_CompressMatch( const MQTTPublishInfo_t *publish_info, void *context );
+static uint32_t mqtt_Replay( void );
+static MQTTStatus_t mqtt_WaitWindow( uint32_t timeout_ms );
+static bool mqtt_SetWindow( uint32_t window );
+static void mqtt_SetTopic( const char *topic );
+static void mqtt_PrintPublish( const MQTTPublishInfo_t *publish_info, void *context );
+#if MQTT_BENCHMARK_ENABLED
+static int32_t mqtt_BenchReceive( NetworkContext_t *context, void *buffer, size_t size );
+static int32_t mqtt_BenchTransmit( NetworkContext_t *context, const void * buffer, size_t size );
+static int32_t mqtt_BenchTransmitV( NetworkContext_t *context, TransportOutVector_t *iov, size_t count );
+static void mqtt_BenchRespond( const uint8_t *packet, uint32_t length, uint32_t delay_ms );
+#endif
 
 #endif /* __MQTT_PRIV_H__ */
 
@@ -0,0 +1,304 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      nvmc.c
+ * @brief     NVMC block device module
+ * @details   littlefs block device on the internal flash, with bulk word programs and erases ahead of need.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Nvmc NVMC block device
+ * @brief     Internal flash block device of the file system
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "nvmc_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+nvmc_interface_t nvmc =
+{
+    .Open               = &nvmc_Open,
+    .Read               = &nvmc_Read,
+    .Prog               = &nvmc_Prog,
+    .Erase              = &nvmc_Erase,
+    .Plan               = &nvmc_Plan,
+    .EraseAhead         = &nvmc_EraseAhead,
+    .Report             = &nvmc_Report,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t nvmc_Open( nvmc_device_t *device, uint32_t base, uint32_t block_size, uint32_t block_count )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( device == NULL || ( base & 3 ) != 0 || block_size == 0 || ( block_size & 3 ) != 0 ||
+         block_count == 0 || block_count > NVMC_BLOCK_MAX )
+    {
+        error = ERROR_NVMC_BAD_PARAM;
+    }
+    else
+    {
+        memset( device, 0, sizeof( nvmc_device_t ) );
+        device->base = base;
+        device->block_size = block_size;
+        device->block_count = block_count;
+        device->program = &nvmc_Program;
+        device->erase = &nvmc_PageErase;
+        device->partial = -1;
+        device->dirty = true;
+    }
+
+    return error;
+}
+
+int32_t nvmc_Read( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size )
+{
+    if ( block >= device->block_count || off + size > device->block_size )
+    {
+        return LFS_ERR_INVAL;
+    }
+
+    device->stats.reads++;
+    device->stats.read_bytes += size;
+    memcpy( buffer, ( const void * )( device->base + block * device->block_size + off ), size );
+
+    return LFS_ERR_OK;
+}
+
+int32_t nvmc_Prog( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size )
+{
+    uint32_t chunk[ NVMC_CHUNK_WORDS ];
+    uint32_t address = device->base + block * device->block_size + off;
+    uint32_t done, length;
+    int32_t result = LFS_ERR_OK;
+
+    if ( block >= device->block_count || off + size > device->block_size || ( ( off | size ) & 3 ) != 0 )
+    {
+        return LFS_ERR_INVAL;
+    }
+
+    // The block may have been allocated, so the plan is stale
+    device->erased &= ~( 1UL << block );
+    device->ahead = 0;
+    device->partial = -1;
+    device->dirty = true;
+    device->stats.programs++;
+
+    // The source need not be word aligned, the bulk write needs it
+    for ( done = 0; done < size; done += length )
+    {
+        length = ( size - done < sizeof( chunk ) ) ? size - done : sizeof( chunk );
+        memcpy( chunk, ( const uint8_t * )buffer + done, length );
+        nvmc_Runs( device, address + done, chunk, length / sizeof( uint32_t ) );
+    }
+
+#if NVMC_VERIFY
+    if ( memcmp( ( const void * )address, buffer, size ) != 0 )
+    {
+        device->stats.verify_errors++;
+        result = LFS_ERR_CORRUPT;
+    }
+#endif
+
+    return result;
+}
+
+int32_t nvmc_Erase( nvmc_device_t *device, lfs_block_t block )
+{
+    uint32_t bit = 1UL << block;
+
+    if ( block >= device->block_count )
+    {
+        return LFS_ERR_INVAL;
+    }
+
+    if ( ( device->erased & bit ) != 0 )
+    {
+        device->stats.erases_skipped++;
+    }
+    else
+    {
+        device->erase( device->base + block * device->block_size, 0 );
+        device->erased |= bit;
+        device->stats.erases++;
+    }
+
+    // littlefs goes on allocating after this block
+    device->ahead = 0;
+    device->partial = -1;
+    device->dirty = true;
+    device->cursor = ( block + 1 ) % device->block_count;
+
+    return LFS_ERR_OK;
+}
+
+void nvmc_Plan( nvmc_device_t *device, lfs_t *lfs )
+{
+    uint32_t i, block, bit, ready = 0;
+
+    // Without a program or erase since the last plan, the blocks in use are the same and the plan still holds
+    if ( !device->dirty )
+    {
+        return;
+    }
+
+    device->used = 0;
+    device->ahead = 0;
+    device->partial = -1;
+    if ( lfs_fs_traverse( lfs, nvmc_Used, device ) < 0 )
+    {
+        return;
+    }
+    device->dirty = false;
+
+    // The free blocks after the cursor come next, those already erased count as done
+    for ( i = 0; i < device->block_count && ready < NVMC_ERASE_AHEAD; i++ )
+    {
+        block = ( device->cursor + i ) % device->block_count;
+        bit = 1UL << block;
+        if ( ( device->used & bit ) == 0 )
+        {
+            if ( ( device->erased & bit ) == 0 )
+            {
+                device->ahead |= bit;
+            }
+            ready++;
+        }
+    }
+}
+
+bool nvmc_EraseAhead( nvmc_device_t *device )
+{
+    uint32_t address, bit;
+
+    if ( device->ahead == 0 )
+    {
+        return false;
+    }
+
+    if ( device->partial < 0 )
+    {
+        for ( device->partial = 0; ( device->ahead & ( 1UL << device->partial ) ) == 0; device->partial++ )
+        {
+        }
+        device->elapsed_ms = 0;
+    }
+    bit = 1UL << device->partial;
+    address = device->base + device->partial * device->block_size;
+
+#if NVMC_PARTIAL_ERASE
+    device->erase( address, NVMC_PARTIAL_ERASE_MS );
+    device->elapsed_ms += NVMC_PARTIAL_ERASE_MS;
+#else
+    device->erase( address, 0 );
+    device->elapsed_ms = NVMC_PAGE_ERASE_MS;
+#endif
+
+    if ( device->elapsed_ms >= NVMC_PAGE_ERASE_MS )
+    {
+        device->erased |= bit;
+        device->ahead &= ~bit;
+        device->partial = -1;
+        device->stats.erases_ahead++;
+    }
+
+    return device->ahead != 0;
+}
+
+void nvmc_Report( const nvmc_device_t *device )
+{
+    Log.Print( "NVMC: %d programs in %d runs, %d words programmed, %d erased words skipped\r\n",
+               device->stats.programs,
+               device->stats.runs,
+               device->stats.words,
+               device->stats.words_skipped );
+    Log.Print( "NVMC: %d erases, %d skipped, %d ahead, %d blocks erased now, %d verify errors\r\n",
+               device->stats.erases,
+               device->stats.erases_skipped,
+               device->stats.erases_ahead,
+               __builtin_popcount( device->erased ),
+               device->stats.verify_errors );
+}
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+void nvmc_Runs( nvmc_device_t *device, uint32_t address, const uint32_t *words, uint32_t count )
+{
+    uint32_t i = 0, start;
+
+    while ( i < count )
+    {
+        if ( words[ i ] == NVMC_ERASED_WORD )
+        {
+            device->stats.words_skipped++;
+            i++;
+        }
+        else
+        {
+            for ( start = i; i < count && words[ i ] != NVMC_ERASED_WORD; i++ )
+            {
+            }
+            device->program( address + start * sizeof( uint32_t ), &words[ start ], i - start );
+            device->stats.runs++;
+            device->stats.words += i - start;
+        }
+    }
+}
+
+int32_t nvmc_Used( void *data, lfs_block_t block )
+{
+    nvmc_device_t *device = ( nvmc_device_t * )data;
+
+    device->used |= 1UL << block;
+
+    return LFS_ERR_OK;
+}
+
+void nvmc_Program( uint32_t address, const uint32_t *words, uint32_t count )
+{
+    nrfx_nvmc_words_write( address, words, count );
+}
+
+void nvmc_PageErase( uint32_t address, uint32_t duration_ms )
+{
+#if NVMC_PARTIAL_ERASE
+    if ( duration_ms > 0 )
+    {
+        nrf_nvmc_partial_erase_duration_set( NRF_NVMC, duration_ms );
+        nrf_nvmc_mode_set( NRF_NVMC, NRF_NVMC_MODE_PARTIAL_ERASE );
+        *( volatile uint32_t * )address = NVMC_ERASED_WORD;
+        while ( !nrf_nvmc_ready_check( NRF_NVMC ) )
+        {
+        }
+        nrf_nvmc_mode_set( NRF_NVMC, NRF_NVMC_MODE_READONLY );
+    }
+    else
+    {
+        nrfx_nvmc_page_erase( address );
+    }
+#else
+    ( void )duration_ms;
+    nrfx_nvmc_page_erase( address );
+#endif
+}
+
+/**
+ * @} Nvmc
+ */
+
+/**
+ * @} Application
+ */
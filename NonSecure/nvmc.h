@@ -0,0 +1,122 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      nvmc.h
+ * @brief     NVMC block device module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Nvmc
+ * @{
+ */
+#ifndef __NVMC_H__
+#define __NVMC_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <nrfx_nvmc.h>
+#include <lfs.h>
+#include "os.h"
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define NVMC_BLOCK_MAX                  ( 32 )          /*!< blocks of a device, one bit each in the block maps */
+#define NVMC_ERASED_WORD                ( 0xffffffff )
+
+#ifndef NVMC_VERIFY
+#define NVMC_VERIFY                     ( 0 )           /*!< set to 1 to read back every program and report a mismatch */
+#endif
+
+#ifndef NVMC_ERASE_AHEAD
+#define NVMC_ERASE_AHEAD                ( 2 )           /*!< free blocks kept erased ahead of littlefs */
+#endif
+
+#ifndef NVMC_PARTIAL_ERASE_MS
+#define NVMC_PARTIAL_ERASE_MS           ( 10 )          /*!< slice of an erase ahead where partial erase is available */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Flash operations under the driver: words to program at a word aligned address, and a page to erase, whole
+ *        when duration_ms is 0, else partially for that long.
+ */
+typedef void ( *nvmc_program_t )( uint32_t address, const uint32_t *words, uint32_t count );
+typedef void ( *nvmc_erase_t )( uint32_t address, uint32_t duration_ms );
+
+typedef struct
+{
+    uint32_t                    reads;
+    uint32_t                    read_bytes;
+    uint32_t                    programs;       /*!< program calls of littlefs */
+    uint32_t                    runs;           /*!< bulk programs handed to the NVMC */
+    uint32_t                    words;          /*!< words programmed */
+    uint32_t                    words_skipped;  /*!< erased words left as they were */
+    uint32_t                    erases;         /*!< erases on the way of a request */
+    uint32_t                    erases_skipped; /*!< erases of blocks known to be erased */
+    uint32_t                    erases_ahead;   /*!< erases done while idle */
+    uint32_t                    verify_errors;
+} nvmc_stats_t;
+
+/**
+ * @brief Block device state, owned by the task that owns the littlefs volume on it.
+ */
+typedef struct
+{
+    uint32_t                    base;           /*!< address of block 0 */
+    uint32_t                    block_size;     /*!< flash page size */
+    uint32_t                    block_count;
+    nvmc_program_t              program;
+    nvmc_erase_t                erase;
+    uint32_t                    erased;         /*!< blocks known to be erased */
+    uint32_t                    ahead;          /*!< free blocks to erase while idle */
+    uint32_t                    used;           /*!< blocks in use, found by Plan */
+    bool                        dirty;          /*!< programmed or erased since the last Plan */
+    uint32_t                    cursor;         /*!< block after the one littlefs erased last */
+    int32_t                     partial;        /*!< block of an erase ahead under way, -1 for none */
+    uint32_t                    elapsed_ms;     /*!< erase time spent on it so far */
+    nvmc_stats_t                stats;
+} nvmc_device_t;
+
+/**
+ * Specifies the public interface functions of the NVMC block device.
+ */
+typedef struct
+{
+    error_code_module_t ( *Open )( nvmc_device_t *device, uint32_t base, uint32_t block_size, uint32_t block_count );
+    int32_t ( *Read )( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size );
+    int32_t ( *Prog )( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size );
+    int32_t ( *Erase )( nvmc_device_t *device, lfs_block_t block );
+    void ( *Plan )( nvmc_device_t *device, lfs_t *lfs );
+    bool ( *EraseAhead )( nvmc_device_t *device );
+    void ( *Report )( const nvmc_device_t *device );
+} const nvmc_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern nvmc_interface_t nvmc;
+
+#endif /* __NVMC_H__ */
+
+/**
+ * @} Nvmc
+ */
+
+/**
+ * @} Applicaton
+ */
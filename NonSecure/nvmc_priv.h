@@ -0,0 +1,143 @@
+/** @file nvmc_priv.h
+ *
+ * @brief       NVMC block device module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Nvmc
+ * @{
+ */
+
+#ifndef __NVMC_PRIV_H__
+#define __NVMC_PRIV_H__
+
+/*
+ * @note
+ * littlefs block device on the internal flash. Reads are copies from mapped memory. A program is cut into runs of
+ * words that are not all ones, and each run goes to the NVMC in one bulk word write: erased flash holds all ones
+ * already, and littlefs pads its programs with them. The source is copied through a word aligned chunk first, so
+ * littlefs may hand over any buffer. With NVMC_VERIFY the data is read back and a mismatch reported to littlefs as
+ * LFS_ERR_CORRUPT, which makes it move to another block.
+ *
+ * An erase halts the CPU for a page erase time, so the driver avoids erases on the way of a request. It remembers
+ * which blocks it erased and has not programmed since, and skips the erase when littlefs asks for one of them. When
+ * the file system is idle, Plan finds the blocks littlefs uses and picks the NVMC_ERASE_AHEAD free blocks after the
+ * one erased last, since littlefs allocates blocks in order; EraseAhead then erases one of them per call. Any program
+ * or erase by littlefs drops the plan, as the block may have been allocated meanwhile, and marks the device dirty.
+ * Plan walks the volume only on a dirty device, so an idle period without writes costs no traversal. Where the NVMC
+ * offers partial erase to the caller, an erase ahead goes in slices of NVMC_PARTIAL_ERASE_MS. The non-secure side of
+ * the nRF9160 has no partial erase, so there each erase ahead takes the whole page erase time.
+ *
+ * The device state belongs to the task that owns the volume; the driver does not lock.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "nvmc.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define NVMC_CHUNK_WORDS        ( 16 )          /*!< words copied from the source per step */
+#define NVMC_PAGE_ERASE_MS      ( 85 )          /*!< erase time a page needs in total */
+
+#if defined( NRF_NVMC_PARTIAL_ERASE_PRESENT ) && !defined( NRF_TRUSTZONE_NONSECURE )
+#define NVMC_PARTIAL_ERASE      ( 1 )
+#else
+#define NVMC_PARTIAL_ERASE      ( 0 )
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Set up a device over flash.
+ * @param[out]  device      Device state.
+ * @param[in]   base        Word aligned address of block 0.
+ * @param[in]   block_size  Flash page size.
+ * @param[in]   block_count Blocks, NVMC_BLOCK_MAX at most.
+ * @return      Error code.
+ */
+static error_code_module_t nvmc_Open( nvmc_device_t *device, uint32_t base, uint32_t block_size, uint32_t block_count );
+
+/**
+ * @brief       Read from a block.
+ * @return      littlefs error code.
+ */
+static int32_t nvmc_Read( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, void *buffer, lfs_size_t size );
+
+/**
+ * @brief       Program a block that was erased. Offset and size are multiples of a word.
+ * @return      littlefs error code, LFS_ERR_CORRUPT when the read back differs.
+ */
+static int32_t nvmc_Prog( nvmc_device_t *device, lfs_block_t block, lfs_off_t off, const void *buffer, lfs_size_t size );
+
+/**
+ * @brief       Erase a block, unless it is known to be erased.
+ * @return      littlefs error code.
+ */
+static int32_t nvmc_Erase( nvmc_device_t *device, lfs_block_t block );
+
+/**
+ * @brief       Choose the free blocks to erase ahead of littlefs, if littlefs programmed or erased since the last plan.
+ * @param[in]   device      Device state.
+ * @param[in]   lfs         Mounted volume on the device, with no file open.
+ */
+static void nvmc_Plan( nvmc_device_t *device, lfs_t *lfs );
+
+/**
+ * @brief       Erase, or erase a slice of, the next block of the plan.
+ * @param[in]   device      Device state.
+ * @return      True while the plan has blocks left.
+ */
+static bool nvmc_EraseAhead( nvmc_device_t *device );
+
+/**
+ * @brief       Print program and erase counters.
+ * @param[in]   device      Device state.
+ */
+static void nvmc_Report( const nvmc_device_t *device );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+/**
+ * @brief       Hand the runs of words that are not all ones to the NVMC.
+ */
+static void nvmc_Runs( nvmc_device_t *device, uint32_t address, const uint32_t *words, uint32_t count );
+
+/**
+ * @brief       Mark a block in use, called by littlefs for each one.
+ */
+static int32_t nvmc_Used( void *data, lfs_block_t block );
+
+/**
+ * @brief       Program words into flash.
+ */
+static void nvmc_Program( uint32_t address, const uint32_t *words, uint32_t count );
+
+/**
+ * @brief       Erase a flash page, whole or partially.
+ */
+static void nvmc_PageErase( uint32_t address, uint32_t duration_ms );
+
+#endif /* __NVMC_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -18,6 +18,8 @@
  * Includes
 */
 #include "os_priv.h"
+#include "pool.h"
+#include "dmm.h"
 
 /***************************************************************************************************************************
  * Global variables
@@ -54,6 +56,11 @@ os_interface_t os =
     .QueueSend              = &os_QueueSend,
     .QueueReceive           = &os_QueueReceive,
     .QueueMessagesWaiting   = &os_QueueMessagesWaiting,
+    .CreateMailbox          = &os_CreateMailbox,
+    .MailboxAlloc           = &os_MailboxAlloc,
+    .MailboxSend            = &os_MailboxSend,
+    .MailboxReceive         = &os_MailboxReceive,
+    .MailboxFree            = &os_MailboxFree,
     .CreateStream           = &os_CreateStream,
     .DeleteStream           = &os_DeleteStream,
     .StreamSend             = &os_StreamSend,
@@ -395,6 +402,91 @@ uint32_t os_QueueMessagesWaiting( QueueHandle_t handle )
     return result;
 }
 
+MailboxHandle_t os_CreateMailbox( UBaseType_t length, size_t item_size )
+{
+    MailboxHandle_t handle = DMM_ALLOC( dmm_handle_0, sizeof( os_mailbox_t ), "mailbox" );
+    bool result = ( handle != NULL );
+    void *msg;
+
+    if ( result )
+    {
+        handle->item_size = item_size;
+        handle->queue = xQueueCreate( length, sizeof( void * ) );
+        handle->free = xQueueCreate( length, sizeof( void * ) );
+        result = ( handle->queue != NULL && handle->free != NULL );
+    }
+
+    // fill the free list with message buffers
+    for ( UBaseType_t i = 0; result && i < length; i++ )
+    {
+        msg = pool.Alloc( item_size );
+        result = ( msg != NULL && xQueueSend( handle->free, &msg, 0 ) == pdPASS );
+        if ( !result && msg != NULL )
+        {
+            pool.Free( msg );
+        }
+    }
+
+    // the pools are sized for the mailboxes, so a failed one gives back all it took
+    if ( !result && handle != NULL )
+    {
+        if ( handle->free != NULL )
+        {
+            while ( xQueueReceive( handle->free, &msg, 0 ) == pdPASS )
+            {
+                pool.Free( msg );
+            }
+            vQueueDelete( handle->free );
+        }
+        if ( handle->queue != NULL )
+        {
+            vQueueDelete( handle->queue );
+        }
+        dmm.Free( dmm_handle_0, handle );
+        handle = NULL;
+    }
+
+    return handle;
+}
+
+void* os_MailboxAlloc( MailboxHandle_t handle, uint32_t timeout )
+{
+    void *msg = NULL;
+
+    if ( handle != NULL && !os_QueueReceive( handle->free, &msg, timeout ) )
+    {
+        msg = NULL;
+    }
+
+    return msg;
+}
+
+bool os_MailboxSend( MailboxHandle_t handle, void *msg, uint32_t timeout )
+{
+    return ( handle != NULL && msg != NULL ) ? os_QueueSend( handle->queue, &msg, timeout ) : false;
+}
+
+void* os_MailboxReceive( MailboxHandle_t handle, uint32_t timeout )
+{
+    void *msg = NULL;
+
+    if ( handle != NULL && !os_QueueReceive( handle->queue, &msg, timeout ) )
+    {
+        msg = NULL;
+    }
+
+    return msg;
+}
+
+void os_MailboxFree( MailboxHandle_t handle, void *msg )
+{
+    // there is always room, as the free list holds every buffer of the mailbox
+    if ( handle != NULL && msg != NULL )
+    {
+        os_QueueSend( handle->free, &msg, 0 );
+    }
+}
+
 StreamBufferHandle_t os_CreateStream( size_t size, size_t trigger )
 {
     return xStreamBufferCreate( size, trigger );
@@ -513,28 +605,28 @@ bool os_GiveSemaphore( SemaphoreHandle_t handle )
     return result;
 }
 
-bool os_TaskNotifyGive( TaskHandle_t handle )
+bool os_TaskNotifyGive( TaskHandle_t handle, UBaseType_t index )
 {
     bool result;
     BaseType_t high_priority_task = pdFALSE;
 
     if ( xPortIsInsideInterrupt() )                     // In interrupt context
     {
-        vTaskNotifyGiveFromISR( handle, &high_priority_task );
+        vTaskNotifyGiveIndexedFromISR( handle, index, &high_priority_task );
         portYIELD_FROM_ISR( high_priority_task );
         result = true;
     }
     else                                                // In normal context
     {
-        result = ( xTaskNotifyGive( handle ) == pdPASS );
+        result = ( xTaskNotifyGiveIndexed( handle, index ) == pdPASS );
     }
 
     return result;
 }
 
-uint32_t os_TaskNotifyTake( bool clear, uint32_t timeout )
+uint32_t os_TaskNotifyTake( UBaseType_t index, bool clear, uint32_t timeout )
 {
-    return ulTaskNotifyTake( clear ? pdTRUE : pdFALSE, os_Ms2Ticks( timeout ) );
+    return ulTaskNotifyTakeIndexed( index, clear ? pdTRUE : pdFALSE, os_Ms2Ticks( timeout ) );
 }
 
 TimerHandle_t os_CreateTimer( char *name, uint32_t period, bool reload, void *timer_id, TimerCallbackFunction_t callback )
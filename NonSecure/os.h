@@ -33,9 +33,36 @@
  * Public constants and macros
  */
 
+/**
+ * @brief Typed wrappers around the mailbox functions.
+ */
+#define OS_CREATE_MAILBOX( length, type )               os.CreateMailbox( length, sizeof( type ) )
+#define OS_MAILBOX_ALLOC( handle, type, timeout )       ( ( type * )os.MailboxAlloc( handle, timeout ) )
+#define OS_MAILBOX_RECEIVE( handle, type, timeout )     ( ( type * )os.MailboxReceive( handle, timeout ) )
+
+/**
+ * @brief Task notification indexes (configTASK_NOTIFICATION_ARRAY_ENTRIES). The modem library wakes whichever task
+ *        slept in it last through the default index, so a task that waits for anything else uses an index of its own.
+ */
+#define OS_NOTIFY_MODEM                                 ( 0 )           /*!< modem library wait, see nrf_modem_os_timedwait */
+#define OS_NOTIFY_REPLY                                 ( 1 )           /*!< answer to a request posted to another task */
+#define OS_NOTIFY_WAKE                                  ( 2 )           /*!< wake a service task from its idle wait */
+
 /***************************************************************************************************************************
  * Public data structures and typedefs
  */
+/**
+ * @brief Mailbox: a queue of message pointers plus the pool of message buffers that belongs to it.
+ */
+typedef struct
+{
+    QueueHandle_t   queue;          /*!< messages posted to the mailbox (pointers) */
+    QueueHandle_t   free;           /*!< message buffers available to senders (pointers) */
+    size_t          item_size;      /*!< size of each message buffer in bytes */
+} os_mailbox_t;
+
+typedef os_mailbox_t* MailboxHandle_t;
+
 typedef struct
 {
     error_code_module_t ( *Init )( void );
@@ -68,6 +95,11 @@ typedef struct
     bool ( *QueueSend )( QueueHandle_t handle, void *item, uint32_t timeout );
     bool ( *QueueReceive )( QueueHandle_t handle, void *item, uint32_t timeout );
     uint32_t ( *QueueMessagesWaiting )( QueueHandle_t handle );
+    MailboxHandle_t ( *CreateMailbox )( UBaseType_t length, size_t item_size );
+    void* ( *MailboxAlloc )( MailboxHandle_t handle, uint32_t timeout );
+    bool ( *MailboxSend )( MailboxHandle_t handle, void *msg, uint32_t timeout );
+    void* ( *MailboxReceive )( MailboxHandle_t handle, uint32_t timeout );
+    void ( *MailboxFree )( MailboxHandle_t handle, void *msg );
     StreamBufferHandle_t ( *CreateStream )( size_t size, size_t trigger );
     void ( *DeleteStream )( StreamBufferHandle_t handle );
     size_t ( *StreamSend )( StreamBufferHandle_t handle, const void *data, size_t size, uint32_t timeout );
@@ -80,8 +112,8 @@ typedef struct
     void ( *DeleteSemaphore )( SemaphoreHandle_t handle );
     bool ( *TakeSemaphore )( SemaphoreHandle_t handle, uint32_t timeout );
     bool ( *GiveSemaphore )( SemaphoreHandle_t handle );
-    bool ( *TaskNotifyGive )( TaskHandle_t handle );
-    uint32_t ( *TaskNotifyTake )( bool clear, uint32_t timeout );
+    bool ( *TaskNotifyGive )( TaskHandle_t handle, UBaseType_t index );
+    uint32_t ( *TaskNotifyTake )( UBaseType_t index, bool clear, uint32_t timeout );
     TimerHandle_t ( *CreateTimer )( char *name, uint32_t period, bool reload, void *timer_id, TimerCallbackFunction_t callback );
     bool ( *DeleteTimer )( TimerHandle_t handle, uint32_t timeout );
     bool ( *TimerReset )( TimerHandle_t handle, uint32_t timeout );
@@ -235,6 +235,48 @@ static bool os_QueueReceive( QueueHandle_t handle, void *item, uint32_t timeout
  */
 static uint32_t os_QueueMessagesWaiting( QueueHandle_t handle );
 
+/**
+ * @brief       Create new mailbox. The mailbox descriptor is taken from the application heap and its message buffers
+ *              from the block pools (both shared memory, so unprivileged tasks can use them) once at start-up; mailboxes
+ *              are never deleted.
+ * @param[in]   length              Maximum number of messages (and number of message buffers)
+ * @param[in]   item_size           Size of each message buffer (in bytes)
+ * @return      Mailbox handle (NULL if out of memory).
+ */
+static MailboxHandle_t os_CreateMailbox( UBaseType_t length, size_t item_size );
+
+/**
+ * @brief       Take a free message buffer from a mailbox (also from interrupt context, without waiting).
+ * @param[in]   handle              Mailbox handle
+ * @param[in]   timeout             Maximum wait time (ms)
+ * @return      Pointer to message buffer (NULL if none available).
+ */
+static void* os_MailboxAlloc( MailboxHandle_t handle, uint32_t timeout );
+
+/**
+ * @brief       Post a message buffer to a mailbox, passing its ownership to the receiver.
+ * @param[in]   handle              Mailbox handle
+ * @param[in]   msg                 Message buffer taken with os_MailboxAlloc()
+ * @param[in]   timeout             Maximum wait time (ms)
+ * @return      Success (on failure the caller still owns the buffer).
+ */
+static bool os_MailboxSend( MailboxHandle_t handle, void *msg, uint32_t timeout );
+
+/**
+ * @brief       Receive a message buffer from a mailbox, taking ownership of it.
+ * @param[in]   handle              Mailbox handle
+ * @param[in]   timeout             Maximum wait time (ms)
+ * @return      Pointer to message buffer (NULL if none received).
+ */
+static void* os_MailboxReceive( MailboxHandle_t handle, uint32_t timeout );
+
+/**
+ * @brief       Return a consumed (or unsent) message buffer to its mailbox.
+ * @param[in]   handle              Mailbox handle
+ * @param[in]   msg                 Message buffer
+ */
+static void os_MailboxFree( MailboxHandle_t handle, void *msg );
+
 /**
  * @brief       Create stream buffer.
  * @param[in]   size                Size of stream buffer
@@ -326,17 +368,19 @@ static bool os_GiveSemaphore( SemaphoreHandle_t handle );
 /**
  * @brief       Notify task when counting semaphore taken.
  * @param[in]   handle              Task handle
+ * @param[in]   index               Notification index (OS_NOTIFY_xxx)
  * @return      Success.
  */
-static bool os_TaskNotifyGive( TaskHandle_t handle );
+static bool os_TaskNotifyGive( TaskHandle_t handle, UBaseType_t index );
 
 /**
  * @brief       Notify task when counting semaphore given.
+ * @param[in]   index               Notification index (OS_NOTIFY_xxx)
  * @param[in]   clear               Clear semaphore count
  * @param[in]   timeout             Maximum time to wait (ms)
  * @return      Success.
  */
-static uint32_t os_TaskNotifyTake( bool clear, uint32_t timeout );
+static uint32_t os_TaskNotifyTake( UBaseType_t index, bool clear, uint32_t timeout );
 
 /**
  * @brief       Create new timer.
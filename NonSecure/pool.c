@@ -0,0 +1,219 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      pool.c
+ * @brief     Fixed-size block pools
+ * @details   O(1) block pools for message buffers, with fallback to the dynamic memory manager.
+ * @author    Johnas Cukier
+ * @date      Jan 2023
+ */
+
+/**
+ * @defgroup pool Fixed-size block pools
+ * @brief     Fixed-size block pool module
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+
+#include "pool_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+pool_interface_t pool =
+{
+    .Init               = &pool_Init,
+    .Alloc              = &pool_Alloc,
+    .Free               = &pool_Free,
+    .GetStats           = &pool_GetStats,
+    .Report             = &pool_Report,
+};
+
+pool_obj_t pool_obj =
+{
+    .is_init            = false,
+    .stats              =
+    {
+        { .block_size = SHORT_MSG_MAX,  .count = POOL_SHORT_COUNT,  },
+        { .block_size = MEDIUM_MSG_MAX, .count = POOL_MEDIUM_COUNT, },
+        { .block_size = LONG_MSG_MAX,   .count = POOL_LONG_COUNT,   },
+    },
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+error_code_module_t pool_Init( void* mem, size_t size )
+{
+    error_code_module_t error = NO_ERROR;
+    uint8_t *block = ( uint8_t * )mem;
+
+    /* Singleton pattern */
+    if ( pool_obj.is_init == false )
+    {
+        if ( mem != NULL && size >= POOL_MEM_SIZE )
+        {
+            for ( uint32_t id = 0; id < NPOOLS; id++ )
+            {
+                pool_obj.free_list[ id ] = NULL;
+                pool_obj.start[ id ] = block;
+                for ( uint32_t i = 0; i < pool_obj.stats[ id ].count; i++ )
+                {
+                    ( ( pool_block_t * )block )->next = pool_obj.free_list[ id ];
+                    pool_obj.free_list[ id ] = ( pool_block_t * )block;
+                    block += pool_obj.stats[ id ].block_size;
+                }
+                pool_obj.end[ id ] = block;
+            }
+            pool_obj.is_init = true;
+        }
+        else
+        {
+            error = ERROR_POOL_BAD_PARAM;
+        }
+    }
+    else
+    {
+        error = ERROR_POOL_ALREADY_INIT;
+    }
+
+    return error;
+}
+
+void* pool_Alloc( size_t size )
+{
+    void *result = NULL;
+    bool miss = false;
+    UBaseType_t interrupt_status;
+
+    if ( pool_obj.is_init == true )
+    {
+        for ( uint32_t id = 0; id < NPOOLS && result == NULL; id++ )
+        {
+            if ( size <= pool_obj.stats[ id ].block_size )
+            {
+                if ( ( result = pool_Get( ( pool_id_t )id ) ) == NULL && miss == false )
+                {
+                    // only count a miss against the pool the request was meant for
+                    interrupt_status = os.EnterCritical();
+                    pool_obj.stats[ id ].misses++;
+                    os.ExitCritical( interrupt_status );
+                    miss = true;
+                }
+            }
+        }
+    }
+
+    // no pool could serve the request, so use the heap (which cannot be used from interrupt context)
+    if ( result == NULL && !os.IsInsideInterrupt() )
+    {
+        if ( ( result = DMM_ALLOC( dmm_handle_0, size, "pool" ) ) != NULL )
+        {
+            interrupt_status = os.EnterCritical();
+            pool_obj.fallbacks++;
+            os.ExitCritical( interrupt_status );
+        }
+    }
+
+    return result;
+}
+
+void pool_Free( void* ptr )
+{
+    // move along, nothing to free here
+    if ( ptr == NULL )
+    {
+        return;
+    }
+
+    for ( uint32_t id = 0; id < NPOOLS; id++ )
+    {
+        if ( ( uint8_t * )ptr >= pool_obj.start[ id ] && ( uint8_t * )ptr < pool_obj.end[ id ] )
+        {
+            pool_Put( ( pool_id_t )id, ptr );
+            return;
+        }
+    }
+
+    // not a pool block, so it must have come from the heap
+    dmm.Free( dmm_handle_0, ptr );
+}
+
+error_code_module_t pool_GetStats( pool_id_t id, pool_stats_t* stats )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( stats == NULL || id >= NPOOLS )
+    {
+        error = ERROR_POOL_BAD_PARAM;
+    }
+    else
+    {
+        UBaseType_t interrupt_status = os.EnterCritical();
+        *stats = pool_obj.stats[ id ];
+        os.ExitCritical( interrupt_status );
+    }
+
+    return error;
+}
+
+void pool_Report( void )
+{
+    pool_stats_t stats;
+
+    for ( uint32_t id = 0; id < NPOOLS; id++ )
+    {
+        if ( pool_GetStats( ( pool_id_t )id, &stats ) == NO_ERROR )
+        {
+            Log.Print( "Pool: %d, block size: %d, used: %d of %d, high water: %d, misses: %d\r\n",
+                       id,
+                       stats.block_size,
+                       stats.used,
+                       stats.count,
+                       stats.high_water,
+                       stats.misses );
+        }
+    }
+    Log.Print( "Pool allocations served by heap: %d\r\n", pool_obj.fallbacks );
+}
+
+void *pool_Get( pool_id_t id )
+{
+    pool_stats_t *stats = &pool_obj.stats[ id ];
+    UBaseType_t interrupt_status = os.EnterCritical();
+    pool_block_t *block = pool_obj.free_list[ id ];
+
+    if ( block != NULL )
+    {
+        pool_obj.free_list[ id ] = block->next;
+        if ( ++stats->used > stats->high_water )
+        {
+            stats->high_water = stats->used;
+        }
+    }
+    os.ExitCritical( interrupt_status );
+
+    return block;
+}
+
+void pool_Put( pool_id_t id, void *ptr )
+{
+    UBaseType_t interrupt_status = os.EnterCritical();
+
+    ( ( pool_block_t * )ptr )->next = pool_obj.free_list[ id ];
+    pool_obj.free_list[ id ] = ( pool_block_t * )ptr;
+    pool_obj.stats[ id ].used--;
+    os.ExitCritical( interrupt_status );
+}
+
+/**
+ * @} pool
+ */
+
+/**
+ * @} Application
+ */
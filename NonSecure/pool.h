@@ -0,0 +1,85 @@
+/**
+ * @addtogroup Driver Driver
+ * @{
+ *
+ * @file      pool.h
+ * @brief     Fixed-size block pool module (public header).
+ * @author    Johnas Cukier
+ * @date      January 2023
+ */
+
+/**
+ * @addtogroup pool
+ * @{
+ */
+#ifndef __POOL_H__
+#define __POOL_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "os.h"
+#include "eelcodes.h"
+#include "app.h"
+#include "dmm.h"
+#include "log.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+/**
+ * @brief Enumeration of block pools, ordered by block size.
+ */
+typedef enum
+{
+    pool_short,             /*!< blocks of SHORT_MSG_MAX bytes */
+    pool_medium,            /*!< blocks of MEDIUM_MSG_MAX bytes */
+    pool_long,              /*!< blocks of LONG_MSG_MAX bytes */
+} pool_id_t;
+
+/**
+ * @brief Block pool statistics.
+ */
+typedef struct
+{
+    uint32_t    block_size;         /*!< size of each block in bytes */
+    uint32_t    count;              /*!< number of blocks in the pool */
+    uint32_t    used;               /*!< number of blocks currently in use */
+    uint32_t    high_water;         /*!< maximum number of blocks in use since initialized */
+    uint32_t    misses;             /*!< number of requests that found the pool empty */
+} pool_stats_t;
+
+/**
+ * Specifies the public interface functions of the block pool module.
+ */
+typedef struct
+{
+    error_code_module_t ( *Init )( void* mem, size_t size );
+    void* ( *Alloc )( size_t numbytes );
+    void ( *Free )( void* ptr );
+    error_code_module_t ( *GetStats )( pool_id_t id, pool_stats_t* stats );
+    void ( *Report )( void );
+} const pool_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern pool_interface_t pool;
+
+#endif /* __POOL_H__ */
+
+/**
+ * @} pool
+ */
+
+/**
+ * @} Driver
+ */
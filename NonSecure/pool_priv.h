@@ -0,0 +1,110 @@
+/** @file pool_priv.h
+ *
+ * @brief       Fixed-size block pool module (private header).
+ * @author      Johnas Cukier
+ * @date        January 2023
+ *
+ */
+
+/**
+ * @addtogroup pool
+ * @{
+ */
+
+#ifndef __POOL_PRIV_H__
+#define __POOL_PRIV_H__
+
+/*
+ * @note
+ * Each pool is a singly linked free list threaded through the unused blocks themselves, so getting and putting a block
+ * is a pointer swap done inside a short critical section. That makes both operations O(1) and safe to call from tasks
+ * and interrupt handlers alike. Blocks are carved out of the shared memory area at start-up, so they are accessible
+ * from every task under MPU control.
+ *
+ * A request is served from the smallest pool whose blocks are large enough; if that pool is empty, the next larger pool
+ * is tried. Requests that cannot be served from any pool fall back to the application heap (dmm_handle_0), unless they
+ * are made from interrupt context. pool.Free() tells pool blocks from heap blocks by address; a heap block freed from
+ * interrupt context is handed back to the heap by its next task-context user.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "pool.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define NPOOLS                      ( 3 )
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block_t;
+
+typedef struct
+{
+    bool                        is_init;
+    pool_block_t                *free_list[ NPOOLS ];
+    uint8_t                     *start[ NPOOLS ];
+    uint8_t                     *end[ NPOOLS ];
+    pool_stats_t                stats[ NPOOLS ];
+    uint32_t                    fallbacks;
+} pool_obj_t ;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Initialize the module.
+ * @param[in]   mem             pointer to block of memory holding all pools (aligned to 4 byte boundary)
+ * @param[in]   size            size of memory block in bytes (at least POOL_MEM_SIZE)
+ * @return      Error code.
+ */
+static error_code_module_t pool_Init( void* mem, size_t size );
+
+/**
+ * @brief       Allocate a block from the smallest pool that fits, falling back to the application heap.
+ * @param[in]   numbytes        size of memory block to allocate in bytes
+ * @return      Pointer to allocated memory block (NULL if error).
+ */
+static void* pool_Alloc( size_t numbytes );
+
+/**
+ * @brief       Return a block to its pool (or to the application heap if it came from there).
+ * @param[in]   ptr             Pointer to memory block to be freed.
+ */
+static void pool_Free( void* ptr );
+
+/**
+ * @brief       Get statistics of a pool.
+ * @param[in]   id              Pool to report about.
+ * @param[out]  stats           Pointer to statistics structure to fill in.
+ * @return      Error code.
+ */
+static error_code_module_t pool_GetStats( pool_id_t id, pool_stats_t* stats );
+
+/**
+ * @brief       Print pool statistics.
+ */
+static void pool_Report( void );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+void *pool_Get( pool_id_t id );
+void pool_Put( pool_id_t id, void *ptr );
+
+#endif /* __POOL_PRIV_H__ */
+
+/**
+ * @}
+ */
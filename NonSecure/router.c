@@ -0,0 +1,557 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      router.c
+ * @brief     MQTT topic router module
+ * @details   Delivers incoming publishes to the handlers of matching topic filters.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Router Topic router
+ * @brief     MQTT topic filter trie
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "router_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+router_interface_t router =
+{
+    .Init               = &router_Init,
+    .Add                = &router_Add,
+    .Remove             = &router_Remove,
+    .Route              = &router_Route,
+    .Report             = &router_Report,
+#if ROUTER_BENCHMARK_ENABLED
+    .Benchmark          = &router_Benchmark,
+#endif
+};
+
+#if ROUTER_BENCHMARK_ENABLED
+static router_table_t benchmark_table;
+static router_node_t benchmark_nodes[ ROUTER_BENCHMARK_NODES ];
+static router_route_t benchmark_routes[ ROUTER_BENCHMARK_FILTERS ];
+static char benchmark_filters[ ROUTER_BENCHMARK_FILTERS ][ ROUTER_BENCHMARK_NAME_MAX ];
+static uint16_t benchmark_lengths[ ROUTER_BENCHMARK_FILTERS ];
+#endif
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t router_Init( router_table_t *table, router_node_t *nodes, uint16_t node_count, router_route_t *routes, uint16_t route_count )
+{
+    error_code_module_t error = NO_ERROR;
+    uint16_t i;
+
+    if ( table == NULL || nodes == NULL || node_count < 2 || node_count >= ROUTER_NONE || routes == NULL || route_count == 0 || route_count >= ROUTER_NONE )
+    {
+        error = ERROR_ROUTER_BAD_PARAM;
+    }
+    else
+    {
+        memset( table, 0, sizeof( router_table_t ) );
+        table->nodes = nodes;
+        table->node_count = node_count;
+        table->routes = routes;
+        table->route_count = route_count;
+
+        // Chain all nodes but the root into the free list
+        for ( i = 1; i < node_count; i++ )
+        {
+            nodes[ i ].sibling = ( i + 1 < node_count ) ? i + 1 : ROUTER_NONE;
+        }
+        table->free_node = 1;
+        table->nodes_used = 1;
+
+        for ( i = 0; i < route_count; i++ )
+        {
+            routes[ i ].next = ( i + 1 < route_count ) ? i + 1 : ROUTER_NONE;
+        }
+        table->free_route = 0;
+
+        memset( &nodes[ ROUTER_ROOT ], 0, sizeof( router_node_t ) );
+        nodes[ ROUTER_ROOT ].parent = ROUTER_NONE;
+        nodes[ ROUTER_ROOT ].child = ROUTER_NONE;
+        nodes[ ROUTER_ROOT ].sibling = ROUTER_NONE;
+        nodes[ ROUTER_ROOT ].plus = ROUTER_NONE;
+        nodes[ ROUTER_ROOT ].multi = ROUTER_NONE;
+        nodes[ ROUTER_ROOT ].routes = ROUTER_NONE;
+    }
+
+    return error;
+}
+
+error_code_module_t router_Add( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler, void *context )
+{
+    error_code_module_t error = NO_ERROR;
+    router_levels_t levels;
+    uint16_t node = ROUTER_ROOT;
+    uint16_t last = ROUTER_ROOT;
+    uint16_t route;
+    uint16_t i;
+
+    if ( table == NULL || handler == NULL || !router_Split( filter, length, true, &levels ) )
+    {
+        error = ERROR_ROUTER_BAD_PARAM;
+    }
+    for ( i = 0; i < levels.count && error == NO_ERROR; i++ )
+    {
+        if ( levels.length[ i ] >= ROUTER_LEVEL_MAX )
+        {
+            error = ERROR_ROUTER_BAD_PARAM;
+        }
+    }
+
+    // Find or create one node per level
+    for ( i = 0; i < levels.count && error == NO_ERROR; i++ )
+    {
+        node = router_Insert( table, last, levels.start[ i ], levels.length[ i ], levels.hash[ i ] );
+        if ( node == ROUTER_NONE )
+        {
+            error = ERROR_ROUTER_FULL;
+        }
+        else
+        {
+            last = node;
+        }
+    }
+
+    if ( error == NO_ERROR )
+    {
+        for ( route = table->nodes[ node ].routes; route != ROUTER_NONE; route = table->routes[ route ].next )
+        {
+            if ( table->routes[ route ].handler == handler && table->routes[ route ].context == context )
+            {
+                break;
+            }
+        }
+
+        if ( route == ROUTER_NONE )
+        {
+            if ( ( route = table->free_route ) == ROUTER_NONE )
+            {
+                error = ERROR_ROUTER_FULL;
+            }
+            else
+            {
+                table->free_route = table->routes[ route ].next;
+                table->routes[ route ].handler = handler;
+                table->routes[ route ].context = context;
+                table->routes[ route ].node = node;
+                table->routes[ route ].next = table->nodes[ node ].routes;
+                table->nodes[ node ].routes = route;
+                table->routes_used++;
+            }
+        }
+    }
+
+    // Drop the levels created for a filter that could not be added
+    if ( error == ERROR_ROUTER_FULL )
+    {
+        router_Prune( table, last );
+    }
+
+    return error;
+}
+
+error_code_module_t router_Remove( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler )
+{
+    error_code_module_t error = NO_ERROR;
+    router_levels_t levels;
+    uint16_t node = ROUTER_ROOT;
+    uint16_t *link;
+    uint16_t route;
+    uint16_t i;
+
+    if ( table == NULL || !router_Split( filter, length, true, &levels ) )
+    {
+        error = ERROR_ROUTER_BAD_PARAM;
+    }
+
+    for ( i = 0; i < levels.count && error == NO_ERROR; i++ )
+    {
+        node = router_Find( table, node, levels.start[ i ], levels.length[ i ], levels.hash[ i ] );
+        if ( node == ROUTER_NONE )
+        {
+            error = ERROR_ROUTER_NOT_FOUND;
+        }
+    }
+
+    if ( error == NO_ERROR )
+    {
+        error = ERROR_ROUTER_NOT_FOUND;
+        link = &table->nodes[ node ].routes;
+        while ( *link != ROUTER_NONE )
+        {
+            route = *link;
+            if ( handler == NULL || table->routes[ route ].handler == handler )
+            {
+                *link = table->routes[ route ].next;
+                table->routes[ route ].handler = NULL;
+                table->routes[ route ].next = table->free_route;
+                table->free_route = route;
+                table->routes_used--;
+                error = NO_ERROR;
+            }
+            else
+            {
+                link = &table->routes[ route ].next;
+            }
+        }
+        router_Prune( table, node );
+    }
+
+    return error;
+}
+
+uint32_t router_Route( router_table_t *table, const MQTTPublishInfo_t *publish_info )
+{
+    router_levels_t levels;
+    uint32_t count = 0;
+
+    if ( router_Split( publish_info->pTopicName, publish_info->topicNameLength, false, &levels ) )
+    {
+        count = router_Match( table, ROUTER_ROOT, 0, &levels, publish_info );
+    }
+
+    if ( count != 0 )
+    {
+        table->routed++;
+    }
+    else
+    {
+        table->unmatched++;
+    }
+
+    return count;
+}
+
+void router_Report( const router_table_t *table )
+{
+    Log.Print( "Topic router: %d of %d levels, %d of %d routes\r\n",
+               table->nodes_used,
+               table->node_count,
+               table->routes_used,
+               table->route_count );
+    Log.Print( "Publishes routed: %d, unmatched: %d\r\n", table->routed, table->unmatched );
+}
+
+bool router_Split( const char *name, uint16_t length, bool filter, router_levels_t *levels )
+{
+    bool valid = ( name != NULL && length != 0 );
+    uint16_t start = 0;
+    uint16_t i;
+
+    levels->count = 0;
+    for ( i = 0; i <= length && valid; i++ )
+    {
+        if ( i == length || name[ i ] == '/' )
+        {
+            if ( levels->count == ROUTER_DEPTH_MAX )
+            {
+                valid = false;
+            }
+            else
+            {
+                levels->start[ levels->count ] = &name[ start ];
+                levels->length[ levels->count ] = i - start;
+                levels->hash[ levels->count ] = router_Hash( &name[ start ], i - start );
+                levels->count++;
+                start = i + 1;
+            }
+        }
+        else if ( name[ i ] == '+' || name[ i ] == '#' )
+        {
+            // Wildcards only in filters, alone in their level, and '#' only in the last level
+            valid = filter &&
+                    i == start &&
+                    ( i + 1 == length || name[ i + 1 ] == '/' ) &&
+                    ( name[ i ] == '+' || i + 1 == length );
+        }
+    }
+
+    return valid;
+}
+
+uint16_t router_Hash( const char *text, uint16_t length )
+{
+    uint32_t hash = 2166136261u;
+    uint16_t i;
+
+    // FNV-1a, folded to 16 bits
+    for ( i = 0; i < length; i++ )
+    {
+        hash = ( hash ^ ( uint8_t )text[ i ] ) * 16777619u;
+    }
+
+    return ( uint16_t )( ( hash >> 16 ) ^ hash );
+}
+
+uint16_t router_Find( const router_table_t *table, uint16_t node, const char *level, uint16_t length, uint16_t hash )
+{
+    const router_node_t *child;
+    uint16_t next = ROUTER_NONE;
+
+    if ( length == 1 && level[ 0 ] == '+' )
+    {
+        next = table->nodes[ node ].plus;
+    }
+    else if ( length == 1 && level[ 0 ] == '#' )
+    {
+        next = table->nodes[ node ].multi;
+    }
+    else if ( length < ROUTER_LEVEL_MAX )
+    {
+        for ( next = table->nodes[ node ].child; next != ROUTER_NONE; next = child->sibling )
+        {
+            child = &table->nodes[ next ];
+            if ( child->hash == hash && child->level[ length ] == '\0' && memcmp( child->level, level, length ) == 0 )
+            {
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+uint16_t router_Insert( router_table_t *table, uint16_t node, const char *level, uint16_t length, uint16_t hash )
+{
+    router_node_t *parent = &table->nodes[ node ];
+    router_node_t *child;
+    uint16_t next;
+
+    next = router_Find( table, node, level, length, hash );
+    if ( next == ROUTER_NONE && table->free_node != ROUTER_NONE )
+    {
+        next = table->free_node;
+        child = &table->nodes[ next ];
+        table->free_node = child->sibling;
+        table->nodes_used++;
+
+        memcpy( child->level, level, length );
+        child->level[ length ] = '\0';
+        child->hash = hash;
+        child->parent = node;
+        child->child = ROUTER_NONE;
+        child->plus = ROUTER_NONE;
+        child->multi = ROUTER_NONE;
+        child->routes = ROUTER_NONE;
+        child->sibling = ROUTER_NONE;
+
+        if ( length == 1 && level[ 0 ] == '+' )
+        {
+            parent->plus = next;
+        }
+        else if ( length == 1 && level[ 0 ] == '#' )
+        {
+            parent->multi = next;
+        }
+        else
+        {
+            child->sibling = parent->child;
+            parent->child = next;
+        }
+    }
+
+    return next;
+}
+
+void router_Prune( router_table_t *table, uint16_t node )
+{
+    router_node_t *child;
+    router_node_t *parent;
+    uint16_t *link;
+
+    // Free levels that no longer lead to a route, up to the first one still in use
+    while ( node != ROUTER_ROOT )
+    {
+        child = &table->nodes[ node ];
+        if ( child->routes != ROUTER_NONE || child->child != ROUTER_NONE || child->plus != ROUTER_NONE || child->multi != ROUTER_NONE )
+        {
+            break;
+        }
+
+        parent = &table->nodes[ child->parent ];
+        if ( parent->plus == node )
+        {
+            parent->plus = ROUTER_NONE;
+        }
+        else if ( parent->multi == node )
+        {
+            parent->multi = ROUTER_NONE;
+        }
+        else
+        {
+            for ( link = &parent->child; *link != node; link = &table->nodes[ *link ].sibling )
+            {
+            }
+            *link = child->sibling;
+        }
+
+        node = child->parent;
+        child->sibling = table->free_node;
+        table->free_node = ( uint16_t )( child - table->nodes );
+        table->nodes_used--;
+    }
+}
+
+uint32_t router_Match( router_table_t *table, uint16_t node, uint16_t depth, const router_levels_t *levels, const MQTTPublishInfo_t *publish_info )
+{
+    const router_node_t *current = &table->nodes[ node ];
+    uint32_t count = 0;
+    uint16_t next;
+    bool wildcards;
+
+    // Wildcards in the first level do not match topics starting with '$'
+    wildcards = ( depth != 0 || levels->length[ 0 ] == 0 || levels->start[ 0 ][ 0 ] != '$' );
+
+    // '#' matches all remaining levels, including none
+    if ( current->multi != ROUTER_NONE && wildcards )
+    {
+        count += router_Dispatch( table, current->multi, publish_info );
+    }
+
+    if ( depth == levels->count )
+    {
+        count += router_Dispatch( table, node, publish_info );
+    }
+    else
+    {
+        next = router_Find( table, node, levels->start[ depth ], levels->length[ depth ], levels->hash[ depth ] );
+        if ( next != ROUTER_NONE )
+        {
+            count += router_Match( table, next, depth + 1, levels, publish_info );
+        }
+        if ( current->plus != ROUTER_NONE && wildcards )
+        {
+            count += router_Match( table, current->plus, depth + 1, levels, publish_info );
+        }
+    }
+
+    return count;
+}
+
+uint32_t router_Dispatch( router_table_t *table, uint16_t node, const MQTTPublishInfo_t *publish_info )
+{
+    uint32_t count = 0;
+    uint16_t route;
+
+    for ( route = table->nodes[ node ].routes; route != ROUTER_NONE; route = table->routes[ route ].next )
+    {
+        table->routes[ route ].handler( publish_info, table->routes[ route ].context );
+        count++;
+    }
+
+    return count;
+}
+
+#if ROUTER_BENCHMARK_ENABLED
+void router_Benchmark( uint32_t filters, uint32_t iterations )
+{
+    uint32_t i, j, start;
+    uint32_t trie_cycles = 0, linear_cycles = 0, trie_matches = 0, linear_matches = 0;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+    char topic[ ROUTER_BENCHMARK_NAME_MAX ];
+    MQTTPublishInfo_t publish_info = { 0 };
+    bool is_match;
+
+    if ( filters > ROUTER_BENCHMARK_FILTERS )
+    {
+        filters = ROUTER_BENCHMARK_FILTERS;
+    }
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    router_Init( &benchmark_table, benchmark_nodes, ROUTER_BENCHMARK_NODES, benchmark_routes, ROUTER_BENCHMARK_FILTERS );
+    for ( i = 0; i < filters; i++ )
+    {
+        benchmark_lengths[ i ] = router_BenchName( benchmark_filters[ i ], i, true );
+        if ( router_Add( &benchmark_table, benchmark_filters[ i ], benchmark_lengths[ i ], router_BenchHandler, &trie_matches ) != NO_ERROR )
+        {
+            Log.Print( "Only %d filters fit in the scratch table\r\n", i );
+            filters = i;
+        }
+    }
+
+    for ( i = 0; i < iterations; i++ )
+    {
+        publish_info.pTopicName = topic;
+        publish_info.topicNameLength = router_BenchName( topic, i * 37, false );
+
+        start = DWT->CYCCNT;
+        router_Route( &benchmark_table, &publish_info );
+        trie_cycles += DWT->CYCCNT - start;
+
+        start = DWT->CYCCNT;
+        for ( j = 0; j < filters; j++ )
+        {
+            MQTT_MatchTopic( topic, publish_info.topicNameLength, benchmark_filters[ j ], benchmark_lengths[ j ], &is_match );
+            linear_matches += is_match;
+        }
+        linear_cycles += DWT->CYCCNT - start;
+    }
+
+    if ( iterations == 0 || cycles_per_us == 0 )
+    {
+        return;
+    }
+
+    Log.Print( "Topic router benchmark: %d filters, %d levels, %d publishes, %d MHz\r\n",
+               filters,
+               benchmark_table.nodes_used,
+               iterations,
+               cycles_per_us );
+    Log.Print( "Trie:           %7d cycles per publish, %d matches\r\n", trie_cycles / iterations, trie_matches );
+    Log.Print( "MQTT_MatchTopic: %6d cycles per publish, %d matches\r\n", linear_cycles / iterations, linear_matches );
+}
+
+uint16_t router_BenchName( char *name, uint32_t index, bool filter )
+{
+    static const char *const formats[] =
+    {
+        "site/%d/dev/%d/temp",
+        "site/%d/dev/%d/+",
+        "site/%d/+/%d/temp",
+        "site/%d/dev/%d/#",
+    };
+    uint32_t site = index % 16;
+    uint32_t device = ( index / 16 ) % 16;
+
+    if ( filter )
+    {
+        sprintf( name, formats[ ( index + index / 16 ) % 4 ], site, device );
+    }
+    else
+    {
+        sprintf( name, "site/%d/dev/%d/%s", site, device, ( index & 1 ) ? "temp" : "humidity" );
+    }
+
+    return strlen( name );
+}
+
+void router_BenchHandler( const MQTTPublishInfo_t *publish_info, void *context )
+{
+    ( *( uint32_t * )context )++;
+}
+#endif
+
+/**
+ * @} Router
+ */
+
+/**
+ * @} Application
+ */
@@ -0,0 +1,121 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      router.h
+ * @brief     MQTT topic router module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Router
+ * @{
+ */
+#ifndef __ROUTER_H__
+#define __ROUTER_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "core_mqtt.h"
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define ROUTER_LEVEL_MAX                ( 24 )          /*!< longest topic level stored in the trie, including terminator */
+#define ROUTER_DEPTH_MAX                ( 8 )           /*!< most levels in a topic filter or topic name */
+#define ROUTER_NONE                     ( 0xffff )      /*!< no node or route */
+
+#ifndef ROUTER_BENCHMARK_ENABLED
+#define ROUTER_BENCHMARK_ENABLED        ( 0 )           /*!< set to 1 to build router.Benchmark() and its scratch table */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Handler of publishes matching a topic filter.
+ */
+typedef void ( *router_handler_t )( const MQTTPublishInfo_t *publish_info, void *context );
+
+/**
+ * @brief One topic level of the trie. Exact levels are kept in a sibling list, wildcards in their own links.
+ */
+typedef struct
+{
+    char                        level[ ROUTER_LEVEL_MAX ];
+    uint16_t                    hash;           /*!< hash of level, compared before the text */
+    uint16_t                    parent;
+    uint16_t                    child;          /*!< first exact child level */
+    uint16_t                    sibling;        /*!< next exact level of the same parent (next free node when unused) */
+    uint16_t                    plus;           /*!< '+' child level */
+    uint16_t                    multi;          /*!< '#' child level */
+    uint16_t                    routes;         /*!< first route of the filter ending at this level */
+} router_node_t;
+
+/**
+ * @brief Handler registered for one topic filter.
+ */
+typedef struct
+{
+    router_handler_t            handler;
+    void                        *context;
+    uint16_t                    node;           /*!< last level of the filter */
+    uint16_t                    next;           /*!< next route of the same filter (next free route when unused) */
+} router_route_t;
+
+/**
+ * @brief Topic filter trie and its storage.
+ */
+typedef struct
+{
+    router_node_t               *nodes;         /*!< node 0 is the root */
+    uint16_t                    node_count;
+    uint16_t                    nodes_used;
+    uint16_t                    free_node;
+    router_route_t              *routes;
+    uint16_t                    route_count;
+    uint16_t                    routes_used;
+    uint16_t                    free_route;
+    uint32_t                    routed;         /*!< publishes delivered to at least one handler */
+    uint32_t                    unmatched;      /*!< publishes no filter matched */
+} router_table_t;
+
+/**
+ * Specifies the public interface functions of the topic router.
+ */
+typedef struct
+{
+    error_code_module_t ( *Init )( router_table_t *table, router_node_t *nodes, uint16_t node_count, router_route_t *routes, uint16_t route_count );
+    error_code_module_t ( *Add )( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler, void *context );
+    error_code_module_t ( *Remove )( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler );
+    uint32_t ( *Route )( router_table_t *table, const MQTTPublishInfo_t *publish_info );
+    void ( *Report )( const router_table_t *table );
+#if ROUTER_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t filters, uint32_t iterations );
+#endif
+} const router_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern router_interface_t router;
+
+#endif /* __ROUTER_H__ */
+
+/**
+ * @} Router
+ */
+
+/**
+ * @} Applicaton
+ */
@@ -0,0 +1,144 @@
+/** @file router_priv.h
+ *
+ * @brief       MQTT topic router module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Router
+ * @{
+ */
+
+#ifndef __ROUTER_PRIV_H__
+#define __ROUTER_PRIV_H__
+
+/*
+ * @note
+ * Topic filters are compiled into a trie with one node per topic level when they are added. A node keeps its exact
+ * child levels in a sibling list, and its '+' and '#' children in separate links, so wildcards are never parsed again
+ * when a publish arrives. Routing splits the topic name into levels once (text, length and hash of each level) and then
+ * walks the trie: at each node it follows the matching exact child and the '+' child, and every '#' child on the way
+ * delivers the publish. The cost depends on the number of levels and wildcard branches of the topic, not on the number
+ * of filters. Topics starting with '$' are not matched by a wildcard in the first level (MQTT 3.1.1, 4.7.2).
+ *
+ * Nodes and routes live in arrays supplied by the owner of the table, so the router does not allocate. The router does
+ * not lock: the owner serializes Add, Remove and Route (the MQTT module calls them under its mutex).
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "router.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define ROUTER_ROOT                 ( 0 )
+#if ROUTER_BENCHMARK_ENABLED
+#define ROUTER_BENCHMARK_FILTERS    ( 256 )
+#define ROUTER_BENCHMARK_NODES      ( 768 )
+#define ROUTER_BENCHMARK_NAME_MAX   ( 32 )
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/**
+ * @brief Topic name or filter split into levels.
+ */
+typedef struct
+{
+    uint16_t                    count;
+    const char                  *start[ ROUTER_DEPTH_MAX ];
+    uint16_t                    length[ ROUTER_DEPTH_MAX ];
+    uint16_t                    hash[ ROUTER_DEPTH_MAX ];
+} router_levels_t;
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Set up an empty topic router.
+ * @param[out]  table       Router state.
+ * @param[in]   nodes       Storage for the trie (one node per distinct filter level, plus the root).
+ * @param[in]   node_count  Number of nodes.
+ * @param[in]   routes      Storage for the registered handlers.
+ * @param[in]   route_count Number of routes.
+ * @return      Error code.
+ */
+static error_code_module_t router_Init( router_table_t *table, router_node_t *nodes, uint16_t node_count, router_route_t *routes, uint16_t route_count );
+
+/**
+ * @brief       Register a handler for a topic filter. Registering the same handler and context twice has no effect.
+ * @param[in]   table       Router state.
+ * @param[in]   filter      Topic filter, may contain '+' and '#' wildcards.
+ * @param[in]   length      Length of filter.
+ * @param[in]   handler     Called for each publish matching the filter.
+ * @param[in]   context     Passed to handler.
+ * @return      Error code.
+ */
+static error_code_module_t router_Add( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler, void *context );
+
+/**
+ * @brief       Remove the routes of a topic filter.
+ * @param[in]   table       Router state.
+ * @param[in]   filter      Topic filter as registered.
+ * @param[in]   length      Length of filter.
+ * @param[in]   handler     Handler to remove, NULL to remove all handlers of the filter.
+ * @return      Error code.
+ */
+static error_code_module_t router_Remove( router_table_t *table, const char *filter, uint16_t length, router_handler_t handler );
+
+/**
+ * @brief       Deliver a publish to the handlers of all matching filters.
+ * @param[in]   table       Router state.
+ * @param[in]   publish_info Incoming publish.
+ * @return      Number of handlers called.
+ */
+static uint32_t router_Route( router_table_t *table, const MQTTPublishInfo_t *publish_info );
+
+/**
+ * @brief       Print router usage.
+ * @param[in]   table       Router state.
+ */
+static void router_Report( const router_table_t *table );
+#if ROUTER_BENCHMARK_ENABLED
+
+/**
+ * @brief       Compare routing through the trie with matching every filter by MQTT_MatchTopic.
+ * @param[in]   filters     Number of filters to register (at most ROUTER_BENCHMARK_FILTERS).
+ * @param[in]   iterations  Number of publishes to route.
+ */
+static void router_Benchmark( uint32_t filters, uint32_t iterations );
+#endif
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static bool router_Split( const char *name, uint16_t length, bool filter, router_levels_t *levels );
+static uint16_t router_Hash( const char *text, uint16_t length );
+static uint16_t router_Find( const router_table_t *table, uint16_t node, const char *level, uint16_t length, uint16_t hash );
+static uint16_t router_Insert( router_table_t *table, uint16_t node, const char *level, uint16_t length, uint16_t hash );
+static void router_Prune( router_table_t *table, uint16_t node );
+static uint32_t router_Match( router_table_t *table, uint16_t node, uint16_t depth, const router_levels_t *levels, const MQTTPublishInfo_t *publish_info );
+static uint32_t router_Dispatch( router_table_t *table, uint16_t node, const MQTTPublishInfo_t *publish_info );
+#if ROUTER_BENCHMARK_ENABLED
+static uint16_t router_BenchName( char *name, uint32_t index, bool filter );
+static void router_BenchHandler( const MQTTPublishInfo_t *publish_info, void *context );
+#endif
+
+#endif /* __ROUTER_PRIV_H__ */
+
+/**
+ * @}
+ */
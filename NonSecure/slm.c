@@ -43,7 +43,7 @@ slm_obj_t slm_obj =
 void slm_Thread( void *parameter_ptr )
 {
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-    slm_msg_t msg;
+    slm_msg_t *msg;
     char byte;
     char *buf;
     uint32_t i;
@@ -166,12 +166,12 @@ void slm_Thread( void *parameter_ptr )
          * The period will be indefinite if INCLUDE_vTaskSuspend is set to 1 in
          * FreeRTOSConfig.h.
          */
-        if( os.QueueReceive( app.GetSlmQHandle(), &msg, os.Ms2Ticks( TWDT_KICK_TIME ) ) )
+        if( ( msg = OS_MAILBOX_RECEIVE( app.GetSlmQHandle(), slm_msg_t, TWDT_KICK_TIME ) ) != NULL )
         {
             cli.Enable( false );
-            if ( embeddedCliGetTokenCount( msg.msg ) > 0 )
+            if ( embeddedCliGetTokenCount( msg->msg ) > 0 )
             {
-                buf = ( char *) embeddedCliGetToken( msg.msg, 1 );
+                buf = ( char *) embeddedCliGetToken( msg->msg, 1 );
                 for ( i = 0; buf[ i ] != NULL && i < SHORT_MSG_MAX; i++ )
                 {
                     embeddedCliReceiveChar( embedded_cli, buf[ i ] );
@@ -207,6 +207,9 @@ void slm_Thread( void *parameter_ptr )
                 }
             }
             cli.Enable( true );
+
+            /* Return message buffer to the mailbox */
+            os.MailboxFree( app.GetSlmQHandle(), msg );
         }
     }
 }
@@ -301,7 +304,7 @@ void slm_GetRequest( const char *transport_protocol, const char *host_name, uint
 {
     int32_t result, received_bytes = 0;
     bool no_error = true;
-    uint8_t *data = malloc( LONG_MSG_MAX );
+    uint8_t *data = pool.Alloc( LONG_MSG_MAX );
     ntp_packet_t *ntp_pkt = ( ntp_packet_t *)data;
 
     if ( data == NULL )
@@ -423,7 +426,7 @@ void slm_GetRequest( const char *transport_protocol, const char *host_name, uint
     /* Clean up */
     if ( data != NULL )
     {
-        free( data );
+        pool.Free( data );
     }
 }
 
@@ -483,6 +486,20 @@ void slm_Mqttreq( EmbeddedCli *embedded_cli, char *args, void *context )
         {
             mqtt.Status();
         }
+        else if ( modem.StriStr( embeddedCliGetToken( args, 1 ), "uncompress" ) && embeddedCliGetTokenCount( args ) >= 2 )
+        {
+            mqtt.Compress( embeddedCliGetToken( args, 2 ), false );
+        }
+        else if ( modem.StriStr( embeddedCliGetToken( args, 1 ), "compress" ) && embeddedCliGetTokenCount( args ) >= 2 )
+        {
+            mqtt.Compress( embeddedCliGetToken( args, 2 ), true );
+        }
+#if MQTT_BENCHMARK_ENABLED
+        else if ( modem.StriStr( embeddedCliGetToken( args, 1 ), "bench" ) && embeddedCliGetTokenCount( args ) >= 3 )
+        {
+            mqtt.Benchmark( atoi( embeddedCliGetToken( args, 2 ) ), atoi( embeddedCliGetToken( args, 3 ) ) );
+        }
+#endif
         else if ( modem.StriStr( embeddedCliGetToken( args, 1 ), "enable" ) )
         {
             blinky.EnableMQTT( true );
@@ -532,7 +549,7 @@ error_code_module_t slm_Init( void )
 
         /* Set up SLM task */
         shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-        shared_struct->slm_queue = os.CreateQueue( QUEUE_LEN, MAX_TASKS * sizeof( TaskHandle_t ) );
+        shared_struct->slm_queue = OS_CREATE_MAILBOX( QUEUE_LEN, slm_msg_t );
         static StackType_t task_stack[ configMINIMAL_STACK_SIZE ] __attribute__( ( aligned( 32 ) ) );
         TaskHandle_t handle = os.CreateTask( slm_Thread,
                                              "SLM",
@@ -596,20 +613,26 @@ EmbeddedCli* slm_Bindings( CliCommandBinding *binding, size_t nbindings, CLI_UIN
 void slm_Command( char *args )
 {
     uint32_t i;
-    slm_msg_t cmd_msg;
+    slm_msg_t *cmd_msg = OS_MAILBOX_ALLOC( app.GetSlmQHandle(), slm_msg_t, QUEUE_WAIT_TIME );
+
+    if ( cmd_msg == NULL )
+    {
+        return;
+    }
 
-    cmd_msg.handle = os.GetTaskHandle();
-    memset( cmd_msg.msg, 0, sizeof( cmd_msg.msg ) );
+    cmd_msg->handle = os.GetTaskHandle();
+    memset( cmd_msg->msg, 0, sizeof( cmd_msg->msg ) );
     for ( i = 0; i < embeddedCliGetTokenCount( args ); i++ )
     {
-        strcat( cmd_msg.msg, embeddedCliGetToken( args, i + 1 ) );
-        strcat( cmd_msg.msg, " " );
+        strcat( cmd_msg->msg, embeddedCliGetToken( args, i + 1 ) );
+        strcat( cmd_msg->msg, " " );
     }
-    cmd_msg.msg[ strlen( cmd_msg.msg ) - 1 ] = '\r';
+    cmd_msg->msg[ strlen( cmd_msg->msg ) - 1 ] = '\r';
 
-    if ( !os.QueueSend( app.GetSlmQHandle(), &cmd_msg, os.Ms2Ticks( QUEUE_WAIT_TIME ) ) )
+    if ( !os.MailboxSend( app.GetSlmQHandle(), cmd_msg, QUEUE_WAIT_TIME ) )
     {
         /* Message failed to send */
+        os.MailboxFree( app.GetSlmQHandle(), cmd_msg );
     }
 }
 
@@ -23,6 +23,7 @@
 #include <string.h>
 #include "os.h"
 #include "dmm.h"
+#include "pool.h"
 #include "embedded_cli.h"
 #include "app.h"
 #include "log.h"
@@ -0,0 +1,371 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      telemetry.c
+ * @brief     Telemetry encoder module
+ * @details   Encodes telemetry records as CBOR maps without allocating.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Telemetry Telemetry encoder
+ * @brief     CBOR telemetry records
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "telemetry_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+telemetry_interface_t telemetry =
+{
+    .Begin              = &telemetry_Begin,
+    .Int                = &telemetry_Int,
+    .Float              = &telemetry_Float,
+    .Bool               = &telemetry_Bool,
+    .Text               = &telemetry_Text,
+    .Bytes              = &telemetry_Bytes,
+    .End                = &telemetry_End,
+#if TELEMETRY_BENCHMARK_ENABLED
+    .Benchmark          = &telemetry_Benchmark,
+#endif
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t telemetry_Begin( telemetry_t *encoder, uint8_t *buffer, uint32_t size, uint32_t sequence, uint32_t timestamp )
+{
+    error_code_module_t error = NO_ERROR;
+    uint8_t map = TELEMETRY_MAJOR_MAP | TELEMETRY_INFO_INDEFINITE;
+
+    if ( encoder == NULL || buffer == NULL || size < 2 )
+    {
+        error = ERROR_TELEMETRY_BAD_PARAM;
+    }
+    else
+    {
+        encoder->buffer = buffer;
+        encoder->size = size - 1;
+        encoder->length = 0;
+        encoder->overflow = false;
+
+        telemetry_Put( encoder, &map, sizeof( map ) );
+        error = telemetry_Int( encoder, TELEMETRY_KEY_SEQUENCE, sequence );
+        if ( error == NO_ERROR )
+        {
+            error = telemetry_Int( encoder, TELEMETRY_KEY_TIME, timestamp );
+        }
+    }
+
+    return error;
+}
+
+error_code_module_t telemetry_Int( telemetry_t *encoder, const char *name, int32_t value )
+{
+    uint32_t start;
+
+    if ( encoder == NULL || name == NULL )
+    {
+        return ERROR_TELEMETRY_BAD_PARAM;
+    }
+
+    start = encoder->length;
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( name ) );
+    telemetry_Put( encoder, name, strlen( name ) );
+    if ( value < 0 )
+    {
+        telemetry_Head( encoder, TELEMETRY_MAJOR_NINT, ( uint32_t )( -1 - value ) );
+    }
+    else
+    {
+        telemetry_Head( encoder, TELEMETRY_MAJOR_UINT, ( uint32_t )value );
+    }
+
+    return telemetry_Field( encoder, start );
+}
+
+error_code_module_t telemetry_Float( telemetry_t *encoder, const char *name, float value )
+{
+    uint32_t start, bits;
+    uint8_t data[ 5 ];
+
+    if ( encoder == NULL || name == NULL )
+    {
+        return ERROR_TELEMETRY_BAD_PARAM;
+    }
+
+    // CBOR is big-endian
+    memcpy( &bits, &value, sizeof( bits ) );
+    data[ 0 ] = TELEMETRY_FLOAT32;
+    data[ 1 ] = ( uint8_t )( bits >> 24 );
+    data[ 2 ] = ( uint8_t )( bits >> 16 );
+    data[ 3 ] = ( uint8_t )( bits >> 8 );
+    data[ 4 ] = ( uint8_t )bits;
+
+    start = encoder->length;
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( name ) );
+    telemetry_Put( encoder, name, strlen( name ) );
+    telemetry_Put( encoder, data, sizeof( data ) );
+
+    return telemetry_Field( encoder, start );
+}
+
+error_code_module_t telemetry_Bool( telemetry_t *encoder, const char *name, bool value )
+{
+    uint32_t start;
+    uint8_t data = value ? TELEMETRY_TRUE : TELEMETRY_FALSE;
+
+    if ( encoder == NULL || name == NULL )
+    {
+        return ERROR_TELEMETRY_BAD_PARAM;
+    }
+
+    start = encoder->length;
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( name ) );
+    telemetry_Put( encoder, name, strlen( name ) );
+    telemetry_Put( encoder, &data, sizeof( data ) );
+
+    return telemetry_Field( encoder, start );
+}
+
+error_code_module_t telemetry_Text( telemetry_t *encoder, const char *name, const char *value )
+{
+    uint32_t start;
+
+    if ( encoder == NULL || name == NULL || value == NULL )
+    {
+        return ERROR_TELEMETRY_BAD_PARAM;
+    }
+
+    start = encoder->length;
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( name ) );
+    telemetry_Put( encoder, name, strlen( name ) );
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( value ) );
+    telemetry_Put( encoder, value, strlen( value ) );
+
+    return telemetry_Field( encoder, start );
+}
+
+error_code_module_t telemetry_Bytes( telemetry_t *encoder, const char *name, const uint8_t *value, uint32_t length )
+{
+    uint32_t start;
+
+    if ( encoder == NULL || name == NULL || ( value == NULL && length > 0 ) )
+    {
+        return ERROR_TELEMETRY_BAD_PARAM;
+    }
+
+    start = encoder->length;
+    telemetry_Head( encoder, TELEMETRY_MAJOR_TEXT, strlen( name ) );
+    telemetry_Put( encoder, name, strlen( name ) );
+    telemetry_Head( encoder, TELEMETRY_MAJOR_BYTES, length );
+    telemetry_Put( encoder, value, length );
+
+    return telemetry_Field( encoder, start );
+}
+
+error_code_module_t telemetry_End( telemetry_t *encoder, uint32_t *length )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( encoder == NULL || length == NULL )
+    {
+        error = ERROR_TELEMETRY_BAD_PARAM;
+    }
+    else if ( encoder->overflow )
+    {
+        error = ERROR_TELEMETRY_FULL;
+    }
+    else
+    {
+        // Begin held back this byte
+        encoder->buffer[ encoder->length++ ] = TELEMETRY_BREAK;
+        *length = encoder->length;
+    }
+
+    return error;
+}
+
+#if TELEMETRY_BENCHMARK_ENABLED
+void telemetry_Benchmark( uint32_t iterations )
+{
+    static const char *const names[] =
+    {
+        "sprintf message",
+        "CBOR message",
+        "sprintf record",
+        "CBOR record",
+    };
+    uint8_t cbor[ TELEMETRY_BENCHMARK_SIZE ];
+    char text[ TELEMETRY_BENCHMARK_SIZE ];
+    uint32_t cycles[ 4 ] = { 0 }, bytes[ 4 ] = { 0 };
+    uint32_t i, start;
+    uint32_t cycles_per_us = SystemCoreClock / 1000000;
+
+    // enable the cycle counter
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for ( i = 0; i < iterations; i++ )
+    {
+        start = DWT->CYCCNT;
+        bytes[ 0 ] += telemetry_BenchText( text, i, false );
+        cycles[ 0 ] += DWT->CYCCNT - start;
+
+        start = DWT->CYCCNT;
+        bytes[ 1 ] += telemetry_BenchCbor( cbor, i, false );
+        cycles[ 1 ] += DWT->CYCCNT - start;
+
+        start = DWT->CYCCNT;
+        bytes[ 2 ] += telemetry_BenchText( text, i, true );
+        cycles[ 2 ] += DWT->CYCCNT - start;
+
+        start = DWT->CYCCNT;
+        bytes[ 3 ] += telemetry_BenchCbor( cbor, i, true );
+        cycles[ 3 ] += DWT->CYCCNT - start;
+    }
+
+    if ( iterations == 0 || cycles_per_us == 0 )
+    {
+        return;
+    }
+
+    Log.Print( "Telemetry benchmark: %d records per format, %d MHz\r\n", iterations, cycles_per_us );
+    Log.Print( "Message: text and sequence (CBOR adds the time); record: sequence, time and six typed fields\r\n" );
+    for ( i = 0; i < 4; i++ )
+    {
+        Log.Print( "%-16s %4d bytes %6d cycles per record\r\n", names[ i ], bytes[ i ] / iterations, cycles[ i ] / iterations );
+    }
+}
+#endif
+
+/*************************************************************************************************************************************
+ * Private Functions Definition
+ */
+
+void telemetry_Head( telemetry_t *encoder, uint8_t major, uint32_t value )
+{
+    uint8_t data[ 5 ];
+    uint32_t length;
+
+    // Shortest form of the argument
+    if ( value < TELEMETRY_INFO_UINT8 )
+    {
+        data[ 0 ] = major | ( uint8_t )value;
+        length = 1;
+    }
+    else if ( value <= UINT8_MAX )
+    {
+        data[ 0 ] = major | TELEMETRY_INFO_UINT8;
+        data[ 1 ] = ( uint8_t )value;
+        length = 2;
+    }
+    else if ( value <= UINT16_MAX )
+    {
+        data[ 0 ] = major | TELEMETRY_INFO_UINT16;
+        data[ 1 ] = ( uint8_t )( value >> 8 );
+        data[ 2 ] = ( uint8_t )value;
+        length = 3;
+    }
+    else
+    {
+        data[ 0 ] = major | TELEMETRY_INFO_UINT32;
+        data[ 1 ] = ( uint8_t )( value >> 24 );
+        data[ 2 ] = ( uint8_t )( value >> 16 );
+        data[ 3 ] = ( uint8_t )( value >> 8 );
+        data[ 4 ] = ( uint8_t )value;
+        length = 5;
+    }
+    telemetry_Put( encoder, data, length );
+}
+
+void telemetry_Put( telemetry_t *encoder, const void *data, uint32_t length )
+{
+    if ( encoder->overflow || encoder->length + length > encoder->size )
+    {
+        encoder->overflow = true;
+    }
+    else
+    {
+        memcpy( &encoder->buffer[ encoder->length ], data, length );
+        encoder->length += length;
+    }
+}
+
+error_code_module_t telemetry_Field( telemetry_t *encoder, uint32_t start )
+{
+    error_code_module_t error = NO_ERROR;
+
+    // Leave out the whole field, not a part of it
+    if ( encoder->overflow )
+    {
+        encoder->length = start;
+        error = ERROR_TELEMETRY_FULL;
+    }
+
+    return error;
+}
+
+#if TELEMETRY_BENCHMARK_ENABLED
+uint32_t telemetry_BenchCbor( uint8_t *buffer, uint32_t sequence, bool full )
+{
+    telemetry_t encoder;
+    uint32_t length = 0;
+
+    telemetry_Begin( &encoder, buffer, TELEMETRY_BENCHMARK_SIZE, sequence, 86400000 + sequence * 1000 );
+    if ( full )
+    {
+        telemetry_Float( &encoder, "temp", 21.5f + ( sequence % 10 ) );
+        telemetry_Int( &encoder, "hum", 40 + sequence % 20 );
+        telemetry_Int( &encoder, "bat", 3700 + sequence % 100 );
+        telemetry_Int( &encoder, "rssi", -90 - ( int32_t )( sequence % 20 ) );
+        telemetry_Bool( &encoder, "ok", true );
+    }
+    telemetry_Text( &encoder, "msg", "Hello World!" );
+    telemetry_End( &encoder, &length );
+
+    return length;
+}
+
+uint32_t telemetry_BenchText( char *buffer, uint32_t sequence, bool full )
+{
+    int32_t length;
+
+    // The payload of mqtt.Send before CBOR, and the same record as JSON
+    if ( full )
+    {
+        length = sprintf( buffer,
+                          "{\"seq\":%d,\"ts\":%d,\"temp\":%d.5,\"hum\":%d,\"bat\":%d,\"rssi\":%d,\"ok\":true,\"msg\":\"%s\"}",
+                          sequence,
+                          86400000 + sequence * 1000,
+                          21 + sequence % 10,
+                          40 + sequence % 20,
+                          3700 + sequence % 100,
+                          -90 - ( int32_t )( sequence % 20 ),
+                          "Hello World!" );
+    }
+    else
+    {
+        length = sprintf( buffer, "\"%s: %d\"", "Hello World!", sequence );
+    }
+
+    return ( uint32_t )length;
+}
+#endif
+
+/**
+ * @} Telemetry
+ */
+
+/**
+ * @} Application
+ */
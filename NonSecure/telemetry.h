@@ -0,0 +1,84 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      telemetry.h
+ * @brief     Telemetry encoder module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Telemetry
+ * @{
+ */
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define TELEMETRY_KEY_SEQUENCE          "seq"
+#define TELEMETRY_KEY_TIME              "ts"
+
+#ifndef TELEMETRY_BENCHMARK_ENABLED
+#define TELEMETRY_BENCHMARK_ENABLED     ( 0 )           /*!< set to 1 to build telemetry.Benchmark() */
+#endif
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief CBOR encoder writing one telemetry record (a map of named fields) into a buffer of the caller.
+ */
+typedef struct
+{
+    uint8_t                     *buffer;
+    uint32_t                    size;           /*!< bytes available to fields, the end of the map not counted */
+    uint32_t                    length;
+    bool                        overflow;       /*!< a field did not fit, End reports it */
+} telemetry_t;
+
+/**
+ * Specifies the public interface functions of the telemetry encoder.
+ */
+typedef struct
+{
+    error_code_module_t ( *Begin )( telemetry_t *encoder, uint8_t *buffer, uint32_t size, uint32_t sequence, uint32_t timestamp );
+    error_code_module_t ( *Int )( telemetry_t *encoder, const char *name, int32_t value );
+    error_code_module_t ( *Float )( telemetry_t *encoder, const char *name, float value );
+    error_code_module_t ( *Bool )( telemetry_t *encoder, const char *name, bool value );
+    error_code_module_t ( *Text )( telemetry_t *encoder, const char *name, const char *value );
+    error_code_module_t ( *Bytes )( telemetry_t *encoder, const char *name, const uint8_t *value, uint32_t length );
+    error_code_module_t ( *End )( telemetry_t *encoder, uint32_t *length );
+#if TELEMETRY_BENCHMARK_ENABLED
+    void ( *Benchmark )( uint32_t iterations );
+#endif
+} const telemetry_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern telemetry_interface_t telemetry;
+
+#endif /* __TELEMETRY_H__ */
+
+/**
+ * @} Telemetry
+ */
+
+/**
+ * @} Applicaton
+ */
@@ -0,0 +1,156 @@
+/** @file telemetry_priv.h
+ *
+ * @brief       Telemetry encoder module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Telemetry
+ * @{
+ */
+
+#ifndef __TELEMETRY_PRIV_H__
+#define __TELEMETRY_PRIV_H__
+
+/*
+ * @note
+ * A record is a CBOR map (RFC 8949) of indefinite length, so fields can be added without counting them first: Begin
+ * writes the map start and the sequence and time fields, every field adds a text key and its value, End writes the break
+ * byte that closes the map. Integers take the shortest CBOR form (1 to 5 bytes), floats are single precision. The
+ * encoder only writes into the buffer it is given and keeps no state of its own.
+ *
+ * A field that does not fit is left out completely and marks the record as overflowed; End then fails, so a truncated
+ * record is never sent. One byte of the buffer is held back for the break byte.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "telemetry.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+#define TELEMETRY_MAJOR_UINT        ( 0 << 5 )
+#define TELEMETRY_MAJOR_NINT        ( 1 << 5 )
+#define TELEMETRY_MAJOR_BYTES       ( 2 << 5 )
+#define TELEMETRY_MAJOR_TEXT        ( 3 << 5 )
+#define TELEMETRY_MAJOR_MAP         ( 5 << 5 )
+#define TELEMETRY_MAJOR_SIMPLE      ( 7 << 5 )
+#define TELEMETRY_INFO_UINT8        ( 24 )
+#define TELEMETRY_INFO_UINT16       ( 25 )
+#define TELEMETRY_INFO_UINT32       ( 26 )
+#define TELEMETRY_INFO_INDEFINITE   ( 31 )
+#define TELEMETRY_FALSE             ( TELEMETRY_MAJOR_SIMPLE | 20 )
+#define TELEMETRY_TRUE              ( TELEMETRY_MAJOR_SIMPLE | 21 )
+#define TELEMETRY_FLOAT32           ( TELEMETRY_MAJOR_SIMPLE | 26 )
+#define TELEMETRY_BREAK             ( TELEMETRY_MAJOR_SIMPLE | TELEMETRY_INFO_INDEFINITE )
+#if TELEMETRY_BENCHMARK_ENABLED
+#define TELEMETRY_BENCHMARK_SIZE    ( 128 )
+#endif
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Start a record with its sequence number and time stamp.
+ * @param[out]  encoder     Encoder state.
+ * @param[in]   buffer      Where the record is written.
+ * @param[in]   size        Size of buffer.
+ * @param[in]   sequence    Sequence number of the record.
+ * @param[in]   timestamp   Time of the record in ms.
+ * @return      Error code.
+ */
+static error_code_module_t telemetry_Begin( telemetry_t *encoder, uint8_t *buffer, uint32_t size, uint32_t sequence, uint32_t timestamp );
+
+/**
+ * @brief       Add an integer field.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   name        Field name.
+ * @param[in]   value       Field value.
+ * @return      Error code, ERROR_TELEMETRY_FULL when the field does not fit.
+ */
+static error_code_module_t telemetry_Int( telemetry_t *encoder, const char *name, int32_t value );
+
+/**
+ * @brief       Add a single precision floating point field.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   name        Field name.
+ * @param[in]   value       Field value.
+ * @return      Error code, ERROR_TELEMETRY_FULL when the field does not fit.
+ */
+static error_code_module_t telemetry_Float( telemetry_t *encoder, const char *name, float value );
+
+/**
+ * @brief       Add a boolean field.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   name        Field name.
+ * @param[in]   value       Field value.
+ * @return      Error code, ERROR_TELEMETRY_FULL when the field does not fit.
+ */
+static error_code_module_t telemetry_Bool( telemetry_t *encoder, const char *name, bool value );
+
+/**
+ * @brief       Add a text field.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   name        Field name.
+ * @param[in]   value       Field value (null-terminated).
+ * @return      Error code, ERROR_TELEMETRY_FULL when the field does not fit.
+ */
+static error_code_module_t telemetry_Text( telemetry_t *encoder, const char *name, const char *value );
+
+/**
+ * @brief       Add a byte string field.
+ * @param[in]   encoder     Encoder state.
+ * @param[in]   name        Field name.
+ * @param[in]   value       Field value.
+ * @param[in]   length      Length of value.
+ * @return      Error code, ERROR_TELEMETRY_FULL when the field does not fit.
+ */
+static error_code_module_t telemetry_Bytes( telemetry_t *encoder, const char *name, const uint8_t *value, uint32_t length );
+
+/**
+ * @brief       Close the record.
+ * @param[in]   encoder     Encoder state.
+ * @param[out]  length      Length of the record.
+ * @return      Error code, ERROR_TELEMETRY_FULL when a field was left out.
+ */
+static error_code_module_t telemetry_End( telemetry_t *encoder, uint32_t *length );
+#if TELEMETRY_BENCHMARK_ENABLED
+
+/**
+ * @brief       Compare size and encode time of CBOR records with the sprintf text payloads they replace.
+ * @param[in]   iterations  Records encoded per format.
+ */
+static void telemetry_Benchmark( uint32_t iterations );
+#endif
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+static void telemetry_Head( telemetry_t *encoder, uint8_t major, uint32_t value );
+static void telemetry_Put( telemetry_t *encoder, const void *data, uint32_t length );
+static error_code_module_t telemetry_Field( telemetry_t *encoder, uint32_t start );
+#if TELEMETRY_BENCHMARK_ENABLED
+static uint32_t telemetry_BenchCbor( uint8_t *buffer, uint32_t sequence, bool full );
+static uint32_t telemetry_BenchText( char *buffer, uint32_t sequence, bool full );
+#endif
+
+#endif /* __TELEMETRY_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -26,13 +26,18 @@ tls_interface_t tls =
 {
     .Init               = &tls_Init,
     .Setup              = &tls_Setup,
+    .Handshake          = &tls_Handshake,
+    .Policy             = &tls_Policy,
     .Dump               = &tls_Dump,
+#if TLS_BENCHMARK_ENABLED
+    .Benchmark          = &tls_Benchmark,
+#endif
 };
 
 tls_obj_t tls_obj =
 {
     .is_init            = false,
-    .always_provision   = true,    // TODO: remove later and do not expose all certificates and keys
+    .always_provision   = false,   // true: write all credentials even if the modem has them
 };
 
 /* Taken from the IANA register */
@@ -84,90 +89,102 @@ static const char private_key[] =
 #endif
 };
 
+static const tls_credential_t credentials[] =
+{
+    { tag_tls, cred_type_ca_chain, rootCA, "TLS CA Cert", TLS_BLOB_CA },
+    { tag_tls, cred_type_public_cert, client_cert, "mTLS Public Cert", TLS_BLOB_CERT },
+    { tag_tls, cred_type_private_key, private_key, "mTLS Private Cert", TLS_BLOB_KEY },
+};
+
+static const uint32_t sha256_k[ 64 ] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
 /*************************************************************************************************************************************
  * Public Functions Definition
  */
 
 error_code_module_t tls_Init( void )
 {
-    bool exists = false;
-    int32_t err = tls_KeyExists( tag_tls, cred_type_ca_chain, &exists );
+    int32_t err = 0;
+    uint32_t i;
+    uint32_t written = 0;
+    bool is_offline = false;
+    char stored[ SHA256_HEX_SIZE ];
+    char digest[ SHA256_HEX_SIZE ];
+    const char *data;
+    uint32_t length;
 
-    modem.Stop();
     Log.DebugPrint( "Provisioning certificates" );
-    if ( !exists || tls_obj.always_provision )
+    for ( i = 0; i < ARRAY_SIZE( credentials ) && err == 0; i++ )
     {
-#if 0
-        if ( ( err = tls_WriteKey( tag_tls, cred_type_ca_chain, rootCA, sizeof( rootCA ) ) ) )
+        // A stored blob takes the place of the compiled-in credential, and is hashed and written where it lies in flash
+        if ( ( data = ( const char * )fs.BlobFind( credentials[ i ].blob, &length ) ) == NULL )
         {
-            Log.ErrorPrint( "TLS CA Cert failed, err=%d, errno=%d", err, errno );
+            data = credentials[ i ].data;
+            length = strlen( data );
         }
-        else if ( ( err = tls_EraseKey( tag_mtls, cred_type_ca_chain ) ) )
+        tls_Digest( data, length, digest );
+        if ( tls_KeyDigest( credentials[ i ].tag, credentials[ i ].type, stored ) != 0 )
         {
-            Log.ErrorPrint( "mTLS CA Cert failed, err=%d, errno=%d", err, errno );
+            stored[ 0 ] = 0;
         }
-        else if ( ( err = tls_WriteKey( tag_mtls, cred_type_ca_chain, rootCA, sizeof( rootCA ) ) ) )
+        if ( !tls_obj.always_provision && modem.StriStr( stored, digest ) != NULL )
         {
-            Log.ErrorPrint( "mTLS CA Cert failed, err=%d, errno=%d", err, errno );
+            Log.DebugPrint( "%s unchanged", credentials[ i ].name );
+            continue;
         }
-        else if ( ( err = tls_EraseKey( tag_mtls, cred_type_public_cert ) ) )
-        {
-            Log.ErrorPrint( "mTLS Public Cert failed, err=%d, errno=%d", err, errno );
-        }
-        else if ( ( err = tls_WriteKey( tag_mtls, cred_type_public_cert, client_cert, sizeof( client_cert ) ) ) )
-        {
-            Log.ErrorPrint( "mTLS Public Cert failed, err=%d, errno=%d", err, errno );
-        }
-        else if ( ( err = tls_EraseKey( tag_mtls, cred_type_private_key ) ) )
-        {
-            Log.ErrorPrint( "mTLS Private Cert failed, err=%d, errno=%d", err, errno );
-        }
-        else if ( ( err = tls_WriteKey( tag_mtls, cred_type_private_key, private_key, sizeof( private_key ) ) ) )
-        {
-            Log.ErrorPrint( "mTLS Private Cert failed, err=%d, errno=%d", err, errno );
-        }
-#else
-        if ( ( err = tls_WriteKey( tag_tls, cred_type_ca_chain, rootCA, sizeof( rootCA ) ) ) )
+
+        // Writing needs the modem offline; only take it down when a credential changed
+        if ( !is_offline )
         {
-            Log.ErrorPrint( "TLS CA Cert failed, err=%d, errno=%d", err, errno );
+            modem.Stop();
+            is_offline = true;
         }
-        else if ( ( err = tls_WriteKey( tag_tls, cred_type_public_cert, client_cert, sizeof( client_cert ) ) ) )
+        if ( ( err = tls_WriteKey( credentials[ i ].tag, credentials[ i ].type, data, length ) ) )
         {
-            Log.ErrorPrint( "mTLS Public Cert failed, err=%d, errno=%d", err, errno );
+            Log.ErrorPrint( "%s failed, err=%d, errno=%d", credentials[ i ].name, err, errno );
         }
-        else if ( ( err = tls_WriteKey( tag_tls, cred_type_private_key, private_key, sizeof( private_key ) ) ) )
+        else
         {
-            Log.ErrorPrint( "mTLS Private Cert failed, err=%d, errno=%d", err, errno );
+            written++;
         }
-#endif
     }
 
     if ( err == 0 )
     {
         tls_obj.is_init = true;
-        Log.InfoPrint( "TLS provisioning complete" );
+        Log.InfoPrint( "TLS provisioning complete, %d of %d credentials written", written, ARRAY_SIZE( credentials ) );
     }
     return err;
 }
 
-int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag )
+int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag, bool session_cache )
 {
     int32_t err = 0;
     int32_t parm;
-    //nrf_sec_cipher_t ciphersuite_list[12];
-    nrf_sec_cipher_t ciphersuite_list[1];
+    uint32_t i, count = 1;
+    nrf_sec_cipher_t ciphersuite_list[ TLS_CIPHER_MAX ] = { TLS_CIPHER_DEFAULT };
+    tls_policy_t *policy = tls_FindPolicy( host_name );
 
     Log.DebugPrint( "Setting up TLS for socket=%d, host=%s, tag=%u", socket, host_name, tag );
 
-#if 1
-    ciphersuite_list[ 0 ] = cipher_suites[ 5 ].value;
-#else
-    uint32_t i;
-    for ( i = 0; i < 12; i++ )
+    if ( policy != NULL )
     {
-        ciphersuite_list[ i ] = xCiphersuites[ i ].value;
+        for ( i = 0; i < policy->count; i++ )
+        {
+            ciphersuite_list[ i ] = policy->ciphers[ i ];
+        }
+        count = policy->count;
     }
-#endif
 
     if ( err == 0 )
     {
@@ -185,8 +202,8 @@ int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag )
 
     if ( err == 0 )
     {
-        parm = 1;
-        Log.DebugPrint( "nrf_setsockopt(NRF_SO_SEC_SESSION_CACHE)" );
+        parm = session_cache ? 1 : 0;
+        Log.DebugPrint( "nrf_setsockopt(NRF_SO_SEC_SESSION_CACHE), cache=%d", parm );
         err = nrf_setsockopt(socket, NRF_SOL_SECURE, NRF_SO_SEC_SESSION_CACHE, &parm, sizeof( nrf_sec_session_cache_t ) );
     }
 
@@ -198,15 +215,8 @@ int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag )
 
     if ( err == 0 )
     {
-        Log.DebugPrint( "nrf_setsockopt(NRF_SO_CIPHERSUITE_LIST), len=%d", sizeof( ciphersuite_list ));
-        err = nrf_setsockopt( socket, NRF_SOL_SECURE, NRF_SO_SEC_CIPHERSUITE_LIST, ciphersuite_list, sizeof( ciphersuite_list ) );
-    }
-
-    if ( err == 0 )
-    {
-        parm = 0;
-        Log.DebugPrint( "nrf_setsockopt(NRF_SO_SEC_SESSION_CACHE)" );
-        err = nrf_setsockopt( socket, NRF_SOL_SECURE, NRF_SO_SEC_SESSION_CACHE, &parm, sizeof( nrf_sec_session_cache_t ) );
+        Log.DebugPrint( "nrf_setsockopt(NRF_SO_CIPHERSUITE_LIST), count=%d", count );
+        err = nrf_setsockopt( socket, NRF_SOL_SECURE, NRF_SO_SEC_CIPHERSUITE_LIST, ciphersuite_list, count * sizeof( nrf_sec_cipher_t ) );
     }
 
     if ( err == 0 )
@@ -224,11 +234,66 @@ int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag )
     return err;
 }
 
+tls_handshake_t tls_Handshake( int32_t socket )
+{
+    tls_handshake_t handshake = tls_handshake_unknown;
+#ifdef NRF_SO_SEC_HANDSHAKE_STATUS
+    int32_t status;
+    nrf_socklen_t length = sizeof( status );
+
+    if ( nrf_getsockopt( socket, NRF_SOL_SECURE, NRF_SO_SEC_HANDSHAKE_STATUS, &status, &length ) == 0 )
+    {
+        handshake = ( status == NRF_SO_SEC_HANDSHAKE_STATUS_CACHED ) ? tls_handshake_resumed : tls_handshake_full;
+    }
+#endif
+
+    return handshake;
+}
+
+error_code_module_t tls_Policy( const char *host_name, const uint16_t *ciphers, uint32_t count )
+{
+    error_code_module_t error = NO_ERROR;
+    tls_policy_t *policy;
+    uint32_t i;
+
+    if ( host_name == NULL || strlen( host_name ) >= HOST_NAME_MAX || count > TLS_CIPHER_MAX || ( ciphers == NULL && count > 0 ) )
+    {
+        return ERROR_TLS_BAD_PARAM;
+    }
+
+    // Take the host's entry, or a free one
+    if ( ( policy = tls_FindPolicy( host_name ) ) == NULL && count > 0 )
+    {
+        for ( i = 0; i < TLS_POLICY_COUNT && policy == NULL; i++ )
+        {
+            if ( tls_obj.policy[ i ].count == 0 )
+            {
+                policy = &tls_obj.policy[ i ];
+                strcpy( policy->host_name, host_name );
+            }
+        }
+        if ( policy == NULL )
+        {
+            error = ERROR_TLS_FULL;
+        }
+    }
+
+    if ( policy != NULL )
+    {
+        memcpy( policy->ciphers, ciphers, count * sizeof( uint16_t ) );
+        policy->count = count;
+    }
+
+    return error;
+}
+
 int32_t tls_Dump( void )
 {
     size_t len = 2048;
-    char *buf = malloc( len );
+    char *buf = pool.Alloc( len );
     int32_t err = 0;
+    const char *data;
+    uint32_t i, length;
 
     if ( buf == NULL )
     {
@@ -248,11 +313,101 @@ int32_t tls_Dump( void )
         err = tls_ReadKey( tag_mtls, cred_type_ca_chain, buf, len );
         tls_PrintCredential( buf, len );
     }
+    pool.Free( buf );
+
+    // Stored blobs are printed from flash, private keys are not printed at all
+    for ( i = 0; i < ARRAY_SIZE( credentials ); i++ )
+    {
+        if ( credentials[ i ].type != cred_type_private_key &&
+             ( data = ( const char * )fs.BlobFind( credentials[ i ].blob, &length ) ) != NULL )
+        {
+            Log.Print( "Blob %s (%s): %d bytes\r\n", credentials[ i ].blob, credentials[ i ].name, length );
+            tls_PrintPem( data, length );
+        }
+    }
 
-    free( buf );
     return err;
 }
 
+#if TLS_BENCHMARK_ENABLED
+void tls_Benchmark( const char *host_name, uint16_t port, uint32_t runs )
+{
+    uint32_t i, run, start, handshake_ms, download_ms, received;
+    uint32_t sent_kb[ 2 ], received_kb[ 2 ];
+    int32_t fd, length;
+    bool is_counted;
+    char *buf = pool.Alloc( LONG_MSG_MAX );
+
+    if ( buf == NULL || host_name == NULL || runs == 0 )
+    {
+        Log.ErrorPrint( "No valid arguments" );
+        if ( buf != NULL )
+        {
+            pool.Free( buf );
+        }
+        return;
+    }
+
+    // Full handshakes only
+    modem.SessionCache( host_name, false );
+    nrf_modem_at_printf( "AT%%XCONNSTAT=1" );
+
+    Log.Print( "TLS handshake benchmark: %s:%d, %d connects per suite\r\n", host_name, port, runs );
+    for ( i = 0; i < ARRAY_SIZE( cipher_suites ); i++ )
+    {
+        if ( modem.StriStr( cipher_suites[ i ].name, "ECDHE" ) == NULL || tls_Policy( host_name, &cipher_suites[ i ].value, 1 ) != NO_ERROR )
+        {
+            continue;
+        }
+
+        handshake_ms = 0;
+        download_ms = 0;
+        received = 0;
+        is_counted = tls_ConnStat( &sent_kb[ 0 ], &received_kb[ 0 ] );
+        for ( run = 0; run < runs; run++ )
+        {
+            start = os.GetTickCountMs();
+            fd = modem.Connect( "tls", host_name, port, TLS_BENCH_TIMEOUT, TLS_BENCH_TIMEOUT );
+            if ( fd < 0 )
+            {
+                break;
+            }
+            handshake_ms += os.GetTickCountMs() - start;
+
+            // Record layer: download whatever the server sends for a GET
+            sprintf( buf, "GET / HTTP/1.0\r\nHost:%s\r\n\r\n", host_name );
+            start = os.GetTickCountMs();
+            if ( modem.Send( fd, ( uint8_t * )buf, strlen( buf ) ) > 0 )
+            {
+                while ( ( length = modem.ReceiveTimeout( fd, ( uint8_t * )buf, LONG_MSG_MAX, TLS_BENCH_RECEIVE ) ) > 0 )
+                {
+                    received += length;
+                    download_ms = os.GetTickCountMs() - start;
+                }
+            }
+            modem.Disconnect( fd );
+        }
+        is_counted = is_counted && tls_ConnStat( &sent_kb[ 1 ], &received_kb[ 1 ] );
+
+        if ( run < runs )
+        {
+            Log.Print( "%-40s failed\r\n", cipher_suites[ i ].name );
+            continue;
+        }
+        Log.Print( "%-40s %5d ms handshake, %5d B/s", cipher_suites[ i ].name, handshake_ms / runs, download_ms > 0 ? received * 1000 / download_ms : 0 );
+        if ( is_counted )
+        {
+            Log.Print( ", %d kB sent, %d kB received per connect", ( sent_kb[ 1 ] - sent_kb[ 0 ] ) / runs, ( received_kb[ 1 ] - received_kb[ 0 ] ) / runs );
+        }
+        Log.Print( "\r\n" );
+    }
+
+    tls_Policy( host_name, NULL, 0 );
+    modem.SessionCache( host_name, MODEM_SESSION_CACHE );
+    pool.Free( buf );
+}
+#endif
+
 void tls_PrintCredential( char *buf, size_t len )
 {
     uint32_t i, line_len = 65;
@@ -275,6 +430,24 @@ void tls_PrintCredential( char *buf, size_t len )
     }
 }
 
+void tls_PrintPem( const char *data, size_t length )
+{
+    const char *end = data + length;
+    const char *eol;
+
+    while ( data < end )
+    {
+        eol = memchr( data, '\n', end - data );
+        if ( eol == NULL )
+        {
+            eol = end;
+        }
+        Log.Print( "%.*s\r\n", ( int )( eol - data ), data );
+        data = eol + 1;
+        os.Delay( 10 );
+    }
+}
+
 int32_t tls_Cmee( bool enable )
 {
     int err =  nrf_modem_at_printf("AT+CMEE=%d", enable ? 1 : 0 );
@@ -295,8 +468,9 @@ int32_t tls_WriteKey( tls_tag_t tag, tls_cred_type_t type, const void *buf, size
         return -EINVAL;
     }
 
+    // A blob in flash is not terminated, so only len bytes go out
     tls_Cmee( true );
-    err = nrf_modem_at_printf( "AT%%CMNG=0,%d,%d,\"\n%s\"", tag, type, (const char *)buf );
+    err = nrf_modem_at_printf( "AT%%CMNG=0,%d,%d,\"%.*s\"", tag, type, ( int )len, (const char *)buf );
     tls_Cmee( false );
 
     return err;
@@ -329,40 +503,158 @@ int32_t tls_ReadKey( tls_tag_t tag, tls_cred_type_t type, void *buf, size_t len
     return err;
 }
 
-int tls_KeyExists( tls_tag_t tag, tls_cred_type_t type, bool *exists )
+int32_t tls_KeyDigest( tls_tag_t tag, tls_cred_type_t type, char *digest )
 {
     const size_t size = 128;
-    int err = 0;
-    char str [ 32 ];
-    char *resp;
+    int32_t err = 0;
+    char *resp = NULL;
+    char *start;
 
-    if ( exists == NULL )
+    if ( digest == NULL || ( resp = pool.Alloc( size ) ) == NULL )
     {
         err = -EINVAL;
     }
 
     if ( err == 0 )
     {
-        resp = malloc( size );
-        *exists = false;
-
-        sprintf( str, "AT%%CMNG=2,%d,%d", tag, type );
-        err = nrf_modem_at_cmd( resp, size, "%s", str );
+        digest[ 0 ] = 0;
 
         /* Expected response, sample: "%CMNG: 16842754,0,"760EB917DCF13F71B491D6DE8B04F79D638E1AEC40578384A1BE8BF" ... */
-        sprintf( str, "CMNG: %d,%d,\"", tag, type );
-        resp[ strlen( str ) + 4 ] = '\0';       // Evaluating some parts only, good enough to validate the existince of the CERT
-        if ( modem.StriStr( resp, str ) != NULL )
+        err = nrf_modem_at_cmd( resp, size, "AT%%CMNG=1,%d,%d", tag, type );
+        if ( err == 0 && ( start = strchr( resp, '"' ) ) != NULL && strlen( start + 1 ) > SHA256_HEX_SIZE - 1 )
         {
-            *exists = true;
+            memcpy( digest, start + 1, SHA256_HEX_SIZE - 1 );
+            digest[ SHA256_HEX_SIZE - 1 ] = 0;
         }
-
-        free( resp );
     }
 
+    if ( resp != NULL )
+    {
+        pool.Free( resp );
+    }
     return err;
 }
 
+tls_policy_t *tls_FindPolicy( const char *host_name )
+{
+    uint32_t i;
+
+    for ( i = 0; i < TLS_POLICY_COUNT; i++ )
+    {
+        if ( tls_obj.policy[ i ].count > 0 && strcmp( tls_obj.policy[ i ].host_name, host_name ) == 0 )
+        {
+            return &tls_obj.policy[ i ];
+        }
+    }
+
+    return NULL;
+}
+
+#if TLS_BENCHMARK_ENABLED
+bool tls_ConnStat( uint32_t *sent_kb, uint32_t *received_kb )
+{
+    char resp[ SHORT_MSG_MAX ];
+    uint32_t sms_sent, sms_received;
+    char *start;
+
+    /* Expected response, sample: "%XCONNSTAT: 0,0,12,34,708,236" (data in kB) */
+    return nrf_modem_at_cmd( resp, sizeof( resp ), "AT%%XCONNSTAT?" ) == 0 &&
+           ( start = strchr( resp, ':' ) ) != NULL &&
+           sscanf( start + 1, "%lu,%lu,%lu,%lu", ( unsigned long * )&sms_sent, ( unsigned long * )&sms_received,
+                   ( unsigned long * )sent_kb, ( unsigned long * )received_kb ) == 4;
+}
+#endif
+
+void tls_Digest( const char *data, size_t length, char *digest )
+{
+    tls_sha256_t sha =
+    {
+        .state = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 },
+    };
+    uint32_t i;
+    uint64_t bits;
+
+    for ( ; length > 0; data++, length-- )
+    {
+        sha.block[ sha.block_length++ ] = ( uint8_t )*data;
+        sha.length++;
+        if ( sha.block_length == SHA256_BLOCK_SIZE )
+        {
+            tls_Sha256Block( &sha, sha.block );
+            sha.block_length = 0;
+        }
+    }
+
+    // Padding: 0x80, zeros, message length in bits (big-endian)
+    bits = ( uint64_t )sha.length * 8;
+    sha.block[ sha.block_length++ ] = 0x80;
+    if ( sha.block_length > SHA256_BLOCK_SIZE - 8 )
+    {
+        memset( &sha.block[ sha.block_length ], 0, SHA256_BLOCK_SIZE - sha.block_length );
+        tls_Sha256Block( &sha, sha.block );
+        sha.block_length = 0;
+    }
+    memset( &sha.block[ sha.block_length ], 0, SHA256_BLOCK_SIZE - 8 - sha.block_length );
+    for ( i = 0; i < 8; i++ )
+    {
+        sha.block[ SHA256_BLOCK_SIZE - 1 - i ] = ( uint8_t )( bits >> ( 8 * i ) );
+    }
+    tls_Sha256Block( &sha, sha.block );
+
+    for ( i = 0; i < 8; i++ )
+    {
+        sprintf( &digest[ 8 * i ], "%08lX", ( unsigned long )sha.state[ i ] );
+    }
+}
+
+void tls_Sha256Block( tls_sha256_t *sha, const uint8_t *block )
+{
+    uint32_t w[ 64 ];
+    uint32_t a, b, c, d, e, f, g, h, t1, t2;
+    uint32_t i;
+
+    for ( i = 0; i < 16; i++ )
+    {
+        w[ i ] = ( ( uint32_t )block[ 4 * i ] << 24 ) | ( ( uint32_t )block[ 4 * i + 1 ] << 16 ) |
+                 ( ( uint32_t )block[ 4 * i + 2 ] << 8 ) | block[ 4 * i + 3 ];
+    }
+    for ( ; i < 64; i++ )
+    {
+        w[ i ] = w[ i - 16 ] + ( ROTR32( w[ i - 15 ], 7 ) ^ ROTR32( w[ i - 15 ], 18 ) ^ ( w[ i - 15 ] >> 3 ) ) +
+                 w[ i - 7 ] + ( ROTR32( w[ i - 2 ], 17 ) ^ ROTR32( w[ i - 2 ], 19 ) ^ ( w[ i - 2 ] >> 10 ) );
+    }
+
+    a = sha->state[ 0 ];
+    b = sha->state[ 1 ];
+    c = sha->state[ 2 ];
+    d = sha->state[ 3 ];
+    e = sha->state[ 4 ];
+    f = sha->state[ 5 ];
+    g = sha->state[ 6 ];
+    h = sha->state[ 7 ];
+    for ( i = 0; i < 64; i++ )
+    {
+        t1 = h + ( ROTR32( e, 6 ) ^ ROTR32( e, 11 ) ^ ROTR32( e, 25 ) ) + ( ( e & f ) ^ ( ~e & g ) ) + sha256_k[ i ] + w[ i ];
+        t2 = ( ROTR32( a, 2 ) ^ ROTR32( a, 13 ) ^ ROTR32( a, 22 ) ) + ( ( a & b ) ^ ( a & c ) ^ ( b & c ) );
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    sha->state[ 0 ] += a;
+    sha->state[ 1 ] += b;
+    sha->state[ 2 ] += c;
+    sha->state[ 3 ] += d;
+    sha->state[ 4 ] += e;
+    sha->state[ 5 ] += f;
+    sha->state[ 6 ] += g;
+    sha->state[ 7 ] += h;
+}
+
 /**
  * @} tls
  */
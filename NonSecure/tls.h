@@ -23,12 +23,26 @@
 #include "os.h"
 #include "eelcodes.h"
 #include "dmm.h"
+#include "pool.h"
 #include "log.h"
 #include "modem.h"
 
 /***************************************************************************************************************************
  * Public constants and macros
  */
+#define TLS_CIPHER_MAX                  ( 4 )           /*!< cipher suites offered per host */
+#define TLS_POLICY_COUNT                ( 4 )           /*!< hosts with their own cipher suites */
+#define TLS_BLOB_CA                     "tls-ca"        /*!< blobs that take the place of the compiled-in credentials */
+#define TLS_BLOB_CERT                   "tls-cert"
+#define TLS_BLOB_KEY                    "tls-key"
+
+#ifndef TLS_CIPHER_DEFAULT
+#define TLS_CIPHER_DEFAULT              ( 0xC027 )      /*!< TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256, hosts without a policy */
+#endif
+
+#ifndef TLS_BENCHMARK_ENABLED
+#define TLS_BENCHMARK_ENABLED           ( 0 )           /*!< set to 1 to build tls.Benchmark() */
+#endif
 
 /***************************************************************************************************************************
  * Public data structures and typedefs
@@ -40,11 +54,23 @@ typedef enum
     tag_mtls                = 0x00bad5d8,       // 12244440,
 } tls_tag_t;
 
+typedef enum
+{
+    tls_handshake_unknown   = 0,                /*!< modem does not report how the session was set up */
+    tls_handshake_full,                         /*!< full handshake with certificate exchange */
+    tls_handshake_resumed,                      /*!< session resumed from the modem's session cache */
+} tls_handshake_t;
+
 typedef struct
 {
     error_code_module_t ( *Init )( void );
-    int32_t ( *Setup )( int32_t socket, const char *host_name, tls_tag_t tag );
+    int32_t ( *Setup )( int32_t socket, const char *host_name, tls_tag_t tag, bool session_cache );
+    tls_handshake_t ( *Handshake )( int32_t socket );
+    error_code_module_t ( *Policy )( const char *host_name, const uint16_t *ciphers, uint32_t count );
     int32_t ( *Dump )( void );
+#if TLS_BENCHMARK_ENABLED
+    void ( *Benchmark )( const char *host_name, uint16_t port, uint32_t runs );
+#endif
 } const tls_interface_t;
 
 /***************************************************************************************************************************
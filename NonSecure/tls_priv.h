@@ -20,12 +20,22 @@
  */
 
 #include "tls.h"
+#include "fs.h"
 
 /***************************************************************************************************************************
  * Private constants and macros
  */
 #define ARRAY_SIZE( arr )    ( sizeof( arr ) / sizeof( ( arr )[ 0 ] ) )
 #define SCRATCH_SIZE         ( 1500 )
+#define SHA256_SIZE          ( 32 )
+#define SHA256_BLOCK_SIZE    ( 64 )
+#define SHA256_HEX_SIZE      ( 2 * SHA256_SIZE + 1 )
+#define ROTR32( x, n )       ( ( ( x ) >> ( n ) ) | ( ( x ) << ( 32 - ( n ) ) ) )
+#define HOST_NAME_MAX        ( 64 )
+#if TLS_BENCHMARK_ENABLED
+#define TLS_BENCH_TIMEOUT    ( 5000 )       /*!< connect, send and receive time-out */
+#define TLS_BENCH_RECEIVE    ( 2000 )       /*!< wait for more response data before the download counts as done */
+#endif
 
 /***************************************************************************************************************************
  * Private data structures and typedefs
@@ -53,10 +63,52 @@ typedef struct {
     bool supported;
 } cipher_suite_t;
 
+/*
+ * @note
+ * The modem keeps a SHA-256 digest of every stored credential and lists it with AT%CMNG=1. At boot each compiled-in
+ * credential is hashed and compared with that digest; only credentials that differ (or are missing) are written, and
+ * the modem is only taken offline (AT+CFUN=0, which writing needs) when there is something to write. Credentials are
+ * written exactly as compiled in, so the digest of the next boot matches. A credential stored in the mapped blob store
+ * (TLS_BLOB_CA and so on, see fs.BlobStore) takes the place of the compiled-in one; it is hashed and written straight
+ * from flash, and tls.Dump prints it in place.
+ */
+typedef struct
+{
+    tls_tag_t                   tag;
+    tls_cred_type_t             type;
+    const char                  *data;          /*!< PEM, null-terminated */
+    const char                  *name;
+    const char                  *blob;          /*!< blob that takes the place of data when stored */
+} tls_credential_t;
+
+typedef struct
+{
+    uint32_t                    state[ 8 ];
+    uint8_t                     block[ SHA256_BLOCK_SIZE ];
+    uint32_t                    block_length;
+    uint32_t                    length;         /*!< bytes hashed */
+} tls_sha256_t;
+
+/*
+ * @note
+ * Each connect offers the cipher suites of the host's policy (tls.Policy), or TLS_CIPHER_DEFAULT for hosts without one.
+ * The modem socket API has no option for the ECDHE curve, so the curve is left to the modem and the server. With
+ * TLS_BENCHMARK_ENABLED, tls.Benchmark connects to a host once per ECDHE suite of cipher_suites, with session caching
+ * off so every handshake is a full one, and reports handshake time, data counted by the modem (AT%XCONNSTAT, whole
+ * kilobytes) and the download rate of an HTTP GET over the connection.
+ */
+typedef struct
+{
+    char                        host_name[ HOST_NAME_MAX ];
+    uint16_t                    ciphers[ TLS_CIPHER_MAX ];
+    uint32_t                    count;          /*!< 0: entry unused */
+} tls_policy_t;
+
 typedef struct
 {
     bool                        is_init;
     bool                        always_provision;
+    tls_policy_t                policy[ TLS_POLICY_COUNT ];
 } tls_obj_t;
 
 /***************************************************************************************************************************
@@ -75,13 +127,30 @@ static error_code_module_t tls_Init( void );
 
 /**
  * @brief       TLS/mTLS handshake setup.
- * @param[in]   socket       Socket file descriptor.
- * @param[in]   host_name    Host-name of the server.
- * @param[in]   tag          Security tag (RootCA, public cert, private key).
+ * @param[in]   socket          Socket file descriptor.
+ * @param[in]   host_name       Host-name of the server.
+ * @param[in]   tag             Security tag (RootCA, public cert, private key).
+ * @param[in]   session_cache   Let the modem cache the session and resume it on the next connect.
  * @return:     x == 0 , no error
  *              x != 0 , error number
  */
-static int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag );
+static int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag, bool session_cache );
+
+/**
+ * @brief       Tell how the handshake of a connected socket was done.
+ * @param[in]   socket       Socket file descriptor.
+ * @return      Full handshake, resumed session, or unknown if the modem library cannot tell.
+ */
+static tls_handshake_t tls_Handshake( int32_t socket );
+
+/**
+ * @brief       Set the cipher suites offered to a host, most preferred first.
+ * @param[in]   host_name    Host-name of the server.
+ * @param[in]   ciphers      IANA cipher suite values.
+ * @param[in]   count        Number of ciphers (at most TLS_CIPHER_MAX), 0 to go back to TLS_CIPHER_DEFAULT.
+ * @return      Error code, ERROR_TLS_FULL when TLS_POLICY_COUNT hosts already have a policy.
+ */
+static error_code_module_t tls_Policy( const char *host_name, const uint16_t *ciphers, uint32_t count );
 
 /**
  * @brief       TLS/mTLS certificates dump.
@@ -89,6 +158,16 @@ static int32_t tls_Setup( int32_t socket, const char *host_name, tls_tag_t tag )
  *              x != 0 , error number
  */
 static int32_t tls_Dump( void );
+#if TLS_BENCHMARK_ENABLED
+
+/**
+ * @brief       Connect to a host with each ECDHE cipher suite and compare full handshakes and download rate.
+ * @param[in]   host_name    Host-name of the server.
+ * @param[in]   port         Server port (443 for the download rate to mean anything).
+ * @param[in]   runs         Connects per cipher suite.
+ */
+static void tls_Benchmark( const char *host_name, uint16_t port, uint32_t runs );
+#endif
 
 /***************************************************************************************************************************
  * Private prototypes
@@ -101,14 +180,14 @@ static int32_t tls_Dump( void );
 static int32_t tls_Cmee( bool enable );
 
 /**
- * @brief       Check if credentials exist in modem
+ * @brief       Get the digest the modem keeps of a stored credential
  * @param[in]   tag         Credential security tag
  * @param[in]   type        Credential type
- * @param[out]  exists      Credential exists? (true = yes, false = no)
+ * @param[out]  digest      SHA-256 in hexadecimal (SHA256_HEX_SIZE), empty if the credential does not exist
  */
-static int32_t tls_KeyExists( tls_tag_t tag,
+static int32_t tls_KeyDigest( tls_tag_t tag,
                               tls_cred_type_t type,
-                              bool *exists );
+                              char *digest );
 
 static int32_t tls_WriteKey( tls_tag_t tag,
                              tls_cred_type_t type,
@@ -125,6 +204,26 @@ static int32_t tls_ReadKey( tls_tag_t tag,
 
 static void tls_PrintCredential( char *buf, size_t len );
 
+/**
+ * @brief       Print a PEM credential line by line where it lies, with no copy
+ * @param[in]   data        Credential, need not be null-terminated
+ * @param[in]   length      Length of data
+ */
+static void tls_PrintPem( const char *data, size_t length );
+
+/**
+ * @brief       SHA-256 in upper case hexadecimal, as listed by AT%CMNG=1
+ * @param[in]   data        Bytes to hash
+ * @param[in]   length      Length of data
+ * @param[out]  digest      Digest (SHA256_HEX_SIZE)
+ */
+static void tls_Digest( const char *data, size_t length, char *digest );
+static void tls_Sha256Block( tls_sha256_t *sha, const uint8_t *block );
+static tls_policy_t *tls_FindPolicy( const char *host_name );
+#if TLS_BENCHMARK_ENABLED
+static bool tls_ConnStat( uint32_t *sent_kb, uint32_t *received_kb );
+#endif
+
 #endif /* __TLS_PRIV_H__ */
 
 /**
@@ -0,0 +1,154 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ * @file      transport.c
+ * @brief     Buffered transport module
+ * @details   Read-ahead buffering for any TransportInterface_t.
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @defgroup Transport Buffered transport
+ * @brief     Buffered transport adapter
+ * @{
+ */
+
+/*************************************************************************************************************************************
+ * Includes
+*/
+#include "transport_priv.h"
+
+/***************************************************************************************************************************
+ * Global variables
+ */
+
+transport_interface_t transport =
+{
+    .Wrap               = &transport_Wrap,
+    .Reset              = &transport_Reset,
+    .Report             = &transport_Report,
+};
+
+/*************************************************************************************************************************************
+ * Public Functions Definition
+ */
+
+error_code_module_t transport_Wrap( TransportInterface_t *buffered, transport_buffer_t *state, const TransportInterface_t *lower, uint8_t *buffer, size_t size )
+{
+    error_code_module_t error = NO_ERROR;
+
+    if ( buffered == NULL || state == NULL || lower == NULL || lower->recv == NULL || lower->send == NULL || buffer == NULL || size == 0 )
+    {
+        error = ERROR_TRANSPORT_BAD_PARAM;
+    }
+    else
+    {
+        state->lower = *lower;
+        state->buffer = buffer;
+        state->size = size;
+        memset( &state->stats, 0, sizeof( state->stats ) );
+        transport_Reset( state );
+
+        buffered->pNetworkContext = ( NetworkContext_t * ) state;
+        buffered->recv = transport_Receive;
+        buffered->send = transport_Send;
+        buffered->writev = ( lower->writev != NULL ) ? transport_Writev : NULL;
+    }
+
+    return error;
+}
+
+void transport_Reset( transport_buffer_t *state )
+{
+    state->head = 0;
+    state->tail = 0;
+}
+
+void transport_Report( const transport_buffer_t *state, uint32_t packets )
+{
+    Log.Print( "Transport reads: %d requested, %d socket calls, %d bytes\r\n",
+               state->stats.recv_calls,
+               state->stats.lower_recv_calls,
+               state->stats.recv_bytes );
+    Log.Print( "Transport writes: %d requested, %d socket calls\r\n",
+               state->stats.send_calls,
+               state->stats.lower_send_calls );
+    if ( packets != 0 )
+    {
+        Log.Print( "Packets received: %d, socket reads per packet: %d.%02d\r\n",
+                   packets,
+                   state->stats.lower_recv_calls / packets,
+                   ( state->stats.lower_recv_calls * 100 / packets ) % 100 );
+    }
+}
+
+int32_t transport_Receive( NetworkContext_t *context, void *buffer, size_t size )
+{
+    transport_buffer_t *state = &context->state;
+    int32_t result;
+    size_t available = state->tail - state->head;
+
+    state->stats.recv_calls++;
+    if ( available == 0 )
+    {
+        state->stats.lower_recv_calls++;
+        if ( size >= state->size )
+        {
+            // large read: bypass the read-ahead buffer
+            result = state->lower.recv( state->lower.pNetworkContext, buffer, size );
+            if ( result > 0 )
+            {
+                state->stats.recv_bytes += result;
+            }
+            return result;
+        }
+
+        // refill the read-ahead buffer with one large read
+        result = state->lower.recv( state->lower.pNetworkContext, state->buffer, state->size );
+        if ( result <= 0 )
+        {
+            return result;
+        }
+        state->head = 0;
+        state->tail = result;
+        available = result;
+    }
+
+    // serve the read from memory
+    if ( size > available )
+    {
+        size = available;
+    }
+    memcpy( buffer, &state->buffer[ state->head ], size );
+    state->head += size;
+    state->stats.recv_bytes += size;
+
+    return size;
+}
+
+int32_t transport_Send( NetworkContext_t *context, const void *buffer, size_t size )
+{
+    transport_buffer_t *state = &context->state;
+
+    state->stats.send_calls++;
+    state->stats.lower_send_calls++;
+    return state->lower.send( state->lower.pNetworkContext, buffer, size );
+}
+
+int32_t transport_Writev( NetworkContext_t *context, TransportOutVector_t *iov, size_t count )
+{
+    transport_buffer_t *state = &context->state;
+
+    state->stats.send_calls++;
+    state->stats.lower_send_calls++;
+    return state->lower.writev( state->lower.pNetworkContext, iov, count );
+}
+
+/**
+ * @} Transport
+ */
+
+/**
+ * @} Application
+ */
@@ -0,0 +1,88 @@
+/**
+ * @addtogroup Application Application
+ * @{
+ *
+ * @file      transport.h
+ * @brief     Buffered transport module (public header).
+ * @author    Johnas Cukier
+ * @date      May 2023
+ */
+
+/**
+ * @addtogroup Transport
+ * @{
+ */
+#ifndef __TRANSPORT_H__
+#define __TRANSPORT_H__
+
+/***************************************************************************************************************************
+ * Includes
+ */
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include "transport_interface.h"
+#include "os.h"
+#include "app.h"
+#include "log.h"
+#include "eelcodes.h"
+
+/***************************************************************************************************************************
+ * Public constants and macros
+ */
+#define TRANSPORT_READ_AHEAD_SIZE       ( MEDIUM_MSG_MAX )
+
+/***************************************************************************************************************************
+ * Public data structures and typedefs
+ */
+
+/**
+ * @brief Transport call statistics, used to measure how many socket calls each packet costs.
+ */
+typedef struct
+{
+    uint32_t    recv_calls;             /*!< reads requested by the protocol library */
+    uint32_t    lower_recv_calls;       /*!< reads passed on to the underlying transport */
+    uint32_t    recv_bytes;             /*!< bytes delivered to the protocol library */
+    uint32_t    send_calls;             /*!< writes requested by the protocol library */
+    uint32_t    lower_send_calls;       /*!< writes passed on to the underlying transport */
+} transport_stats_t;
+
+/**
+ * @brief Read-ahead state of one buffered connection.
+ */
+typedef struct
+{
+    TransportInterface_t        lower;          /*!< underlying (unbuffered) transport */
+    uint8_t                     *buffer;        /*!< read-ahead buffer */
+    size_t                      size;           /*!< size of read-ahead buffer */
+    size_t                      head;           /*!< next buffered byte to hand out */
+    size_t                      tail;           /*!< end of buffered data */
+    transport_stats_t           stats;
+} transport_buffer_t;
+
+/**
+ * Specifies the public interface functions of the buffered transport.
+ */
+typedef struct
+{
+    error_code_module_t ( *Wrap )( TransportInterface_t *buffered, transport_buffer_t *state, const TransportInterface_t *lower, uint8_t *buffer, size_t size );
+    void ( *Reset )( transport_buffer_t *state );
+    void ( *Report )( const transport_buffer_t *state, uint32_t packets );
+} const transport_interface_t;
+
+/***************************************************************************************************************************
+ * Public variables
+ */
+
+extern transport_interface_t transport;
+
+#endif /* __TRANSPORT_H__ */
+
+/**
+ * @} Transport
+ */
+
+/**
+ * @} Applicaton
+ */
@@ -0,0 +1,105 @@
+/** @file transport_priv.h
+ *
+ * @brief       Buffered transport module (private header).
+ * @author      Johnas Cukier
+ * @date        May 2023
+ *
+ */
+
+/**
+ * @addtogroup Transport
+ * @{
+ */
+
+#ifndef __TRANSPORT_PRIV_H__
+#define __TRANSPORT_PRIV_H__
+
+/*
+ * @note
+ * coreMQTT reads an incoming packet in small pieces: one byte for the packet type, one byte per remaining-length byte
+ * and then the body. Passed straight to the socket, a PUBACK costs three to four socket calls. The buffered transport
+ * sits between the protocol library and any TransportInterface_t: when its read-ahead buffer is empty it fills it with
+ * one large read, and serves the small reads from memory. Reads at least as large as the buffer bypass it, so large
+ * payloads are not copied twice. Writes, including vectored writes when the underlying transport provides them, are
+ * passed through unchanged.
+ */
+
+/***************************************************************************************************************************
+ * Includes
+ */
+
+#include "transport.h"
+
+/***************************************************************************************************************************
+ * Private constants and macros
+ */
+
+/***************************************************************************************************************************
+ * Private data structures and typedefs
+ */
+
+/**
+ * @brief Network context of the buffered transport: the read-ahead state of the connection, which holds the underlying
+ *        transport. The network context of the underlying transport is left to that transport.
+ */
+struct NetworkContext
+{
+    transport_buffer_t          state;          /*!< must stay the first member, Wrap hands out its address */
+};
+
+/***************************************************************************************************************************
+ * Private variables
+ */
+
+/***************************************************************************************************************************
+ * Private prototypes (interface functions)
+ */
+
+/**
+ * @brief       Set up a buffered transport on top of another transport.
+ * @param[out]  buffered    Transport interface to hand to the protocol library.
+ * @param[in]   state       Read-ahead state of the connection (must stay valid while the transport is in use).
+ * @param[in]   lower       Underlying transport, copied into the read-ahead state; its network context is not changed.
+ * @param[in]   buffer      Read-ahead buffer.
+ * @param[in]   size        Size of read-ahead buffer in bytes.
+ * @return      Error code.
+ */
+static error_code_module_t transport_Wrap( TransportInterface_t *buffered, transport_buffer_t *state, const TransportInterface_t *lower, uint8_t *buffer, size_t size );
+
+/**
+ * @brief       Drop buffered data (call when the underlying connection is re-established).
+ * @param[in]   state       Read-ahead state of the connection.
+ */
+static void transport_Reset( transport_buffer_t *state );
+
+/**
+ * @brief       Print transport call statistics.
+ * @param[in]   state       Read-ahead state of the connection.
+ * @param[in]   packets     Number of packets received, to report calls per packet.
+ */
+static void transport_Report( const transport_buffer_t *state, uint32_t packets );
+
+/***************************************************************************************************************************
+ * Private prototypes
+ */
+
+/**
+ * @brief       Receive function of the buffered transport (see TransportRecv_t).
+ */
+static int32_t transport_Receive( NetworkContext_t *context, void *buffer, size_t size );
+
+/**
+ * @brief       Send function of the buffered transport (see TransportSend_t).
+ */
+static int32_t transport_Send( NetworkContext_t *context, const void *buffer, size_t size );
+
+/**
+ * @brief       Vectored send function of the buffered transport (see TransportWritev_t).
+ */
+static int32_t transport_Writev( NetworkContext_t *context, TransportOutVector_t *iov, size_t count );
+
+#endif /* __TRANSPORT_PRIV_H__ */
+
+/**
+ * @}
+ */
@@ -208,16 +208,22 @@ void twdt_List( void )
 {
     uint32_t i;
     shared_struct_t *shared_struct = ( shared_struct_t *)shared_mem;
-    TaskHandle_t task_handle[ MAX_TASKS ];
+    TaskHandle_t *task_handle = OS_MAILBOX_ALLOC( app.GetCliQHandle(), TaskHandle_t, QUEUE_WAIT_TIME );
 
-    memset( task_handle, NULL, sizeof( task_handle ) );
+    if ( task_handle == NULL )
+    {
+        return;
+    }
+
+    memset( task_handle, NULL, MAX_TASKS * sizeof( TaskHandle_t ) );
     for ( i = 0; shared_struct->task_status[ i ].handle != NULL && i < MAX_TASKS; i++ )
     {
         task_handle[ i ] = shared_struct->task_status[ i ].handle;
     }
-    if ( !os.QueueSend( app.GetCliQHandle(), task_handle, os.Ms2Ticks( QUEUE_WAIT_TIME ) ) )
+    if ( !os.MailboxSend( app.GetCliQHandle(), task_handle, QUEUE_WAIT_TIME ) )
     {
         /* Message failed to send */
+        os.MailboxFree( app.GetCliQHandle(), task_handle );
     }
 }
 
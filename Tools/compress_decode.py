@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Decode payloads compressed by the firmware compress module (NonSecure/compress.c).
+
+A compressed payload starts with the marker 0x1e and a byte holding the window bits (high nibble) and the lookahead
+bits (low nibble), followed by an LZSS bit stream, most significant bit first:
+    1, 8 bits                           literal byte
+    0, window bits, lookahead bits      distance - 1 and length - 1 of a copy of earlier output
+Payloads without the marker are returned unchanged.
+
+Usage: compress_decode.py [input [output]]  (stdin and stdout by default)
+"""
+
+import sys
+
+MARKER = 0x1E
+HEADER_SIZE = 2
+
+
+def is_compressed(data: bytes) -> bool:
+    return len(data) >= HEADER_SIZE and data[0] == MARKER
+
+
+def decode(data: bytes) -> bytes:
+    if not is_compressed(data):
+        return bytes(data)
+
+    window_bits = data[1] >> 4
+    lookahead_bits = data[1] & 0x0F
+    if lookahead_bits == 0 or window_bits < lookahead_bits or window_bits + lookahead_bits < 8:
+        raise ValueError("bad compression parameters")
+
+    position = HEADER_SIZE * 8
+    bit_length = len(data) * 8
+
+    def bits(count):
+        nonlocal position
+        value = 0
+        for _ in range(count):
+            value = (value << 1) | ((data[position >> 3] >> (7 - (position & 7))) & 1)
+            position += 1
+        return value
+
+    output = bytearray()
+    while position < bit_length:
+        if bits(1):
+            if bit_length - position < 8:
+                break
+            output.append(bits(8))
+        else:
+            if bit_length - position < window_bits + lookahead_bits:
+                break
+            distance = bits(window_bits) + 1
+            count = bits(lookahead_bits) + 1
+            if distance > len(output):
+                raise ValueError("copy before start of payload")
+            # Byte by byte, a copy may overlap its own output
+            for _ in range(count):
+                output.append(output[-distance])
+    return bytes(output)
+
+
+def main():
+    source = open(sys.argv[1], "rb") if len(sys.argv) > 1 else sys.stdin.buffer
+    target = open(sys.argv[2], "wb") if len(sys.argv) > 2 else sys.stdout.buffer
+    target.write(decode(source.read()))
+
+
+if __name__ == "__main__":
+    main()